@@ -0,0 +1,120 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Measures the throughput of format conversions at every vector instruction
+// set level supported by the CPU. Build with CMAKE_BUILD_TYPE=Release.
+
+#include <chrono>
+#include <cstdio>
+#include <imgio/image.h>
+#include <imgio/simd.h>
+
+using namespace ImgIO;
+
+namespace
+{
+
+const int kIterations = 50;
+
+// Prints the conversion speed at each supported level.
+void benchmark(const Image& aImage, const char* aName, ColorSpec::Format aFormat, ColorSpec::ChannelDepth aDepth)
+{
+    const int maxLevel = static_cast<int>(Simd::supportedLevel());
+
+    std::printf("%-24s", aName);
+    for (int level = 0; level <= maxLevel; ++level) {
+        Simd::setLevel(static_cast<Simd::Level>(level));
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kIterations; ++i) {
+            Image converted = aImage.convertedTo(aFormat, aDepth);
+            asm volatile("" : : "r"(converted.data()) : "memory");
+        }
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+        std::printf(" %10.1f", static_cast<double>(aImage.width()) * aImage.height() * kIterations / time.count() / 1e6);
+    }
+    std::printf("\n");
+}
+
+} // namespace
+
+int main()
+{
+    const unsigned int width = 1920;
+    const unsigned int height = 1080;
+
+    const struct {
+        ColorSpec::Format format;
+        ColorSpec::ChannelDepth depth;
+        const char* name;
+    } formats[] = {
+        {ColorSpec::Format::kMonochromatic, ColorSpec::ChannelDepth::k8Bit, "Mono8"},
+        {ColorSpec::Format::kMonochromatic, ColorSpec::ChannelDepth::k16Bit, "Mono16"},
+        {ColorSpec::Format::kMonochromaticAlpha, ColorSpec::ChannelDepth::k8Bit, "MonoAlpha8"},
+        {ColorSpec::Format::kMonochromaticAlpha, ColorSpec::ChannelDepth::k16Bit, "MonoAlpha16"},
+        {ColorSpec::Format::kRGB, ColorSpec::ChannelDepth::k8Bit, "RGB8"},
+        {ColorSpec::Format::kRGB, ColorSpec::ChannelDepth::k16Bit, "RGB16"},
+        {ColorSpec::Format::kRGBA, ColorSpec::ChannelDepth::k8Bit, "RGBA8"},
+        {ColorSpec::Format::kRGBA, ColorSpec::ChannelDepth::k16Bit, "RGBA16"},
+    };
+    const char* levelNames[] = {"scalar", "SSE2", "SSSE3", "AVX2"};
+    const int maxLevel = static_cast<int>(Simd::supportedLevel());
+
+    std::printf("%-24s", "MPix/s");
+    for (int level = 0; level <= maxLevel; ++level)
+        std::printf(" %10s", levelNames[level]);
+    std::printf("\n");
+
+    for (const auto& src : formats) {
+        Image image(width, height, src.format, src.depth);
+        for (size_t y = 0; y < height; ++y)
+            for (size_t x = 0; x < image.stride(); ++x)
+                image.data()[y * image.stride() + x] = static_cast<uint8_t>(x * 7 + y);
+
+        for (const auto& dest : formats) {
+            if (&src == &dest)
+                continue;
+
+            char name[32];
+            std::snprintf(name, sizeof(name), "%s->%s", src.name, dest.name);
+            benchmark(image, name, dest.format, dest.depth);
+        }
+    }
+
+    // Indexed images expand through a palette with all 256 colors
+    Image indexed(width, height, ColorSpec::Format::kIndexed);
+    for (size_t y = 0; y < height; ++y)
+        for (size_t x = 0; x < indexed.stride(); ++x)
+            indexed.data()[y * indexed.stride() + x] = static_cast<uint8_t>(x * 7 + y);
+    Palette palette(256);
+    for (size_t i = 0; i < palette.size(); ++i)
+        palette[i] = PaletteColor{static_cast<uint8_t>(i), static_cast<uint8_t>(i * 3), static_cast<uint8_t>(i * 5), 0xff};
+    indexed.setPalette(palette);
+
+    for (const auto& dest : formats) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "Indexed8->%s", dest.name);
+        benchmark(indexed, name, dest.format, dest.depth);
+    }
+
+    Simd::setLevel(Simd::supportedLevel());
+    return 0;
+}
@@ -0,0 +1,67 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// Measures the cost of copying an image. Copies share the pixel buffer,
+// so the time per copy should not depend on the image size.
+
+#include <chrono>
+#include <cstdio>
+#include <imgio/image.h>
+
+using namespace ImgIO;
+
+int main()
+{
+    const unsigned int sizes[][2] = {{64, 64}, {512, 512}, {1920, 1080}, {4000, 3000}, {8000, 6000}};
+    const int iterations = 100000;
+
+    std::printf("%12s %12s %14s %14s\n", "size", "bytes", "copy [ns]", "detach [us]");
+
+    for (const auto& size : sizes) {
+        Image image(size[0], size[1], ColorSpec::Format::kRGBA, ColorSpec::ChannelDepth::k8Bit);
+        size_t bytes = static_cast<size_t>(size[0]) * size[1] * 4;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            const Image copy(image);
+            asm volatile("" : : "r"(copy.data()) : "memory");
+        }
+        auto copyTime = std::chrono::steady_clock::now() - start;
+
+        // A mutable access to a copy pays for the full buffer copy once.
+        Image copy(image);
+        start = std::chrono::steady_clock::now();
+        copy.data()[0] = 0;
+        auto detachTime = std::chrono::steady_clock::now() - start;
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "%ux%u", size[0], size[1]);
+        std::printf("%12s %12zu %14.1f %14.1f\n",
+                    name,
+                    bytes,
+                    std::chrono::duration<double, std::nano>(copyTime).count() / iterations,
+                    std::chrono::duration<double, std::micro>(detachTime).count());
+    }
+
+    return 0;
+}
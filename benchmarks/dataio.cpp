@@ -0,0 +1,113 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Measures decoding and encoding 2000x1500 and 256x256 PNG and JPEG images
+// through std::stringstream against memory buffers, to show what the I/O
+// layer costs on top of the codecs. Build with CMAKE_BUILD_TYPE=Release.
+
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <imgio/imageio.h>
+
+using namespace ImgIO;
+
+int main()
+{
+    const struct {
+        unsigned int width;
+        unsigned int height;
+        int iterations;
+    } sizes[] = {
+        {2000, 1500, 10},
+        {256, 256, 500},
+    };
+    const struct {
+        ImageIO::ImageFormat format;
+        const char* name;
+    } formats[] = {
+        {ImageIO::ImageFormat::kPng, "PNG"},
+        {ImageIO::ImageFormat::kJpeg, "JPEG"},
+    };
+
+    std::printf("RGB, MPix/s\n");
+    std::printf("%-24s %10s %10s\n", "", "stream", "memory");
+
+    for (const auto& size : sizes) {
+        Image image(size.width, size.height, ColorSpec::Format::kRGB);
+        uint8_t* data = image.data();
+        for (unsigned int y = 0; y < size.height; ++y)
+            for (unsigned int x = 0; x < size.width * 3; ++x)
+                data[y * image.stride() + x] = static_cast<uint8_t>((x / 3 + y) / 8 + (x % 3) * 40 + ((x * y) % 5));
+        double pixels = static_cast<double>(size.width) * size.height * size.iterations;
+
+        for (const auto& format : formats) {
+            std::ostringstream encoded;
+            ImageIO::write(image, encoded, format.format);
+            std::string file = encoded.str();
+            std::vector<uint8_t> buffer(ImageIO::maxEncodedSize(image, format.format));
+
+            char name[64];
+            std::snprintf(name, sizeof(name), "%ux%u %s decode", size.width, size.height, format.name);
+            std::printf("%-24s", name);
+            for (int memory = 0; memory < 2; ++memory) {
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < size.iterations; ++i) {
+                    Image decoded;
+                    if (memory) {
+                        decoded = ImageIO::read(reinterpret_cast<const uint8_t*>(file.data()), file.size(),
+                                                format.format, ColorSpec::Format::kRGB);
+                    } else {
+                        std::istringstream stream(file);
+                        decoded = ImageIO::read(stream, format.format, ColorSpec::Format::kRGB);
+                    }
+                    asm volatile("" : : "r"(decoded.data()) : "memory");
+                }
+                std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+                std::printf(" %10.1f", pixels / time.count() / 1e6);
+            }
+            std::printf("\n");
+
+            std::snprintf(name, sizeof(name), "%ux%u %s encode", size.width, size.height, format.name);
+            std::printf("%-24s", name);
+            for (int memory = 0; memory < 2; ++memory) {
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < size.iterations; ++i) {
+                    if (memory) {
+                        ImageIO::write(image, buffer.data(), buffer.size(), format.format);
+                    } else {
+                        std::ostringstream stream;
+                        ImageIO::write(image, stream, format.format);
+                    }
+                    asm volatile("" : : "r"(buffer.data()) : "memory");
+                }
+                std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+                std::printf(" %10.1f", pixels / time.count() / 1e6);
+            }
+            std::printf("\n");
+        }
+    }
+
+    return 0;
+}
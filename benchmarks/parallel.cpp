@@ -0,0 +1,75 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Measures how format conversion and the copy of a cropped view scale with
+// the number of threads. Build with CMAKE_BUILD_TYPE=Release.
+
+#include <chrono>
+#include <cstdio>
+#include <imgio/image.h>
+#include <imgio/parallelism.h>
+
+using namespace ImgIO;
+
+template <class Function>
+static double megapixelsPerSecond(size_t aPixelsCount, int aIterations, Function aFunction)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < aIterations; ++i)
+        aFunction();
+    std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(aPixelsCount) * aIterations / time.count() / 1e6;
+}
+
+int main()
+{
+    const unsigned int width = 12000;
+    const unsigned int height = 9000;
+    const int iterations = 5;
+
+    Image image(width, height, ColorSpec::Format::kRGB, ColorSpec::ChannelDepth::k8Bit);
+    for (size_t y = 0; y < height; ++y)
+        for (size_t x = 0; x < image.stride(); ++x)
+            image.data()[y * image.stride() + x] = static_cast<uint8_t>(x * 7 + y);
+
+    std::printf("%d hardware threads, %ux%u RGB8, MPix/s\n", Parallelism::hardwareThreadsCount(), width, height);
+    std::printf("%8s %16s %16s\n", "threads", "RGB8->RGBA16", "crop copy");
+
+    for (unsigned int threads = 1; threads <= Parallelism::hardwareThreadsCount(); ++threads) {
+        Parallelism::setThreadsCount(threads);
+
+        double convert = megapixelsPerSecond(static_cast<size_t>(width) * height, iterations, [&image] {
+            Image converted = image.convertedTo(ColorSpec::Format::kRGBA, ColorSpec::ChannelDepth::k16Bit);
+            asm volatile("" : : "r"(converted.data()) : "memory");
+        });
+
+        double crop = megapixelsPerSecond(static_cast<size_t>(width - 2) * (height - 2), iterations, [&image] {
+            Image cropped = image.cropped(1, 1, width - 2, height - 2);
+            asm volatile("" : : "r"(cropped.data()) : "memory");
+        });
+
+        std::printf("%8u %16.1f %16.1f\n", threads, convert, crop);
+    }
+
+    Parallelism::setThreadsCount(0);
+    return 0;
+}
@@ -0,0 +1,147 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+// Compares transcoding through a Pipeline with the materializing path
+// (read, cropped, resized, convertedTo, write), in milliseconds per
+// transcode, and reports the peak resident set size of each.
+// Build with CMAKE_BUILD_TYPE=Release.
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <sstream>
+#include <vector>
+#include <sys/resource.h>
+#include <imgio/imageio.h>
+#include <imgio/pipeline.h>
+
+using namespace ImgIO;
+
+namespace
+{
+
+struct Transcode
+{
+    const char* name;
+    ImageIO::ImageFormat inputFormat;
+    ImageIO::ImageFormat outputFormat;
+    unsigned int cropX;
+    unsigned int cropY;
+    unsigned int cropWidth;
+    unsigned int cropHeight;
+    unsigned int width;
+    unsigned int height;
+};
+
+// Upscales a small pattern through a pipeline, so that preparing the
+// source doesn't inflate the peak RSS.
+std::string encode(ColorSpec::Format aFormat, ImageIO::ImageFormat aImageFormat)
+{
+    Image image(800, 600, aFormat, ColorSpec::ChannelDepth::k8Bit);
+    size_t rowSize = image.width() * ColorSpec::channelCount(aFormat);
+    for (size_t y = 0; y < image.height(); ++y) {
+        uint8_t* row = image.data() + y * image.stride();
+        for (size_t i = 0; i < rowSize; ++i)
+            row[i] = static_cast<uint8_t>((i / 7 + y / 5) ^ (i * y / 4096));
+    }
+
+    std::ostringstream pattern;
+    ImageIO::write(image, pattern, ImageIO::ImageFormat::kPng);
+
+    std::istringstream input(pattern.str());
+    std::ostringstream output;
+    Pipeline().resize(4000, 3000, Image::ResizeFilter::kLanczos3)
+              .run(input, ImageIO::ImageFormat::kPng, output, aImageFormat);
+    return output.str();
+}
+
+long peakRssKb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+double milliseconds(const std::function<void()>& aFunction, int aIterations)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < aIterations; ++i)
+        aFunction();
+    std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+    return time.count() / aIterations;
+}
+
+} // namespace
+
+int main()
+{
+    const int iterations = 5;
+
+    const std::string jpeg = encode(ColorSpec::Format::kRGB, ImageIO::ImageFormat::kJpeg);
+    const std::string png = encode(ColorSpec::Format::kRGBA, ImageIO::ImageFormat::kPng);
+    std::vector<uint8_t> output(32 * 1024 * 1024);
+
+    const Transcode transcodes[] = {
+        {"jpeg crop+thumbnail", ImageIO::ImageFormat::kJpeg, ImageIO::ImageFormat::kJpeg, 1000, 750, 2000, 1500, 500, 375},
+        {"jpeg downscale", ImageIO::ImageFormat::kJpeg, ImageIO::ImageFormat::kJpeg, 0, 0, 4000, 3000, 1920, 1440},
+        {"png crop", ImageIO::ImageFormat::kPng, ImageIO::ImageFormat::kPng, 0, 0, 2000, 1000, 2000, 1000},
+    };
+
+    std::printf("4000x3000 source, single thread, ms per transcode\n");
+    std::printf("%-24s %12s %12s\n", "", "materialized", "pipeline");
+
+    // The pipeline goes first, so the peak RSS growth of the materializing
+    // path shows in the second figure.
+    double pipelineTimes[3];
+    for (size_t t = 0; t < 3; ++t) {
+        const Transcode& transcode = transcodes[t];
+        const std::string& input = (transcode.inputFormat == ImageIO::ImageFormat::kJpeg) ? jpeg : png;
+        Pipeline pipeline;
+        pipeline.crop(transcode.cropX, transcode.cropY, transcode.cropWidth, transcode.cropHeight)
+                .resize(transcode.width, transcode.height)
+                .convert(ColorSpec::Format::kRGB);
+        pipelineTimes[t] = milliseconds([&]() {
+            pipeline.run(reinterpret_cast<const uint8_t*>(input.data()), input.size(), transcode.inputFormat,
+                         output.data(), output.size(), transcode.outputFormat);
+        }, iterations);
+    }
+    long pipelineRss = peakRssKb();
+
+    for (size_t t = 0; t < 3; ++t) {
+        const Transcode& transcode = transcodes[t];
+        const std::string& input = (transcode.inputFormat == ImageIO::ImageFormat::kJpeg) ? jpeg : png;
+        double materializedTime = milliseconds([&]() {
+            Image image = ImageIO::read(reinterpret_cast<const uint8_t*>(input.data()), input.size(), transcode.inputFormat);
+            Image result = image.cropped(transcode.cropX, transcode.cropY, transcode.cropWidth, transcode.cropHeight)
+                                .resized(transcode.width, transcode.height, Image::ResizeFilter::kBilinear, 1)
+                                .convertedTo(ColorSpec::Format::kRGB, ColorSpec::ChannelDepth::k8Bit, 1);
+            ImageIO::write(result, output.data(), output.size(), transcode.outputFormat);
+        }, iterations);
+        std::printf("%-24s %12.1f %12.1f\n", transcode.name, materializedTime, pipelineTimes[t]);
+    }
+    long materializedRss = peakRssKb();
+
+    std::printf("%-24s %12.1f %12.1f\n", "peak RSS, MiB", materializedRss / 1024.0, pipelineRss / 1024.0);
+    return 0;
+}
@@ -0,0 +1,130 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Measures building 256x256 tile pyramids of a 4000x3000 image: resizing
+// the full size image for every level and cropping it against
+// TilePyramid, with tiles as views at every vector instruction set level
+// supported by the CPU, and encoded as JPEG. Build with
+// CMAKE_BUILD_TYPE=Release.
+
+#include <chrono>
+#include <cstdio>
+#include <imgio/parallelism.h>
+#include <imgio/pyramid.h>
+#include <imgio/simd.h>
+
+using namespace ImgIO;
+
+// Every level scaled from the full size image, then cut into tiles.
+static size_t naivePyramid(const Image& aImage, unsigned int aTileSize)
+{
+    size_t tilesCount = 0;
+    unsigned int levels = TilePyramid::levelsCount(aImage.width(), aImage.height());
+    for (unsigned int level = 0; level < levels; ++level) {
+        unsigned int width = std::max((aImage.width() >> level), 1u);
+        unsigned int height = std::max((aImage.height() >> level), 1u);
+        Image scaled = (level == 0) ? aImage : aImage.resized(width, height, Image::ResizeFilter::kBilinear, 1);
+        for (unsigned int y = 0; y < height; y += aTileSize) {
+            for (unsigned int x = 0; x < width; x += aTileSize) {
+                Image tile = scaled.cropped(x, y, aTileSize, aTileSize);
+                asm volatile("" : : "r"(tile.data()) : "memory");
+                ++tilesCount;
+            }
+        }
+    }
+    return tilesCount;
+}
+
+int main()
+{
+    const int iterations = 3;
+    const unsigned int width = 4000;
+    const unsigned int height = 3000;
+    const unsigned int tileSize = 256;
+
+    const struct {
+        ColorSpec::Format format;
+        ColorSpec::ChannelDepth depth;
+        const char* name;
+    } formats[] = {
+        {ColorSpec::Format::kMonochromatic, ColorSpec::ChannelDepth::k8Bit, "Mono8"},
+        {ColorSpec::Format::kRGB, ColorSpec::ChannelDepth::k8Bit, "RGB8"},
+        {ColorSpec::Format::kRGBAPremultiplied, ColorSpec::ChannelDepth::k8Bit, "RGBAPremul8"},
+        {ColorSpec::Format::kRGBA, ColorSpec::ChannelDepth::k8Bit, "RGBA8"},
+        {ColorSpec::Format::kRGB, ColorSpec::ChannelDepth::k16Bit, "RGB16"},
+    };
+    const char* levelNames[] = {"scalar", "SSE2", "SSSE3", "AVX2"};
+    const int maxLevel = static_cast<int>(Simd::supportedLevel());
+    TilePyramid pyramid(tileSize);
+
+    std::printf("%ux%u, %ux%u tiles, single thread, MPix/s of the full size image\n", width, height, tileSize, tileSize);
+    std::printf("%-16s %10s", "", "naive");
+    for (int level = 0; level <= maxLevel; ++level)
+        std::printf(" %10s", levelNames[level]);
+    std::printf("\n");
+
+    for (const auto& format : formats) {
+        Image image(width, height, format.format, format.depth);
+        uint8_t* data = image.data();
+        for (size_t i = 0; i < image.stride() * image.height(); ++i)
+            data[i] = static_cast<uint8_t>(i * 13);
+
+        std::printf("%-16s", format.name);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            naivePyramid(image, tileSize);
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+        std::printf(" %10.1f", static_cast<double>(width) * height * iterations / time.count() / 1e6);
+
+        for (int level = 0; level <= maxLevel; ++level) {
+            Simd::setLevel(static_cast<Simd::Level>(level));
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                pyramid.build(image, [](unsigned int, unsigned int, unsigned int, const Image& aTile) {
+                    asm volatile("" : : "r"(aTile.data()) : "memory");
+                });
+            }
+            time = std::chrono::steady_clock::now() - start;
+            std::printf(" %10.1f", static_cast<double>(width) * height * iterations / time.count() / 1e6);
+        }
+        std::printf("\n");
+    }
+    Simd::setLevel(Simd::supportedLevel());
+
+    Image image(width, height, ColorSpec::Format::kRGB);
+    uint8_t* data = image.data();
+    for (size_t i = 0; i < image.stride() * image.height(); ++i)
+        data[i] = static_cast<uint8_t>(i * 13);
+
+    std::printf("\nRGB8 JPEG tiles, MPix/s of the full size image\n");
+    for (unsigned int threads : {1u, Parallelism::hardwareThreadsCount()}) {
+        size_t bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        pyramid.build(image, ImageIO::ImageFormat::kJpeg, [&](unsigned int, unsigned int, unsigned int, const uint8_t*, size_t aLength) {
+            bytes += aLength;
+        }, threads);
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+        std::printf("%2u threads %10.1f (%zu bytes)\n", threads, static_cast<double>(width) * height / time.count() / 1e6, bytes);
+    }
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Measures decoding 4000x3000 PNG and JPEG files through an std::ifstream
+// against ImageIO::read() of the path, which maps the file and decodes it
+// in place. The files are written to the temporary directory and stay in
+// the page cache. Build with CMAKE_BUILD_TYPE=Release.
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <imgio/imageio.h>
+
+using namespace ImgIO;
+
+int main()
+{
+    const int iterations = 5;
+    const unsigned int width = 4000;
+    const unsigned int height = 3000;
+
+    Image image(width, height, ColorSpec::Format::kRGB);
+    uint8_t* data = image.data();
+    for (unsigned int y = 0; y < height; ++y)
+        for (unsigned int x = 0; x < width * 3; ++x)
+            data[y * image.stride() + x] = static_cast<uint8_t>((x / 3 + y) / 16 + (x % 3) * 40);
+
+    const struct {
+        ImageIO::ImageFormat format;
+        const char* name;
+    } formats[] = {
+        {ImageIO::ImageFormat::kPng, "PNG"},
+        {ImageIO::ImageFormat::kJpeg, "JPEG"},
+    };
+
+    std::printf("%ux%u RGB, MPix/s\n", width, height);
+    std::printf("%-8s %10s %10s\n", "", "ifstream", "path");
+
+    for (const auto& format : formats) {
+        std::string path = std::string("/tmp/benchmark_readfile.") + format.name;
+        {
+            std::ofstream file(path, std::ios::binary);
+            ImageIO::write(image, file, format.format);
+        }
+
+        std::printf("%-8s", format.name);
+        for (int mapped = 0; mapped < 2; ++mapped) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                Image decoded;
+                if (mapped) {
+                    decoded = ImageIO::read(path, format.format, ColorSpec::Format::kRGB);
+                } else {
+                    std::ifstream file(path, std::ios::binary);
+                    decoded = ImageIO::read(file, format.format, ColorSpec::Format::kRGB);
+                }
+                asm volatile("" : : "r"(decoded.data()) : "memory");
+            }
+            std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+            std::printf(" %10.1f", static_cast<double>(width) * height * iterations / time.count() / 1e6);
+        }
+        std::printf("\n");
+        std::remove(path.c_str());
+    }
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Measures resize() throughput, in source megapixels per second, for every
+// filter at every vector instruction set level supported by the CPU.
+// Build with CMAKE_BUILD_TYPE=Release.
+
+#include <chrono>
+#include <cstdio>
+#include <imgio/image.h>
+#include <imgio/simd.h>
+
+using namespace ImgIO;
+
+int main()
+{
+    const int iterations = 5;
+
+    const struct {
+        unsigned int width;
+        unsigned int height;
+        unsigned int destWidth;
+        unsigned int destHeight;
+    } sizes[] = {
+        {4000, 3000, 400, 300},
+        {4000, 3000, 1920, 1440},
+        {1920, 1080, 3840, 2160},
+    };
+    const struct {
+        Image::ResizeFilter filter;
+        const char* name;
+    } filters[] = {
+        {Image::ResizeFilter::kNearest, "nearest"},
+        {Image::ResizeFilter::kBilinear, "bilinear"},
+        {Image::ResizeFilter::kBicubic, "bicubic"},
+        {Image::ResizeFilter::kLanczos3, "lanczos3"},
+    };
+    const char* levelNames[] = {"scalar", "SSE2", "SSSE3", "AVX2"};
+    const int maxLevel = static_cast<int>(Simd::supportedLevel());
+
+    std::printf("RGBA8, single thread, source MPix/s\n");
+    std::printf("%-32s", "");
+    for (int level = 0; level <= maxLevel; ++level)
+        std::printf(" %10s", levelNames[level]);
+    std::printf("\n");
+
+    for (const auto& size : sizes) {
+        Image image(size.width, size.height, ColorSpec::Format::kRGBA, ColorSpec::ChannelDepth::k8Bit);
+        uint8_t* data = image.data();
+        for (size_t i = 0; i < image.stride() * image.height(); ++i)
+            data[i] = static_cast<uint8_t>(i * 13);
+
+        for (const auto& filter : filters) {
+            char name[64];
+            std::snprintf(name, sizeof(name), "%ux%u->%ux%u %s",
+                          size.width, size.height, size.destWidth, size.destHeight, filter.name);
+            std::printf("%-32s", name);
+
+            for (int level = 0; level <= maxLevel; ++level) {
+                Simd::setLevel(static_cast<Simd::Level>(level));
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < iterations; ++i) {
+                    Image resized = image.resized(size.destWidth, size.destHeight, filter.filter, 1);
+                    asm volatile("" : : "r"(resized.data()) : "memory");
+                }
+                std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+                std::printf(" %10.1f", static_cast<double>(size.width) * size.height * iterations / time.count() / 1e6);
+            }
+            std::printf("\n");
+        }
+    }
+
+    Simd::setLevel(Simd::supportedLevel());
+    return 0;
+}
@@ -0,0 +1,125 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Measures rotations and flips of a 4000x3000 image against a plain loop
+// copying pixel by pixel, at every vector instruction set level supported
+// by the CPU. Build with CMAKE_BUILD_TYPE=Release.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <imgio/image.h>
+#include <imgio/simd.h>
+
+using namespace ImgIO;
+
+// Rotation by 90 degrees clockwise, walking the destination row by row.
+static Image naiveRotated90(const Image& aImage)
+{
+    size_t pixelSize = ColorSpec::pixelSize(aImage.colorFormat(), aImage.colorChannelDepth());
+    Image rotated(aImage.height(), aImage.width(), aImage.colorFormat(), aImage.colorChannelDepth());
+    for (unsigned int y = 0; y < rotated.height(); ++y) {
+        uint8_t* dest = rotated.data() + y * rotated.stride();
+        for (unsigned int x = 0; x < rotated.width(); ++x, dest += pixelSize) {
+            const uint8_t* src = aImage.data() + (aImage.height() - 1 - x) * aImage.stride() + y * pixelSize;
+            std::memcpy(dest, src, pixelSize);
+        }
+    }
+    return rotated;
+}
+
+int main()
+{
+    const int iterations = 5;
+    const unsigned int width = 4000;
+    const unsigned int height = 3000;
+
+    const struct {
+        ColorSpec::Format format;
+        ColorSpec::ChannelDepth depth;
+        const char* name;
+    } formats[] = {
+        {ColorSpec::Format::kMonochromatic, ColorSpec::ChannelDepth::k8Bit, "Mono8"},
+        {ColorSpec::Format::kMonochromaticAlpha, ColorSpec::ChannelDepth::k8Bit, "MonoA8"},
+        {ColorSpec::Format::kRGB, ColorSpec::ChannelDepth::k8Bit, "RGB8"},
+        {ColorSpec::Format::kRGBA, ColorSpec::ChannelDepth::k8Bit, "RGBA8"},
+        {ColorSpec::Format::kRGBA, ColorSpec::ChannelDepth::k16Bit, "RGBA16"},
+    };
+    const struct {
+        Image::Orientation orientation;
+        const char* name;
+    } orientations[] = {
+        {Image::Orientation::kRightTop, "rotated90"},
+        {Image::Orientation::kBottomRight, "rotated180"},
+        {Image::Orientation::kTopRight, "flippedHorizontally"},
+        {Image::Orientation::kBottomLeft, "flippedVertically"},
+        {Image::Orientation::kLeftTop, "transposed"},
+    };
+    const char* levelNames[] = {"scalar", "SSE2", "SSSE3", "AVX2"};
+    const int maxLevel = static_cast<int>(Simd::supportedLevel());
+
+    std::printf("%ux%u, single thread, MPix/s\n", width, height);
+    std::printf("%-28s %10s", "", "naive");
+    for (int level = 0; level <= maxLevel; ++level)
+        std::printf(" %10s", levelNames[level]);
+    std::printf("\n");
+
+    for (const auto& format : formats) {
+        Image image(width, height, format.format, format.depth);
+        uint8_t* data = image.data();
+        for (size_t i = 0; i < image.stride() * image.height(); ++i)
+            data[i] = static_cast<uint8_t>(i * 13);
+
+        for (const auto& orientation : orientations) {
+            char name[64];
+            std::snprintf(name, sizeof(name), "%s %s", format.name, orientation.name);
+            std::printf("%-28s", name);
+
+            if (orientation.orientation == Image::Orientation::kRightTop) {
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < iterations; ++i) {
+                    Image rotated = naiveRotated90(image);
+                    asm volatile("" : : "r"(rotated.data()) : "memory");
+                }
+                std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+                std::printf(" %10.1f", static_cast<double>(width) * height * iterations / time.count() / 1e6);
+            } else {
+                std::printf(" %10s", "");
+            }
+
+            for (int level = 0; level <= maxLevel; ++level) {
+                Simd::setLevel(static_cast<Simd::Level>(level));
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < iterations; ++i) {
+                    Image oriented = image.oriented(orientation.orientation, 1);
+                    asm volatile("" : : "r"(oriented.data()) : "memory");
+                }
+                std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+                std::printf(" %10.1f", static_cast<double>(width) * height * iterations / time.count() / 1e6);
+            }
+            std::printf("\n");
+        }
+    }
+
+    Simd::setLevel(Simd::supportedLevel());
+    return 0;
+}
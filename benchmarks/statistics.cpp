@@ -0,0 +1,155 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Measures per channel statistics, histograms and the alpha scan of
+// isOpaque() on a 4000x3000 image against plain loops over the samples, at
+// every vector instruction set level supported by the CPU. The image is
+// opaque, so the alpha scan reads all of it. Build with
+// CMAKE_BUILD_TYPE=Release.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <imgio/image.h>
+#include <imgio/simd.h>
+
+using namespace ImgIO;
+
+// Minimum, maximum and sum of each channel of an 8 bit image, with the
+// channel count known only at run time.
+static std::vector<uint64_t> naiveStatistics(const Image& aImage)
+{
+    size_t channels = ColorSpec::channelCount(aImage.colorFormat());
+    std::vector<uint64_t> result(3 * channels);
+    for (size_t c = 0; c < channels; ++c)
+        result[3 * c] = 255;
+    for (unsigned int y = 0; y < aImage.height(); ++y) {
+        const uint8_t* row = aImage.data() + y * aImage.stride();
+        for (size_t i = 0; i < aImage.width() * channels; ++i) {
+            uint64_t* channel = &result[3 * (i % channels)];
+            channel[0] = std::min<uint64_t>(channel[0], row[i]);
+            channel[1] = std::max<uint64_t>(channel[1], row[i]);
+            channel[2] += row[i];
+        }
+    }
+    return result;
+}
+
+// Whether every alpha of an 8 bit RGBA image is 255, checked pixel by pixel.
+static bool naiveIsOpaque(const Image& aImage)
+{
+    bool opaque = true;
+    for (unsigned int y = 0; y < aImage.height(); ++y) {
+        const uint8_t* row = aImage.data() + y * aImage.stride();
+        for (unsigned int x = 0; x < aImage.width(); ++x)
+            opaque = opaque && (row[4 * x + 3] == 255);
+    }
+    return opaque;
+}
+
+int main()
+{
+    const int iterations = 5;
+    const unsigned int width = 4000;
+    const unsigned int height = 3000;
+
+    const struct {
+        ColorSpec::Format format;
+        ColorSpec::ChannelDepth depth;
+        const char* name;
+    } formats[] = {
+        {ColorSpec::Format::kMonochromatic, ColorSpec::ChannelDepth::k8Bit, "Mono8"},
+        {ColorSpec::Format::kRGB, ColorSpec::ChannelDepth::k8Bit, "RGB8"},
+        {ColorSpec::Format::kRGBA, ColorSpec::ChannelDepth::k8Bit, "RGBA8"},
+        {ColorSpec::Format::kRGBA, ColorSpec::ChannelDepth::k16Bit, "RGBA16"},
+    };
+    enum Operation { kStatistics, kHistograms, kIsOpaque };
+    const struct {
+        Operation operation;
+        const char* name;
+    } operations[] = {
+        {kStatistics, "statistics"},
+        {kHistograms, "histograms"},
+        {kIsOpaque, "isOpaque"},
+    };
+    const char* levelNames[] = {"scalar", "SSE2", "SSSE3", "AVX2"};
+    const int maxLevel = static_cast<int>(Simd::supportedLevel());
+
+    std::printf("%ux%u, single thread, MPix/s\n", width, height);
+    std::printf("%-20s %10s", "", "naive");
+    for (int level = 0; level <= maxLevel; ++level)
+        std::printf(" %10s", levelNames[level]);
+    std::printf("\n");
+
+    for (const auto& format : formats) {
+        Image image(width, height, format.format, format.depth);
+        uint8_t* data = image.data();
+        for (size_t i = 0; i < image.stride() * image.height(); ++i)
+            data[i] = static_cast<uint8_t>(i * 13);
+        if (format.format == ColorSpec::Format::kRGBA)
+            image = image.convertedTo(ColorSpec::Format::kRGB, format.depth).convertedTo(format.format, format.depth);
+
+        for (const auto& operation : operations) {
+            if ((operation.operation == kIsOpaque) && (format.format != ColorSpec::Format::kRGBA))
+                continue;
+
+            char name[64];
+            std::snprintf(name, sizeof(name), "%s %s", format.name, operation.name);
+            std::printf("%-20s", name);
+
+            bool is8Bit = (format.depth == ColorSpec::ChannelDepth::k8Bit);
+            if (is8Bit && (operation.operation != kHistograms)) {
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < iterations; ++i) {
+                    volatile bool result = (operation.operation == kStatistics) ? naiveStatistics(image)[2] != 0
+                                                                                : naiveIsOpaque(image);
+                    (void)result;
+                }
+                std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+                std::printf(" %10.1f", static_cast<double>(width) * height * iterations / time.count() / 1e6);
+            } else {
+                std::printf(" %10s", "");
+            }
+
+            for (int level = 0; level <= maxLevel; ++level) {
+                Simd::setLevel(static_cast<Simd::Level>(level));
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < iterations; ++i) {
+                    volatile bool result = false;
+                    switch (operation.operation) {
+                    case kStatistics: result = image.statistics(1)[0].mean > 0.0; break;
+                    case kHistograms: result = image.histograms(1)[0][0] > 0; break;
+                    case kIsOpaque: result = image.isOpaque(1); break;
+                    }
+                    (void)result;
+                }
+                std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+                std::printf(" %10.1f", static_cast<double>(width) * height * iterations / time.count() / 1e6);
+            }
+            std::printf("\n");
+        }
+    }
+
+    Simd::setLevel(Simd::supportedLevel());
+    return 0;
+}
@@ -0,0 +1,109 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// Measures encoding 4000x3000 images and batches of 256x256 tiles into PNG
+// and JPEG files through an std::ofstream against ImageIO::write() of the
+// path, with writes, with a mapping of the file, and with each durability
+// policy. Files go to the temporary directory. Build with
+// CMAKE_BUILD_TYPE=Release.
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <imgio/imageio.h>
+
+using namespace ImgIO;
+
+int main()
+{
+    const struct {
+        unsigned int width;
+        unsigned int height;
+        int iterations;
+    } sizes[] = {
+        {4000, 3000, 3},
+        {256, 256, 200},
+    };
+    const struct {
+        ImageIO::ImageFormat format;
+        const char* name;
+    } formats[] = {
+        {ImageIO::ImageFormat::kPng, "PNG"},
+        {ImageIO::ImageFormat::kJpeg, "JPEG"},
+    };
+    enum Mode { kStream, kPath, kMapped, kDataSync, kReplace };
+    const char* modeNames[] = {"ofstream", "path", "mapped", "datasync", "replace"};
+
+    std::printf("RGB, MPix/s\n");
+    std::printf("%-16s", "");
+    for (const char* name : modeNames)
+        std::printf(" %10s", name);
+    std::printf("\n");
+
+    for (const auto& size : sizes) {
+        Image image(size.width, size.height, ColorSpec::Format::kRGB);
+        uint8_t* data = image.data();
+        for (unsigned int y = 0; y < size.height; ++y)
+            for (unsigned int x = 0; x < size.width * 3; ++x)
+                data[y * image.stride() + x] = static_cast<uint8_t>((x / 3 + y) / 16 + (x % 3) * 40);
+
+        for (const auto& format : formats) {
+            std::string path = std::string("/tmp/benchmark_writefile.") + format.name;
+            char name[32];
+            std::snprintf(name, sizeof(name), "%ux%u %s", size.width, size.height, format.name);
+            std::printf("%-16s", name);
+
+            for (int mode = kStream; mode <= kReplace; ++mode) {
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < size.iterations; ++i) {
+                    switch (mode) {
+                    case kStream: {
+                        std::ofstream file(path, std::ios::binary);
+                        ImageIO::write(image, file, format.format);
+                        break;
+                    }
+                    case kPath:
+                        ImageIO::write(image, path, format.format);
+                        break;
+                    case kMapped:
+                        ImageIO::write(image, path, format.format, ImageIO::Durability::kNone, true);
+                        break;
+                    case kDataSync:
+                        ImageIO::write(image, path, format.format, ImageIO::Durability::kDataSync);
+                        break;
+                    case kReplace:
+                        ImageIO::write(image, path, format.format, ImageIO::Durability::kReplace);
+                        break;
+                    }
+                }
+                std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+                std::printf(" %10.1f", static_cast<double>(size.width) * size.height * size.iterations / time.count() / 1e6);
+            }
+            std::printf("\n");
+            std::remove(path.c_str());
+        }
+    }
+
+    return 0;
+}
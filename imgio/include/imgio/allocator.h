@@ -0,0 +1,153 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef __IMAGEIO_ALLOCATOR_H__
+#define __IMAGEIO_ALLOCATOR_H__
+
+#include <cstddef>
+#include <memory>
+
+namespace ImgIO
+{
+
+/**
+ * Pixel buffer allocator interface.
+ */
+class Allocator
+{
+public:
+    /**
+     * Destructor.
+     */
+    virtual ~Allocator() {}
+
+    /**
+     * Allocates a buffer, throws std::bad_alloc on failure.
+     * @param aSize Buffer size in bytes.
+     * @param aAlignment Buffer alignment, a power of two.
+     * @return Allocated buffer.
+     */
+    virtual void* allocate(size_t aSize, size_t aAlignment) = 0;
+
+    /**
+     * Releases a buffer returned by allocate().
+     * @param aData Buffer.
+     * @param aSize Buffer size passed to allocate().
+     * @param aAlignment Buffer alignment passed to allocate().
+     */
+    virtual void deallocate(void* aData, size_t aSize, size_t aAlignment) = 0;
+
+    /**
+     * Returns the allocator used for all pixel buffers allocated by the library.
+     * @return Default allocator, a PoolAllocator unless replaced.
+     */
+    static std::shared_ptr<Allocator> defaultAllocator();
+
+    /**
+     * Replaces the default allocator. Buffers allocated before keep the
+     * allocator they came from.
+     * @param aAllocator New default allocator, nullptr restores the built-in one.
+     */
+    static void setDefaultAllocator(std::shared_ptr<Allocator> aAllocator);
+}; // class Allocator
+
+/**
+ * Allocator going straight to the system heap.
+ */
+class SystemAllocator : public Allocator
+{
+public:
+    void* allocate(size_t aSize, size_t aAlignment);
+    void deallocate(void* aData, size_t aSize, size_t aAlignment);
+}; // class SystemAllocator
+
+/**
+ * Allocator recycling released buffers.
+ *
+ * Sizes are rounded up to size classes (four per power of two) and
+ * released buffers are kept for reuse, first in a small per-thread cache,
+ * then in a shared one. Buffers beyond the cache limits go back to the
+ * system heap.
+ */
+class PoolAllocator : public Allocator
+{
+public:
+    /**
+     * Default limit of bytes kept in the shared cache.
+     */
+    static const size_t kDefaultMaxCachedBytes = 256 * 1024 * 1024;
+
+    /**
+     * Default limit of bytes kept in each thread's cache.
+     */
+    static const size_t kDefaultMaxThreadCachedBytes = 64 * 1024 * 1024;
+
+public:
+    /**
+     * Constructor.
+     * @param aMaxCachedBytes Limit of bytes kept in the shared cache.
+     * @param aMaxThreadCachedBytes Limit of bytes kept in each thread's cache.
+     */
+    PoolAllocator(size_t aMaxCachedBytes = kDefaultMaxCachedBytes,
+                  size_t aMaxThreadCachedBytes = kDefaultMaxThreadCachedBytes);
+
+    /**
+     * Destructor.
+     */
+    ~PoolAllocator();
+
+    void* allocate(size_t aSize, size_t aAlignment);
+    void deallocate(void* aData, size_t aSize, size_t aAlignment);
+
+    /**
+     * Changes the limits of cached bytes. Applies to buffers released afterwards.
+     * @param aMaxCachedBytes Limit of bytes kept in the shared cache.
+     * @param aMaxThreadCachedBytes Limit of bytes kept in each thread's cache.
+     */
+    void setLimits(size_t aMaxCachedBytes, size_t aMaxThreadCachedBytes);
+
+    /**
+     * Releases the buffers in the shared cache and in the calling thread's cache.
+     */
+    void trim();
+
+    /**
+     * Returns the number of bytes in the shared cache.
+     * @return Cached bytes.
+     */
+    size_t cachedBytes() const;
+
+    /**
+     * Returns how many allocations had to go to the system heap.
+     * @return Number of system allocations.
+     */
+    size_t systemAllocationsCount() const;
+private:
+    class Impl;
+private:
+    std::unique_ptr<Impl> mImpl;
+}; // class PoolAllocator
+
+}; // namespace ImgIO
+
+#endif // __IMAGEIO_ALLOCATOR_H__
@@ -24,7 +24,10 @@
 #ifndef __IMAGEIO_COLOR_H__
 #define __IMAGEIO_COLOR_H__
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace ImgIO
 {
@@ -58,6 +61,11 @@ public:
          */
         kMonochromatic = 1,
 
+        /**
+         * Monochromatic with alpha (two channels, gray and alpha).
+         */
+        kMonochromaticAlpha = 2,
+
         /**
          * RGB (three channels, red, green and blue).
          */
@@ -67,6 +75,18 @@ public:
          * RGBA (four channels, red, green, blue and alpha).
          */
         kRGBA = 4,
+
+        /**
+         * RGBA with the colors premultiplied by alpha. Compositing and
+         * resampling work on it without dividing by alpha.
+         */
+        kRGBAPremultiplied = 5,
+
+        /**
+         * Indexed (8 bit indices into the palette of the image). Only 8 bit
+         * channel depth, colors are looked up by converting to another format.
+         */
+        kIndexed = 6,
     }; // enum class ColorFormat
 
 public:
@@ -94,6 +114,28 @@ public:
      */
     virtual ~ColorSpec();
 
+    /**
+     * Returns the number of channels of a color format.
+     * @param aFormat Color format.
+     * @return Number of channels.
+     */
+    static size_t channelCount(ColorSpec::Format aFormat);
+
+    /**
+     * Returns the format with the alpha channel left out.
+     * @param aFormat Color format.
+     * @return Format without alpha, aFormat itself when it has none or is kIndexed.
+     */
+    static ColorSpec::Format opaqueFormat(ColorSpec::Format aFormat);
+
+    /**
+     * Returns the size of a pixel.
+     * @param aFormat Color format.
+     * @param aChannelDepth Color channel depth.
+     * @return Pixel size in bytes.
+     */
+    static size_t pixelSize(ColorSpec::Format aFormat, ColorSpec::ChannelDepth aChannelDepth);
+
     /**
      * Returns color channel depth.
      * @return Color channel depth.
@@ -123,6 +165,32 @@ private:
     std::unique_ptr<Impl> mImpl;
 }; // class ColorSpec
 
+/**
+ * Palette entry, 8 bit RGBA with straight alpha.
+ */
+struct PaletteColor
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+}; // struct PaletteColor
+
+inline bool operator==(const PaletteColor& aLhs, const PaletteColor& aRhs)
+{
+    return (aLhs.r == aRhs.r) && (aLhs.g == aRhs.g) && (aLhs.b == aRhs.b) && (aLhs.a == aRhs.a);
+}
+
+inline bool operator!=(const PaletteColor& aLhs, const PaletteColor& aRhs)
+{
+    return !(aLhs == aRhs);
+}
+
+/**
+ * Colors of an indexed image, at most 256.
+ */
+typedef std::vector<PaletteColor> Palette;
+
 /**
  * RGB, 8 bit per channel color specification class.
  */
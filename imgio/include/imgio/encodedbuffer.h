@@ -0,0 +1,116 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef __IMAGEIO_ENCODEDBUFFER_H__
+#define __IMAGEIO_ENCODEDBUFFER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <imgio/allocator.h>
+
+namespace ImgIO
+{
+
+/**
+ * Growable buffer of encoded bytes.
+ *
+ * Capacity grows geometrically, storage comes from an Allocator, so with
+ * the default PoolAllocator buffers of repeated encodes are recycled.
+ * Keeping a buffer for the next encode reuses its storage altogether.
+ */
+class EncodedBuffer
+{
+public:
+    /**
+     * Smallest capacity allocated.
+     */
+    static const size_t kMinCapacity = 4096;
+
+public:
+    /**
+     * Constructor.
+     * @param aAllocator Allocator of the storage, nullptr uses Allocator::defaultAllocator().
+     */
+    explicit EncodedBuffer(std::shared_ptr<Allocator> aAllocator = nullptr);
+    EncodedBuffer(EncodedBuffer&& aBuffer) noexcept;
+    ~EncodedBuffer();
+
+    EncodedBuffer& operator=(EncodedBuffer&& aBuffer) noexcept;
+
+    const uint8_t* data() const;
+    uint8_t* data();
+
+    /**
+     * Returns the number of bytes in the buffer.
+     */
+    size_t size() const;
+
+    /**
+     * Returns the number of bytes the buffer can take without growing.
+     */
+    size_t capacity() const;
+
+    /**
+     * Grows the storage to at least aCapacity bytes, keeping the content.
+     */
+    void reserve(size_t aCapacity);
+
+    /**
+     * Sets the number of bytes in the buffer, bytes past the previous size
+     * are left uninitialized. Grows the storage geometrically.
+     */
+    void resize(size_t aSize);
+
+    /**
+     * Appends aLength bytes. Grows the storage geometrically.
+     */
+    void append(const uint8_t* aData, size_t aLength);
+
+    /**
+     * Empties the buffer, keeping its storage.
+     */
+    void clear();
+
+    /**
+     * Empties the buffer and releases its storage.
+     */
+    void release();
+
+private:
+    EncodedBuffer(const EncodedBuffer&) = delete;
+    EncodedBuffer& operator=(const EncodedBuffer&) = delete;
+
+    void grow(size_t aSize);
+
+private:
+    std::shared_ptr<Allocator> mAllocator;
+    uint8_t* mData;
+    size_t mSize;
+    size_t mCapacity;
+}; // class EncodedBuffer
+
+}; // namespace ImgIO
+
+#endif // __IMAGEIO_ENCODEDBUFFER_H__
@@ -24,7 +24,9 @@
 #ifndef _IMAGEIO_IMAGE_H__
 #define _IMAGEIO_IMAGE_H__
 
-#include <memory>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
 #include <imgio/exception.h>
 #include <imgio/color.h>
 
@@ -34,48 +36,365 @@ namespace ImgIO
 class Image
 {
 public:
+    /**
+     * Ways of compositing an image onto another one. Alpha is straight,
+     * unless the destination is kRGBAPremultiplied, images without alpha
+     * are opaque.
+     */
     enum class CompositeOperation
     {
+        /**
+         * Replaces the pixels, alpha included.
+         */
         kCopy,
+
+        /**
+         * Porter-Duff source over.
+         */
+        kSourceOver,
+
+        /**
+         * Source over with the colors multiplied, darkens.
+         */
+        kMultiply,
+
+        /**
+         * Source over with the inverted colors multiplied, lightens.
+         */
+        kScreen,
+    };
+
+    /**
+     * Resampling filters, from the fastest to the sharpest.
+     */
+    enum class ResizeFilter
+    {
+        kNearest,
+        kBilinear,
+        kBicubic,
+        kLanczos3,
+    };
+
+    /**
+     * Pixels filters read beyond the edges of the image.
+     */
+    enum class EdgeMode
+    {
+        /**
+         * Repeats the edge pixels.
+         */
+        kClamp,
+
+        /**
+         * Reflects the image about the edge pixels, which aren't repeated.
+         */
+        kMirror,
+
+        /**
+         * Continues from the opposite edge.
+         */
+        kWrap,
+
+        /**
+         * Transparent black.
+         */
+        kZero,
+    };
+
+    /**
+     * Orientations of stored pixels, numbered as the values of the EXIF
+     * Orientation tag. Each names the operation showing the image upright.
+     */
+    enum class Orientation
+    {
+        /**
+         * Upright as stored.
+         */
+        kTopLeft = 1,
+
+        /**
+         * Mirrored left to right.
+         */
+        kTopRight = 2,
+
+        /**
+         * Rotated by 180 degrees.
+         */
+        kBottomRight = 3,
+
+        /**
+         * Mirrored top to bottom.
+         */
+        kBottomLeft = 4,
+
+        /**
+         * Transposed, mirrored along the main diagonal.
+         */
+        kLeftTop = 5,
+
+        /**
+         * Rotated by 90 degrees clockwise.
+         */
+        kRightTop = 6,
+
+        /**
+         * Transversed, mirrored along the anti-diagonal.
+         */
+        kRightBottom = 7,
+
+        /**
+         * Rotated by 90 degrees counterclockwise.
+         */
+        kLeftBottom = 8,
+    };
+
+    /**
+     * Extremes and average of the samples of a channel.
+     */
+    struct ChannelStatistics
+    {
+        uint16_t minimum;
+        uint16_t maximum;
+        double mean;
     };
 
+    /**
+     * Alignment of rows in buffers allocated by the library. Rows of such
+     * images are padded up to stride().
+     */
+    static const size_t kRowAlignment = 64;
+
 public:
     Image();
-    Image(Image&& aImage);
+    Image(Image&& aImage) noexcept;
     Image(const Image& aImage);
     Image(unsigned int aWidth,
           unsigned int aHeight,
           ColorSpec::Format aColorFormat = ColorSpec::Format::kRGB,
           ColorSpec::ChannelDepth aColorChannelDepth = ColorSpec::ChannelDepth::k8Bit,
-          uint8_t* aData = nullptr);
+          uint8_t* aData = nullptr,
+          size_t aStride = 0);
     ~Image();
 
+    Image& operator=(const Image& aImage);
+    Image& operator=(Image&& aImage) noexcept;
+
     bool isValid() const;
     ColorSpec::Format colorFormat() const;
     ColorSpec::ChannelDepth colorChannelDepth() const;
     unsigned int width() const;
     unsigned int height() const;
+    size_t stride() const;
     const uint8_t* data() const;
     uint8_t* data();
 
+    /**
+     * Returns the palette of a kIndexed image, empty for other formats.
+     */
+    const Palette& palette() const;
+
+    /**
+     * Sets the palette of a kIndexed image, it is shared with the image's
+     * copies. Indices past its end are opaque black. Throws std::logic_error
+     * for other formats and std::invalid_argument for over 256 colors.
+     */
+    Image& setPalette(const Palette& aPalette);
+
+    /**
+     * Composites aImage onto this image, with its top left corner at aX, aY.
+     * Parts outside this image are clipped. The source is converted to this
+     * image's format. Premultiplied RGBA blends without any divisions,
+     * other formats blend through RGBA scratch rows. Indexed images can only
+     * be copied onto indexed images with the same palette.
+     */
     Image& composite(int aX,
                      int aY,
                      const Image& aImage,
                      CompositeOperation aCompositeOperation = Image::CompositeOperation::kCopy);
 
+    /**
+     * Returns a view sharing this image's pixels. They are copied, on
+     * Parallelism::threadsCount() threads, on the first mutable access.
+     */
     Image cropped(unsigned int aX,
                   unsigned int aY,
                   unsigned int aWidth,
                   unsigned int aHeight) const;
 
+    /**
+     * Returns a copy scaled to aWidth x aHeight. Filter coefficients are
+     * computed once per source and destination size and cached. Straight
+     * alpha bleeds the colors of transparent pixels into their neighbours,
+     * premultiplied RGBA resizes without that. Indexed images keep their
+     * palette with kNearest, other filters resize their RGB(A) expansion.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    Image resized(unsigned int aWidth,
+                  unsigned int aHeight,
+                  ResizeFilter aFilter = ResizeFilter::kBilinear,
+                  unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns a copy rotated or mirrored as aOrientation tells, e.g. an
+     * image stored with EXIF orientation aOrientation shown upright. Pixels
+     * are moved in cache sized tiles, by blocks transposed in registers.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    Image oriented(Orientation aOrientation, unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns a copy rotated by 90 degrees clockwise.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    Image rotated90(unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns a copy rotated by 180 degrees.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    Image rotated180(unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns a copy rotated by 270 degrees clockwise (90 counterclockwise).
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    Image rotated270(unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns a copy mirrored left to right.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    Image flippedHorizontally(unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns a copy mirrored top to bottom.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    Image flippedVertically(unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns a copy with rows and columns swapped.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    Image transposed(unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns a copy convolved with a separable kernel, aRowKernel along
+     * the rows and aColumnKernel along the columns. Both have an odd number
+     * of weights, centered on the middle one. 8 bit images are filtered in
+     * fixed point when the weights allow it (magnitudes summing to at most
+     * 8, rounding to 12 fractional bits within half a sample), other ones
+     * in float. Rows go
+     * through both passes in strips sized for the cache. Straight RGBA is
+     * filtered premultiplied, indexed images come back as their RGB(A)
+     * expansion. Throws std::invalid_argument for kernels of even sizes.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    Image convolved(const std::vector<float>& aRowKernel,
+                    const std::vector<float>& aColumnKernel,
+                    EdgeMode aEdgeMode = EdgeMode::kClamp,
+                    unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns a copy averaged over squares of 2 * aRadius + 1 pixels, with
+     * running sums in constant time per pixel whatever the radius. Throws
+     * std::invalid_argument for radii over 32767.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    Image boxBlurred(unsigned int aRadius,
+                     EdgeMode aEdgeMode = EdgeMode::kClamp,
+                     unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns a stack blurred copy: weights fall linearly from the center
+     * to aRadius + 1 pixels away, close to a Gaussian at constant time per
+     * pixel. Throws std::invalid_argument for radii over 254.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    Image stackBlurred(unsigned int aRadius,
+                       EdgeMode aEdgeMode = EdgeMode::kClamp,
+                       unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns a copy convolved with a Gaussian of standard deviation
+     * aSigma, cut at 3 * aSigma. The cost grows with aSigma, stackBlurred()
+     * suits large ones better.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    Image gaussianBlurred(float aSigma,
+                          EdgeMode aEdgeMode = EdgeMode::kClamp,
+                          unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns a sharpened copy, each sample moved away from its Gaussian
+     * blurred value by aAmount times the difference. Differences below
+     * aThreshold, a fraction of the full scale, are left alone.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    Image unsharpMasked(float aSigma,
+                        float aAmount = 1.0f,
+                        float aThreshold = 0.0f,
+                        unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns a copy converted to another format. Indexed images are
+     * expanded through their palette, conversion to kIndexed throws
+     * NotImplementedException.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
     Image convertedTo(ColorSpec::Format aFormat,
-                      ColorSpec::ChannelDepth aChannelDepth = ColorSpec::ChannelDepth::k8Bit);
+                      ColorSpec::ChannelDepth aChannelDepth = ColorSpec::ChannelDepth::k8Bit,
+                      unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Converts this image to another format. Conversions that don't grow the
+     * pixels reuse the buffer, unless it is shared with other images.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    Image& convertInPlace(ColorSpec::Format aFormat,
+                          ColorSpec::ChannelDepth aChannelDepth = ColorSpec::ChannelDepth::k8Bit,
+                          unsigned int aThreadsCount = 0);
+
+    /**
+     * Converts this image into aDest, to aDest's format. aDest takes this
+     * image's size and keeps its buffer when it is large enough and not shared.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    void convertInto(Image& aDest, unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns the statistics of each channel, in the order of the format's
+     * channels. Indexed images report their indices.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    std::vector<ChannelStatistics> statistics(unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns the histogram of each channel, in the order of the format's
+     * channels, with 256 bins for 8 bit channels and 65536 for 16 bit ones.
+     * Indexed images count their indices.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    std::vector<std::vector<uint64_t>> histograms(unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Returns whether all pixels are fully opaque, stopping at the first one
+     * that isn't. Formats without alpha always are, indexed images are
+     * checked through their palette.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    bool isOpaque(unsigned int aThreadsCount = 0) const;
 private:
     class Impl;
 private:
     explicit Image(Image::Impl&& aImpl);
+
+    Impl& impl();
+    const Impl& impl() const;
 private:
-    std::unique_ptr<Impl> mImpl;
+    // Impl is kept inline, so an image costs no allocation besides its pixel buffer.
+    static const size_t kImplSize = 64;
+    std::aligned_storage<kImplSize, alignof(void*)>::type mImpl;
 }; // class Image
 
 } // namespace ImgIO
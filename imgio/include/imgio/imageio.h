@@ -25,6 +25,8 @@
 #define __IMAGEIO_IMAGEIO_H__
 
 #include <iostream>
+#include <string>
+#include <imgio/encodedbuffer.h>
 #include <imgio/image.h>
 
 namespace ImgIO {
@@ -37,26 +39,107 @@ public:
                             kPng = 2,
                             kJpeg = 3,
                             kGif = 4};
+
+    /**
+     * How write() of a file gets the data onto the disk: left to the
+     * system, with fdatasync() before returning, or written to a temporary
+     * file next to it, synced and renamed over the path, so the file is
+     * either the old or the complete new one.
+     */
+    enum class Durability {kNone = 0,
+                           kDataSync = 1,
+                           kReplace = 2};
 public:
+    /**
+     * Guesses the format from the leading bytes of the data. A single byte
+     * tells the supported formats apart, more make the guess more reliable.
+     * @return Format or ImageFormat::kUnspecified, when it isn't recognized.
+     */
+    static ImageFormat detectFormat(const uint8_t* aData, size_t aLength);
+
+    /**
+     * Guesses the format from the next byte of the stream, without consuming it.
+     * @return Format or ImageFormat::kUnspecified, when it isn't recognized.
+     */
+    static ImageFormat detectFormat(std::istream& aInputDataStream);
+
+    /**
+     * Decodes an image. With aApplyOrientation set, the EXIF orientation of
+     * JPEG (APP1) and PNG (eXIf) files is applied, so the image comes upright.
+     * JPEG rows are moved to their place band by band while decoding.
+     * With aDropOpaqueAlpha set, images whose alpha is at its maximum
+     * everywhere come in the format without alpha, see ColorSpec::opaqueFormat().
+     */
     static Image read(std::istream &aInputDataStream,
                       ImageFormat aInputImageFormat = ImageFormat::kUnspecified,
                       ColorSpec::Format aOutputImageColorformat = ColorSpec::Format::kRGBA,
-                      ColorSpec::ChannelDepth aOutputImageChannelDepth = ColorSpec::ChannelDepth::k8Bit);
+                      ColorSpec::ChannelDepth aOutputImageChannelDepth = ColorSpec::ChannelDepth::k8Bit,
+                      bool aApplyOrientation = false,
+                      bool aDropOpaqueAlpha = false);
 
     static Image read(const uint8_t *aInputData,
                       size_t aLength,
                       ImageFormat aInputImageFormat = ImageFormat::kUnspecified,
                       ColorSpec::Format aOutputImageColorformat = ColorSpec::Format::kRGBA,
-                      ColorSpec::ChannelDepth aOutputImageChannelDepth = ColorSpec::ChannelDepth::k8Bit);
+                      ColorSpec::ChannelDepth aOutputImageChannelDepth = ColorSpec::ChannelDepth::k8Bit,
+                      bool aApplyOrientation = false,
+                      bool aDropOpaqueAlpha = false);
+
+    /**
+     * Decodes an image file, mapped into memory and decoded in place.
+     * Throws std::system_error when the file can't be opened or mapped.
+     */
+    static Image read(const std::string& aPath,
+                      ImageFormat aInputImageFormat = ImageFormat::kUnspecified,
+                      ColorSpec::Format aOutputImageColorformat = ColorSpec::Format::kRGBA,
+                      ColorSpec::ChannelDepth aOutputImageChannelDepth = ColorSpec::ChannelDepth::k8Bit,
+                      bool aApplyOrientation = false,
+                      bool aDropOpaqueAlpha = false);
 
     static void write(const Image &aImage,
                       std::ostream &aOutputDataStream,
                       ImageFormat aImageFormat);
 
+    /**
+     * Encodes an image into a buffer of the caller.
+     * @return Number of bytes written. Throws std::length_error when they
+     * don't fit, buffers of maxEncodedSize() bytes always fit.
+     */
+    static size_t write(const Image &aImage,
+                        uint8_t *aOutputDataBuf,
+                        size_t aOutputDataBufLength,
+                        ImageFormat aImageFormat);
+
+    /**
+     * Encodes an image, replacing the content of aOutputBuffer, which ends
+     * up the exact encoded size. The buffer grows as needed, a buffer kept
+     * from a previous encode is reused.
+     */
     static void write(const Image &aImage,
-                      uint8_t *aOutputDataBuf,
-                      size_t aOutputDataBufLength,
+                      EncodedBuffer &aOutputBuffer,
                       ImageFormat aImageFormat);
+
+    /**
+     * Encodes an image into a file, written in large aligned blocks, into
+     * space preallocated for maxEncodedSize() bytes when it is large. With
+     * aMapOutput set, large images are encoded straight into a mapping of
+     * the file.
+     * The file is opened once the encoder has accepted the image. Without
+     * kReplace, a write failing after that leaves the file truncated or
+     * partly written, the previous content is lost.
+     * Throws std::system_error when the file can't be written.
+     */
+    static void write(const Image &aImage,
+                      const std::string &aPath,
+                      ImageFormat aImageFormat,
+                      Durability aDurability = Durability::kNone,
+                      bool aMapOutput = false);
+
+    /**
+     * Returns an upper bound of the size of an image encoded by write().
+     */
+    static size_t maxEncodedSize(const Image &aImage,
+                                 ImageFormat aImageFormat);
 }; // class ImageIO
 
 } // namespace ImgIO
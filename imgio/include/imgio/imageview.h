@@ -0,0 +1,466 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef __IMAGEIO_IMAGEVIEW_H__
+#define __IMAGEIO_IMAGEVIEW_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <imgio/image.h>
+
+namespace ImgIO
+{
+
+/**
+ * Channel depth of a sample type.
+ */
+template <typename Sample>
+struct SampleTraits;
+
+template <>
+struct SampleTraits<uint8_t>
+{
+    static const ColorSpec::ChannelDepth kChannelDepth = ColorSpec::ChannelDepth::k8Bit;
+};
+
+template <>
+struct SampleTraits<uint16_t>
+{
+    static const ColorSpec::ChannelDepth kChannelDepth = ColorSpec::ChannelDepth::k16Bit;
+};
+
+/**
+ * Monochromatic pixel.
+ */
+template <typename Sample>
+struct PixelMono
+{
+    typedef Sample SampleType;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kMonochromatic;
+    static const ColorSpec::ChannelDepth kChannelDepth = SampleTraits<Sample>::kChannelDepth;
+
+    Sample value;
+};
+
+/**
+ * Monochromatic pixel with alpha.
+ */
+template <typename Sample>
+struct PixelMonoAlpha
+{
+    typedef Sample SampleType;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kMonochromaticAlpha;
+    static const ColorSpec::ChannelDepth kChannelDepth = SampleTraits<Sample>::kChannelDepth;
+
+    Sample value;
+    Sample a;
+};
+
+/**
+ * RGB pixel.
+ */
+template <typename Sample>
+struct PixelRGB
+{
+    typedef Sample SampleType;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kRGB;
+    static const ColorSpec::ChannelDepth kChannelDepth = SampleTraits<Sample>::kChannelDepth;
+
+    Sample r;
+    Sample g;
+    Sample b;
+};
+
+/**
+ * RGBA pixel, alpha is straight (not premultiplied).
+ */
+template <typename Sample>
+struct PixelRGBA
+{
+    typedef Sample SampleType;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kRGBA;
+    static const ColorSpec::ChannelDepth kChannelDepth = SampleTraits<Sample>::kChannelDepth;
+
+    Sample r;
+    Sample g;
+    Sample b;
+    Sample a;
+};
+
+/**
+ * RGBA pixel with the colors premultiplied by alpha, none exceeds it.
+ */
+template <typename Sample>
+struct PixelRGBAPremultiplied
+{
+    typedef Sample SampleType;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kRGBAPremultiplied;
+    static const ColorSpec::ChannelDepth kChannelDepth = SampleTraits<Sample>::kChannelDepth;
+
+    Sample r;
+    Sample g;
+    Sample b;
+    Sample a;
+};
+
+/**
+ * Indexed pixel, its color is the palette entry of the index.
+ */
+struct PixelIndexed
+{
+    typedef uint8_t SampleType;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kIndexed;
+    static const ColorSpec::ChannelDepth kChannelDepth = ColorSpec::ChannelDepth::k8Bit;
+
+    uint8_t index;
+};
+
+typedef PixelMono<uint8_t> PixelMono8;
+typedef PixelMono<uint16_t> PixelMono16;
+typedef PixelMonoAlpha<uint8_t> PixelMonoAlpha8;
+typedef PixelMonoAlpha<uint16_t> PixelMonoAlpha16;
+typedef PixelRGB<uint8_t> PixelRGB8;
+typedef PixelRGB<uint16_t> PixelRGB16;
+typedef PixelRGBA<uint8_t> PixelRGBA8;
+typedef PixelRGBA<uint16_t> PixelRGBA16;
+typedef PixelRGBAPremultiplied<uint8_t> PixelRGBAPremultiplied8;
+typedef PixelRGBAPremultiplied<uint16_t> PixelRGBAPremultiplied16;
+
+static_assert(sizeof(PixelMonoAlpha16) == 4, "Pixels have to be packed");
+static_assert(sizeof(PixelRGB8) == 3, "Pixels have to be packed");
+static_assert(sizeof(PixelRGB16) == 6, "Pixels have to be packed");
+static_assert(sizeof(PixelRGBA16) == 8, "Pixels have to be packed");
+
+/**
+ * Typed view on the pixels of an image, or of any buffer of rows.
+ *
+ * Rows are contiguous arrays of Pixel, so loops over them need no per
+ * pixel format checks and vectorize well. A const Pixel gives a read only
+ * view. The view doesn't own the pixels, it is valid as long as the
+ * image's buffer is.
+ *
+ * Iterating a view gives its rows:
+ * @code
+ * for (auto row : ImageView<PixelRGBA8>(image))
+ *     for (PixelRGBA8& pixel : row)
+ *         pixel.a = 255;
+ * @endcode
+ */
+template <typename Pixel>
+class ImageView
+{
+public:
+    typedef typename std::remove_const<Pixel>::type PixelType;
+    typedef typename std::conditional<std::is_const<Pixel>::value, const uint8_t, uint8_t>::type Byte;
+    typedef typename std::conditional<std::is_const<Pixel>::value, const Image, Image>::type ImageType;
+
+    /**
+     * One row of pixels.
+     */
+    class Row
+    {
+    public:
+        Row(Pixel* aPixels, size_t aWidth)
+        : mPixels(aPixels), mWidth(aWidth)
+        {}
+
+        Pixel* begin() const
+        {
+            return mPixels;
+        }
+
+        Pixel* end() const
+        {
+            return mPixels + mWidth;
+        }
+
+        size_t size() const
+        {
+            return mWidth;
+        }
+
+        Pixel& operator[](size_t aX) const
+        {
+            return mPixels[aX];
+        }
+
+    private:
+        Pixel* mPixels;
+        size_t mWidth;
+    }; // class Row
+
+    /**
+     * Random access iterator over rows.
+     */
+    class RowIterator
+    {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef Row value_type;
+        typedef ptrdiff_t difference_type;
+        typedef Row* pointer;
+        typedef Row reference;
+
+    public:
+        RowIterator(Byte* aData, size_t aStride, size_t aWidth)
+        : mData(aData), mStride(aStride), mWidth(aWidth)
+        {}
+
+        Row operator*() const
+        {
+            return Row(reinterpret_cast<Pixel*>(mData), mWidth);
+        }
+
+        Row operator[](ptrdiff_t aOffset) const
+        {
+            return *(*this + aOffset);
+        }
+
+        RowIterator& operator++()
+        {
+            mData += mStride;
+            return *this;
+        }
+
+        RowIterator operator++(int)
+        {
+            RowIterator it(*this);
+            mData += mStride;
+            return it;
+        }
+
+        RowIterator& operator--()
+        {
+            mData -= mStride;
+            return *this;
+        }
+
+        RowIterator operator--(int)
+        {
+            RowIterator it(*this);
+            mData -= mStride;
+            return it;
+        }
+
+        RowIterator& operator+=(ptrdiff_t aOffset)
+        {
+            mData += aOffset * static_cast<ptrdiff_t>(mStride);
+            return *this;
+        }
+
+        RowIterator& operator-=(ptrdiff_t aOffset)
+        {
+            mData -= aOffset * static_cast<ptrdiff_t>(mStride);
+            return *this;
+        }
+
+        RowIterator operator+(ptrdiff_t aOffset) const
+        {
+            return RowIterator(*this) += aOffset;
+        }
+
+        RowIterator operator-(ptrdiff_t aOffset) const
+        {
+            return RowIterator(*this) -= aOffset;
+        }
+
+        ptrdiff_t operator-(const RowIterator& aOther) const
+        {
+            return (mData - aOther.mData) / static_cast<ptrdiff_t>(mStride);
+        }
+
+        bool operator==(const RowIterator& aOther) const
+        {
+            return mData == aOther.mData;
+        }
+
+        bool operator!=(const RowIterator& aOther) const
+        {
+            return mData != aOther.mData;
+        }
+
+        bool operator<(const RowIterator& aOther) const
+        {
+            return mData < aOther.mData;
+        }
+
+        bool operator>(const RowIterator& aOther) const
+        {
+            return mData > aOther.mData;
+        }
+
+        bool operator<=(const RowIterator& aOther) const
+        {
+            return mData <= aOther.mData;
+        }
+
+        bool operator>=(const RowIterator& aOther) const
+        {
+            return mData >= aOther.mData;
+        }
+
+    private:
+        Byte* mData;
+        size_t mStride;
+        size_t mWidth;
+    }; // class RowIterator
+
+public:
+    /**
+     * Constructs a view on rows of aWidth pixels, aStride bytes apart.
+     */
+    ImageView(Byte* aData, unsigned int aWidth, unsigned int aHeight, size_t aStride)
+    : mData(aData), mWidth(aWidth), mHeight(aHeight), mStride(aStride)
+    {}
+
+    /**
+     * Constructs a view on aImage, throws std::invalid_argument when its
+     * format isn't the one of Pixel. A mutable view makes the image's
+     * pixels unshared, as Image::data() does.
+     */
+    explicit ImageView(ImageType& aImage)
+    : mData(aImage.data()), mWidth(aImage.width()), mHeight(aImage.height()), mStride(aImage.stride())
+    {
+        if ((aImage.colorFormat() != PixelType::kFormat) || (aImage.colorChannelDepth() != PixelType::kChannelDepth))
+            throw std::invalid_argument("Image format doesn't match the view's pixel type");
+    }
+
+    unsigned int width() const
+    {
+        return mWidth;
+    }
+
+    unsigned int height() const
+    {
+        return mHeight;
+    }
+
+    size_t stride() const
+    {
+        return mStride;
+    }
+
+    /**
+     * Returns the first pixel of row aY.
+     */
+    Pixel* row(unsigned int aY) const
+    {
+        return reinterpret_cast<Pixel*>(mData + aY * mStride);
+    }
+
+    Pixel& operator()(unsigned int aX, unsigned int aY) const
+    {
+        return row(aY)[aX];
+    }
+
+    RowIterator begin() const
+    {
+        return RowIterator(mData, mStride, mWidth);
+    }
+
+    RowIterator end() const
+    {
+        return RowIterator(mData + mHeight * mStride, mStride, mWidth);
+    }
+
+private:
+    Byte* mData;
+    unsigned int mWidth;
+    unsigned int mHeight;
+    size_t mStride;
+}; // class ImageView
+
+namespace Detail
+{
+
+// View on ImageType, read only for a const image.
+template <typename ImageType, typename Pixel>
+using ViewOf = ImageView<typename std::conditional<std::is_const<ImageType>::value, const Pixel, Pixel>::type>;
+
+template <template <typename> class PixelTemplate, typename Visitor, typename ImageType>
+auto visitDepth(ImageType& aImage, Visitor&& aVisitor)
+    -> decltype(aVisitor(std::declval<ViewOf<ImageType, PixelRGBA8>&>()))
+{
+    if (aImage.colorChannelDepth() == ColorSpec::ChannelDepth::k16Bit) {
+        ViewOf<ImageType, PixelTemplate<uint16_t>> view(aImage);
+        return aVisitor(view);
+    }
+
+    ViewOf<ImageType, PixelTemplate<uint8_t>> view(aImage);
+    return aVisitor(view);
+}
+
+template <typename Visitor, typename ImageType>
+auto visit(ImageType& aImage, Visitor&& aVisitor)
+    -> decltype(aVisitor(std::declval<ViewOf<ImageType, PixelRGBA8>&>()))
+{
+    switch (aImage.colorFormat()) {
+    case ColorSpec::Format::kMonochromatic:
+        return visitDepth<PixelMono>(aImage, aVisitor);
+    case ColorSpec::Format::kMonochromaticAlpha:
+        return visitDepth<PixelMonoAlpha>(aImage, aVisitor);
+    case ColorSpec::Format::kRGB:
+        return visitDepth<PixelRGB>(aImage, aVisitor);
+    case ColorSpec::Format::kRGBAPremultiplied:
+        return visitDepth<PixelRGBAPremultiplied>(aImage, aVisitor);
+    case ColorSpec::Format::kIndexed: {
+        ViewOf<ImageType, PixelIndexed> view(aImage);
+        return aVisitor(view);
+    }
+    default:
+        return visitDepth<PixelRGBA>(aImage, aVisitor);
+    }
+}
+
+} // namespace Detail
+
+/**
+ * Calls aVisitor with an ImageView of aImage's concrete pixel type, read
+ * only for a const image. The visitor is instantiated once per pixel type,
+ * a generic lambda (C++14) or a functor with a templated operator() (C++11):
+ * @code
+ * visit(image, [](auto& view) {
+ *     for (auto row : view)
+ *         for (auto& pixel : row)
+ *             invert(pixel);
+ * });
+ * @endcode
+ * @return What aVisitor returns, the same type for all pixel types.
+ */
+template <typename ImageType, typename Visitor>
+auto visit(ImageType& aImage, Visitor&& aVisitor)
+    -> typename std::enable_if<std::is_same<typename std::remove_const<ImageType>::type, Image>::value,
+                               decltype(aVisitor(std::declval<Detail::ViewOf<ImageType, PixelRGBA8>&>()))>::type
+{
+    return Detail::visit(aImage, aVisitor);
+}
+
+}; // namespace ImgIO
+
+#endif // __IMAGEIO_IMAGEVIEW_H__
+// EOF
@@ -0,0 +1,70 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef __IMAGEIO_PARALLELISM_H__
+#define __IMAGEIO_PARALLELISM_H__
+
+#include <cstddef>
+
+namespace ImgIO
+{
+
+/**
+ * Control of the threads used by image operations.
+ *
+ * Large images are split into bands of rows, which run on a library owned
+ * thread pool and on the calling thread. Smaller images are processed on
+ * the calling thread only.
+ */
+class Parallelism
+{
+public:
+    /**
+     * Operations touching fewer bytes than this run on the calling thread.
+     */
+    static const size_t kMinParallelBytes = 1024 * 1024;
+
+public:
+    /**
+     * Returns the number of threads operations use unless told otherwise.
+     * @return Threads count, the calling thread included.
+     */
+    static unsigned int threadsCount();
+
+    /**
+     * Changes the number of threads operations use unless told otherwise.
+     * @param aThreadsCount Threads count, the calling thread included. 1 runs
+     * everything on the calling thread, 0 restores the number of hardware threads.
+     */
+    static void setThreadsCount(unsigned int aThreadsCount);
+
+    /**
+     * Returns the number of hardware threads.
+     * @return Hardware threads count, at least 1.
+     */
+    static unsigned int hardwareThreadsCount();
+}; // class Parallelism
+
+}; // namespace ImgIO
+
+#endif // __IMAGEIO_PARALLELISM_H__
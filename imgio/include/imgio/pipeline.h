@@ -0,0 +1,155 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef __IMAGEIO_PIPELINE_H__
+#define __IMAGEIO_PIPELINE_H__
+
+#include <iostream>
+#include <memory>
+#include <imgio/image.h>
+#include <imgio/imageio.h>
+
+namespace ImgIO
+{
+
+/**
+ * Lazily evaluated chain of image operations.
+ *
+ * Operations are only recorded, run() decodes the input and streams it row
+ * by row through all of them, into an encoder or an image. No intermediate
+ * image is materialized, each stage keeps just the rows it needs. A crop
+ * and a downscale at the front of the chain are handed to the decoder,
+ * which skips rows it doesn't have to decode, stops after the last used
+ * one and, for JPEG, crops columns and downscales in the IDCT.
+ *
+ * A pipeline may be run any number of times, from any number of threads.
+ */
+class Pipeline
+{
+public:
+    /**
+     * Constructs an empty pipeline, passing images unchanged.
+     */
+    Pipeline();
+
+    Pipeline(const Pipeline& aPipeline);
+    Pipeline& operator=(const Pipeline& aPipeline);
+
+    /**
+     * Destructor.
+     */
+    ~Pipeline();
+
+    /**
+     * Appends a crop, clipped to the image as Image::cropped().
+     * @return This pipeline.
+     */
+    Pipeline& crop(unsigned int aX,
+                   unsigned int aY,
+                   unsigned int aWidth,
+                   unsigned int aHeight);
+
+    /**
+     * Appends a resize, as Image::resized().
+     * @return This pipeline.
+     */
+    Pipeline& resize(unsigned int aWidth,
+                     unsigned int aHeight,
+                     Image::ResizeFilter aFilter = Image::ResizeFilter::kBilinear);
+
+    /**
+     * Appends a conversion, as Image::convertedTo().
+     * @return This pipeline.
+     */
+    Pipeline& convert(ColorSpec::Format aFormat,
+                      ColorSpec::ChannelDepth aChannelDepth = ColorSpec::ChannelDepth::k8Bit);
+
+    /**
+     * Enables downscaling in the decoder, on by default. The JPEG IDCT
+     * scales by powers of two with a box like filter, so the result differs
+     * slightly from resizing the full size image.
+     * @return This pipeline.
+     */
+    Pipeline& setDecoderScaling(bool aEnabled);
+
+    /**
+     * Decodes aInputDataStream through the operations into an image.
+     * @param aInputImageFormat Input format, guessed when unspecified.
+     */
+    Image run(std::istream& aInputDataStream,
+              ImageIO::ImageFormat aInputImageFormat = ImageIO::ImageFormat::kUnspecified) const;
+
+    /**
+     * Decodes aInputData through the operations into an image.
+     * @param aInputImageFormat Input format, guessed when unspecified.
+     */
+    Image run(const uint8_t* aInputData,
+              size_t aLength,
+              ImageIO::ImageFormat aInputImageFormat = ImageIO::ImageFormat::kUnspecified) const;
+
+    /**
+     * Transcodes aInputDataStream through the operations into aOutputDataStream.
+     * The last operation has to leave rows the output format can take.
+     * @param aInputImageFormat Input format, guessed when unspecified.
+     */
+    void run(std::istream& aInputDataStream,
+             ImageIO::ImageFormat aInputImageFormat,
+             std::ostream& aOutputDataStream,
+             ImageIO::ImageFormat aOutputImageFormat) const;
+
+    /**
+     * Transcodes aInputData through the operations into aOutputDataBuf.
+     * The last operation has to leave rows the output format can take.
+     * @param aInputImageFormat Input format, guessed when unspecified.
+     * @return Number of bytes written. Throws std::length_error when they don't fit.
+     */
+    size_t run(const uint8_t* aInputData,
+               size_t aLength,
+               ImageIO::ImageFormat aInputImageFormat,
+               uint8_t* aOutputDataBuf,
+               size_t aOutputDataBufLength,
+               ImageIO::ImageFormat aOutputImageFormat) const;
+
+    /**
+     * Transcodes aInputData through the operations, replacing the content
+     * of aOutputBuffer, which grows as needed.
+     * The last operation has to leave rows the output format can take.
+     * @param aInputImageFormat Input format, guessed when unspecified.
+     */
+    void run(const uint8_t* aInputData,
+             size_t aLength,
+             ImageIO::ImageFormat aInputImageFormat,
+             EncodedBuffer& aOutputBuffer,
+             ImageIO::ImageFormat aOutputImageFormat) const;
+
+private:
+    class Impl;
+private:
+    std::unique_ptr<Impl> mImpl;
+}; // class Pipeline
+
+}; // namespace ImgIO
+
+#endif // __IMAGEIO_PIPELINE_H__
+// EOF
@@ -0,0 +1,142 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef __IMAGEIO_PYRAMID_H__
+#define __IMAGEIO_PYRAMID_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <imgio/image.h>
+#include <imgio/imageio.h>
+
+namespace ImgIO
+{
+
+/**
+ * Builder of multi-resolution tile pyramids, as served by deep zoom viewers.
+ *
+ * Level 0 is the image itself, each following level is half the size of
+ * the previous one, rounded up, down to a single pixel. Every level is cut
+ * into square tiles of tileSize() pixels, the last column and row of tiles
+ * take what remains. With an overlap, tiles extend that many pixels into
+ * their neighbours, where they have some. Deep Zoom (DZI) numbers levels
+ * the other way round, its level is levelsCount() - 1 - level.
+ *
+ * Each level is derived from the rows of the previous one with a 2x2 box
+ * filter, straight RGBA weighted by alpha, indexed images as RGB(A). Rows
+ * stream through the levels in strips one tile high, so only a strip of
+ * each level is in memory at a time. Tiles of level 0 of an image are
+ * views of it, the other ones views of the strips.
+ */
+class TilePyramid
+{
+public:
+    /**
+     * Takes a tile, column aColumn and row aRow of level aLevel. The tile is
+     * a view, valid after the call only as long as it's kept: the pixels it
+     * shares are copied, on write, before its strip is reused.
+     */
+    typedef std::function<void(unsigned int aLevel,
+                               unsigned int aColumn,
+                               unsigned int aRow,
+                               const Image& aTile)> TileFunction;
+
+    /**
+     * Takes an encoded tile, its data valid only during the call.
+     */
+    typedef std::function<void(unsigned int aLevel,
+                               unsigned int aColumn,
+                               unsigned int aRow,
+                               const uint8_t* aData,
+                               size_t aLength)> EncodedTileFunction;
+
+public:
+    /**
+     * Constructor. Throws std::invalid_argument for a zero aTileSize or an
+     * aOverlap not below it.
+     * @param aTileSize Side of the tiles in pixels, without the overlap.
+     * @param aOverlap Pixels tiles share with each of their neighbours.
+     */
+    explicit TilePyramid(unsigned int aTileSize = 256, unsigned int aOverlap = 0);
+
+    unsigned int tileSize() const;
+    unsigned int overlap() const;
+
+    /**
+     * Returns the number of levels of the pyramid of an image.
+     * @return Levels count, 0 for an empty image.
+     */
+    static unsigned int levelsCount(unsigned int aWidth, unsigned int aHeight);
+
+    /**
+     * Cuts aImage and its downscaled levels into tiles. A level's tiles are
+     * passed row by row, left to right, interleaved with the rows of the
+     * smaller levels, all on the calling thread.
+     */
+    void build(const Image& aImage, const TileFunction& aTileFunction) const;
+
+    /**
+     * Cuts aImage and its downscaled levels into tiles encoded as
+     * aTileFormat, which has to take the pixels of the image, as
+     * ImageIO::write(). Each row of tiles is encoded in parallel, then
+     * passed in the order of the other build().
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    void build(const Image& aImage,
+               ImageIO::ImageFormat aTileFormat,
+               const EncodedTileFunction& aTileFunction,
+               unsigned int aThreadsCount = 0) const;
+
+    /**
+     * Decodes aInputDataStream row by row into a pyramid, never holding the
+     * whole image. Rows keep the channels and depth of the file.
+     * @param aInputImageFormat Input format, guessed when unspecified.
+     */
+    void build(std::istream& aInputDataStream,
+               ImageIO::ImageFormat aInputImageFormat,
+               const TileFunction& aTileFunction) const;
+
+    /**
+     * Decodes aInputDataStream row by row into a pyramid of tiles encoded
+     * as aTileFormat.
+     * @param aInputImageFormat Input format, guessed when unspecified.
+     * @param aThreadsCount Threads to use, 0 uses Parallelism::threadsCount().
+     */
+    void build(std::istream& aInputDataStream,
+               ImageIO::ImageFormat aInputImageFormat,
+               ImageIO::ImageFormat aTileFormat,
+               const EncodedTileFunction& aTileFunction,
+               unsigned int aThreadsCount = 0) const;
+
+private:
+    unsigned int mTileSize;
+    unsigned int mOverlap;
+}; // class TilePyramid
+
+}; // namespace ImgIO
+
+#endif // __IMAGEIO_PYRAMID_H__
+// EOF
@@ -0,0 +1,83 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef __IMAGEIO_SIMD_H__
+#define __IMAGEIO_SIMD_H__
+
+namespace ImgIO
+{
+
+/**
+ * Selection of the vector instruction set used by pixel kernels.
+ */
+class Simd
+{
+public:
+    /**
+     * Instruction set level, each level includes the previous ones.
+     */
+    enum class Level {
+        /**
+         * Plain C++ kernels.
+         */
+        kScalar = 0,
+
+        /**
+         * SSE2 kernels.
+         */
+        kSSE2 = 1,
+
+        /**
+         * SSSE3 kernels.
+         */
+        kSSSE3 = 2,
+
+        /**
+         * AVX2 kernels.
+         */
+        kAVX2 = 3
+    }; // enum class Level
+
+public:
+    /**
+     * Returns the highest level supported by the CPU.
+     * @return Supported level.
+     */
+    static Simd::Level supportedLevel();
+
+    /**
+     * Returns the level used by the kernels, by default the supported one.
+     * @return Used level.
+     */
+    static Simd::Level level();
+
+    /**
+     * Limits the level used by the kernels, e.g. to compare implementations.
+     * @param aLevel Requested level, clamped to the supported one.
+     */
+    static void setLevel(Simd::Level aLevel);
+}; // class Simd
+
+}; // namespace ImgIO
+
+#endif // __IMAGEIO_SIMD_H__
@@ -0,0 +1,334 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <imgio/allocator.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+namespace ImgIO
+{
+
+namespace
+{
+
+const size_t kPoolAlignment = 64;
+const size_t kMinClassSize = 256;
+const size_t kClassesCount = 4 * (8 * sizeof(size_t) - 8) + 1;
+const size_t kMaxThreadCachedBlocks = 16;
+
+void* systemAllocate(size_t aSize, size_t aAlignment)
+{
+    void* data = nullptr;
+    if (aAlignment < sizeof(void*))
+        aAlignment = sizeof(void*);
+    if (posix_memalign(&data, aAlignment, aSize) != 0)
+        throw std::bad_alloc();
+    return data;
+}
+
+// Rounds the size up to one of four classes per power of two, so at most
+// a quarter of a buffer is wasted.
+size_t sizeClass(size_t aSize, size_t& aIndex)
+{
+    if (aSize <= kMinClassSize) {
+        aIndex = 0;
+        return kMinClassSize;
+    }
+
+    // 2^k < aSize <= 2^(k+1)
+    unsigned int k = 8;
+    while ((static_cast<size_t>(2) << k) < aSize)
+        ++k;
+
+    size_t step = static_cast<size_t>(1) << (k - 2);
+    size_t size = (aSize + step - 1) & ~(step - 1);
+    aIndex = (k - 8) * 4 + (size >> (k - 2)) - 4;
+    return size;
+}
+
+struct Block
+{
+    void* data;
+    size_t classIndex;
+    size_t size;
+};
+
+// Buffers cached by one thread for one pool. The blocks come straight from
+// the system heap, so they can be released even after the pool is gone.
+struct ThreadCache
+{
+    ThreadCache()
+    : bytes(0)
+    {
+        blocks.reserve(kMaxThreadCachedBlocks);
+    }
+
+    ~ThreadCache()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for (const Block& block : blocks)
+            std::free(block.data);
+        blocks.clear();
+        bytes = 0;
+    }
+
+    std::vector<Block> blocks;
+    size_t bytes;
+};
+
+thread_local bool tThreadCachesDestroyed = false;
+
+struct ThreadCaches
+{
+    ~ThreadCaches()
+    {
+        tThreadCachesDestroyed = true;
+    }
+
+    std::unordered_map<uint64_t, ThreadCache> caches;
+};
+
+thread_local ThreadCaches tThreadCaches;
+
+ThreadCache* threadCache(uint64_t aPoolId)
+{
+    // Buffers may be released by thread-exit or static destructors
+    if (tThreadCachesDestroyed)
+        return nullptr;
+    return &tThreadCaches.caches[aPoolId];
+}
+
+std::atomic<uint64_t> sNextPoolId(1);
+
+std::shared_ptr<Allocator>& defaultAllocatorStorage()
+{
+    static std::shared_ptr<Allocator> allocator(std::make_shared<PoolAllocator>());
+    return allocator;
+}
+
+} // namespace
+
+std::shared_ptr<Allocator> Allocator::defaultAllocator()
+{
+    return std::atomic_load(&defaultAllocatorStorage());
+}
+
+void Allocator::setDefaultAllocator(std::shared_ptr<Allocator> aAllocator)
+{
+    if (!aAllocator)
+        aAllocator = std::make_shared<PoolAllocator>();
+    std::atomic_store(&defaultAllocatorStorage(), aAllocator);
+}
+
+void* SystemAllocator::allocate(size_t aSize, size_t aAlignment)
+{
+    return systemAllocate(aSize, aAlignment);
+}
+
+void SystemAllocator::deallocate(void* aData, size_t aSize, size_t aAlignment)
+{
+    std::free(aData);
+}
+
+class PoolAllocator::Impl
+{
+public:
+    Impl(size_t aMaxCachedBytes, size_t aMaxThreadCachedBytes)
+    : mId(sNextPoolId++),
+      mMaxCachedBytes(aMaxCachedBytes),
+      mMaxThreadCachedBytes(aMaxThreadCachedBytes),
+      mFreeLists(kClassesCount),
+      mCachedBytes(0),
+      mSystemAllocationsCount(0)
+    {}
+
+    ~Impl()
+    {
+        trim();
+    }
+
+    void* allocate(size_t aSize, size_t aAlignment)
+    {
+        if (aAlignment > kPoolAlignment) {
+            ++mSystemAllocationsCount;
+            return systemAllocate(aSize, aAlignment);
+        }
+
+        size_t classIndex;
+        size_t size = sizeClass(aSize, classIndex);
+
+        ThreadCache* cache = threadCache(mId);
+        if (cache) {
+            for (size_t i = cache->blocks.size(); i > 0; --i) {
+                Block& block = cache->blocks[i - 1];
+                if (block.classIndex == classIndex) {
+                    void* data = block.data;
+                    cache->bytes -= block.size;
+                    block = cache->blocks.back();
+                    cache->blocks.pop_back();
+                    return data;
+                }
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            std::vector<void*>& freeList = mFreeLists[classIndex];
+            if (!freeList.empty()) {
+                void* data = freeList.back();
+                freeList.pop_back();
+                mCachedBytes -= size;
+                return data;
+            }
+        }
+
+        ++mSystemAllocationsCount;
+        return systemAllocate(size, kPoolAlignment);
+    }
+
+    void deallocate(void* aData, size_t aSize, size_t aAlignment)
+    {
+        if (!aData)
+            return;
+
+        if (aAlignment > kPoolAlignment) {
+            std::free(aData);
+            return;
+        }
+
+        size_t classIndex;
+        size_t size = sizeClass(aSize, classIndex);
+
+        ThreadCache* cache = threadCache(mId);
+        if (cache &&
+            (cache->blocks.size() < kMaxThreadCachedBlocks) &&
+            (cache->bytes + size <= mMaxThreadCachedBytes)) {
+            cache->blocks.push_back(Block{aData, classIndex, size});
+            cache->bytes += size;
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mCachedBytes + size <= mMaxCachedBytes) {
+                mFreeLists[classIndex].push_back(aData);
+                mCachedBytes += size;
+                return;
+            }
+        }
+
+        std::free(aData);
+    }
+
+    void setLimits(size_t aMaxCachedBytes, size_t aMaxThreadCachedBytes)
+    {
+        mMaxCachedBytes = aMaxCachedBytes;
+        mMaxThreadCachedBytes = aMaxThreadCachedBytes;
+    }
+
+    void trim()
+    {
+        if (!tThreadCachesDestroyed)
+            tThreadCaches.caches.erase(mId);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (std::vector<void*>& freeList : mFreeLists) {
+            for (void* data : freeList)
+                std::free(data);
+            freeList.clear();
+        }
+        mCachedBytes = 0;
+    }
+
+    size_t cachedBytes() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mCachedBytes;
+    }
+
+    size_t systemAllocationsCount() const
+    {
+        return mSystemAllocationsCount;
+    }
+
+private:
+    const uint64_t mId;
+    std::atomic<size_t> mMaxCachedBytes;
+    std::atomic<size_t> mMaxThreadCachedBytes;
+    mutable std::mutex mMutex;
+    std::vector<std::vector<void*>> mFreeLists;
+    size_t mCachedBytes;
+    std::atomic<size_t> mSystemAllocationsCount;
+}; // class PoolAllocator::Impl
+
+const size_t PoolAllocator::kDefaultMaxCachedBytes;
+const size_t PoolAllocator::kDefaultMaxThreadCachedBytes;
+
+PoolAllocator::PoolAllocator(size_t aMaxCachedBytes, size_t aMaxThreadCachedBytes)
+: mImpl(new Impl(aMaxCachedBytes, aMaxThreadCachedBytes))
+{}
+
+PoolAllocator::~PoolAllocator()
+{}
+
+void* PoolAllocator::allocate(size_t aSize, size_t aAlignment)
+{
+    return mImpl->allocate(aSize, aAlignment);
+}
+
+void PoolAllocator::deallocate(void* aData, size_t aSize, size_t aAlignment)
+{
+    mImpl->deallocate(aData, aSize, aAlignment);
+}
+
+void PoolAllocator::setLimits(size_t aMaxCachedBytes, size_t aMaxThreadCachedBytes)
+{
+    mImpl->setLimits(aMaxCachedBytes, aMaxThreadCachedBytes);
+}
+
+void PoolAllocator::trim()
+{
+    mImpl->trim();
+}
+
+size_t PoolAllocator::cachedBytes() const
+{
+    return mImpl->cachedBytes();
+}
+
+size_t PoolAllocator::systemAllocationsCount() const
+{
+    return mImpl->systemAllocationsCount();
+}
+
+} // namespace ImgIO
@@ -0,0 +1,70 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "blend.h"
+
+namespace ImgIO
+{
+
+namespace
+{
+
+template <bool kPremultiplied>
+BlendFunction scalarBlendFunction(Image::CompositeOperation aOperation, bool aIs16Bit)
+{
+    typedef ColorSpec::ChannelDepth Depth;
+
+    switch (aOperation) {
+    case Image::CompositeOperation::kSourceOver:
+        return aIs16Bit ? blendRow<Image::CompositeOperation::kSourceOver, Depth::k16Bit, kPremultiplied>
+                        : blendRow<Image::CompositeOperation::kSourceOver, Depth::k8Bit, kPremultiplied>;
+    case Image::CompositeOperation::kMultiply:
+        return aIs16Bit ? blendRow<Image::CompositeOperation::kMultiply, Depth::k16Bit, kPremultiplied>
+                        : blendRow<Image::CompositeOperation::kMultiply, Depth::k8Bit, kPremultiplied>;
+    case Image::CompositeOperation::kScreen:
+        return aIs16Bit ? blendRow<Image::CompositeOperation::kScreen, Depth::k16Bit, kPremultiplied>
+                        : blendRow<Image::CompositeOperation::kScreen, Depth::k8Bit, kPremultiplied>;
+    default:
+        return nullptr;
+    }
+}
+
+} // namespace
+
+BlendFunction blendFunction(Image::CompositeOperation aOperation,
+                            ColorSpec::Format aFormat,
+                            ColorSpec::ChannelDepth aChannelDepth)
+{
+    BlendFunction blendFunc = simdBlendFunction(Simd::level(), aOperation, aFormat, aChannelDepth);
+    if (blendFunc)
+        return blendFunc;
+
+    bool is16Bit = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+    if (aFormat == ColorSpec::Format::kRGBAPremultiplied)
+        return scalarBlendFunction<true>(aOperation, is16Bit);
+    return scalarBlendFunction<false>(aOperation, is16Bit);
+}
+
+} // namespace ImgIO
+
+// EOF
@@ -0,0 +1,143 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _BLEND_H__
+#define _BLEND_H__
+
+#include <algorithm>
+#include <imgio/image.h>
+#include <imgio/simd.h>
+#include "convert.h"
+
+namespace ImgIO
+{
+
+/**
+ * Blends a row of RGBA source pixels into a row of RGBA destination pixels,
+ * both in the same format (straight or premultiplied alpha) and depth.
+ */
+typedef void (*BlendFunction)(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount);
+
+// Separable blend mode B(Cs, Cb), source over uses the source color.
+template <Image::CompositeOperation kOperation>
+inline float blendColor(float aSrc, float aDest)
+{
+    switch (kOperation) {
+    case Image::CompositeOperation::kMultiply:
+        return aSrc * aDest;
+    case Image::CompositeOperation::kScreen:
+        return aSrc + aDest - aSrc * aDest;
+    default:
+        return aSrc;
+    }
+}
+
+// Premultiplied blend term as * ab * B(Cs, Cb) of premultiplied samples.
+template <Image::CompositeOperation kOperation>
+inline float blendPremultiplied(float aSrc, float aDest, float aSrcAlpha, float aDestAlpha)
+{
+    switch (kOperation) {
+    case Image::CompositeOperation::kMultiply:
+        return aSrc * aDest;
+    case Image::CompositeOperation::kScreen:
+        return aSrc * aDestAlpha + aDest * aSrcAlpha - aSrc * aDest;
+    default:
+        return aSrc * aDestAlpha;
+    }
+}
+
+/**
+ * Porter-Duff source over with a blend mode (W3C compositing):
+ *   ao = as + ab - as * ab
+ *   co = (Cs * as * (1 - ab) + Cb * ab * (1 - as) + B(Cs, Cb) * as * ab) / ao
+ * With premultiplied samples s and d the division goes away and the same
+ * expression covers alpha as well:
+ *   o = s * (1 - ab) + d * (1 - as) + as * ab * B(Cs, Cb)
+ * The vector kernels evaluate the same expressions in the same order.
+ */
+template <Image::CompositeOperation kOperation, ColorSpec::ChannelDepth kDepth, bool kPremultiplied>
+void blendRow(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    typedef typename DepthTraits<kDepth>::Sample Sample;
+    const float max = static_cast<float>(DepthTraits<kDepth>::kMax);
+    const float scale = 1.0f / max;
+
+    const Sample* src = reinterpret_cast<const Sample*>(aSrc);
+    Sample* dest = reinterpret_cast<Sample*>(aDest);
+
+    for (size_t i = 0; i < aPixelsCount; ++i, src += 4, dest += 4) {
+        float srcAlpha = src[3] * scale;
+        float destAlpha = dest[3] * scale;
+
+        if (kPremultiplied) {
+            float srcWeight = 1.0f - destAlpha;
+            float destWeight = 1.0f - srcAlpha;
+
+            for (size_t c = 0; c < 4; ++c) {
+                float s = src[c] * scale;
+                float d = dest[c] * scale;
+                float value = s * srcWeight + d * destWeight +
+                              blendPremultiplied<kOperation>(s, d, srcAlpha, destAlpha);
+                dest[c] = static_cast<Sample>(std::min(value * max + 0.5f, max));
+            }
+            continue;
+        }
+
+        float srcWeight = srcAlpha * (1.0f - destAlpha);
+        float destWeight = destAlpha * (1.0f - srcAlpha);
+        float blendWeight = srcAlpha * destAlpha;
+        float alpha = srcAlpha + destAlpha - blendWeight;
+
+        for (size_t c = 0; c < 3; ++c) {
+            float s = src[c] * scale;
+            float d = dest[c] * scale;
+            float color = s * srcWeight + d * destWeight + blendColor<kOperation>(s, d) * blendWeight;
+            color = (alpha > 0.0f) ? color / alpha : 0.0f;
+            dest[c] = static_cast<Sample>(std::min(color * max + 0.5f, max));
+        }
+        dest[3] = static_cast<Sample>(std::min(alpha * max + 0.5f, max));
+    }
+}
+
+/**
+ * Returns the blend kernel for the current Simd::level().
+ * @param aFormat kRGBA or kRGBAPremultiplied.
+ * @return Blend function or nullptr for kCopy, which needs no blending.
+ */
+BlendFunction blendFunction(Image::CompositeOperation aOperation,
+                            ColorSpec::Format aFormat,
+                            ColorSpec::ChannelDepth aChannelDepth);
+
+/**
+ * Returns the vectorized blend kernel for the given instruction set level.
+ * @return Blend function or nullptr, when the level has none.
+ */
+BlendFunction simdBlendFunction(Simd::Level aLevel,
+                                Image::CompositeOperation aOperation,
+                                ColorSpec::Format aFormat,
+                                ColorSpec::ChannelDepth aChannelDepth);
+
+} // namespace ImgIO
+
+#endif // _BLEND_H__
+// EOF
@@ -0,0 +1,379 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "blend.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMGIO_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace ImgIO
+{
+
+#ifdef IMGIO_X86_SIMD
+
+#define IMGIO_TARGET_SSE2 __attribute__((target("sse2")))
+#define IMGIO_TARGET_AVX2 __attribute__((target("avx2")))
+
+namespace
+{
+
+//
+// SSE2 kernels: one RGBA pixel per register, as four floats in [0, 1].
+//
+
+template <Image::CompositeOperation kOperation>
+IMGIO_TARGET_SSE2 inline __m128 blendColorSSE2(__m128 aSrc, __m128 aDest)
+{
+    switch (kOperation) {
+    case Image::CompositeOperation::kMultiply:
+        return _mm_mul_ps(aSrc, aDest);
+    case Image::CompositeOperation::kScreen:
+        return _mm_sub_ps(_mm_add_ps(aSrc, aDest), _mm_mul_ps(aSrc, aDest));
+    default:
+        return aSrc;
+    }
+}
+
+template <Image::CompositeOperation kOperation>
+IMGIO_TARGET_SSE2 inline __m128 blendPremultipliedSSE2(__m128 aSrc, __m128 aDest, __m128 aSrcAlpha, __m128 aDestAlpha)
+{
+    switch (kOperation) {
+    case Image::CompositeOperation::kMultiply:
+        return _mm_mul_ps(aSrc, aDest);
+    case Image::CompositeOperation::kScreen:
+        return _mm_sub_ps(_mm_add_ps(_mm_mul_ps(aSrc, aDestAlpha), _mm_mul_ps(aDest, aSrcAlpha)),
+                          _mm_mul_ps(aSrc, aDest));
+    default:
+        return _mm_mul_ps(aSrc, aDestAlpha);
+    }
+}
+
+// Blends normalized pixels, returns them scaled back to aMax.
+template <Image::CompositeOperation kOperation, bool kPremultiplied>
+IMGIO_TARGET_SSE2 inline __m128 blendPixelSSE2(__m128 aSrc, __m128 aDest, __m128 aMax)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 alphaMask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+
+    __m128 srcAlpha = _mm_shuffle_ps(aSrc, aSrc, 0xff);
+    __m128 destAlpha = _mm_shuffle_ps(aDest, aDest, 0xff);
+    if (kPremultiplied) {
+        __m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(aSrc, _mm_sub_ps(one, destAlpha)),
+                                             _mm_mul_ps(aDest, _mm_sub_ps(one, srcAlpha))),
+                                  blendPremultipliedSSE2<kOperation>(aSrc, aDest, srcAlpha, destAlpha));
+        return _mm_min_ps(_mm_add_ps(_mm_mul_ps(value, aMax), _mm_set1_ps(0.5f)), aMax);
+    }
+
+    __m128 srcWeight = _mm_mul_ps(srcAlpha, _mm_sub_ps(one, destAlpha));
+    __m128 destWeight = _mm_mul_ps(destAlpha, _mm_sub_ps(one, srcAlpha));
+    __m128 blendWeight = _mm_mul_ps(srcAlpha, destAlpha);
+    __m128 alpha = _mm_sub_ps(_mm_add_ps(srcAlpha, destAlpha), blendWeight);
+
+    __m128 color = _mm_add_ps(_mm_add_ps(_mm_mul_ps(aSrc, srcWeight), _mm_mul_ps(aDest, destWeight)),
+                              _mm_mul_ps(blendColorSSE2<kOperation>(aSrc, aDest), blendWeight));
+    color = _mm_and_ps(_mm_div_ps(color, alpha), _mm_cmpgt_ps(alpha, _mm_setzero_ps()));
+    color = _mm_or_ps(_mm_andnot_ps(alphaMask, color), _mm_and_ps(alphaMask, alpha));
+
+    return _mm_min_ps(_mm_add_ps(_mm_mul_ps(color, aMax), _mm_set1_ps(0.5f)), aMax);
+}
+
+template <Image::CompositeOperation kOperation, bool kPremultiplied>
+IMGIO_TARGET_SSE2 void blendRow8BitSSE2(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 max = _mm_set1_ps(255.0f);
+    const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= aPixelsCount; i += 4) {
+        __m128i src = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 4 * i));
+        __m128i dest = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aDest + 4 * i));
+        __m128i src16[2] = {_mm_unpacklo_epi8(src, zero), _mm_unpackhi_epi8(src, zero)};
+        __m128i dest16[2] = {_mm_unpacklo_epi8(dest, zero), _mm_unpackhi_epi8(dest, zero)};
+
+        __m128i result16[2];
+        for (int half = 0; half < 2; ++half) {
+            __m128i pixels[2];
+            for (int p = 0; p < 2; ++p) {
+                __m128i s = p ? _mm_unpackhi_epi16(src16[half], zero) : _mm_unpacklo_epi16(src16[half], zero);
+                __m128i d = p ? _mm_unpackhi_epi16(dest16[half], zero) : _mm_unpacklo_epi16(dest16[half], zero);
+                __m128 blended = blendPixelSSE2<kOperation, kPremultiplied>(_mm_mul_ps(_mm_cvtepi32_ps(s), scale),
+                                                            _mm_mul_ps(_mm_cvtepi32_ps(d), scale),
+                                                            max);
+                pixels[p] = _mm_cvttps_epi32(blended);
+            }
+            result16[half] = _mm_packs_epi32(pixels[0], pixels[1]);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + 4 * i), _mm_packus_epi16(result16[0], result16[1]));
+    }
+
+    if (i < aPixelsCount)
+        blendRow<kOperation, ColorSpec::ChannelDepth::k8Bit, kPremultiplied>(aSrc + 4 * i, aDest + 4 * i, aPixelsCount - i);
+}
+
+template <Image::CompositeOperation kOperation, bool kPremultiplied>
+IMGIO_TARGET_SSE2 void blendRow16BitSSE2(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16(static_cast<int16_t>(0x8000));
+    const __m128 max = _mm_set1_ps(65535.0f);
+    const __m128 scale = _mm_set1_ps(1.0f / 65535.0f);
+
+    size_t i = 0;
+    for (; i + 2 <= aPixelsCount; i += 2) {
+        __m128i src = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 8 * i));
+        __m128i dest = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aDest + 8 * i));
+
+        __m128i pixels[2];
+        for (int p = 0; p < 2; ++p) {
+            __m128i s = p ? _mm_unpackhi_epi16(src, zero) : _mm_unpacklo_epi16(src, zero);
+            __m128i d = p ? _mm_unpackhi_epi16(dest, zero) : _mm_unpacklo_epi16(dest, zero);
+            __m128 blended = blendPixelSSE2<kOperation, kPremultiplied>(_mm_mul_ps(_mm_cvtepi32_ps(s), scale),
+                                                        _mm_mul_ps(_mm_cvtepi32_ps(d), scale),
+                                                        max);
+            pixels[p] = _mm_sub_epi32(_mm_cvttps_epi32(blended), bias32);
+        }
+
+        // SSE2 only packs signed words, so the samples are shifted by 0x8000 around the pack.
+        __m128i result = _mm_xor_si128(_mm_packs_epi32(pixels[0], pixels[1]), bias16);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + 8 * i), result);
+    }
+
+    if (i < aPixelsCount)
+        blendRow<kOperation, ColorSpec::ChannelDepth::k16Bit, kPremultiplied>(aSrc + 8 * i, aDest + 8 * i, aPixelsCount - i);
+}
+
+//
+// AVX2 kernels: two RGBA pixels per register, one per 128 bit lane.
+//
+
+template <Image::CompositeOperation kOperation>
+IMGIO_TARGET_AVX2 inline __m256 blendPremultipliedAVX2(__m256 aSrc, __m256 aDest, __m256 aSrcAlpha, __m256 aDestAlpha)
+{
+    switch (kOperation) {
+    case Image::CompositeOperation::kMultiply:
+        return _mm256_mul_ps(aSrc, aDest);
+    case Image::CompositeOperation::kScreen:
+        return _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(aSrc, aDestAlpha), _mm256_mul_ps(aDest, aSrcAlpha)),
+                             _mm256_mul_ps(aSrc, aDest));
+    default:
+        return _mm256_mul_ps(aSrc, aDestAlpha);
+    }
+}
+
+template <Image::CompositeOperation kOperation>
+IMGIO_TARGET_AVX2 inline __m256 blendColorAVX2(__m256 aSrc, __m256 aDest)
+{
+    switch (kOperation) {
+    case Image::CompositeOperation::kMultiply:
+        return _mm256_mul_ps(aSrc, aDest);
+    case Image::CompositeOperation::kScreen:
+        return _mm256_sub_ps(_mm256_add_ps(aSrc, aDest), _mm256_mul_ps(aSrc, aDest));
+    default:
+        return aSrc;
+    }
+}
+
+// Blends samples converted from 32 bit integers, returns them as integers.
+template <Image::CompositeOperation kOperation, bool kPremultiplied>
+IMGIO_TARGET_AVX2 inline __m256i blendPixelsAVX2(__m256i aSrc, __m256i aDest, __m256 aMax, __m256 aScale)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    __m256 src = _mm256_mul_ps(_mm256_cvtepi32_ps(aSrc), aScale);
+    __m256 dest = _mm256_mul_ps(_mm256_cvtepi32_ps(aDest), aScale);
+
+    __m256 srcAlpha = _mm256_shuffle_ps(src, src, 0xff);
+    __m256 destAlpha = _mm256_shuffle_ps(dest, dest, 0xff);
+    if (kPremultiplied) {
+        __m256 value = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(src, _mm256_sub_ps(one, destAlpha)),
+                                                   _mm256_mul_ps(dest, _mm256_sub_ps(one, srcAlpha))),
+                                     blendPremultipliedAVX2<kOperation>(src, dest, srcAlpha, destAlpha));
+        value = _mm256_min_ps(_mm256_add_ps(_mm256_mul_ps(value, aMax), _mm256_set1_ps(0.5f)), aMax);
+        return _mm256_cvttps_epi32(value);
+    }
+
+    __m256 srcWeight = _mm256_mul_ps(srcAlpha, _mm256_sub_ps(one, destAlpha));
+    __m256 destWeight = _mm256_mul_ps(destAlpha, _mm256_sub_ps(one, srcAlpha));
+    __m256 blendWeight = _mm256_mul_ps(srcAlpha, destAlpha);
+    __m256 alpha = _mm256_sub_ps(_mm256_add_ps(srcAlpha, destAlpha), blendWeight);
+
+    __m256 color = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(src, srcWeight), _mm256_mul_ps(dest, destWeight)),
+                                 _mm256_mul_ps(blendColorAVX2<kOperation>(src, dest), blendWeight));
+    color = _mm256_and_ps(_mm256_div_ps(color, alpha), _mm256_cmp_ps(alpha, _mm256_setzero_ps(), _CMP_GT_OQ));
+    color = _mm256_blend_ps(color, alpha, 0x88);
+
+    color = _mm256_min_ps(_mm256_add_ps(_mm256_mul_ps(color, aMax), _mm256_set1_ps(0.5f)), aMax);
+    return _mm256_cvttps_epi32(color);
+}
+
+template <Image::CompositeOperation kOperation, bool kPremultiplied>
+IMGIO_TARGET_AVX2 void blendRow8BitAVX2(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    const __m256 max = _mm256_set1_ps(255.0f);
+    const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= aPixelsCount; i += 8) {
+        __m256i packed[2];
+        for (int half = 0; half < 2; ++half) {
+            const uint8_t* src = aSrc + 4 * (i + 4 * half);
+            const uint8_t* dest = aDest + 4 * (i + 4 * half);
+            __m256i pixels[2];
+            for (int p = 0; p < 2; ++p) {
+                __m256i s = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + 8 * p)));
+                __m256i d = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(dest + 8 * p)));
+                pixels[p] = blendPixelsAVX2<kOperation, kPremultiplied>(s, d, max, scale);
+            }
+            // Packing works within lanes, the permute restores the pixel order.
+            packed[half] = _mm256_permute4x64_epi64(_mm256_packs_epi32(pixels[0], pixels[1]), 0xd8);
+        }
+        __m256i result = _mm256_permute4x64_epi64(_mm256_packus_epi16(packed[0], packed[1]), 0xd8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + 4 * i), result);
+    }
+
+    if (i < aPixelsCount)
+        blendRow8BitSSE2<kOperation, kPremultiplied>(aSrc + 4 * i, aDest + 4 * i, aPixelsCount - i);
+}
+
+template <Image::CompositeOperation kOperation, bool kPremultiplied>
+IMGIO_TARGET_AVX2 void blendRow16BitAVX2(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    const __m256 max = _mm256_set1_ps(65535.0f);
+    const __m256 scale = _mm256_set1_ps(1.0f / 65535.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= aPixelsCount; i += 4) {
+        __m256i pixels[2];
+        for (int p = 0; p < 2; ++p) {
+            const __m128i* src = reinterpret_cast<const __m128i*>(aSrc + 8 * (i + 2 * p));
+            const __m128i* dest = reinterpret_cast<const __m128i*>(aDest + 8 * (i + 2 * p));
+            __m256i s = _mm256_cvtepu16_epi32(_mm_loadu_si128(src));
+            __m256i d = _mm256_cvtepu16_epi32(_mm_loadu_si128(dest));
+            pixels[p] = blendPixelsAVX2<kOperation, kPremultiplied>(s, d, max, scale);
+        }
+        __m256i result = _mm256_permute4x64_epi64(_mm256_packus_epi32(pixels[0], pixels[1]), 0xd8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + 8 * i), result);
+    }
+
+    if (i < aPixelsCount)
+        blendRow16BitSSE2<kOperation, kPremultiplied>(aSrc + 8 * i, aDest + 8 * i, aPixelsCount - i);
+}
+
+// Indexed by premultiplied alpha, operation (kSourceOver, kMultiply, kScreen) and depth.
+const BlendFunction kSSE2Functions[2][3][2] = {
+    {
+        {blendRow8BitSSE2<Image::CompositeOperation::kSourceOver, false>,
+         blendRow16BitSSE2<Image::CompositeOperation::kSourceOver, false>},
+        {blendRow8BitSSE2<Image::CompositeOperation::kMultiply, false>,
+         blendRow16BitSSE2<Image::CompositeOperation::kMultiply, false>},
+        {blendRow8BitSSE2<Image::CompositeOperation::kScreen, false>,
+         blendRow16BitSSE2<Image::CompositeOperation::kScreen, false>},
+    },
+    {
+        {blendRow8BitSSE2<Image::CompositeOperation::kSourceOver, true>,
+         blendRow16BitSSE2<Image::CompositeOperation::kSourceOver, true>},
+        {blendRow8BitSSE2<Image::CompositeOperation::kMultiply, true>,
+         blendRow16BitSSE2<Image::CompositeOperation::kMultiply, true>},
+        {blendRow8BitSSE2<Image::CompositeOperation::kScreen, true>,
+         blendRow16BitSSE2<Image::CompositeOperation::kScreen, true>},
+    },
+};
+
+const BlendFunction kAVX2Functions[2][3][2] = {
+    {
+        {blendRow8BitAVX2<Image::CompositeOperation::kSourceOver, false>,
+         blendRow16BitAVX2<Image::CompositeOperation::kSourceOver, false>},
+        {blendRow8BitAVX2<Image::CompositeOperation::kMultiply, false>,
+         blendRow16BitAVX2<Image::CompositeOperation::kMultiply, false>},
+        {blendRow8BitAVX2<Image::CompositeOperation::kScreen, false>,
+         blendRow16BitAVX2<Image::CompositeOperation::kScreen, false>},
+    },
+    {
+        {blendRow8BitAVX2<Image::CompositeOperation::kSourceOver, true>,
+         blendRow16BitAVX2<Image::CompositeOperation::kSourceOver, true>},
+        {blendRow8BitAVX2<Image::CompositeOperation::kMultiply, true>,
+         blendRow16BitAVX2<Image::CompositeOperation::kMultiply, true>},
+        {blendRow8BitAVX2<Image::CompositeOperation::kScreen, true>,
+         blendRow16BitAVX2<Image::CompositeOperation::kScreen, true>},
+    },
+};
+
+int operationIndex(Image::CompositeOperation aOperation)
+{
+    switch (aOperation) {
+    case Image::CompositeOperation::kSourceOver:
+        return 0;
+    case Image::CompositeOperation::kMultiply:
+        return 1;
+    case Image::CompositeOperation::kScreen:
+        return 2;
+    default:
+        return -1;
+    }
+}
+
+} // namespace
+
+BlendFunction simdBlendFunction(Simd::Level aLevel,
+                                Image::CompositeOperation aOperation,
+                                ColorSpec::Format aFormat,
+                                ColorSpec::ChannelDepth aChannelDepth)
+{
+    int operation = operationIndex(aOperation);
+    if (operation < 0)
+        return nullptr;
+
+    int premultiplied = (aFormat == ColorSpec::Format::kRGBAPremultiplied) ? 1 : 0;
+    int depth = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit) ? 1 : 0;
+
+    // There are no SSSE3 specific kernels, the level includes SSE2.
+    switch (aLevel) {
+    case Simd::Level::kAVX2:
+        return kAVX2Functions[premultiplied][operation][depth];
+    case Simd::Level::kSSSE3:
+    case Simd::Level::kSSE2:
+        return kSSE2Functions[premultiplied][operation][depth];
+    default:
+        return nullptr;
+    }
+}
+
+#else // IMGIO_X86_SIMD
+
+BlendFunction simdBlendFunction(Simd::Level aLevel,
+                                Image::CompositeOperation aOperation,
+                                ColorSpec::Format aFormat,
+                                ColorSpec::ChannelDepth aChannelDepth)
+{
+    return nullptr;
+}
+
+#endif // IMGIO_X86_SIMD
+
+} // namespace ImgIO
+
+// EOF
@@ -34,6 +34,42 @@ ColorSpec::ColorSpec(ColorSpec::Format aFormat, ColorSpec::ChannelDepth aChannel
 ColorSpec::~ColorSpec()
 {}
 
+size_t ColorSpec::channelCount(ColorSpec::Format aFormat)
+{
+    switch (aFormat) {
+    case Format::kMonochromatic:
+    case Format::kIndexed:
+        return 1;
+    case Format::kMonochromaticAlpha:
+        return 2;
+    case Format::kRGB:
+        return 3;
+    case Format::kRGBA:
+    case Format::kRGBAPremultiplied:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+ColorSpec::Format ColorSpec::opaqueFormat(ColorSpec::Format aFormat)
+{
+    switch (aFormat) {
+    case Format::kMonochromaticAlpha:
+        return Format::kMonochromatic;
+    case Format::kRGBA:
+    case Format::kRGBAPremultiplied:
+        return Format::kRGB;
+    default:
+        return aFormat;
+    }
+}
+
+size_t ColorSpec::pixelSize(ColorSpec::Format aFormat, ColorSpec::ChannelDepth aChannelDepth)
+{
+    return channelCount(aFormat) * static_cast<size_t>(aChannelDepth);
+}
+
 ColorSpec::ChannelDepth ColorSpec::channelDepth() const
 {
     return mImpl->channelDepth();
@@ -0,0 +1,132 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "convert.h"
+#include "convertsimd.h"
+
+namespace ImgIO
+{
+
+namespace
+{
+
+typedef ColorSpec::Format Format;
+typedef ColorSpec::ChannelDepth Depth;
+
+int formatIndex(Format aFormat)
+{
+    switch (aFormat) {
+    case Format::kMonochromatic:
+        return 0;
+    case Format::kRGB:
+        return 1;
+    case Format::kRGBA:
+        return 2;
+    case Format::kRGBAPremultiplied:
+        return 3;
+    case Format::kMonochromaticAlpha:
+        return 4;
+    default:
+        return -1;
+    }
+}
+
+int depthIndex(Depth aDepth)
+{
+    switch (aDepth) {
+    case Depth::k8Bit:
+        return 0;
+    case Depth::k16Bit:
+        return 1;
+    default:
+        return -1;
+    }
+}
+
+// Conversions from one format, indexed by destination format and depth.
+template <Format kSrcFormat, Depth kSrcDepth>
+ConvertFunction convertRowTo(int aDestFormat, int aDestDepth)
+{
+    static const ConvertFunction kFunctions[5][2] = {
+        {convertRow<kSrcFormat, kSrcDepth, Format::kMonochromatic, Depth::k8Bit>,
+         convertRow<kSrcFormat, kSrcDepth, Format::kMonochromatic, Depth::k16Bit>},
+        {convertRow<kSrcFormat, kSrcDepth, Format::kRGB, Depth::k8Bit>,
+         convertRow<kSrcFormat, kSrcDepth, Format::kRGB, Depth::k16Bit>},
+        {convertRow<kSrcFormat, kSrcDepth, Format::kRGBA, Depth::k8Bit>,
+         convertRow<kSrcFormat, kSrcDepth, Format::kRGBA, Depth::k16Bit>},
+        {convertRow<kSrcFormat, kSrcDepth, Format::kRGBAPremultiplied, Depth::k8Bit>,
+         convertRow<kSrcFormat, kSrcDepth, Format::kRGBAPremultiplied, Depth::k16Bit>},
+        {convertRow<kSrcFormat, kSrcDepth, Format::kMonochromaticAlpha, Depth::k8Bit>,
+         convertRow<kSrcFormat, kSrcDepth, Format::kMonochromaticAlpha, Depth::k16Bit>},
+    };
+    return kFunctions[aDestFormat][aDestDepth];
+}
+
+typedef ConvertFunction (*ConvertRowTo)(int aDestFormat, int aDestDepth);
+
+const ConvertRowTo kConvertRowTo[5][2] = {
+    {convertRowTo<Format::kMonochromatic, Depth::k8Bit>, convertRowTo<Format::kMonochromatic, Depth::k16Bit>},
+    {convertRowTo<Format::kRGB, Depth::k8Bit>, convertRowTo<Format::kRGB, Depth::k16Bit>},
+    {convertRowTo<Format::kRGBA, Depth::k8Bit>, convertRowTo<Format::kRGBA, Depth::k16Bit>},
+    {convertRowTo<Format::kRGBAPremultiplied, Depth::k8Bit>,
+     convertRowTo<Format::kRGBAPremultiplied, Depth::k16Bit>},
+    {convertRowTo<Format::kMonochromaticAlpha, Depth::k8Bit>,
+     convertRowTo<Format::kMonochromaticAlpha, Depth::k16Bit>},
+};
+
+} // namespace
+
+ConvertFunction scalarConvertFunction(ColorSpec::Format aSrcFormat,
+                                      ColorSpec::ChannelDepth aSrcChannelDepth,
+                                      ColorSpec::Format aDestFormat,
+                                      ColorSpec::ChannelDepth aDestChannelDepth)
+{
+    int srcFormat = formatIndex(aSrcFormat);
+    int srcDepth = depthIndex(aSrcChannelDepth);
+    int destFormat = formatIndex(aDestFormat);
+    int destDepth = depthIndex(aDestChannelDepth);
+    if ((srcFormat < 0) || (srcDepth < 0) || (destFormat < 0) || (destDepth < 0))
+        return nullptr;
+
+    return kConvertRowTo[srcFormat][srcDepth](destFormat, destDepth);
+}
+
+ConvertFunction convertFunction(ColorSpec::Format aSrcFormat,
+                                ColorSpec::ChannelDepth aSrcChannelDepth,
+                                ColorSpec::Format aDestFormat,
+                                ColorSpec::ChannelDepth aDestChannelDepth)
+{
+    ConvertFunction convertFunc = simdConvertFunction(Simd::level(),
+                                                      aSrcFormat,
+                                                      aSrcChannelDepth,
+                                                      aDestFormat,
+                                                      aDestChannelDepth);
+    if (!convertFunc)
+        convertFunc = scalarConvertFunction(aSrcFormat, aSrcChannelDepth, aDestFormat, aDestChannelDepth);
+
+    return convertFunc;
+}
+
+} // namespace ImgIO
+
+// EOF
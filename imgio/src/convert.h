@@ -0,0 +1,216 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _CONVERT_H__
+#define _CONVERT_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <imgio/color.h>
+
+namespace ImgIO
+{
+
+typedef void (*ConvertFunction)(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount);
+
+template <ColorSpec::Format kFormat>
+struct FormatTraits;
+
+template <>
+struct FormatTraits<ColorSpec::Format::kMonochromatic>
+{
+    static const size_t kChannels = 1;
+    static const size_t kColorChannels = 1;
+    static const bool kHasAlpha = false;
+    static const bool kPremultiplied = false;
+};
+
+template <>
+struct FormatTraits<ColorSpec::Format::kMonochromaticAlpha>
+{
+    static const size_t kChannels = 2;
+    static const size_t kColorChannels = 1;
+    static const bool kHasAlpha = true;
+    static const bool kPremultiplied = false;
+};
+
+template <>
+struct FormatTraits<ColorSpec::Format::kRGB>
+{
+    static const size_t kChannels = 3;
+    static const size_t kColorChannels = 3;
+    static const bool kHasAlpha = false;
+    static const bool kPremultiplied = false;
+};
+
+template <>
+struct FormatTraits<ColorSpec::Format::kRGBA>
+{
+    static const size_t kChannels = 4;
+    static const size_t kColorChannels = 3;
+    static const bool kHasAlpha = true;
+    static const bool kPremultiplied = false;
+};
+
+template <>
+struct FormatTraits<ColorSpec::Format::kRGBAPremultiplied>
+{
+    static const size_t kChannels = 4;
+    static const size_t kColorChannels = 3;
+    static const bool kHasAlpha = true;
+    static const bool kPremultiplied = true;
+};
+
+template <ColorSpec::ChannelDepth kDepth>
+struct DepthTraits;
+
+template <>
+struct DepthTraits<ColorSpec::ChannelDepth::k8Bit>
+{
+    typedef uint8_t Sample;
+    static const uint32_t kMax = 0xff;
+};
+
+template <>
+struct DepthTraits<ColorSpec::ChannelDepth::k16Bit>
+{
+    typedef uint16_t Sample;
+    static const uint32_t kMax = 0xffff;
+};
+
+// Widening replicates the byte (v * 257), so white stays white.
+template <ColorSpec::ChannelDepth kSrcDepth, ColorSpec::ChannelDepth kDestDepth>
+inline typename DepthTraits<kDestDepth>::Sample convertSample(uint32_t aValue)
+{
+    typedef typename DepthTraits<kDestDepth>::Sample Sample;
+
+    if (kSrcDepth == kDestDepth)
+        return static_cast<Sample>(aValue);
+    if (kDestDepth == ColorSpec::ChannelDepth::k16Bit)
+        return static_cast<Sample>(aValue * 257);
+    return static_cast<Sample>(aValue >> 8);
+}
+
+// Rec. 601 luma with 16 bit fixed point weights, at the depth of the input.
+inline uint32_t luma(uint32_t aRed, uint32_t aGreen, uint32_t aBlue)
+{
+    return (19595 * aRed + 38470 * aGreen + 7471 * aBlue + 32768) >> 16;
+}
+
+// Rounded c * a / max, exact for both depths.
+template <ColorSpec::ChannelDepth kDepth>
+inline uint32_t premultiply(uint32_t aColor, uint32_t aAlpha)
+{
+    const uint32_t kShift = (kDepth == ColorSpec::ChannelDepth::k8Bit) ? 8 : 16;
+    uint32_t t = aColor * aAlpha + (1u << (kShift - 1));
+    return (t + (t >> kShift)) >> kShift;
+}
+
+// Rounded c * max / a, colors of fully transparent pixels are lost.
+template <ColorSpec::ChannelDepth kDepth>
+inline uint32_t unpremultiply(uint32_t aColor, uint32_t aAlpha)
+{
+    const float kMax = static_cast<float>(DepthTraits<kDepth>::kMax);
+
+    if (aAlpha == 0)
+        return 0;
+    float value = static_cast<float>(aColor) * kMax / static_cast<float>(aAlpha) + 0.5f;
+    return (value < kMax) ? static_cast<uint32_t>(value) : DepthTraits<kDepth>::kMax;
+}
+
+/**
+ * Converts a row of pixels. Gray is replicated into RGB, RGB is reduced to
+ * its luma, alpha is dropped or set to opaque. Premultiplied colors are
+ * divided by alpha at the source depth and multiplied at the destination one.
+ */
+template <ColorSpec::Format kSrcFormat,
+          ColorSpec::ChannelDepth kSrcDepth,
+          ColorSpec::Format kDestFormat,
+          ColorSpec::ChannelDepth kDestDepth>
+void convertRow(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    typedef FormatTraits<kSrcFormat> Src;
+    typedef FormatTraits<kDestFormat> Dest;
+    typedef typename DepthTraits<kSrcDepth>::Sample SrcSample;
+    typedef typename DepthTraits<kDestDepth>::Sample DestSample;
+
+    const SrcSample* src = reinterpret_cast<const SrcSample*>(aSrc);
+    DestSample* dest = reinterpret_cast<DestSample*>(aDest);
+
+    for (size_t i = 0; i < aPixelsCount; ++i, src += Src::kChannels, dest += Dest::kChannels) {
+        uint32_t color[Src::kColorChannels];
+        uint32_t alpha = Src::kHasAlpha ? src[Src::kChannels - 1] : DepthTraits<kSrcDepth>::kMax;
+
+        for (size_t c = 0; c < Src::kColorChannels; ++c) {
+            if (Src::kPremultiplied && !Dest::kPremultiplied)
+                color[c] = unpremultiply<kSrcDepth>(src[c], alpha);
+            else
+                color[c] = src[c];
+        }
+
+        if (Src::kColorChannels == Dest::kColorChannels) {
+            for (size_t c = 0; c < Dest::kColorChannels; ++c)
+                dest[c] = convertSample<kSrcDepth, kDestDepth>(color[c]);
+        } else if (Dest::kColorChannels == 1) {
+            dest[0] = convertSample<kSrcDepth, kDestDepth>(luma(color[0], color[1], color[2]));
+        } else {
+            DestSample gray = convertSample<kSrcDepth, kDestDepth>(color[0]);
+            dest[0] = gray;
+            dest[1] = gray;
+            dest[2] = gray;
+        }
+
+        if (Dest::kHasAlpha) {
+            DestSample destAlpha = convertSample<kSrcDepth, kDestDepth>(alpha);
+
+            dest[Dest::kChannels - 1] = destAlpha;
+            if (Dest::kPremultiplied && !Src::kPremultiplied) {
+                for (size_t c = 0; c < Dest::kColorChannels; ++c)
+                    dest[c] = static_cast<DestSample>(premultiply<kDestDepth>(dest[c], destAlpha));
+            }
+        }
+    }
+}
+
+/**
+ * Returns the plain C++ row conversion.
+ * @return Conversion function or nullptr, when there is none.
+ */
+ConvertFunction scalarConvertFunction(ColorSpec::Format aSrcFormat,
+                                      ColorSpec::ChannelDepth aSrcChannelDepth,
+                                      ColorSpec::Format aDestFormat,
+                                      ColorSpec::ChannelDepth aDestChannelDepth);
+
+/**
+ * Returns the fastest row conversion for the current Simd::level().
+ * @return Conversion function or nullptr, when there is none.
+ */
+ConvertFunction convertFunction(ColorSpec::Format aSrcFormat,
+                                ColorSpec::ChannelDepth aSrcChannelDepth,
+                                ColorSpec::Format aDestFormat,
+                                ColorSpec::ChannelDepth aDestChannelDepth);
+
+} // namespace ImgIO
+
+#endif // _CONVERT_H__
+// EOF
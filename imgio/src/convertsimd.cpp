@@ -0,0 +1,949 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "convertsimd.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMGIO_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace ImgIO
+{
+
+#ifdef IMGIO_X86_SIMD
+
+#define IMGIO_TARGET_SSE2 __attribute__((target("sse2")))
+#define IMGIO_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define IMGIO_TARGET_AVX2 __attribute__((target("avx2")))
+
+namespace
+{
+
+//
+// Channel depth conversions of whole rows, the channel layout is unchanged.
+// Widening replicates the byte (v * 257), so 0xff becomes 0xffff.
+//
+
+IMGIO_TARGET_SSE2 void widenSSE2(const uint8_t* aSrc, uint8_t* aDest, size_t aBytesCount)
+{
+    size_t i = 0;
+    for (; i + 16 <= aBytesCount; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + 2 * i), _mm_unpacklo_epi8(v, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + 2 * i + 16), _mm_unpackhi_epi8(v, v));
+    }
+    for (; i < aBytesCount; ++i) {
+        uint16_t value = static_cast<uint16_t>(aSrc[i] * 257);
+        std::memcpy(aDest + 2 * i, &value, sizeof(value));
+    }
+}
+
+IMGIO_TARGET_SSE2 void narrowSSE2(const uint8_t* aSrc, uint8_t* aDest, size_t aSamplesCount)
+{
+    size_t i = 0;
+    for (; i + 16 <= aSamplesCount; i += 16) {
+        __m128i a = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 2 * i)), 8);
+        __m128i b = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 2 * i + 16)), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + i), _mm_packus_epi16(a, b));
+    }
+    for (; i < aSamplesCount; ++i) {
+        uint16_t value;
+        std::memcpy(&value, aSrc + 2 * i, sizeof(value));
+        aDest[i] = static_cast<uint8_t>(value >> 8);
+    }
+}
+
+IMGIO_TARGET_AVX2 void widenAVX2(const uint8_t* aSrc, uint8_t* aDest, size_t aBytesCount)
+{
+    size_t i = 0;
+    for (; i + 32 <= aBytesCount; i += 32) {
+        __m256i v = _mm256_permute4x64_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc + i)), 0xd8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + 2 * i), _mm256_unpacklo_epi8(v, v));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + 2 * i + 32), _mm256_unpackhi_epi8(v, v));
+    }
+    widenSSE2(aSrc + i, aDest + 2 * i, aBytesCount - i);
+}
+
+IMGIO_TARGET_AVX2 void narrowAVX2(const uint8_t* aSrc, uint8_t* aDest, size_t aSamplesCount)
+{
+    size_t i = 0;
+    for (; i + 32 <= aSamplesCount; i += 32) {
+        __m256i a = _mm256_srli_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc + 2 * i)), 8);
+        __m256i b = _mm256_srli_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc + 2 * i + 32)), 8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8));
+    }
+    narrowSSE2(aSrc + 2 * i, aDest + i, aSamplesCount - i);
+}
+
+template <size_t kChannels>
+void widenRowSSE2(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    widenSSE2(aSrc, aDest, aPixelsCount * kChannels);
+}
+
+template <size_t kChannels>
+void narrowRowSSE2(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    narrowSSE2(aSrc, aDest, aPixelsCount * kChannels);
+}
+
+template <size_t kChannels>
+void widenRowAVX2(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    widenAVX2(aSrc, aDest, aPixelsCount * kChannels);
+}
+
+template <size_t kChannels>
+void narrowRowAVX2(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    narrowAVX2(aSrc, aDest, aPixelsCount * kChannels);
+}
+
+//
+// SSSE3 kernels: four pixels per step, held in registers as RGBA with the
+// alpha filled in for RGB sources.
+//
+
+struct RGBA8x4
+{
+    __m128i v;
+};
+
+struct RGBA16x4
+{
+    __m128i lo;
+    __m128i hi;
+};
+
+IMGIO_TARGET_SSSE3 inline __m128i load12(const uint8_t* aSrc)
+{
+    int32_t tail;
+    std::memcpy(&tail, aSrc + 8, sizeof(tail));
+    return _mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(aSrc)), _mm_cvtsi32_si128(tail));
+}
+
+IMGIO_TARGET_SSSE3 inline void store12(uint8_t* aDest, __m128i aValue)
+{
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(aDest), aValue);
+    int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(aValue, 8));
+    std::memcpy(aDest + 8, &tail, sizeof(tail));
+}
+
+IMGIO_TARGET_SSSE3 inline void convertPixels(const RGBA8x4& aSrc, RGBA8x4& aDest)
+{
+    aDest = aSrc;
+}
+
+IMGIO_TARGET_SSSE3 inline void convertPixels(const RGBA16x4& aSrc, RGBA16x4& aDest)
+{
+    aDest = aSrc;
+}
+
+IMGIO_TARGET_SSSE3 inline void convertPixels(const RGBA8x4& aSrc, RGBA16x4& aDest)
+{
+    aDest.lo = _mm_unpacklo_epi8(aSrc.v, aSrc.v);
+    aDest.hi = _mm_unpackhi_epi8(aSrc.v, aSrc.v);
+}
+
+IMGIO_TARGET_SSSE3 inline void convertPixels(const RGBA16x4& aSrc, RGBA8x4& aDest)
+{
+    aDest.v = _mm_packus_epi16(_mm_srli_epi16(aSrc.lo, 8), _mm_srli_epi16(aSrc.hi, 8));
+}
+
+struct RGB8SSSE3
+{
+    typedef RGBA8x4 Pixels;
+    static const size_t kPixelSize = 3;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kRGB;
+    static const ColorSpec::ChannelDepth kDepth = ColorSpec::ChannelDepth::k8Bit;
+
+    IMGIO_TARGET_SSSE3 static Pixels load(const uint8_t* aSrc)
+    {
+        const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha = _mm_set1_epi32(static_cast<int32_t>(0xff000000));
+        return Pixels{_mm_or_si128(_mm_shuffle_epi8(load12(aSrc), expand), alpha)};
+    }
+
+    IMGIO_TARGET_SSSE3 static void store(uint8_t* aDest, const Pixels& aPixels)
+    {
+        const __m128i compact = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        store12(aDest, _mm_shuffle_epi8(aPixels.v, compact));
+    }
+};
+
+struct RGBA8SSSE3
+{
+    typedef RGBA8x4 Pixels;
+    static const size_t kPixelSize = 4;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kRGBA;
+    static const ColorSpec::ChannelDepth kDepth = ColorSpec::ChannelDepth::k8Bit;
+
+    IMGIO_TARGET_SSSE3 static Pixels load(const uint8_t* aSrc)
+    {
+        return Pixels{_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc))};
+    }
+
+    IMGIO_TARGET_SSSE3 static void store(uint8_t* aDest, const Pixels& aPixels)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest), aPixels.v);
+    }
+};
+
+struct RGB16SSSE3
+{
+    typedef RGBA16x4 Pixels;
+    static const size_t kPixelSize = 6;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kRGB;
+    static const ColorSpec::ChannelDepth kDepth = ColorSpec::ChannelDepth::k16Bit;
+
+    IMGIO_TARGET_SSSE3 static Pixels load(const uint8_t* aSrc)
+    {
+        // Pixels 0 and 1 are bytes 0-11 of the first load, pixels 2 and 3
+        // bytes 4-15 of the second one, so nothing past the pixels is read.
+        const __m128i expandLo = _mm_setr_epi8(0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11, -1, -1);
+        const __m128i expandHi = _mm_setr_epi8(4, 5, 6, 7, 8, 9, -1, -1, 10, 11, 12, 13, 14, 15, -1, -1);
+        const __m128i alpha = _mm_set1_epi64x(static_cast<int64_t>(0xffff000000000000ull));
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 8));
+        return Pixels{_mm_or_si128(_mm_shuffle_epi8(lo, expandLo), alpha),
+                      _mm_or_si128(_mm_shuffle_epi8(hi, expandHi), alpha)};
+    }
+
+    IMGIO_TARGET_SSSE3 static void store(uint8_t* aDest, const Pixels& aPixels)
+    {
+        const __m128i compact = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, -1, -1, -1, -1);
+        __m128i lo = _mm_shuffle_epi8(aPixels.lo, compact);
+        __m128i hi = _mm_shuffle_epi8(aPixels.hi, compact);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest), _mm_or_si128(lo, _mm_slli_si128(hi, 12)));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(aDest + 16), _mm_srli_si128(hi, 4));
+    }
+};
+
+struct RGBA16SSSE3
+{
+    typedef RGBA16x4 Pixels;
+    static const size_t kPixelSize = 8;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kRGBA;
+    static const ColorSpec::ChannelDepth kDepth = ColorSpec::ChannelDepth::k16Bit;
+
+    IMGIO_TARGET_SSSE3 static Pixels load(const uint8_t* aSrc)
+    {
+        return Pixels{_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc)),
+                      _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 16))};
+    }
+
+    IMGIO_TARGET_SSSE3 static void store(uint8_t* aDest, const Pixels& aPixels)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest), aPixels.lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + 16), aPixels.hi);
+    }
+};
+
+// Rec. 601 luma of four RGBA pixels as 32 bit integers, the same fixed
+// point sum as luma(). Green is doubled first, so that all the weights fit
+// signed 16 bit madd operands.
+IMGIO_TARGET_SSSE3 inline __m128i lumaSSSE3(__m128i aPixels)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i doubleGreen = _mm_setr_epi16(1, 2, 1, 0, 1, 2, 1, 0);
+    const __m128i weights = _mm_setr_epi16(19595, 19235, 7471, 0, 19595, 19235, 7471, 0);
+    __m128i lo = _mm_madd_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(aPixels, zero), doubleGreen), weights);
+    __m128i hi = _mm_madd_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(aPixels, zero), doubleGreen), weights);
+    return _mm_srli_epi32(_mm_add_epi32(_mm_hadd_epi32(lo, hi), _mm_set1_epi32(32768)), 16);
+}
+
+// Luma of four RGBA pixels in the low four bytes.
+IMGIO_TARGET_SSSE3 inline __m128i grayBytesSSSE3(__m128i aPixels)
+{
+    __m128i luma = _mm_packs_epi32(lumaSSSE3(aPixels), lumaSSSE3(aPixels));
+    return _mm_packus_epi16(luma, luma);
+}
+
+struct Mono8SSSE3
+{
+    typedef RGBA8x4 Pixels;
+    static const size_t kPixelSize = 1;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kMonochromatic;
+    static const ColorSpec::ChannelDepth kDepth = ColorSpec::ChannelDepth::k8Bit;
+
+    IMGIO_TARGET_SSSE3 static Pixels load(const uint8_t* aSrc)
+    {
+        const __m128i expand = _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1);
+        const __m128i alpha = _mm_set1_epi32(static_cast<int32_t>(0xff000000));
+        int32_t gray;
+        std::memcpy(&gray, aSrc, sizeof(gray));
+        return Pixels{_mm_or_si128(_mm_shuffle_epi8(_mm_cvtsi32_si128(gray), expand), alpha)};
+    }
+
+    IMGIO_TARGET_SSSE3 static void store(uint8_t* aDest, const Pixels& aPixels)
+    {
+        int32_t gray = _mm_cvtsi128_si32(grayBytesSSSE3(aPixels.v));
+        std::memcpy(aDest, &gray, sizeof(gray));
+    }
+};
+
+struct MonoAlpha8SSSE3
+{
+    typedef RGBA8x4 Pixels;
+    static const size_t kPixelSize = 2;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kMonochromaticAlpha;
+    static const ColorSpec::ChannelDepth kDepth = ColorSpec::ChannelDepth::k8Bit;
+
+    IMGIO_TARGET_SSSE3 static Pixels load(const uint8_t* aSrc)
+    {
+        const __m128i expand = _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7);
+        return Pixels{_mm_shuffle_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(aSrc)), expand)};
+    }
+
+    IMGIO_TARGET_SSSE3 static void store(uint8_t* aDest, const Pixels& aPixels)
+    {
+        const __m128i alphas = _mm_setr_epi8(3, 7, 11, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        __m128i pixels = _mm_unpacklo_epi8(grayBytesSSSE3(aPixels.v), _mm_shuffle_epi8(aPixels.v, alphas));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(aDest), pixels);
+    }
+};
+
+template <class Src, class Dest>
+IMGIO_TARGET_SSSE3 void convertSSSE3(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    size_t i = 0;
+    for (; i + 4 <= aPixelsCount; i += 4) {
+        typename Dest::Pixels pixels;
+        convertPixels(Src::load(aSrc + i * Src::kPixelSize), pixels);
+        Dest::store(aDest + i * Dest::kPixelSize, pixels);
+    }
+    if (i < aPixelsCount)
+        convertRow<Src::kFormat, Src::kDepth, Dest::kFormat, Dest::kDepth>(aSrc + i * Src::kPixelSize,
+                                                                           aDest + i * Dest::kPixelSize,
+                                                                           aPixelsCount - i);
+}
+
+//
+// AVX2 kernels: eight pixels per step, the shuffles work within 128 bit
+// lanes, so each lane holds four consecutive pixels.
+//
+
+struct RGBA8x8
+{
+    __m256i v;
+};
+
+struct RGBA16x8
+{
+    __m256i lo;
+    __m256i hi;
+};
+
+IMGIO_TARGET_AVX2 inline void convertPixels(const RGBA8x8& aSrc, RGBA8x8& aDest)
+{
+    aDest = aSrc;
+}
+
+IMGIO_TARGET_AVX2 inline void convertPixels(const RGBA16x8& aSrc, RGBA16x8& aDest)
+{
+    aDest = aSrc;
+}
+
+IMGIO_TARGET_AVX2 inline void convertPixels(const RGBA8x8& aSrc, RGBA16x8& aDest)
+{
+    __m256i lo = _mm256_unpacklo_epi8(aSrc.v, aSrc.v);
+    __m256i hi = _mm256_unpackhi_epi8(aSrc.v, aSrc.v);
+    aDest.lo = _mm256_permute2x128_si256(lo, hi, 0x20);
+    aDest.hi = _mm256_permute2x128_si256(lo, hi, 0x31);
+}
+
+IMGIO_TARGET_AVX2 inline void convertPixels(const RGBA16x8& aSrc, RGBA8x8& aDest)
+{
+    __m256i packed = _mm256_packus_epi16(_mm256_srli_epi16(aSrc.lo, 8), _mm256_srli_epi16(aSrc.hi, 8));
+    aDest.v = _mm256_permute4x64_epi64(packed, 0xd8);
+}
+
+// Stores the low 12 bytes of both lanes as 24 consecutive bytes.
+IMGIO_TARGET_AVX2 inline void store24(uint8_t* aDest, __m256i aValue)
+{
+    __m256i packed = _mm256_permutevar8x32_epi32(aValue, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest), _mm256_castsi256_si128(packed));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(aDest + 16), _mm256_extracti128_si256(packed, 1));
+}
+
+struct RGB8AVX2
+{
+    typedef RGBA8x8 Pixels;
+    static const size_t kPixelSize = 3;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kRGB;
+    static const ColorSpec::ChannelDepth kDepth = ColorSpec::ChannelDepth::k8Bit;
+
+    IMGIO_TARGET_AVX2 static Pixels load(const uint8_t* aSrc)
+    {
+        const __m256i expand = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                                0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m256i alpha = _mm256_set1_epi32(static_cast<int32_t>(0xff000000));
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(load12(aSrc)), load12(aSrc + 12), 1);
+        return Pixels{_mm256_or_si256(_mm256_shuffle_epi8(v, expand), alpha)};
+    }
+
+    IMGIO_TARGET_AVX2 static void store(uint8_t* aDest, const Pixels& aPixels)
+    {
+        const __m256i compact = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                                 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        store24(aDest, _mm256_shuffle_epi8(aPixels.v, compact));
+    }
+};
+
+struct RGBA8AVX2
+{
+    typedef RGBA8x8 Pixels;
+    static const size_t kPixelSize = 4;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kRGBA;
+    static const ColorSpec::ChannelDepth kDepth = ColorSpec::ChannelDepth::k8Bit;
+
+    IMGIO_TARGET_AVX2 static Pixels load(const uint8_t* aSrc)
+    {
+        return Pixels{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc))};
+    }
+
+    IMGIO_TARGET_AVX2 static void store(uint8_t* aDest, const Pixels& aPixels)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest), aPixels.v);
+    }
+};
+
+struct RGB16AVX2
+{
+    typedef RGBA16x8 Pixels;
+    static const size_t kPixelSize = 6;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kRGB;
+    static const ColorSpec::ChannelDepth kDepth = ColorSpec::ChannelDepth::k16Bit;
+
+    // Four pixels from 24 bytes, see RGB16SSSE3::load().
+    IMGIO_TARGET_AVX2 static __m256i load4(const uint8_t* aSrc)
+    {
+        const __m256i expand = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11, -1, -1,
+                                                4, 5, 6, 7, 8, 9, -1, -1, 10, 11, 12, 13, 14, 15, -1, -1);
+        const __m256i alpha = _mm256_set1_epi64x(static_cast<int64_t>(0xffff000000000000ull));
+        __m256i v = _mm256_loadu2_m128i(reinterpret_cast<const __m128i*>(aSrc + 8), reinterpret_cast<const __m128i*>(aSrc));
+        return _mm256_or_si256(_mm256_shuffle_epi8(v, expand), alpha);
+    }
+
+    IMGIO_TARGET_AVX2 static Pixels load(const uint8_t* aSrc)
+    {
+        return Pixels{load4(aSrc), load4(aSrc + 24)};
+    }
+
+    IMGIO_TARGET_AVX2 static void store(uint8_t* aDest, const Pixels& aPixels)
+    {
+        const __m256i compact = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, -1, -1, -1, -1,
+                                                 0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, -1, -1, -1, -1);
+        store24(aDest, _mm256_shuffle_epi8(aPixels.lo, compact));
+        store24(aDest + 24, _mm256_shuffle_epi8(aPixels.hi, compact));
+    }
+};
+
+struct RGBA16AVX2
+{
+    typedef RGBA16x8 Pixels;
+    static const size_t kPixelSize = 8;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kRGBA;
+    static const ColorSpec::ChannelDepth kDepth = ColorSpec::ChannelDepth::k16Bit;
+
+    IMGIO_TARGET_AVX2 static Pixels load(const uint8_t* aSrc)
+    {
+        return Pixels{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc)),
+                      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc + 32))};
+    }
+
+    IMGIO_TARGET_AVX2 static void store(uint8_t* aDest, const Pixels& aPixels)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest), aPixels.lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + 32), aPixels.hi);
+    }
+};
+
+// Luma of eight RGBA pixels as 32 bit integers, four per lane, see lumaSSSE3().
+IMGIO_TARGET_AVX2 inline __m256i lumaAVX2(__m256i aPixels)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i doubleGreen = _mm256_setr_epi16(1, 2, 1, 0, 1, 2, 1, 0, 1, 2, 1, 0, 1, 2, 1, 0);
+    const __m256i weights = _mm256_setr_epi16(19595, 19235, 7471, 0, 19595, 19235, 7471, 0,
+                                              19595, 19235, 7471, 0, 19595, 19235, 7471, 0);
+    __m256i lo = _mm256_madd_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(aPixels, zero), doubleGreen), weights);
+    __m256i hi = _mm256_madd_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(aPixels, zero), doubleGreen), weights);
+    return _mm256_srli_epi32(_mm256_add_epi32(_mm256_hadd_epi32(lo, hi), _mm256_set1_epi32(32768)), 16);
+}
+
+// Luma of eight RGBA pixels in the low four bytes of each lane.
+IMGIO_TARGET_AVX2 inline __m256i grayBytesAVX2(__m256i aPixels)
+{
+    __m256i luma = _mm256_packs_epi32(lumaAVX2(aPixels), lumaAVX2(aPixels));
+    return _mm256_packus_epi16(luma, luma);
+}
+
+struct Mono8AVX2
+{
+    typedef RGBA8x8 Pixels;
+    static const size_t kPixelSize = 1;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kMonochromatic;
+    static const ColorSpec::ChannelDepth kDepth = ColorSpec::ChannelDepth::k8Bit;
+
+    IMGIO_TARGET_AVX2 static Pixels load(const uint8_t* aSrc)
+    {
+        const __m256i expand = _mm256_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1,
+                                                4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1);
+        const __m256i alpha = _mm256_set1_epi32(static_cast<int32_t>(0xff000000));
+        __m256i v = _mm256_broadcastsi128_si256(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(aSrc)));
+        return Pixels{_mm256_or_si256(_mm256_shuffle_epi8(v, expand), alpha)};
+    }
+
+    IMGIO_TARGET_AVX2 static void store(uint8_t* aDest, const Pixels& aPixels)
+    {
+        __m256i gray = _mm256_permutevar8x32_epi32(grayBytesAVX2(aPixels.v), _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(aDest), _mm256_castsi256_si128(gray));
+    }
+};
+
+struct MonoAlpha8AVX2
+{
+    typedef RGBA8x8 Pixels;
+    static const size_t kPixelSize = 2;
+    static const ColorSpec::Format kFormat = ColorSpec::Format::kMonochromaticAlpha;
+    static const ColorSpec::ChannelDepth kDepth = ColorSpec::ChannelDepth::k8Bit;
+
+    IMGIO_TARGET_AVX2 static Pixels load(const uint8_t* aSrc)
+    {
+        const __m256i expand = _mm256_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7,
+                                                8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+        __m256i v = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc)));
+        return Pixels{_mm256_shuffle_epi8(v, expand)};
+    }
+
+    IMGIO_TARGET_AVX2 static void store(uint8_t* aDest, const Pixels& aPixels)
+    {
+        const __m256i alphas = _mm256_setr_epi8(3, 7, 11, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                3, 7, 11, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        __m256i pixels = _mm256_unpacklo_epi8(grayBytesAVX2(aPixels.v), _mm256_shuffle_epi8(aPixels.v, alphas));
+        pixels = _mm256_permute4x64_epi64(pixels, 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest), _mm256_castsi256_si128(pixels));
+    }
+};
+
+template <class Src, class Dest>
+IMGIO_TARGET_AVX2 void convertAVX2(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    size_t i = 0;
+    for (; i + 8 <= aPixelsCount; i += 8) {
+        typename Dest::Pixels pixels;
+        convertPixels(Src::load(aSrc + i * Src::kPixelSize), pixels);
+        Dest::store(aDest + i * Dest::kPixelSize, pixels);
+    }
+    if (i < aPixelsCount)
+        convertRow<Src::kFormat, Src::kDepth, Dest::kFormat, Dest::kDepth>(aSrc + i * Src::kPixelSize,
+                                                                           aDest + i * Dest::kPixelSize,
+                                                                           aPixelsCount - i);
+}
+
+//
+// Premultiplication of 8 bit RGBA rows. Colors are multiplied by alpha with
+// the exact rounded division by 255, division goes through floats in the
+// same order of operations as the scalar unpremultiply(), so both paths give
+// identical results.
+//
+
+// Rounded aValue / 255 of 16 bit products.
+IMGIO_TARGET_SSE2 inline __m128i div255SSE2(__m128i aValue)
+{
+    __m128i t = _mm_add_epi16(aValue, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// Multiplies two pixels of 16 bit samples by their alpha, alpha itself by 255.
+IMGIO_TARGET_SSE2 inline __m128i premultiplySSE2(__m128i aPixels)
+{
+    const __m128i alphaMask = _mm_set1_epi64x(static_cast<int64_t>(0xffff000000000000ull));
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(aPixels, 0xff), 0xff);
+    alpha = _mm_or_si128(_mm_andnot_si128(alphaMask, alpha), _mm_and_si128(alphaMask, _mm_set1_epi16(255)));
+    return div255SSE2(_mm_mullo_epi16(aPixels, alpha));
+}
+
+IMGIO_TARGET_SSE2 void premultiplyRowSSE2(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= aPixelsCount; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 4 * i));
+        __m128i lo = premultiplySSE2(_mm_unpacklo_epi8(v, zero));
+        __m128i hi = premultiplySSE2(_mm_unpackhi_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + 4 * i), _mm_packus_epi16(lo, hi));
+    }
+    if (i < aPixelsCount)
+        convertRow<ColorSpec::Format::kRGBA,
+                   ColorSpec::ChannelDepth::k8Bit,
+                   ColorSpec::Format::kRGBAPremultiplied,
+                   ColorSpec::ChannelDepth::k8Bit>(aSrc + 4 * i, aDest + 4 * i, aPixelsCount - i);
+}
+
+// Divides one pixel of float samples by its alpha, zero alpha gives zero.
+IMGIO_TARGET_SSE2 inline __m128i unpremultiplySSE2(__m128i aPixel)
+{
+    const __m128 max = _mm_set1_ps(255.0f);
+    __m128 color = _mm_cvtepi32_ps(aPixel);
+    __m128 alpha = _mm_shuffle_ps(color, color, 0xff);
+    __m128 value = _mm_add_ps(_mm_div_ps(_mm_mul_ps(color, max), alpha), _mm_set1_ps(0.5f));
+    value = _mm_andnot_ps(_mm_cmpeq_ps(alpha, _mm_setzero_ps()), _mm_min_ps(value, max));
+    return _mm_cvttps_epi32(value);
+}
+
+IMGIO_TARGET_SSE2 void unpremultiplyRowSSE2(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int32_t>(0xff000000));
+    size_t i = 0;
+    for (; i + 4 <= aPixelsCount; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 4 * i));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        __m128i p0 = unpremultiplySSE2(_mm_unpacklo_epi16(lo, zero));
+        __m128i p1 = unpremultiplySSE2(_mm_unpackhi_epi16(lo, zero));
+        __m128i p2 = unpremultiplySSE2(_mm_unpacklo_epi16(hi, zero));
+        __m128i p3 = unpremultiplySSE2(_mm_unpackhi_epi16(hi, zero));
+        __m128i colors = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+        __m128i result = _mm_or_si128(_mm_andnot_si128(alphaMask, colors), _mm_and_si128(alphaMask, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + 4 * i), result);
+    }
+    if (i < aPixelsCount)
+        convertRow<ColorSpec::Format::kRGBAPremultiplied,
+                   ColorSpec::ChannelDepth::k8Bit,
+                   ColorSpec::Format::kRGBA,
+                   ColorSpec::ChannelDepth::k8Bit>(aSrc + 4 * i, aDest + 4 * i, aPixelsCount - i);
+}
+
+IMGIO_TARGET_AVX2 inline __m256i div255AVX2(__m256i aValue)
+{
+    __m256i t = _mm256_add_epi16(aValue, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+IMGIO_TARGET_AVX2 inline __m256i premultiplyAVX2(__m256i aPixels)
+{
+    const __m256i alphaMask = _mm256_set1_epi64x(static_cast<int64_t>(0xffff000000000000ull));
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(aPixels, 0xff), 0xff);
+    alpha = _mm256_blendv_epi8(alpha, _mm256_set1_epi16(255), alphaMask);
+    return div255AVX2(_mm256_mullo_epi16(aPixels, alpha));
+}
+
+IMGIO_TARGET_AVX2 void premultiplyRowAVX2(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= aPixelsCount; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc + 4 * i));
+        __m256i lo = premultiplyAVX2(_mm256_unpacklo_epi8(v, zero));
+        __m256i hi = premultiplyAVX2(_mm256_unpackhi_epi8(v, zero));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + 4 * i), _mm256_packus_epi16(lo, hi));
+    }
+    premultiplyRowSSE2(aSrc + 4 * i, aDest + 4 * i, aPixelsCount - i);
+}
+
+// Two pixels, one per 128 bit lane.
+IMGIO_TARGET_AVX2 inline __m256i unpremultiplyAVX2(__m256i aPixels)
+{
+    const __m256 max = _mm256_set1_ps(255.0f);
+    __m256 color = _mm256_cvtepi32_ps(aPixels);
+    __m256 alpha = _mm256_shuffle_ps(color, color, 0xff);
+    __m256 value = _mm256_add_ps(_mm256_div_ps(_mm256_mul_ps(color, max), alpha), _mm256_set1_ps(0.5f));
+    value = _mm256_andnot_ps(_mm256_cmp_ps(alpha, _mm256_setzero_ps(), _CMP_EQ_OQ), _mm256_min_ps(value, max));
+    return _mm256_cvttps_epi32(value);
+}
+
+IMGIO_TARGET_AVX2 void unpremultiplyRowAVX2(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int32_t>(0xff000000));
+    size_t i = 0;
+    for (; i + 8 <= aPixelsCount; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc + 4 * i));
+        __m256i lo = _mm256_unpacklo_epi8(v, zero);
+        __m256i hi = _mm256_unpackhi_epi8(v, zero);
+        __m256i p0 = unpremultiplyAVX2(_mm256_unpacklo_epi16(lo, zero));
+        __m256i p1 = unpremultiplyAVX2(_mm256_unpackhi_epi16(lo, zero));
+        __m256i p2 = unpremultiplyAVX2(_mm256_unpacklo_epi16(hi, zero));
+        __m256i p3 = unpremultiplyAVX2(_mm256_unpackhi_epi16(hi, zero));
+        __m256i colors = _mm256_packus_epi16(_mm256_packs_epi32(p0, p1), _mm256_packs_epi32(p2, p3));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + 4 * i), _mm256_blendv_epi8(colors, v, alphaMask));
+    }
+    unpremultiplyRowSSE2(aSrc + 4 * i, aDest + 4 * i, aPixelsCount - i);
+}
+
+// Table index of a format and depth: RGB8, RGB16, RGBA8, RGBA16, Mono8,
+// Mono16, MonoAlpha8, MonoAlpha16. Vectorized luma needs 8 bit sources,
+// gray to gray alpha and back is left to the compiler's vectorizer.
+int formatIndex(ColorSpec::Format aFormat, ColorSpec::ChannelDepth aChannelDepth)
+{
+    int depthIndex = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit) ? 1 : 0;
+    switch (aFormat) {
+    case ColorSpec::Format::kRGB:
+        return depthIndex;
+    case ColorSpec::Format::kRGBA:
+        return 2 + depthIndex;
+    case ColorSpec::Format::kMonochromatic:
+        return 4 + depthIndex;
+    case ColorSpec::Format::kMonochromaticAlpha:
+        return 6 + depthIndex;
+    default:
+        return -1;
+    }
+}
+
+const ConvertFunction kSSE2Functions[8][8] = {
+    // from RGB8
+    {nullptr, widenRowSSE2<3>, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr},
+    // from RGB16
+    {narrowRowSSE2<3>, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr},
+    // from RGBA8
+    {nullptr, nullptr, nullptr, widenRowSSE2<4>, nullptr, nullptr, nullptr, nullptr},
+    // from RGBA16
+    {nullptr, nullptr, narrowRowSSE2<4>, nullptr, nullptr, nullptr, nullptr, nullptr},
+    // from Mono8
+    {nullptr, nullptr, nullptr, nullptr, nullptr, widenRowSSE2<1>, nullptr, nullptr},
+    // from Mono16
+    {nullptr, nullptr, nullptr, nullptr, narrowRowSSE2<1>, nullptr, nullptr, nullptr},
+    // from MonoAlpha8
+    {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, widenRowSSE2<2>},
+    // from MonoAlpha16
+    {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, narrowRowSSE2<2>, nullptr},
+};
+
+const ConvertFunction kSSSE3Functions[8][8] = {
+    // from RGB8
+    {nullptr,
+     widenRowSSE2<3>,
+     convertSSSE3<RGB8SSSE3, RGBA8SSSE3>,
+     convertSSSE3<RGB8SSSE3, RGBA16SSSE3>,
+     convertSSSE3<RGB8SSSE3, Mono8SSSE3>,
+     nullptr,
+     convertSSSE3<RGB8SSSE3, MonoAlpha8SSSE3>,
+     nullptr},
+    // from RGB16
+    {narrowRowSSE2<3>,
+     nullptr,
+     convertSSSE3<RGB16SSSE3, RGBA8SSSE3>,
+     convertSSSE3<RGB16SSSE3, RGBA16SSSE3>,
+     nullptr,
+     nullptr,
+     nullptr,
+     nullptr},
+    // from RGBA8
+    {convertSSSE3<RGBA8SSSE3, RGB8SSSE3>,
+     convertSSSE3<RGBA8SSSE3, RGB16SSSE3>,
+     nullptr,
+     widenRowSSE2<4>,
+     convertSSSE3<RGBA8SSSE3, Mono8SSSE3>,
+     nullptr,
+     convertSSSE3<RGBA8SSSE3, MonoAlpha8SSSE3>,
+     nullptr},
+    // from RGBA16
+    {convertSSSE3<RGBA16SSSE3, RGB8SSSE3>,
+     convertSSSE3<RGBA16SSSE3, RGB16SSSE3>,
+     narrowRowSSE2<4>,
+     nullptr,
+     nullptr,
+     nullptr,
+     nullptr,
+     nullptr},
+    // from Mono8
+    {convertSSSE3<Mono8SSSE3, RGB8SSSE3>,
+     convertSSSE3<Mono8SSSE3, RGB16SSSE3>,
+     convertSSSE3<Mono8SSSE3, RGBA8SSSE3>,
+     convertSSSE3<Mono8SSSE3, RGBA16SSSE3>,
+     nullptr,
+     widenRowSSE2<1>,
+     nullptr,
+     nullptr},
+    // from Mono16
+    {nullptr,
+     nullptr,
+     nullptr,
+     nullptr,
+     narrowRowSSE2<1>,
+     nullptr,
+     nullptr,
+     nullptr},
+    // from MonoAlpha8
+    {convertSSSE3<MonoAlpha8SSSE3, RGB8SSSE3>,
+     convertSSSE3<MonoAlpha8SSSE3, RGB16SSSE3>,
+     convertSSSE3<MonoAlpha8SSSE3, RGBA8SSSE3>,
+     convertSSSE3<MonoAlpha8SSSE3, RGBA16SSSE3>,
+     nullptr,
+     nullptr,
+     nullptr,
+     widenRowSSE2<2>},
+    // from MonoAlpha16
+    {nullptr,
+     nullptr,
+     nullptr,
+     nullptr,
+     nullptr,
+     nullptr,
+     narrowRowSSE2<2>,
+     nullptr},
+};
+
+const ConvertFunction kAVX2Functions[8][8] = {
+    // from RGB8
+    {nullptr,
+     widenRowAVX2<3>,
+     convertAVX2<RGB8AVX2, RGBA8AVX2>,
+     convertAVX2<RGB8AVX2, RGBA16AVX2>,
+     convertAVX2<RGB8AVX2, Mono8AVX2>,
+     nullptr,
+     convertAVX2<RGB8AVX2, MonoAlpha8AVX2>,
+     nullptr},
+    // from RGB16
+    {narrowRowAVX2<3>,
+     nullptr,
+     convertAVX2<RGB16AVX2, RGBA8AVX2>,
+     convertAVX2<RGB16AVX2, RGBA16AVX2>,
+     nullptr,
+     nullptr,
+     nullptr,
+     nullptr},
+    // from RGBA8
+    {convertAVX2<RGBA8AVX2, RGB8AVX2>,
+     convertAVX2<RGBA8AVX2, RGB16AVX2>,
+     nullptr,
+     widenRowAVX2<4>,
+     convertAVX2<RGBA8AVX2, Mono8AVX2>,
+     nullptr,
+     convertAVX2<RGBA8AVX2, MonoAlpha8AVX2>,
+     nullptr},
+    // from RGBA16
+    {convertAVX2<RGBA16AVX2, RGB8AVX2>,
+     convertAVX2<RGBA16AVX2, RGB16AVX2>,
+     narrowRowAVX2<4>,
+     nullptr,
+     nullptr,
+     nullptr,
+     nullptr,
+     nullptr},
+    // from Mono8
+    {convertAVX2<Mono8AVX2, RGB8AVX2>,
+     convertAVX2<Mono8AVX2, RGB16AVX2>,
+     convertAVX2<Mono8AVX2, RGBA8AVX2>,
+     convertAVX2<Mono8AVX2, RGBA16AVX2>,
+     nullptr,
+     widenRowAVX2<1>,
+     nullptr,
+     nullptr},
+    // from Mono16
+    {nullptr,
+     nullptr,
+     nullptr,
+     nullptr,
+     narrowRowAVX2<1>,
+     nullptr,
+     nullptr,
+     nullptr},
+    // from MonoAlpha8
+    {convertAVX2<MonoAlpha8AVX2, RGB8AVX2>,
+     convertAVX2<MonoAlpha8AVX2, RGB16AVX2>,
+     convertAVX2<MonoAlpha8AVX2, RGBA8AVX2>,
+     convertAVX2<MonoAlpha8AVX2, RGBA16AVX2>,
+     nullptr,
+     nullptr,
+     nullptr,
+     widenRowAVX2<2>},
+    // from MonoAlpha16
+    {nullptr,
+     nullptr,
+     nullptr,
+     nullptr,
+     nullptr,
+     nullptr,
+     narrowRowAVX2<2>,
+     nullptr},
+};
+
+} // namespace
+
+ConvertFunction simdConvertFunction(Simd::Level aLevel,
+                                    ColorSpec::Format aSrcFormat,
+                                    ColorSpec::ChannelDepth aSrcChannelDepth,
+                                    ColorSpec::Format aDestFormat,
+                                    ColorSpec::ChannelDepth aDestChannelDepth)
+{
+    const ColorSpec::Format kPremultiplied = ColorSpec::Format::kRGBAPremultiplied;
+    const ColorSpec::ChannelDepth k8Bit = ColorSpec::ChannelDepth::k8Bit;
+
+    if ((aLevel >= Simd::Level::kSSE2) && (aSrcChannelDepth == k8Bit) && (aDestChannelDepth == k8Bit)) {
+        bool avx2 = (aLevel >= Simd::Level::kAVX2);
+        if ((aSrcFormat == ColorSpec::Format::kRGBA) && (aDestFormat == kPremultiplied))
+            return avx2 ? premultiplyRowAVX2 : premultiplyRowSSE2;
+        if ((aSrcFormat == kPremultiplied) && (aDestFormat == ColorSpec::Format::kRGBA))
+            return avx2 ? unpremultiplyRowAVX2 : unpremultiplyRowSSE2;
+    }
+
+    // Premultiplied rows convert like straight ones when both sides are
+    // premultiplied or the source is opaque.
+    if ((aDestFormat == kPremultiplied) &&
+        ((aSrcFormat == kPremultiplied) ||
+         (aSrcFormat == ColorSpec::Format::kRGB) ||
+         (aSrcFormat == ColorSpec::Format::kMonochromatic))) {
+        aDestFormat = ColorSpec::Format::kRGBA;
+        if (aSrcFormat == kPremultiplied)
+            aSrcFormat = ColorSpec::Format::kRGBA;
+    }
+
+    int src = formatIndex(aSrcFormat, aSrcChannelDepth);
+    int dest = formatIndex(aDestFormat, aDestChannelDepth);
+    if ((src < 0) || (dest < 0))
+        return nullptr;
+
+    switch (aLevel) {
+    case Simd::Level::kAVX2:
+        return kAVX2Functions[src][dest];
+    case Simd::Level::kSSSE3:
+        return kSSSE3Functions[src][dest];
+    case Simd::Level::kSSE2:
+        return kSSE2Functions[src][dest];
+    default:
+        return nullptr;
+    }
+}
+
+#else // IMGIO_X86_SIMD
+
+ConvertFunction simdConvertFunction(Simd::Level aLevel,
+                                    ColorSpec::Format aSrcFormat,
+                                    ColorSpec::ChannelDepth aSrcChannelDepth,
+                                    ColorSpec::Format aDestFormat,
+                                    ColorSpec::ChannelDepth aDestChannelDepth)
+{
+    return nullptr;
+}
+
+#endif // IMGIO_X86_SIMD
+
+} // namespace ImgIO
+// EOF
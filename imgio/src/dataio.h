@@ -24,8 +24,11 @@
 #ifndef _DATAIO_H__
 #define _DATAIO_H__
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <memory>
+#include <imgio/encodedbuffer.h>
 
 namespace ImgIO
 {
@@ -40,6 +43,28 @@ public:
     virtual size_t tellPos() const = 0;
     virtual void seekPos(ssize_t aPosDiff) = 0;
     virtual void clearErrors() = 0;
+
+    /**
+     * Returns the unread bytes in place and moves past them, when the reader
+     * keeps all of them in memory, so decoders can do without copying them.
+     * Readers of other sources return nullptr.
+     * @param aLength Set to the number of bytes returned.
+     */
+    virtual const uint8_t* readInPlace(size_t& aLength)
+    {
+        aLength = 0;
+        return nullptr;
+    }
+
+    /**
+     * Reads at least aMinLength bytes, unless the data ends before, and up
+     * to aMaxLength more that are at hand without waiting for them.
+     * @return Number of bytes read.
+     */
+    virtual size_t readAhead(uint8_t* aData, size_t aMinLength, size_t aMaxLength)
+    {
+        return read(aData, aMinLength);
+    }
 }; // class DataReader
 
 class StreamReader : public DataReader
@@ -62,13 +87,20 @@ public:
 
     void seekPos(ssize_t aPosDiff)
     {
-        mStream.seekg(aPosDiff);
+        mStream.seekg(aPosDiff, std::ios::cur);
     }
 
     void clearErrors()
     {
         mStream.clear();
     }
+
+    size_t readAhead(uint8_t* aData, size_t aMinLength, size_t aMaxLength)
+    {
+        std::streamsize available = mStream.rdbuf() ? mStream.rdbuf()->in_avail() : 0;
+        size_t length = (available > 0) ? std::min(aMaxLength, static_cast<size_t>(available)) : 0;
+        return read(aData, std::max(aMinLength, length));
+    }
 private:
     std::istream& mStream;
 }; // class StreamReader
@@ -111,12 +143,133 @@ public:
     {
     }
 
+    const uint8_t* readInPlace(size_t& aLength)
+    {
+        aLength = mLength - mReadPos;
+        const uint8_t* data = mData + mReadPos;
+        mReadPos = mLength;
+        return data;
+    }
+
 private:
     const uint8_t* mData;
     size_t mReadPos;
     size_t mLength;
 }; // class MemoryReader
 
+/**
+ * Reader of a DataReader in blocks of kBlockSize bytes. Reads within the
+ * current block are inline copies, data kept in memory is a single block
+ * used in place. Bytes read ahead are given back when it is destroyed.
+ */
+class BufferedReader
+{
+public:
+    static const size_t kBlockSize = 64 * 1024;
+
+public:
+    explicit BufferedReader(DataReader& aSource)
+    : mSource(aSource), mBlock(), mNext(nullptr), mEnd(nullptr), mInPlace(false)
+    {
+        size_t length = 0;
+        mNext = aSource.readInPlace(length);
+        if (mNext) {
+            mEnd = mNext + length;
+            mInPlace = true;
+        }
+    }
+
+    ~BufferedReader()
+    {
+        if (mNext == mEnd)
+            return;
+
+        try {
+            mSource.clearErrors();
+            mSource.seekPos(-static_cast<ssize_t>(mEnd - mNext));
+        } catch (...) {
+        }
+    }
+
+    size_t read(uint8_t* aData, size_t aLength)
+    {
+        if (aLength <= static_cast<size_t>(mEnd - mNext)) {
+            std::memcpy(aData, mNext, aLength);
+            mNext += aLength;
+            return aLength;
+        }
+        return readBlocks(aData, aLength);
+    }
+
+    /**
+     * Returns the unread bytes of the current block, reading the next one
+     * when there are none.
+     * @param aLength Set to the number of bytes returned, 0 at the end of the data.
+     */
+    const uint8_t* peek(size_t& aLength)
+    {
+        if (mNext == mEnd)
+            fill(1);
+        aLength = mEnd - mNext;
+        return mNext;
+    }
+
+    /**
+     * Moves past aLength bytes returned by peek().
+     */
+    void skip(size_t aLength)
+    {
+        mNext += aLength;
+    }
+
+private:
+    BufferedReader(const BufferedReader&) = delete;
+    BufferedReader& operator=(const BufferedReader&) = delete;
+
+    size_t readBlocks(uint8_t* aData, size_t aLength)
+    {
+        size_t length = mEnd - mNext;
+        if (length) {
+            std::memcpy(aData, mNext, length);
+            mNext = mEnd;
+        }
+
+        while (length < aLength) {
+            // Reads of whole blocks go straight to aData
+            size_t remaining = aLength - length;
+            if (remaining >= kBlockSize)
+                return length + (mInPlace ? 0 : mSource.read(aData + length, remaining));
+
+            if (!fill(remaining))
+                break;
+            size_t bytes = std::min(remaining, static_cast<size_t>(mEnd - mNext));
+            std::memcpy(aData + length, mNext, bytes);
+            mNext += bytes;
+            length += bytes;
+        }
+        return length;
+    }
+
+    bool fill(size_t aMinLength)
+    {
+        if (mInPlace)
+            return false;
+
+        if (!mBlock)
+            mBlock.reset(new uint8_t[kBlockSize]);
+        mNext = mBlock.get();
+        mEnd = mNext + mSource.readAhead(mBlock.get(), aMinLength, kBlockSize);
+        return mNext != mEnd;
+    }
+
+private:
+    DataReader& mSource;
+    std::unique_ptr<uint8_t[]> mBlock;
+    const uint8_t* mNext;
+    const uint8_t* mEnd;
+    bool mInPlace;
+}; // class BufferedReader
+
 class DataWriter
 {
 public:
@@ -125,6 +278,26 @@ public:
 
     virtual size_t write(const uint8_t* data, size_t length) = 0;
     virtual void flush() = 0;
+
+    /**
+     * Returns memory the next bytes can be encoded into in place, when the
+     * writer writes to memory, so encoders can do without staging buffers.
+     * Growable memory takes at least aMinLength bytes, fixed memory what is
+     * left of it. Other writers and full fixed memory return nullptr.
+     * @param aLength Set to the number of bytes returned.
+     */
+    virtual uint8_t* spaceInPlace(size_t aMinLength, size_t& aLength)
+    {
+        aLength = 0;
+        return nullptr;
+    }
+
+    /**
+     * Adds aLength bytes written into spaceInPlace() to the data.
+     */
+    virtual void commitInPlace(size_t aLength)
+    {
+    }
 }; // class DataWriter
 
 class StreamWriter : public DataWriter
@@ -152,18 +325,20 @@ class MemoryWriter : public DataWriter
 {
 public:
     MemoryWriter(uint8_t* aData, size_t aLength)
-            : mData(aData), mLength(aLength)
+            : mData(aData), mLength(aLength), mBytesWritten(0), mTruncated(false)
     {}
 
     size_t write(const uint8_t* aData, size_t aLength)
     {
         if (aLength > mLength) {
             aLength = mLength;
+            mTruncated = true;
         }
 
         std::memcpy(mData, aData, aLength);
         mData += aLength;
         mLength -= aLength;
+        mBytesWritten += aLength;
 
         return aLength;
     }
@@ -171,11 +346,197 @@ public:
     void flush()
     {
     }
+
+    uint8_t* spaceInPlace(size_t aMinLength, size_t& aLength)
+    {
+        aLength = mLength;
+        return mLength ? mData : nullptr;
+    }
+
+    void commitInPlace(size_t aLength)
+    {
+        mData += aLength;
+        mLength -= aLength;
+        mBytesWritten += aLength;
+    }
+
+    size_t bytesWritten() const
+    {
+        return mBytesWritten;
+    }
+
+    /**
+     * Returns whether some of the data didn't fit and was dropped.
+     */
+    bool isTruncated() const
+    {
+        return mTruncated;
+    }
 private:
     uint8_t* mData;
     size_t mLength;
+    size_t mBytesWritten;
+    bool mTruncated;
 }; // class MemoryWriter
 
+class BufferWriter : public DataWriter
+{
+public:
+    BufferWriter(EncodedBuffer& aBuffer)
+            : mBuffer(aBuffer)
+    {}
+
+    size_t write(const uint8_t* aData, size_t aLength)
+    {
+        mBuffer.append(aData, aLength);
+        return aLength;
+    }
+
+    void flush()
+    {
+    }
+
+    uint8_t* spaceInPlace(size_t aMinLength, size_t& aLength)
+    {
+        // Grows as EncodedBuffer::append()
+        size_t size = mBuffer.size();
+        size_t minCapacity = EncodedBuffer::kMinCapacity;
+        if ((mBuffer.capacity() - size) < aMinLength)
+            mBuffer.reserve(std::max(std::max(size + aMinLength, 2 * mBuffer.capacity()), minCapacity));
+        aLength = mBuffer.capacity() - size;
+        return mBuffer.data() + size;
+    }
+
+    void commitInPlace(size_t aLength)
+    {
+        mBuffer.resize(mBuffer.size() + aLength);
+    }
+private:
+    EncodedBuffer& mBuffer;
+}; // class BufferWriter
+
+/**
+ * Writer to a DataWriter in blocks of kBlockSize bytes. Writes that fit
+ * into the current block are inline copies. Memory of the writer is used
+ * in place of the block, so encodes to memory are not staged. Buffered
+ * bytes are written out by flush() only.
+ */
+class BufferedWriter
+{
+public:
+    static const size_t kBlockSize = 64 * 1024;
+
+public:
+    explicit BufferedWriter(DataWriter& aSink)
+    : mSink(aSink), mBlock(), mStart(nullptr), mNext(nullptr), mEnd(nullptr), mInPlace(false)
+    {}
+
+    void write(const uint8_t* aData, size_t aLength)
+    {
+        if (aLength <= static_cast<size_t>(mEnd - mNext)) {
+            std::memcpy(mNext, aData, aLength);
+            mNext += aLength;
+            return;
+        }
+        writeBlocks(aData, aLength);
+    }
+
+    /**
+     * Returns the free space of the current block, writing the block out
+     * when it is full.
+     * @param aLength Set to the number of bytes free.
+     */
+    uint8_t* space(size_t& aLength)
+    {
+        if (mNext == mEnd) {
+            writeBlock();
+            acquire(1);
+        }
+        aLength = mEnd - mNext;
+        return mNext;
+    }
+
+    /**
+     * Adds aLength bytes written into space() to the block.
+     */
+    void commit(size_t aLength)
+    {
+        mNext += aLength;
+    }
+
+    /**
+     * Writes the buffered bytes out and flushes the sink.
+     */
+    void flush()
+    {
+        writeBlock();
+        mSink.flush();
+    }
+
+private:
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    // Takes memory of the sink when it has some, the own block otherwise
+    void acquire(size_t aMinLength)
+    {
+        size_t length = 0;
+        uint8_t* data = mSink.spaceInPlace(aMinLength, length);
+        mInPlace = (data != nullptr);
+        if (!mInPlace) {
+            if (!mBlock)
+                mBlock.reset(new uint8_t[kBlockSize]);
+            data = mBlock.get();
+            length = kBlockSize;
+        }
+        mStart = mNext = data;
+        mEnd = data + length;
+    }
+
+    void writeBlock()
+    {
+        if (mNext != mStart) {
+            if (mInPlace)
+                mSink.commitInPlace(mNext - mStart);
+            else
+                mSink.write(mStart, mNext - mStart);
+        }
+        mStart = mNext = mEnd = nullptr;
+    }
+
+    void writeBlocks(const uint8_t* aData, size_t aLength)
+    {
+        while (true) {
+            size_t length = std::min(aLength, static_cast<size_t>(mEnd - mNext));
+            if (length) {
+                std::memcpy(mNext, aData, length);
+                mNext += length;
+                aData += length;
+                aLength -= length;
+            }
+            if (aLength == 0)
+                return;
+
+            writeBlock();
+            acquire(aLength);
+
+            // Whole blocks go straight to a sink without memory
+            if (!mInPlace && (aLength >= kBlockSize)) {
+                mSink.write(aData, aLength);
+                return;
+            }
+        }
+    }
+
+private:
+    DataWriter& mSink;
+    std::unique_ptr<uint8_t[]> mBlock;
+    uint8_t* mStart;
+    uint8_t* mNext;
+    uint8_t* mEnd;
+    bool mInPlace;
+}; // class BufferedWriter
+
 }; // namespace ImgIO
 
 #endif // _DATAIO_H__
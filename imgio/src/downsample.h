@@ -0,0 +1,113 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef _DOWNSAMPLE_H__
+#define _DOWNSAMPLE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <imgio/color.h>
+#include <imgio/simd.h>
+
+namespace ImgIO
+{
+
+/**
+ * Halves a pair of rows of aWidth pixels, each destination pixel averaging
+ * a 2x2 square of source pixels. The last pixel of an odd row averages a
+ * 1x2 one, aRow0 and aRow1 may be the same row.
+ */
+typedef void (*DownsampleFunction)(const uint8_t* aRow0, const uint8_t* aRow1, uint8_t* aDest, size_t aWidth);
+
+template <typename Sample, size_t kChannels>
+void downsampleRow(const uint8_t* aRow0, const uint8_t* aRow1, uint8_t* aDest, size_t aWidth)
+{
+    const Sample* row0 = reinterpret_cast<const Sample*>(aRow0);
+    const Sample* row1 = reinterpret_cast<const Sample*>(aRow1);
+    Sample* dest = reinterpret_cast<Sample*>(aDest);
+
+    for (size_t x = 0; x + 1 < aWidth; x += 2, row0 += 2 * kChannels, row1 += 2 * kChannels, dest += kChannels) {
+        for (size_t c = 0; c < kChannels; ++c) {
+            uint32_t sum = uint32_t(row0[c]) + row0[kChannels + c] + row1[c] + row1[kChannels + c];
+            dest[c] = static_cast<Sample>((sum + 2) >> 2);
+        }
+    }
+    if (aWidth % 2) {
+        for (size_t c = 0; c < kChannels; ++c)
+            dest[c] = static_cast<Sample>((uint32_t(row0[c]) + row1[c] + 1) >> 1);
+    }
+}
+
+/**
+ * Straight RGBA averages colors weighted by alpha, so transparent pixels
+ * don't bleed into their neighbours.
+ */
+template <typename Sample>
+void downsampleStraightRow(const uint8_t* aRow0, const uint8_t* aRow1, uint8_t* aDest, size_t aWidth)
+{
+    const Sample* rows[2] = {reinterpret_cast<const Sample*>(aRow0), reinterpret_cast<const Sample*>(aRow1)};
+    Sample* dest = reinterpret_cast<Sample*>(aDest);
+
+    for (size_t x = 0; x < aWidth; x += 2, dest += 4) {
+        size_t count = (x + 1 < aWidth) ? 2 : 1;
+        uint64_t colors[3] = {0, 0, 0};
+        uint64_t plainColors[3] = {0, 0, 0};
+        uint32_t alpha = 0;
+        for (const Sample* row : rows) {
+            for (size_t i = 0; i < count; ++i) {
+                const Sample* pixel = row + 4 * (x + i);
+                for (size_t c = 0; c < 3; ++c) {
+                    colors[c] += uint64_t(pixel[c]) * pixel[3];
+                    plainColors[c] += pixel[c];
+                }
+                alpha += pixel[3];
+            }
+        }
+
+        size_t samples = 2 * count;
+        for (size_t c = 0; c < 3; ++c) {
+            uint64_t value = alpha ? (colors[c] + alpha / 2) / alpha : (plainColors[c] + samples / 2) / samples;
+            dest[c] = static_cast<Sample>(value);
+        }
+        dest[3] = static_cast<Sample>((alpha + samples / 2) / samples);
+    }
+}
+
+/**
+ * Returns the downsampling kernel for the current Simd::level().
+ * @return Downsampling function or nullptr for kIndexed.
+ */
+DownsampleFunction downsampleFunction(ColorSpec::Format aFormat, ColorSpec::ChannelDepth aChannelDepth);
+
+/**
+ * Returns the vectorized downsampling kernel for the given instruction set
+ * level, for pixels of aChannels samples averaged without weights.
+ * @return Downsampling function or nullptr, when the level has none.
+ */
+DownsampleFunction simdDownsampleFunction(Simd::Level aLevel, size_t aChannels, ColorSpec::ChannelDepth aChannelDepth);
+
+} // namespace ImgIO
+
+#endif // _DOWNSAMPLE_H__
+// EOF
@@ -0,0 +1,194 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <cstring>
+#include "downsample.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMGIO_X86_SIMD
+#include <immintrin.h>
+#endif
+
+
+namespace ImgIO
+{
+
+#ifdef IMGIO_X86_SIMD
+
+#define IMGIO_TARGET_SSSE3 __attribute__((target("ssse3")))
+
+namespace
+{
+
+//
+// Pixels are split into even and odd ones with byte shuffles, which are
+// then summed with the pair from the other row in wider lanes. Blocks of
+// kBlockSize destination bytes hold whole pixels, their 2 * kBlockSize
+// source bytes are loaded as 16 bytes from either end.
+//
+
+template <size_t kPixelSize>
+struct DeinterleaveMasks
+{
+    static const size_t kBlockSize = (kPixelSize % 3) ? 16 : 12;
+
+    DeinterleaveMasks()
+    {
+        for (size_t j = 0; j < 16; ++j) {
+            evenLow[j] = -128;
+            evenHigh[j] = -128;
+            oddLow[j] = -128;
+            oddHigh[j] = -128;
+        }
+
+        for (size_t j = 0; j < kBlockSize; ++j) {
+            size_t even = 2 * (j / kPixelSize) * kPixelSize + j % kPixelSize;
+            select(even, evenLow, evenHigh, j);
+            select(even + kPixelSize, oddLow, oddHigh, j);
+        }
+    }
+
+    static void select(size_t aSrc, int8_t* aLow, int8_t* aHigh, size_t aDest)
+    {
+        if (aSrc < 16)
+            aLow[aDest] = static_cast<int8_t>(aSrc);
+        else
+            aHigh[aDest] = static_cast<int8_t>(aSrc - (2 * kBlockSize - 16));
+    }
+
+    alignas(16) int8_t evenLow[16];
+    alignas(16) int8_t evenHigh[16];
+    alignas(16) int8_t oddLow[16];
+    alignas(16) int8_t oddHigh[16];
+};
+
+IMGIO_TARGET_SSSE3 inline __m128i load128(const void* aSrc)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc));
+}
+
+template <size_t kBlockSize>
+IMGIO_TARGET_SSSE3 inline void storeBlock(uint8_t* aDest, __m128i aValue)
+{
+    if (kBlockSize == 16) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest), aValue);
+    } else {
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(aDest), aValue);
+        int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(aValue, 8));
+        std::memcpy(aDest + 8, &tail, sizeof(tail));
+    }
+}
+
+template <typename Sample, size_t kChannels>
+IMGIO_TARGET_SSSE3 void downsampleSSSE3(const uint8_t* aRow0, const uint8_t* aRow1, uint8_t* aDest, size_t aWidth)
+{
+    const size_t kPixelSize = kChannels * sizeof(Sample);
+    typedef DeinterleaveMasks<kPixelSize> Masks;
+    const size_t kBlockSize = Masks::kBlockSize;
+    const size_t kBlockPixels = kBlockSize / kPixelSize;
+    static const Masks masks;
+
+    const __m128i evenLow = load128(masks.evenLow);
+    const __m128i evenHigh = load128(masks.evenHigh);
+    const __m128i oddLow = load128(masks.oddLow);
+    const __m128i oddHigh = load128(masks.oddHigh);
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t x = 0;
+    for (; 2 * (x + kBlockPixels) <= aWidth; x += kBlockPixels) {
+        const uint8_t* rows[2] = {aRow0 + 2 * x * kPixelSize, aRow1 + 2 * x * kPixelSize};
+        __m128i pixels[4];
+        for (size_t r = 0; r < 2; ++r) {
+            __m128i low = load128(rows[r]);
+            __m128i high = load128(rows[r] + 2 * kBlockSize - 16);
+            pixels[2 * r] = _mm_or_si128(_mm_shuffle_epi8(low, evenLow), _mm_shuffle_epi8(high, evenHigh));
+            pixels[2 * r + 1] = _mm_or_si128(_mm_shuffle_epi8(low, oddLow), _mm_shuffle_epi8(high, oddHigh));
+        }
+
+        __m128i result;
+        if (sizeof(Sample) == 1) {
+            const __m128i rounding = _mm_set1_epi16(2);
+            __m128i low = rounding;
+            __m128i high = rounding;
+            for (const __m128i& value : pixels) {
+                low = _mm_add_epi16(low, _mm_unpacklo_epi8(value, zero));
+                high = _mm_add_epi16(high, _mm_unpackhi_epi8(value, zero));
+            }
+            result = _mm_packus_epi16(_mm_srli_epi16(low, 2), _mm_srli_epi16(high, 2));
+        } else {
+            // Results fit 16 bits, biased into the signed range for packing
+            const __m128i rounding = _mm_set1_epi32(2 - (0x8000 << 2));
+            __m128i low = rounding;
+            __m128i high = rounding;
+            for (const __m128i& value : pixels) {
+                low = _mm_add_epi32(low, _mm_unpacklo_epi16(value, zero));
+                high = _mm_add_epi32(high, _mm_unpackhi_epi16(value, zero));
+            }
+            result = _mm_packs_epi32(_mm_srai_epi32(low, 2), _mm_srai_epi32(high, 2));
+            result = _mm_xor_si128(result, _mm_set1_epi16(-0x8000));
+        }
+        storeBlock<kBlockSize>(aDest + x * kPixelSize, result);
+    }
+
+    downsampleRow<Sample, kChannels>(aRow0 + 2 * x * kPixelSize,
+                                     aRow1 + 2 * x * kPixelSize,
+                                     aDest + x * kPixelSize,
+                                     aWidth - 2 * x);
+}
+
+} // namespace
+
+DownsampleFunction simdDownsampleFunction(Simd::Level aLevel, size_t aChannels, ColorSpec::ChannelDepth aChannelDepth)
+{
+    // There are no AVX2 specific kernels, in lane shuffles gain little here.
+    if (aLevel < Simd::Level::kSSSE3)
+        return nullptr;
+
+    bool is16Bit = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+    switch (aChannels) {
+    case 1:
+        return is16Bit ? downsampleSSSE3<uint16_t, 1> : downsampleSSSE3<uint8_t, 1>;
+    case 2:
+        return is16Bit ? downsampleSSSE3<uint16_t, 2> : downsampleSSSE3<uint8_t, 2>;
+    case 3:
+        return is16Bit ? downsampleSSSE3<uint16_t, 3> : downsampleSSSE3<uint8_t, 3>;
+    case 4:
+        return is16Bit ? downsampleSSSE3<uint16_t, 4> : downsampleSSSE3<uint8_t, 4>;
+    default:
+        return nullptr;
+    }
+}
+
+#else // IMGIO_X86_SIMD
+
+DownsampleFunction simdDownsampleFunction(Simd::Level aLevel, size_t aChannels, ColorSpec::ChannelDepth aChannelDepth)
+{
+    return nullptr;
+}
+
+#endif // IMGIO_X86_SIMD
+
+} // namespace ImgIO
+
+// EOF
@@ -0,0 +1,147 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <imgio/encodedbuffer.h>
+#include <algorithm>
+#include <cstring>
+
+namespace ImgIO
+{
+
+// Buffers are aligned as pixel buffers, so they share the allocator's size classes
+static const size_t kAlignment = 64;
+
+EncodedBuffer::EncodedBuffer(std::shared_ptr<Allocator> aAllocator)
+: mAllocator(aAllocator ? aAllocator : Allocator::defaultAllocator()),
+  mData(nullptr),
+  mSize(0),
+  mCapacity(0)
+{
+}
+
+EncodedBuffer::EncodedBuffer(EncodedBuffer&& aBuffer) noexcept
+: mAllocator(aBuffer.mAllocator),
+  mData(aBuffer.mData),
+  mSize(aBuffer.mSize),
+  mCapacity(aBuffer.mCapacity)
+{
+    aBuffer.mData = nullptr;
+    aBuffer.mSize = 0;
+    aBuffer.mCapacity = 0;
+}
+
+EncodedBuffer::~EncodedBuffer()
+{
+    release();
+}
+
+EncodedBuffer& EncodedBuffer::operator=(EncodedBuffer&& aBuffer) noexcept
+{
+    if (&aBuffer != this) {
+        release();
+        mAllocator = aBuffer.mAllocator;
+        mData = aBuffer.mData;
+        mSize = aBuffer.mSize;
+        mCapacity = aBuffer.mCapacity;
+        aBuffer.mData = nullptr;
+        aBuffer.mSize = 0;
+        aBuffer.mCapacity = 0;
+    }
+    return *this;
+}
+
+const uint8_t* EncodedBuffer::data() const
+{
+    return mData;
+}
+
+uint8_t* EncodedBuffer::data()
+{
+    return mData;
+}
+
+size_t EncodedBuffer::size() const
+{
+    return mSize;
+}
+
+size_t EncodedBuffer::capacity() const
+{
+    return mCapacity;
+}
+
+void EncodedBuffer::reserve(size_t aCapacity)
+{
+    if (aCapacity <= mCapacity)
+        return;
+
+    uint8_t* data = static_cast<uint8_t*>(mAllocator->allocate(aCapacity, kAlignment));
+    if (mData) {
+        std::memcpy(data, mData, mSize);
+        mAllocator->deallocate(mData, mCapacity, kAlignment);
+    }
+    mData = data;
+    mCapacity = aCapacity;
+}
+
+void EncodedBuffer::resize(size_t aSize)
+{
+    grow(aSize);
+    mSize = aSize;
+}
+
+void EncodedBuffer::append(const uint8_t* aData, size_t aLength)
+{
+    if (aLength == 0)
+        return;
+
+    grow(mSize + aLength);
+    std::memcpy(mData + mSize, aData, aLength);
+    mSize += aLength;
+}
+
+void EncodedBuffer::clear()
+{
+    mSize = 0;
+}
+
+void EncodedBuffer::release()
+{
+    if (mData)
+        mAllocator->deallocate(mData, mCapacity, kAlignment);
+    mData = nullptr;
+    mSize = 0;
+    mCapacity = 0;
+}
+
+void EncodedBuffer::grow(size_t aSize)
+{
+    size_t minCapacity = kMinCapacity;
+    if (aSize > mCapacity)
+        reserve(std::max(std::max(aSize, 2 * mCapacity), minCapacity));
+}
+
+} // namespace ImgIO
+
+// EOF
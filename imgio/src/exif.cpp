@@ -0,0 +1,107 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "exif.h"
+
+namespace ImgIO
+{
+
+namespace
+{
+
+const uint16_t kOrientationTag = 0x0112;
+const uint16_t kShortType = 3;
+const size_t kEntrySize = 12;
+
+class TiffReader
+{
+public:
+    TiffReader(const uint8_t* aData, bool aBigEndian)
+    : mData(aData), mBigEndian(aBigEndian)
+    {
+    }
+
+    uint16_t u16(size_t aOffset) const
+    {
+        const uint8_t* p = mData + aOffset;
+        return mBigEndian ? ((p[0] << 8) | p[1]) : ((p[1] << 8) | p[0]);
+    }
+
+    uint32_t u32(size_t aOffset) const
+    {
+        return mBigEndian ? ((uint32_t(u16(aOffset)) << 16) | u16(aOffset + 2))
+                          : ((uint32_t(u16(aOffset + 2)) << 16) | u16(aOffset));
+    }
+
+private:
+    const uint8_t* mData;
+    bool mBigEndian;
+}; // class TiffReader
+
+} // namespace
+
+Image::Orientation exifOrientation(const uint8_t* aData, size_t aLength)
+{
+    if ((aData == nullptr) || (aLength < 8))
+        return Image::Orientation::kTopLeft;
+
+    bool bigEndian;
+    if ((aData[0] == 'I') && (aData[1] == 'I'))
+        bigEndian = false;
+    else if ((aData[0] == 'M') && (aData[1] == 'M'))
+        bigEndian = true;
+    else
+        return Image::Orientation::kTopLeft;
+
+    TiffReader reader(aData, bigEndian);
+    if (reader.u16(2) != 42)
+        return Image::Orientation::kTopLeft;
+
+    size_t ifd = reader.u32(4);
+    if ((ifd > aLength) || (aLength - ifd < 2))
+        return Image::Orientation::kTopLeft;
+
+    size_t entriesCount = reader.u16(ifd);
+    if ((aLength - ifd - 2) / kEntrySize < entriesCount)
+        return Image::Orientation::kTopLeft;
+
+    for (size_t i = 0; i < entriesCount; ++i) {
+        size_t entry = ifd + 2 + i * kEntrySize;
+        if (reader.u16(entry) != kOrientationTag)
+            continue;
+
+        // A single SHORT, stored left aligned in the value field
+        if ((reader.u16(entry + 2) != kShortType) || (reader.u32(entry + 4) != 1))
+            break;
+        uint16_t value = reader.u16(entry + 8);
+        if ((value < 1) || (value > 8))
+            break;
+        return static_cast<Image::Orientation>(value);
+    }
+
+    return Image::Orientation::kTopLeft;
+}
+
+} // namespace ImgIO
+
+// EOF
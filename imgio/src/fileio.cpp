@@ -0,0 +1,286 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "fileio.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ImgIO
+{
+
+FileMapping::FileMapping(const std::string& aPath)
+: mData(nullptr),
+  mLength(0)
+{
+    int fd = ::open(aPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "Failed to open " + aPath);
+
+    struct stat status;
+    if (::fstat(fd, &status) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "Failed to stat " + aPath);
+    }
+
+    // Empty files can't be mapped, they have nothing to read anyway
+    mLength = static_cast<size_t>(status.st_size);
+    if (mLength > 0) {
+        void* data = ::mmap(nullptr, mLength, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "Failed to map " + aPath);
+        }
+        ::madvise(data, mLength, MADV_SEQUENTIAL);
+        mData = static_cast<const uint8_t*>(data);
+    }
+
+    // The mapping keeps the file
+    ::close(fd);
+}
+
+FileMapping::~FileMapping()
+{
+    if (mData)
+        ::munmap(const_cast<uint8_t*>(mData), mLength);
+}
+
+// Blocks are aligned to pages, so are the writes of whole blocks
+static const size_t kBlockAlignment = 4096;
+
+static std::atomic<unsigned int> sTempFilesCount(0);
+
+// Makes a rename in the directory of aPath durable, where the file system
+// supports syncing directories.
+static void syncDirectory(const std::string& aPath)
+{
+    size_t slash = aPath.rfind('/');
+    std::string directory = (slash == std::string::npos) ? "." : aPath.substr(0, std::max(slash, static_cast<size_t>(1)));
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+FileWriter::FileWriter(const std::string& aPath,
+                       ImageIO::Durability aDurability,
+                       size_t aSizeHint,
+                       bool aMapped)
+: mPath(aPath),
+  mTempPath(),
+  mDurability(aDurability),
+  mSizeHint(aSizeHint),
+  mMapped(aMapped),
+  mClosed(false),
+  mFd(-1),
+  mAllocator(Allocator::defaultAllocator()),
+  mBlock(nullptr),
+  mBlockLength(0),
+  mMapping(nullptr),
+  mMappingLength(0),
+  mLength(0)
+{
+}
+
+FileWriter::~FileWriter()
+{
+    unmap();
+    if (mFd >= 0) {
+        // Drops the mapped length past the data, failing is harmless here
+        int result = ::ftruncate(mFd, mLength);
+        (void) result;
+        ::close(mFd);
+    }
+    if (!mTempPath.empty())
+        ::unlink(mTempPath.c_str());
+    if (mBlock)
+        mAllocator->deallocate(mBlock, kBlockSize, kBlockAlignment);
+}
+
+size_t FileWriter::write(const uint8_t* aData, size_t aLength)
+{
+    for (size_t written = 0; written < aLength; ) {
+        size_t length = 0;
+        uint8_t* data = spaceInPlace(aLength - written, length);
+        length = std::min(length, aLength - written);
+        std::memcpy(data, aData + written, length);
+        commitInPlace(length);
+        written += length;
+    }
+    return aLength;
+}
+
+void FileWriter::flush()
+{
+    writeBlock();
+}
+
+uint8_t* FileWriter::spaceInPlace(size_t aMinLength, size_t& aLength)
+{
+    if (mFd < 0)
+        open();
+
+    if (mMapping) {
+        if (mLength < mMappingLength) {
+            aLength = mMappingLength - mLength;
+            return mMapping + mLength;
+        }
+        // The file goes on with writes past the size hint
+        unmap();
+    }
+
+    if (!mBlock)
+        mBlock = static_cast<uint8_t*>(mAllocator->allocate(kBlockSize, kBlockAlignment));
+    if (mBlockLength == kBlockSize)
+        writeBlock();
+    aLength = kBlockSize - mBlockLength;
+    return mBlock + mBlockLength;
+}
+
+void FileWriter::commitInPlace(size_t aLength)
+{
+    if (mMapping) {
+        mLength += aLength;
+        return;
+    }
+
+    mBlockLength += aLength;
+    if (mBlockLength == kBlockSize)
+        writeBlock();
+}
+
+void FileWriter::close()
+{
+    if (mClosed)
+        return;
+    if (mFd < 0)
+        open();
+    mClosed = true;
+
+    writeBlock();
+    unmap();
+    if (::ftruncate(mFd, mLength) != 0)
+        fail("Failed to truncate");
+    if ((mDurability != ImageIO::Durability::kNone) && (::fdatasync(mFd) != 0))
+        fail("Failed to sync");
+
+    int fd = mFd;
+    mFd = -1;
+    if (::close(fd) != 0)
+        fail("Failed to close");
+
+    if (mDurability == ImageIO::Durability::kReplace) {
+        if (::rename(mTempPath.c_str(), mPath.c_str()) != 0)
+            fail("Failed to rename");
+        mTempPath.clear();
+        syncDirectory(mPath);
+    }
+}
+
+void FileWriter::open()
+{
+    if (mClosed)
+        throw std::logic_error("Write to a closed file " + mPath);
+
+    if (mDurability == ImageIO::Durability::kReplace) {
+        // rename() replaces within a file system only, so the temporary
+        // file goes next to the file
+        while (mFd < 0) {
+            mTempPath = mPath + ".tmp" + std::to_string(::getpid()) + "." + std::to_string(sTempFilesCount++);
+            mFd = ::open(mTempPath.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+            if ((mFd < 0) && (errno != EEXIST))
+                fail("Failed to create");
+        }
+    } else {
+        mFd = ::open(mPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (mFd < 0)
+            fail("Failed to open");
+    }
+
+    // Preallocated extents cost no writes, the ones not used are freed by
+    // close(). Files of a single block go out in one write anyway.
+    bool preallocated = false;
+#ifdef FALLOC_FL_KEEP_SIZE
+    preallocated = (mSizeHint > kBlockSize) && (::fallocate(mFd, FALLOC_FL_KEEP_SIZE, 0, mSizeHint) == 0);
+#endif // FALLOC_FL_KEEP_SIZE
+
+    // Stores into a mapping of space that isn't allocated fault when the disk is full
+    if (mMapped && preallocated && (::ftruncate(mFd, mSizeHint) == 0)) {
+        void* data = ::mmap(nullptr, mSizeHint, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+        if (data != MAP_FAILED) {
+            mMapping = static_cast<uint8_t*>(data);
+            mMappingLength = mSizeHint;
+        }
+    }
+}
+
+void FileWriter::writeBlock()
+{
+    if (mBlockLength > 0)
+        writeFully(mBlock, mBlockLength);
+    mBlockLength = 0;
+}
+
+void FileWriter::writeFully(const uint8_t* aData, size_t aLength)
+{
+    while (aLength > 0) {
+        ssize_t written = ::pwrite(mFd, aData, aLength, static_cast<off_t>(mLength));
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            fail("Failed to write");
+        }
+        aData += written;
+        aLength -= written;
+        mLength += written;
+    }
+}
+
+void FileWriter::unmap()
+{
+    if (mMapping)
+        ::munmap(mMapping, mMappingLength);
+    mMapping = nullptr;
+    mMappingLength = 0;
+}
+
+void FileWriter::fail(const char* aWhat) const
+{
+    const std::string& path = mTempPath.empty() ? mPath : mTempPath;
+    throw std::system_error(errno, std::generic_category(), std::string(aWhat) + " " + path);
+}
+
+} // namespace ImgIO
+
+// EOF
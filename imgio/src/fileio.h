@@ -0,0 +1,155 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef _FILEIO_H__
+#define _FILEIO_H__
+
+#include <memory>
+#include <string>
+#include <imgio/allocator.h>
+#include <imgio/imageio.h>
+#include "dataio.h"
+
+namespace ImgIO
+{
+
+/**
+ * Read only mapping of a whole file, advised for sequential access.
+ * Throws std::system_error when the file can't be opened or mapped.
+ */
+class FileMapping
+{
+public:
+    explicit FileMapping(const std::string& aPath);
+    ~FileMapping();
+
+    const uint8_t* data() const
+    {
+        return mData;
+    }
+
+    size_t length() const
+    {
+        return mLength;
+    }
+
+private:
+    FileMapping(const FileMapping&) = delete;
+    FileMapping& operator=(const FileMapping&) = delete;
+
+private:
+    const uint8_t* mData;
+    size_t mLength;
+}; // class FileMapping
+
+/**
+ * Reader of a mapped file. Decoders read it in place, pages come in as
+ * they are touched.
+ */
+class MappedFileReader : private FileMapping, public MemoryReader
+{
+public:
+    explicit MappedFileReader(const std::string& aPath)
+    : FileMapping(aPath),
+      MemoryReader(FileMapping::data(), FileMapping::length())
+    {}
+
+    using FileMapping::data;
+    using FileMapping::length;
+}; // class MappedFileReader
+
+/**
+ * Writer of a file. Encoders write into an aligned block in place, which
+ * goes out in single writes of kBlockSize bytes, or straight into a mapping
+ * of the file. Space for a size hint over a block is preallocated, the
+ * file is cut to the bytes written by close(). The file is opened by the
+ * first bytes written, so an encoder rejecting its input leaves an
+ * existing file alone.
+ * Throws std::system_error when the file can't be written.
+ */
+class FileWriter : public DataWriter
+{
+public:
+    static const size_t kBlockSize = 1024 * 1024;
+
+public:
+    /**
+     * Constructor. The file, with kReplace a temporary file next to it, is
+     * created or truncated when it is opened.
+     * @param aSizeHint Expected size at most, 0 when it isn't known.
+     * @param aMapped Whether to write through a mapping, falls back to
+     * writes when space for aSizeHint bytes isn't preallocated.
+     */
+    FileWriter(const std::string& aPath,
+               ImageIO::Durability aDurability,
+               size_t aSizeHint = 0,
+               bool aMapped = false);
+
+    /**
+     * Destructor, a file not closed is left as written so far, a
+     * temporary file is removed.
+     */
+    ~FileWriter();
+
+    size_t write(const uint8_t* aData, size_t aLength);
+    void flush();
+    uint8_t* spaceInPlace(size_t aMinLength, size_t& aLength);
+    void commitInPlace(size_t aLength);
+
+    /**
+     * Writes the rest out, cuts the file to its size and makes it durable
+     * as requested.
+     */
+    void close();
+
+private:
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    void open();
+    void writeBlock();
+    void writeFully(const uint8_t* aData, size_t aLength);
+    void unmap();
+    void fail(const char* aWhat) const;
+
+private:
+    std::string mPath;
+    std::string mTempPath;
+    ImageIO::Durability mDurability;
+    size_t mSizeHint;
+    bool mMapped;
+    bool mClosed;
+    int mFd;
+    std::shared_ptr<Allocator> mAllocator;
+    uint8_t* mBlock;
+    size_t mBlockLength;
+    uint8_t* mMapping;
+    size_t mMappingLength;
+    size_t mLength;
+}; // class FileWriter
+
+} // namespace ImgIO
+
+#endif // _FILEIO_H__
+// EOF
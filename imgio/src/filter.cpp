@@ -0,0 +1,592 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "filter.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "resize.h"
+#include "threadpool.h"
+
+namespace ImgIO
+{
+
+namespace
+{
+
+// Rows of intermediate samples kept for the vertical pass of a strip are
+// meant to stay in the L2 cache.
+const size_t kRingBytes = 256 * 1024;
+
+// Narrowest strip, in pixels.
+const size_t kMinStripWidth = 16;
+
+// Samples past the end of the row buffers, vector kernels may run over.
+const size_t kSlackSamples = 64;
+
+const unsigned int kMaxStackRadius = 254;
+const unsigned int kMaxBoxRadius = 32767;
+
+// Index of the pixel standing in for aIndex outside of [0, aSize), -1 for a zero one.
+ptrdiff_t edgeIndex(ptrdiff_t aIndex, ptrdiff_t aSize, Image::EdgeMode aEdgeMode)
+{
+    if ((aIndex >= 0) && (aIndex < aSize))
+        return aIndex;
+
+    switch (aEdgeMode) {
+    case Image::EdgeMode::kMirror: {
+        // Reflected about the edge pixels, which aren't repeated
+        if (aSize == 1)
+            return 0;
+        ptrdiff_t period = 2 * (aSize - 1);
+        aIndex %= period;
+        if (aIndex < 0)
+            aIndex += period;
+        return (aIndex < aSize) ? aIndex : period - aIndex;
+    }
+    case Image::EdgeMode::kWrap:
+        aIndex %= aSize;
+        return (aIndex < 0) ? aIndex + aSize : aIndex;
+    case Image::EdgeMode::kZero:
+        return -1;
+    default:
+        return std::min(std::max<ptrdiff_t>(aIndex, 0), aSize - 1);
+    }
+}
+
+// Copies aCount pixels of a row starting at aX, which may be outside of it.
+void gatherPixels(const uint8_t* aRow,
+                  unsigned int aWidth,
+                  ptrdiff_t aX,
+                  size_t aCount,
+                  size_t aPixelSize,
+                  Image::EdgeMode aEdgeMode,
+                  uint8_t* aDest)
+{
+    ptrdiff_t first = std::max<ptrdiff_t>(aX, 0);
+    ptrdiff_t last = std::min<ptrdiff_t>(aX + aCount, aWidth);
+    for (ptrdiff_t x = aX; x < aX + static_cast<ptrdiff_t>(aCount); ++x, aDest += aPixelSize) {
+        if ((x == first) && (first < last)) {
+            std::memcpy(aDest, aRow + first * aPixelSize, (last - first) * aPixelSize);
+            aDest += (last - first - 1) * aPixelSize;
+            x = last - 1;
+            continue;
+        }
+        ptrdiff_t index = edgeIndex(x, aWidth, aEdgeMode);
+        if (index < 0)
+            std::memset(aDest, 0, aPixelSize);
+        else
+            std::memcpy(aDest, aRow + index * aPixelSize, aPixelSize);
+    }
+}
+
+void checkKernel(const std::vector<float>& aKernel)
+{
+    if ((aKernel.size() % 2) == 0)
+        throw std::invalid_argument("Kernel size must be odd");
+}
+
+// Rounds the weights keeping their sum, the error goes to the largest one.
+// An odd number of taps is padded with a zero weight.
+std::vector<int16_t> fixedPointWeights(const std::vector<float>& aKernel)
+{
+    const float one = 1 << kWeightBits;
+
+    std::vector<int16_t> weights((aKernel.size() + 1) & ~size_t(1), 0);
+    double sum = 0.0;
+    int32_t fixedSum = 0;
+    size_t largest = 0;
+    for (size_t k = 0; k < aKernel.size(); ++k) {
+        weights[k] = static_cast<int16_t>(std::lround(aKernel[k] * one));
+        sum += aKernel[k];
+        fixedSum += weights[k];
+        if (std::fabs(aKernel[k]) > std::fabs(aKernel[largest]))
+            largest = k;
+    }
+    int32_t corrected = weights[largest] + static_cast<int32_t>(std::lround(sum * one)) - fixedSum;
+    weights[largest] = clampToInt16(corrected);
+    return weights;
+}
+
+// Fixed point weights fit 16 bits, keep the intermediate samples of 8 bit
+// images within 16 bits and stay within half a sample of the exact result.
+bool fitsFixedPoint(const std::vector<float>& aKernel)
+{
+    const float one = 1 << kWeightBits;
+    const float limit = 32767.0f / one;
+
+    float magnitude = 0.0f;
+    for (float weight : aKernel) {
+        if (std::fabs(weight) > limit)
+            return false;
+        magnitude += std::fabs(weight);
+    }
+    if (magnitude > 8.0f)
+        return false;
+
+    // Long flat kernels round badly, a sample error of up to 255 times the
+    // summed rounding errors has to stay below half a sample
+    std::vector<int16_t> weights = fixedPointWeights(aKernel);
+    float error = 0.0f;
+    for (size_t k = 0; k < aKernel.size(); ++k)
+        error += std::fabs(weights[k] - aKernel[k] * one);
+    return error * 255.0f <= 0.5f * one;
+}
+
+// Pixels per strip, so that aRingRows rows of the strip fit kRingBytes.
+size_t stripWidth(unsigned int aWidth, size_t aRingRows, size_t aBytesPerPixel)
+{
+    size_t width = kRingBytes / (aRingRows * aBytesPerPixel);
+    width = std::max(width & ~(kMinStripWidth - 1), kMinStripWidth);
+    return std::min<size_t>(width, aWidth);
+}
+
+/**
+ * Ring of intermediate rows of a strip, by logical row index. Rows are
+ * computed in order, when first needed.
+ */
+template <typename Work>
+class RowRing
+{
+public:
+    RowRing(size_t aRowsCount, size_t aRowLength)
+    : mRows(aRowsCount * aRowLength, Work()), mRowsCount(aRowsCount), mRowLength(aRowLength), mFirst(0), mNext(0)
+    {
+    }
+
+    void reset(ptrdiff_t aFirst)
+    {
+        mFirst = aFirst;
+        mNext = aFirst;
+    }
+
+    template <typename Compute>
+    void fill(ptrdiff_t aLast, Compute aCompute)
+    {
+        for (; mNext <= aLast; ++mNext)
+            aCompute(mNext, row(mNext));
+    }
+
+    Work* row(ptrdiff_t aIndex)
+    {
+        return mRows.data() + ((aIndex - mFirst) % mRowsCount) * mRowLength;
+    }
+
+private:
+    std::vector<Work> mRows;
+    size_t mRowsCount;
+    size_t mRowLength;
+    ptrdiff_t mFirst;
+    ptrdiff_t mNext;
+}; // class RowRing
+
+void clampPremultipliedRows(uint8_t* aDest,
+                            size_t aDestStride,
+                            size_t aPixelsCount,
+                            size_t aRowsCount,
+                            ColorSpec::ChannelDepth aChannelDepth)
+{
+    for (size_t y = 0; y < aRowsCount; ++y, aDest += aDestStride) {
+        if (aChannelDepth == ColorSpec::ChannelDepth::k16Bit)
+            clampPremultipliedRow<ColorSpec::ChannelDepth::k16Bit>(aDest, aPixelsCount);
+        else
+            clampPremultipliedRow<ColorSpec::ChannelDepth::k8Bit>(aDest, aPixelsCount);
+    }
+}
+
+template <typename Sample>
+void unsharpRow(const uint8_t* aSrc,
+                uint8_t* aBlurred,
+                size_t aSamplesCount,
+                int64_t aAmount,
+                int64_t aThreshold)
+{
+    const Sample* src = reinterpret_cast<const Sample*>(aSrc);
+    Sample* blurred = reinterpret_cast<Sample*>(aBlurred);
+
+    for (size_t i = 0; i < aSamplesCount; ++i) {
+        int64_t difference = static_cast<int64_t>(src[i]) - blurred[i];
+        if (std::abs(difference) < aThreshold) {
+            blurred[i] = src[i];
+            continue;
+        }
+        blurred[i] = clampToSample<Sample>(src[i] + ((difference * aAmount + 128) >> 8));
+    }
+}
+
+} // namespace
+
+FixedRowFunction fixedRowFunction()
+{
+    FixedRowFunction rowFunc = simdFixedRowFunction(Simd::level());
+    return rowFunc ? rowFunc : convolveFixedRow;
+}
+
+FixedColumnFunction fixedColumnFunction()
+{
+    FixedColumnFunction columnFunc = simdFixedColumnFunction(Simd::level());
+    return columnFunc ? columnFunc : convolveFixedColumns;
+}
+
+FloatRowFunction floatRowFunction()
+{
+    FloatRowFunction rowFunc = simdFloatRowFunction(Simd::level());
+    return rowFunc ? rowFunc : convolveFloatRow;
+}
+
+FloatColumnFunction floatColumnFunction(ColorSpec::ChannelDepth aChannelDepth)
+{
+    FloatColumnFunction columnFunc = simdFloatColumnFunction(Simd::level(), aChannelDepth);
+    if (columnFunc)
+        return columnFunc;
+
+    if (aChannelDepth == ColorSpec::ChannelDepth::k16Bit)
+        return convolveFloatColumns<ColorSpec::ChannelDepth::k16Bit>;
+    return convolveFloatColumns<ColorSpec::ChannelDepth::k8Bit>;
+}
+
+AccumulateFunction accumulateFunction()
+{
+    AccumulateFunction accumulateFunc = simdAccumulateFunction(Simd::level());
+    return accumulateFunc ? accumulateFunc : accumulateRow;
+}
+
+NormalizeFunction normalizeFunction(ColorSpec::ChannelDepth aChannelDepth)
+{
+    NormalizeFunction normalizeFunc = simdNormalizeFunction(Simd::level(), aChannelDepth);
+    if (normalizeFunc)
+        return normalizeFunc;
+
+    if (aChannelDepth == ColorSpec::ChannelDepth::k16Bit)
+        return normalizeRow<ColorSpec::ChannelDepth::k16Bit>;
+    return normalizeRow<ColorSpec::ChannelDepth::k8Bit>;
+}
+
+static BlurRowFunction blurRowFunction(size_t aChannels, ColorSpec::ChannelDepth aChannelDepth, BlurShape aShape)
+{
+#define IMGIO_BLUR_ROW(Sample, kShape) \
+    switch (aChannels) { \
+    case 1: \
+        return blurRow<Sample, 1, kShape>; \
+    case 2: \
+        return blurRow<Sample, 2, kShape>; \
+    case 3: \
+        return blurRow<Sample, 3, kShape>; \
+    case 4: \
+        return blurRow<Sample, 4, kShape>; \
+    default: \
+        return nullptr; \
+    }
+
+    bool is16Bit = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+    if (aShape == BlurShape::kStack) {
+        if (is16Bit) {
+            IMGIO_BLUR_ROW(uint16_t, BlurShape::kStack)
+        }
+        IMGIO_BLUR_ROW(uint8_t, BlurShape::kStack)
+    }
+    if (is16Bit) {
+        IMGIO_BLUR_ROW(uint16_t, BlurShape::kBox)
+    }
+    IMGIO_BLUR_ROW(uint8_t, BlurShape::kBox)
+
+#undef IMGIO_BLUR_ROW
+}
+
+void convolveRows(const uint8_t* aSrc,
+                  size_t aSrcStride,
+                  unsigned int aWidth,
+                  unsigned int aHeight,
+                  uint8_t* aDest,
+                  size_t aDestStride,
+                  ColorSpec::Format aColorFormat,
+                  ColorSpec::ChannelDepth aChannelDepth,
+                  const std::vector<float>& aRowKernel,
+                  const std::vector<float>& aColumnKernel,
+                  Image::EdgeMode aEdgeMode,
+                  unsigned int aThreadsCount)
+{
+    checkKernel(aRowKernel);
+    checkKernel(aColumnKernel);
+    if ((aWidth == 0) || (aHeight == 0))
+        return;
+
+    size_t channels = ColorSpec::channelCount(aColorFormat);
+    size_t pixelSize = ColorSpec::pixelSize(aColorFormat, aChannelDepth);
+    ptrdiff_t rowRadius = aRowKernel.size() / 2;
+    ptrdiff_t columnRadius = aColumnKernel.size() / 2;
+    bool fixed = (aChannelDepth == ColorSpec::ChannelDepth::k8Bit) &&
+                 fitsFixedPoint(aRowKernel) && fitsFixedPoint(aColumnKernel);
+    bool is16Bit = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+
+    // Fixed point kernels take pairs of taps, an odd tap pairs with a zero
+    // weight and a zero row
+    std::vector<int16_t> fixedRowWeights;
+    std::vector<int16_t> fixedColumnWeights;
+    if (fixed) {
+        fixedRowWeights = fixedPointWeights(aRowKernel);
+        fixedColumnWeights = fixedPointWeights(aColumnKernel);
+    }
+
+    FixedRowFunction fixedRow = fixedRowFunction();
+    FixedColumnFunction fixedColumn = fixedColumnFunction();
+    FloatRowFunction floatRow = floatRowFunction();
+    FloatColumnFunction floatColumn = floatColumnFunction(aChannelDepth);
+
+    size_t ringRows = aColumnKernel.size();
+    size_t workSize = fixed ? sizeof(int16_t) : sizeof(float);
+    size_t strip = stripWidth(aWidth, ringRows, channels * workSize);
+    size_t paddedPixels = strip + 2 * rowRadius + 1;
+    size_t ringRowLength = strip * channels + kSlackSamples;
+    size_t workPerRow = 2 * aWidth * pixelSize * (aRowKernel.size() + aColumnKernel.size());
+    bool premultiplied = (aColorFormat == ColorSpec::Format::kRGBAPremultiplied);
+
+    // Each band walks its strips top to bottom. A strip's source rows go
+    // through the row pass into a ring, the column pass reads the ring.
+    parallelForRows(aHeight, workPerRow, aThreadsCount, [&](size_t aBegin, size_t aEnd) {
+        std::vector<uint8_t> padded(paddedPixels * pixelSize + kSlackSamples * sizeof(uint16_t), 0);
+        std::vector<float> paddedFloats(fixed ? 0 : paddedPixels * channels + kSlackSamples, 0.0f);
+        RowRing<int16_t> fixedRing(fixed ? ringRows : 0, ringRowLength);
+        RowRing<float> floatRing(fixed ? 0 : ringRows, ringRowLength);
+        std::vector<int16_t> zeroFixedRow(fixed ? ringRowLength : 0, 0);
+        std::vector<float> zeroFloatRow(fixed ? 0 : ringRowLength, 0.0f);
+        std::vector<const int16_t*> fixedWindow(fixedColumnWeights.size());
+        std::vector<const float*> floatWindow(aColumnKernel.size());
+
+        for (size_t x0 = 0; x0 < aWidth; x0 += strip) {
+            size_t count = std::min<size_t>(strip, aWidth - x0);
+            size_t samples = count * channels;
+            size_t paddedCount = count + 2 * rowRadius;
+
+            auto gather = [&](ptrdiff_t aY) -> bool {
+                ptrdiff_t y = edgeIndex(aY, aHeight, aEdgeMode);
+                if (y < 0)
+                    return false;
+                gatherPixels(aSrc + y * aSrcStride, aWidth, x0 - rowRadius, paddedCount, pixelSize, aEdgeMode, padded.data());
+                return true;
+            };
+
+            ptrdiff_t first = static_cast<ptrdiff_t>(aBegin) - columnRadius;
+            if (fixed) {
+                fixedRing.reset(first);
+                auto computeRow = [&](ptrdiff_t aY, int16_t* aRow) {
+                    if (gather(aY))
+                        fixedRow(padded.data(), aRow, samples, channels, fixedRowWeights.data(), fixedRowWeights.size());
+                    else
+                        std::fill(aRow, aRow + samples, 0);
+                };
+                for (size_t y = aBegin; y < aEnd; ++y) {
+                    fixedRing.fill(y + columnRadius, computeRow);
+                    for (size_t k = 0; k < aColumnKernel.size(); ++k)
+                        fixedWindow[k] = fixedRing.row(y - columnRadius + k);
+                    if (fixedWindow.size() > aColumnKernel.size())
+                        fixedWindow.back() = zeroFixedRow.data();
+                    fixedColumn(fixedWindow.data(), fixedColumnWeights.data(), fixedWindow.size(),
+                                0, samples, aDest + y * aDestStride + x0 * pixelSize);
+                }
+            } else {
+                floatRing.reset(first);
+                auto computeRow = [&](ptrdiff_t aY, float* aRow) {
+                    if (!gather(aY)) {
+                        std::fill(aRow, aRow + samples, 0.0f);
+                        return;
+                    }
+                    if (is16Bit)
+                        samplesToFloat<uint16_t>(padded.data(), paddedFloats.data(), paddedCount * channels);
+                    else
+                        samplesToFloat<uint8_t>(padded.data(), paddedFloats.data(), paddedCount * channels);
+                    floatRow(paddedFloats.data(), aRow, samples, channels, aRowKernel.data(), aRowKernel.size());
+                };
+                for (size_t y = aBegin; y < aEnd; ++y) {
+                    floatRing.fill(y + columnRadius, computeRow);
+                    for (size_t k = 0; k < aColumnKernel.size(); ++k)
+                        floatWindow[k] = floatRing.row(y - columnRadius + k);
+                    floatColumn(floatWindow.data(), aColumnKernel.data(), floatWindow.size(),
+                                0, samples, aDest + y * aDestStride + x0 * pixelSize);
+                }
+            }
+
+            // Negative weights can ring colors above alpha
+            if (premultiplied)
+                clampPremultipliedRows(aDest + aBegin * aDestStride + x0 * pixelSize, aDestStride, count, aEnd - aBegin, aChannelDepth);
+        }
+    });
+}
+
+void blurRows(const uint8_t* aSrc,
+              size_t aSrcStride,
+              unsigned int aWidth,
+              unsigned int aHeight,
+              uint8_t* aDest,
+              size_t aDestStride,
+              ColorSpec::Format aColorFormat,
+              ColorSpec::ChannelDepth aChannelDepth,
+              unsigned int aRadius,
+              BlurShape aShape,
+              Image::EdgeMode aEdgeMode,
+              unsigned int aThreadsCount)
+{
+    if (aRadius > ((aShape == BlurShape::kStack) ? kMaxStackRadius : kMaxBoxRadius))
+        throw std::invalid_argument("Blur radius too large");
+    if ((aWidth == 0) || (aHeight == 0))
+        return;
+
+    size_t channels = ColorSpec::channelCount(aColorFormat);
+    size_t pixelSize = ColorSpec::pixelSize(aColorFormat, aChannelDepth);
+    if (aRadius == 0) {
+        for (size_t y = 0; y < aHeight; ++y)
+            std::memcpy(aDest + y * aDestStride, aSrc + y * aSrcStride, aWidth * pixelSize);
+        return;
+    }
+
+    BlurRowFunction blurRowFunc = blurRowFunction(channels, aChannelDepth, aShape);
+    AccumulateFunction accumulate = accumulateFunction();
+    NormalizeFunction normalize = normalizeFunction(aChannelDepth);
+    if (!blurRowFunc)
+        throw NotImplementedException("Not implemented.");
+
+    // Row sums are scaled to samples with 7 extra bits for 8 bit images,
+    // column sums back to samples. Both stay below 2^32.
+    ptrdiff_t r = aRadius;
+    uint64_t windowSum = (aShape == BlurShape::kStack) ? static_cast<uint64_t>(r + 1) * (r + 1) : 2 * r + 1;
+    int extraBits = (aChannelDepth == ColorSpec::ChannelDepth::k8Bit) ? 7 : 0;
+    uint64_t rowScale = ((uint64_t(1) << (32 + extraBits)) + windowSum / 2) / windowSum;
+    uint32_t columnScale = static_cast<uint32_t>(((uint64_t(1) << 32) + (windowSum << extraBits) / 2) / (windowSum << extraBits));
+
+    // Box sums need the rows from y - r to y + r + 1, stack sums one more
+    size_t ringRows = 2 * r + ((aShape == BlurShape::kStack) ? 3 : 2);
+    size_t strip = stripWidth(aWidth, ringRows, channels * sizeof(uint32_t));
+    size_t paddedPixels = strip + 2 * r + 2;
+    size_t ringRowLength = strip * channels;
+    size_t workPerRow = 8 * aWidth * pixelSize;
+
+    parallelForRows(aHeight, workPerRow, aThreadsCount, [&](size_t aBegin, size_t aEnd) {
+        std::vector<uint8_t> padded(paddedPixels * pixelSize, 0);
+        RowRing<uint32_t> ring(ringRows, ringRowLength);
+        std::vector<uint32_t> zeroRow(ringRowLength, 0);
+        std::vector<uint32_t> sums(ringRowLength);
+        std::vector<uint32_t> sumsIn(ringRowLength);
+        std::vector<uint32_t> sumsOut(ringRowLength);
+
+        for (size_t x0 = 0; x0 < aWidth; x0 += strip) {
+            size_t count = std::min<size_t>(strip, aWidth - x0);
+            size_t samples = count * channels;
+            const uint32_t* zero = zeroRow.data();
+
+            ptrdiff_t begin = aBegin;
+            ring.reset(begin - r);
+            auto computeRow = [&](ptrdiff_t aY, uint32_t* aRow) {
+                ptrdiff_t y = edgeIndex(aY, aHeight, aEdgeMode);
+                if (y < 0) {
+                    std::fill(aRow, aRow + samples, 0);
+                    return;
+                }
+                gatherPixels(aSrc + y * aSrcStride, aWidth, x0 - r, count + 2 * r + 2, pixelSize, aEdgeMode, padded.data());
+                blurRowFunc(padded.data(), aRow, count, aRadius, rowScale);
+            };
+            auto row = [&](ptrdiff_t aY) -> const uint32_t* {
+                return ring.row(aY);
+            };
+
+            std::fill(sums.begin(), sums.begin() + samples, 0);
+            if (aShape == BlurShape::kBox) {
+                ring.fill(begin + r, computeRow);
+                for (ptrdiff_t j = begin - r; j <= begin + r; ++j)
+                    accumulate(sums.data(), row(j), zero, samples);
+
+                for (ptrdiff_t y = begin; y < static_cast<ptrdiff_t>(aEnd); ++y) {
+                    normalize(sums.data(), aDest + y * aDestStride + x0 * pixelSize, samples, columnScale);
+                    if (y + 1 == static_cast<ptrdiff_t>(aEnd))
+                        break;
+                    ring.fill(y + r + 1, computeRow);
+                    accumulate(sums.data(), row(y + r + 1), row(y - r), samples);
+                }
+                continue;
+            }
+
+            // The triangle is the sum of the r + 1 boxes of r + 1 rows
+            // overlapping its center. sumsOut starts as the top one.
+            ring.fill(begin + r + 1, computeRow);
+            std::fill(sumsOut.begin(), sumsOut.begin() + samples, 0);
+            for (ptrdiff_t j = begin - r; j <= begin; ++j)
+                accumulate(sumsOut.data(), row(j), zero, samples);
+            std::copy(sumsOut.begin(), sumsOut.begin() + samples, sumsIn.begin());
+            accumulate(sums.data(), sumsIn.data(), zero, samples);
+            for (ptrdiff_t j = begin - r; j < begin; ++j) {
+                accumulate(sumsIn.data(), row(j + r + 1), row(j), samples);
+                accumulate(sums.data(), sumsIn.data(), zero, samples);
+            }
+            accumulate(sumsIn.data(), row(begin + r + 1), row(begin), samples);
+
+            for (ptrdiff_t y = begin; y < static_cast<ptrdiff_t>(aEnd); ++y) {
+                normalize(sums.data(), aDest + y * aDestStride + x0 * pixelSize, samples, columnScale);
+                if (y + 1 == static_cast<ptrdiff_t>(aEnd))
+                    break;
+                ring.fill(y + r + 2, computeRow);
+                accumulate(sums.data(), sumsIn.data(), sumsOut.data(), samples);
+                accumulate(sumsIn.data(), row(y + r + 2), row(y + 1), samples);
+                accumulate(sumsOut.data(), row(y + 1), row(y - r), samples);
+            }
+        }
+    });
+}
+
+void unsharpRows(const uint8_t* aSrc,
+                 size_t aSrcStride,
+                 unsigned int aWidth,
+                 unsigned int aHeight,
+                 uint8_t* aBlurred,
+                 size_t aBlurredStride,
+                 ColorSpec::Format aColorFormat,
+                 ColorSpec::ChannelDepth aChannelDepth,
+                 float aAmount,
+                 float aThreshold,
+                 unsigned int aThreadsCount)
+{
+    size_t samples = aWidth * ColorSpec::channelCount(aColorFormat);
+    size_t rowSize = aWidth * ColorSpec::pixelSize(aColorFormat, aChannelDepth);
+    bool is16Bit = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+    bool premultiplied = (aColorFormat == ColorSpec::Format::kRGBAPremultiplied);
+
+    // The amount has 8 fraction bits, the threshold is in samples
+    int64_t amount = std::llround(aAmount * 256.0f);
+    float max = is16Bit ? 65535.0f : 255.0f;
+    int64_t threshold = static_cast<int64_t>(std::ceil(std::min(std::max(aThreshold, 0.0f), 1.0f) * max));
+
+    parallelForRows(aHeight, 3 * rowSize, aThreadsCount, [=](size_t aBegin, size_t aEnd) {
+        for (size_t y = aBegin; y < aEnd; ++y) {
+            uint8_t* blurred = aBlurred + y * aBlurredStride;
+            if (is16Bit)
+                unsharpRow<uint16_t>(aSrc + y * aSrcStride, blurred, samples, amount, threshold);
+            else
+                unsharpRow<uint8_t>(aSrc + y * aSrcStride, blurred, samples, amount, threshold);
+        }
+        if (premultiplied)
+            clampPremultipliedRows(aBlurred + aBegin * aBlurredStride, aBlurredStride, aWidth, aEnd - aBegin, aChannelDepth);
+    });
+}
+
+} // namespace ImgIO
+
+// EOF
@@ -0,0 +1,337 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _FILTER_H__
+#define _FILTER_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <imgio/image.h>
+#include <imgio/simd.h>
+#include "convert.h"
+
+namespace ImgIO
+{
+
+/**
+ * Fraction bits of the fixed point weights of 8 bit convolutions.
+ */
+const int kWeightBits = 12;
+
+/**
+ * Fraction bits of the 16 bit samples between the fixed point passes.
+ */
+const int kIntermediateBits = 4;
+
+/**
+ * Convolves 8 bit samples with aTaps weights, aStep samples apart:
+ * aDest[i] = sum of aWeights[k] * aSrc[i + k * aStep], kept with
+ * kIntermediateBits fraction bits. aTaps is even, aSrc holds all the
+ * samples the taps read.
+ */
+typedef void (*FixedRowFunction)(const uint8_t* aSrc,
+                                 int16_t* aDest,
+                                 size_t aSamplesCount,
+                                 size_t aStep,
+                                 const int16_t* aWeights,
+                                 size_t aTaps);
+
+/**
+ * Combines samples [aBegin, aEnd) of aTaps rows of intermediate samples
+ * into 8 bit samples, aTaps is even.
+ */
+typedef void (*FixedColumnFunction)(const int16_t* const* aRows,
+                                    const int16_t* aWeights,
+                                    size_t aTaps,
+                                    size_t aBegin,
+                                    size_t aEnd,
+                                    uint8_t* aDest);
+
+/**
+ * Float version of FixedRowFunction, for 16 bit samples and for kernels
+ * out of the fixed point range.
+ */
+typedef void (*FloatRowFunction)(const float* aSrc,
+                                 float* aDest,
+                                 size_t aSamplesCount,
+                                 size_t aStep,
+                                 const float* aWeights,
+                                 size_t aTaps);
+
+/**
+ * Float version of FixedColumnFunction, rounds and clamps to 8 or 16 bit samples.
+ */
+typedef void (*FloatColumnFunction)(const float* const* aRows,
+                                    const float* aWeights,
+                                    size_t aTaps,
+                                    size_t aBegin,
+                                    size_t aEnd,
+                                    uint8_t* aDest);
+
+/**
+ * Adds aAdd to running sums and subtracts aSub, modulo 2^32.
+ */
+typedef void (*AccumulateFunction)(uint32_t* aSums, const uint32_t* aAdd, const uint32_t* aSub, size_t aCount);
+
+/**
+ * Scales running sums to 8 or 16 bit samples, (sum * aScale + 2^31) >> 32.
+ */
+typedef void (*NormalizeFunction)(const uint32_t* aSums, uint8_t* aDest, size_t aCount, uint32_t aScale);
+
+/**
+ * Sums a row of pixels over a window of aRadius pixels at each side, the
+ * triangle weighted one of stack blur with kStack. aSrc starts aRadius
+ * pixels left of the first one and holds 2 * aRadius + 2 more than
+ * aPixelsCount. Sums are scaled as (sum * aScale + 2^31) >> 32.
+ */
+typedef void (*BlurRowFunction)(const uint8_t* aSrc,
+                                uint32_t* aDest,
+                                size_t aPixelsCount,
+                                unsigned int aRadius,
+                                uint64_t aScale);
+
+/**
+ * Windows of the constant time blurs.
+ */
+enum class BlurShape
+{
+    kBox,
+    kStack,
+};
+
+inline int16_t clampToInt16(int32_t aValue)
+{
+    return static_cast<int16_t>(std::min(std::max(aValue, -32768), 32767));
+}
+
+template <typename Sample>
+inline Sample clampToSample(int64_t aValue)
+{
+    return static_cast<Sample>(std::min<int64_t>(std::max<int64_t>(aValue, 0), static_cast<Sample>(~Sample(0))));
+}
+
+inline void convolveFixedRow(const uint8_t* aSrc,
+                             int16_t* aDest,
+                             size_t aSamplesCount,
+                             size_t aStep,
+                             const int16_t* aWeights,
+                             size_t aTaps)
+{
+    const int32_t round = 1 << (kWeightBits - kIntermediateBits - 1);
+
+    for (size_t i = 0; i < aSamplesCount; ++i) {
+        int32_t sum = round;
+        for (size_t k = 0; k < aTaps; ++k)
+            sum += aWeights[k] * aSrc[i + k * aStep];
+        aDest[i] = clampToInt16(sum >> (kWeightBits - kIntermediateBits));
+    }
+}
+
+inline void convolveFixedColumns(const int16_t* const* aRows,
+                                 const int16_t* aWeights,
+                                 size_t aTaps,
+                                 size_t aBegin,
+                                 size_t aEnd,
+                                 uint8_t* aDest)
+{
+    const int shift = kWeightBits + kIntermediateBits;
+
+    for (size_t i = aBegin; i < aEnd; ++i) {
+        int32_t sum = 1 << (shift - 1);
+        for (size_t k = 0; k < aTaps; ++k)
+            sum += aWeights[k] * aRows[k][i];
+        aDest[i] = clampToSample<uint8_t>(sum >> shift);
+    }
+}
+
+inline void convolveFloatRow(const float* aSrc,
+                             float* aDest,
+                             size_t aSamplesCount,
+                             size_t aStep,
+                             const float* aWeights,
+                             size_t aTaps)
+{
+    for (size_t i = 0; i < aSamplesCount; ++i) {
+        float sum = 0.0f;
+        for (size_t k = 0; k < aTaps; ++k)
+            sum += aWeights[k] * aSrc[i + k * aStep];
+        aDest[i] = sum;
+    }
+}
+
+template <ColorSpec::ChannelDepth kDepth>
+void convolveFloatColumns(const float* const* aRows,
+                          const float* aWeights,
+                          size_t aTaps,
+                          size_t aBegin,
+                          size_t aEnd,
+                          uint8_t* aDest)
+{
+    typedef typename DepthTraits<kDepth>::Sample Sample;
+    const float max = static_cast<float>(DepthTraits<kDepth>::kMax);
+    Sample* dest = reinterpret_cast<Sample*>(aDest);
+
+    for (size_t i = aBegin; i < aEnd; ++i) {
+        float sum = 0.0f;
+        for (size_t k = 0; k < aTaps; ++k)
+            sum += aWeights[k] * aRows[k][i];
+        dest[i] = static_cast<Sample>(std::min(std::max(sum + 0.5f, 0.0f), max));
+    }
+}
+
+inline void accumulateRow(uint32_t* aSums, const uint32_t* aAdd, const uint32_t* aSub, size_t aCount)
+{
+    for (size_t i = 0; i < aCount; ++i)
+        aSums[i] += aAdd[i] - aSub[i];
+}
+
+template <ColorSpec::ChannelDepth kDepth>
+void normalizeRow(const uint32_t* aSums, uint8_t* aDest, size_t aCount, uint32_t aScale)
+{
+    typedef typename DepthTraits<kDepth>::Sample Sample;
+    Sample* dest = reinterpret_cast<Sample*>(aDest);
+
+    for (size_t i = 0; i < aCount; ++i) {
+        uint64_t value = (static_cast<uint64_t>(aSums[i]) * aScale + (uint64_t(1) << 31)) >> 32;
+        dest[i] = static_cast<Sample>(std::min<uint64_t>(value, DepthTraits<kDepth>::kMax));
+    }
+}
+
+// Running sums carry over from pixel to pixel, the row is summed scalar
+// with the channels of a pixel side by side.
+template <typename Sample, size_t kChannels, BlurShape kShape>
+void blurRow(const uint8_t* aSrc,
+             uint32_t* aDest,
+             size_t aPixelsCount,
+             unsigned int aRadius,
+             uint64_t aScale)
+{
+    const ptrdiff_t r = aRadius;
+    const Sample* src = reinterpret_cast<const Sample*>(aSrc) + r * kChannels;
+    uint32_t sums[kChannels] = {};
+    uint32_t sumsIn[kChannels] = {};
+    uint32_t sumsOut[kChannels] = {};
+
+    for (size_t c = 0; c < kChannels; ++c) {
+        for (ptrdiff_t j = -r; j <= r; ++j) {
+            uint32_t weight = (kShape == BlurShape::kStack) ? static_cast<uint32_t>(r + 1 - std::abs(j)) : 1;
+            sums[c] += weight * src[j * kChannels + c];
+        }
+        if (kShape == BlurShape::kStack) {
+            for (ptrdiff_t j = -r; j <= 0; ++j)
+                sumsOut[c] += src[j * kChannels + c];
+            for (ptrdiff_t j = 1; j <= r + 1; ++j)
+                sumsIn[c] += src[j * kChannels + c];
+        }
+    }
+
+    for (size_t x = 0; x < aPixelsCount; ++x, src += kChannels, aDest += kChannels) {
+        for (size_t c = 0; c < kChannels; ++c) {
+            aDest[c] = static_cast<uint32_t>((sums[c] * aScale + (uint64_t(1) << 31)) >> 32);
+            if (kShape == BlurShape::kStack) {
+                // The triangle moves by the pixels right of its top, minus those left of it
+                sums[c] += sumsIn[c] - sumsOut[c];
+                sumsIn[c] += src[(r + 2) * kChannels + c] - src[kChannels + c];
+                sumsOut[c] += src[kChannels + c] - src[-r * kChannels + c];
+            } else {
+                sums[c] += src[(r + 1) * kChannels + c] - src[-r * kChannels + c];
+            }
+        }
+    }
+}
+
+/**
+ * Returns the kernels for the current Simd::level().
+ */
+FixedRowFunction fixedRowFunction();
+FixedColumnFunction fixedColumnFunction();
+FloatRowFunction floatRowFunction();
+FloatColumnFunction floatColumnFunction(ColorSpec::ChannelDepth aChannelDepth);
+AccumulateFunction accumulateFunction();
+NormalizeFunction normalizeFunction(ColorSpec::ChannelDepth aChannelDepth);
+
+FixedRowFunction simdFixedRowFunction(Simd::Level aLevel);
+FixedColumnFunction simdFixedColumnFunction(Simd::Level aLevel);
+FloatRowFunction simdFloatRowFunction(Simd::Level aLevel);
+FloatColumnFunction simdFloatColumnFunction(Simd::Level aLevel, ColorSpec::ChannelDepth aChannelDepth);
+AccumulateFunction simdAccumulateFunction(Simd::Level aLevel);
+NormalizeFunction simdNormalizeFunction(Simd::Level aLevel, ColorSpec::ChannelDepth aChannelDepth);
+
+/**
+ * Convolves aSrc into aDest, both in the given format and depth, with a
+ * separable kernel of odd sizes. Throws std::invalid_argument for other sizes.
+ */
+void convolveRows(const uint8_t* aSrc,
+                  size_t aSrcStride,
+                  unsigned int aWidth,
+                  unsigned int aHeight,
+                  uint8_t* aDest,
+                  size_t aDestStride,
+                  ColorSpec::Format aColorFormat,
+                  ColorSpec::ChannelDepth aChannelDepth,
+                  const std::vector<float>& aRowKernel,
+                  const std::vector<float>& aColumnKernel,
+                  Image::EdgeMode aEdgeMode,
+                  unsigned int aThreadsCount);
+
+/**
+ * Blurs aSrc into aDest with running sums, in constant time per pixel.
+ * Throws std::invalid_argument for radii the sums can't hold, over 254
+ * for kStack and over 32767 for kBox.
+ */
+void blurRows(const uint8_t* aSrc,
+              size_t aSrcStride,
+              unsigned int aWidth,
+              unsigned int aHeight,
+              uint8_t* aDest,
+              size_t aDestStride,
+              ColorSpec::Format aColorFormat,
+              ColorSpec::ChannelDepth aChannelDepth,
+              unsigned int aRadius,
+              BlurShape aShape,
+              Image::EdgeMode aEdgeMode,
+              unsigned int aThreadsCount);
+
+/**
+ * Sharpens aSrc by the difference from its blurred copy aBlurred, which
+ * receives the result: src + aAmount * (src - blurred), where the
+ * difference reaches aThreshold (a fraction of the full scale).
+ */
+void unsharpRows(const uint8_t* aSrc,
+                 size_t aSrcStride,
+                 unsigned int aWidth,
+                 unsigned int aHeight,
+                 uint8_t* aBlurred,
+                 size_t aBlurredStride,
+                 ColorSpec::Format aColorFormat,
+                 ColorSpec::ChannelDepth aChannelDepth,
+                 float aAmount,
+                 float aThreshold,
+                 unsigned int aThreadsCount);
+
+} // namespace ImgIO
+
+#endif // _FILTER_H__
+// EOF
@@ -0,0 +1,474 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "filter.h"
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMGIO_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace ImgIO
+{
+
+#ifdef IMGIO_X86_SIMD
+
+#define IMGIO_TARGET_SSE2 __attribute__((target("sse2")))
+#define IMGIO_TARGET_AVX2 __attribute__((target("avx2")))
+
+namespace
+{
+
+// Two neighbouring 16 bit weights, as multiplied by pmaddwd.
+inline int32_t weightPair(const int16_t* aWeights)
+{
+    int32_t pair;
+    std::memcpy(&pair, aWeights, sizeof(pair));
+    return pair;
+}
+
+//
+// Fixed point passes: samples of two taps are interleaved and multiplied
+// by their pair of weights in one pmaddwd, summing into 32 bit lanes.
+//
+
+IMGIO_TARGET_SSE2 void convolveFixedRowSSE2(const uint8_t* aSrc,
+                                            int16_t* aDest,
+                                            size_t aSamplesCount,
+                                            size_t aStep,
+                                            const int16_t* aWeights,
+                                            size_t aTaps)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (kWeightBits - kIntermediateBits - 1));
+
+    size_t i = 0;
+    for (; i + 8 <= aSamplesCount; i += 8) {
+        const uint8_t* src = aSrc + i;
+        __m128i sumLo = round;
+        __m128i sumHi = round;
+        for (size_t k = 0; k < aTaps; k += 2, src += 2 * aStep) {
+            __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)), zero);
+            __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + aStep)), zero);
+            __m128i weights = _mm_set1_epi32(weightPair(aWeights + k));
+            sumLo = _mm_add_epi32(sumLo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), weights));
+            sumHi = _mm_add_epi32(sumHi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), weights));
+        }
+        sumLo = _mm_srai_epi32(sumLo, kWeightBits - kIntermediateBits);
+        sumHi = _mm_srai_epi32(sumHi, kWeightBits - kIntermediateBits);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + i), _mm_packs_epi32(sumLo, sumHi));
+    }
+
+    convolveFixedRow(aSrc + i, aDest + i, aSamplesCount - i, aStep, aWeights, aTaps);
+}
+
+IMGIO_TARGET_SSE2 void convolveFixedColumnsSSE2(const int16_t* const* aRows,
+                                                const int16_t* aWeights,
+                                                size_t aTaps,
+                                                size_t aBegin,
+                                                size_t aEnd,
+                                                uint8_t* aDest)
+{
+    const int shift = kWeightBits + kIntermediateBits;
+    const __m128i round = _mm_set1_epi32(1 << (shift - 1));
+
+    size_t i = aBegin;
+    for (; i + 8 <= aEnd; i += 8) {
+        __m128i sumLo = round;
+        __m128i sumHi = round;
+        for (size_t k = 0; k < aTaps; k += 2) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aRows[k] + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aRows[k + 1] + i));
+            __m128i weights = _mm_set1_epi32(weightPair(aWeights + k));
+            sumLo = _mm_add_epi32(sumLo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), weights));
+            sumHi = _mm_add_epi32(sumHi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), weights));
+        }
+        __m128i samples = _mm_packs_epi32(_mm_srai_epi32(sumLo, shift), _mm_srai_epi32(sumHi, shift));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(aDest + i), _mm_packus_epi16(samples, samples));
+    }
+
+    convolveFixedColumns(aRows, aWeights, aTaps, i, aEnd, aDest);
+}
+
+IMGIO_TARGET_AVX2 void convolveFixedRowAVX2(const uint8_t* aSrc,
+                                            int16_t* aDest,
+                                            size_t aSamplesCount,
+                                            size_t aStep,
+                                            const int16_t* aWeights,
+                                            size_t aTaps)
+{
+    const __m256i round = _mm256_set1_epi32(1 << (kWeightBits - kIntermediateBits - 1));
+
+    // Unpacks work within 128 bit lanes, packing the sums back restores
+    // the order of the samples
+    size_t i = 0;
+    for (; i + 16 <= aSamplesCount; i += 16) {
+        const uint8_t* src = aSrc + i;
+        __m256i sumLo = round;
+        __m256i sumHi = round;
+        for (size_t k = 0; k < aTaps; k += 2, src += 2 * aStep) {
+            __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+            __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + aStep)));
+            __m256i weights = _mm256_set1_epi32(weightPair(aWeights + k));
+            sumLo = _mm256_add_epi32(sumLo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), weights));
+            sumHi = _mm256_add_epi32(sumHi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), weights));
+        }
+        sumLo = _mm256_srai_epi32(sumLo, kWeightBits - kIntermediateBits);
+        sumHi = _mm256_srai_epi32(sumHi, kWeightBits - kIntermediateBits);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + i), _mm256_packs_epi32(sumLo, sumHi));
+    }
+
+    convolveFixedRowSSE2(aSrc + i, aDest + i, aSamplesCount - i, aStep, aWeights, aTaps);
+}
+
+IMGIO_TARGET_AVX2 void convolveFixedColumnsAVX2(const int16_t* const* aRows,
+                                                const int16_t* aWeights,
+                                                size_t aTaps,
+                                                size_t aBegin,
+                                                size_t aEnd,
+                                                uint8_t* aDest)
+{
+    const int shift = kWeightBits + kIntermediateBits;
+    const __m256i round = _mm256_set1_epi32(1 << (shift - 1));
+
+    size_t i = aBegin;
+    for (; i + 16 <= aEnd; i += 16) {
+        __m256i sumLo = round;
+        __m256i sumHi = round;
+        for (size_t k = 0; k < aTaps; k += 2) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aRows[k] + i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aRows[k + 1] + i));
+            __m256i weights = _mm256_set1_epi32(weightPair(aWeights + k));
+            sumLo = _mm256_add_epi32(sumLo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), weights));
+            sumHi = _mm256_add_epi32(sumHi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), weights));
+        }
+        __m256i samples = _mm256_packs_epi32(_mm256_srai_epi32(sumLo, shift), _mm256_srai_epi32(sumHi, shift));
+        samples = _mm256_permute4x64_epi64(_mm256_packus_epi16(samples, samples), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + i), _mm256_castsi256_si128(samples));
+    }
+
+    convolveFixedColumnsSSE2(aRows, aWeights, aTaps, i, aEnd, aDest);
+}
+
+//
+// Float passes, for 16 bit samples and kernels out of the fixed point range.
+//
+
+IMGIO_TARGET_SSE2 void convolveFloatRowSSE2(const float* aSrc,
+                                            float* aDest,
+                                            size_t aSamplesCount,
+                                            size_t aStep,
+                                            const float* aWeights,
+                                            size_t aTaps)
+{
+    size_t i = 0;
+    for (; i + 4 <= aSamplesCount; i += 4) {
+        __m128 sum = _mm_setzero_ps();
+        for (size_t k = 0; k < aTaps; ++k)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(aWeights[k]), _mm_loadu_ps(aSrc + i + k * aStep)));
+        _mm_storeu_ps(aDest + i, sum);
+    }
+
+    convolveFloatRow(aSrc + i, aDest + i, aSamplesCount - i, aStep, aWeights, aTaps);
+}
+
+IMGIO_TARGET_AVX2 void convolveFloatRowAVX2(const float* aSrc,
+                                            float* aDest,
+                                            size_t aSamplesCount,
+                                            size_t aStep,
+                                            const float* aWeights,
+                                            size_t aTaps)
+{
+    size_t i = 0;
+    for (; i + 8 <= aSamplesCount; i += 8) {
+        __m256 sum = _mm256_setzero_ps();
+        for (size_t k = 0; k < aTaps; ++k)
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(aWeights[k]), _mm256_loadu_ps(aSrc + i + k * aStep)));
+        _mm256_storeu_ps(aDest + i, sum);
+    }
+
+    convolveFloatRowSSE2(aSrc + i, aDest + i, aSamplesCount - i, aStep, aWeights, aTaps);
+}
+
+template <ColorSpec::ChannelDepth kDepth>
+IMGIO_TARGET_SSE2 void convolveFloatColumnsSSE2(const float* const* aRows,
+                                                const float* aWeights,
+                                                size_t aTaps,
+                                                size_t aBegin,
+                                                size_t aEnd,
+                                                uint8_t* aDest)
+{
+    typedef typename DepthTraits<kDepth>::Sample Sample;
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 max = _mm_set1_ps(static_cast<float>(DepthTraits<kDepth>::kMax));
+    Sample* dest = reinterpret_cast<Sample*>(aDest);
+
+    size_t i = aBegin;
+    for (; i + 4 <= aEnd; i += 4) {
+        __m128 sum = _mm_setzero_ps();
+        for (size_t k = 0; k < aTaps; ++k)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(aWeights[k]), _mm_loadu_ps(aRows[k] + i)));
+        __m128i samples = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_add_ps(sum, half), zero), max));
+        if (kDepth == ColorSpec::ChannelDepth::k16Bit) {
+            // Signed packing, shifted into its range and back
+            const __m128i bias = _mm_set1_epi32(0x8000);
+            samples = _mm_packs_epi32(_mm_sub_epi32(samples, bias), _mm_sub_epi32(samples, bias));
+            samples = _mm_xor_si128(samples, _mm_set1_epi16(static_cast<int16_t>(0x8000)));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + i), samples);
+        } else {
+            samples = _mm_packs_epi32(samples, samples);
+            int32_t packed = _mm_cvtsi128_si32(_mm_packus_epi16(samples, samples));
+            std::memcpy(dest + i, &packed, sizeof(packed));
+        }
+    }
+
+    convolveFloatColumns<kDepth>(aRows, aWeights, aTaps, i, aEnd, aDest);
+}
+
+template <ColorSpec::ChannelDepth kDepth>
+IMGIO_TARGET_AVX2 void convolveFloatColumnsAVX2(const float* const* aRows,
+                                                const float* aWeights,
+                                                size_t aTaps,
+                                                size_t aBegin,
+                                                size_t aEnd,
+                                                uint8_t* aDest)
+{
+    typedef typename DepthTraits<kDepth>::Sample Sample;
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 max = _mm256_set1_ps(static_cast<float>(DepthTraits<kDepth>::kMax));
+    Sample* dest = reinterpret_cast<Sample*>(aDest);
+
+    size_t i = aBegin;
+    for (; i + 8 <= aEnd; i += 8) {
+        __m256 sum = _mm256_setzero_ps();
+        for (size_t k = 0; k < aTaps; ++k)
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(aWeights[k]), _mm256_loadu_ps(aRows[k] + i)));
+        __m256i samples = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_add_ps(sum, half), zero), max));
+        samples = _mm256_packus_epi32(samples, samples);
+        if (kDepth == ColorSpec::ChannelDepth::k16Bit) {
+            samples = _mm256_permute4x64_epi64(samples, 0x08);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm256_castsi256_si128(samples));
+        } else {
+            samples = _mm256_packus_epi16(samples, samples);
+            __m128i packed = _mm_unpacklo_epi32(_mm256_castsi256_si128(samples), _mm256_extracti128_si256(samples, 1));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + i), packed);
+        }
+    }
+
+    convolveFloatColumnsSSE2<kDepth>(aRows, aWeights, aTaps, i, aEnd, aDest);
+}
+
+//
+// Running sums of the constant time blurs, one lane per sample.
+//
+
+IMGIO_TARGET_SSE2 void accumulateRowSSE2(uint32_t* aSums, const uint32_t* aAdd, const uint32_t* aSub, size_t aCount)
+{
+    size_t i = 0;
+    for (; i + 4 <= aCount; i += 4) {
+        __m128i sums = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSums + i));
+        __m128i add = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aAdd + i));
+        __m128i sub = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSub + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aSums + i), _mm_sub_epi32(_mm_add_epi32(sums, add), sub));
+    }
+
+    accumulateRow(aSums + i, aAdd + i, aSub + i, aCount - i);
+}
+
+IMGIO_TARGET_AVX2 void accumulateRowAVX2(uint32_t* aSums, const uint32_t* aAdd, const uint32_t* aSub, size_t aCount)
+{
+    size_t i = 0;
+    for (; i + 8 <= aCount; i += 8) {
+        __m256i sums = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSums + i));
+        __m256i add = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aAdd + i));
+        __m256i sub = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSub + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aSums + i), _mm256_sub_epi32(_mm256_add_epi32(sums, add), sub));
+    }
+
+    accumulateRowSSE2(aSums + i, aAdd + i, aSub + i, aCount - i);
+}
+
+// High halves of 32 x 32 bit products, pmuludq multiplies the even lanes.
+IMGIO_TARGET_SSE2 inline __m128i scaleSums(__m128i aSums, __m128i aScale)
+{
+    const __m128i round = _mm_set1_epi64x(int64_t(1) << 31);
+    __m128i even = _mm_add_epi64(_mm_mul_epu32(aSums, aScale), round);
+    __m128i odd = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(aSums, 32), aScale), round);
+    return _mm_or_si128(_mm_srli_epi64(even, 32), _mm_and_si128(odd, _mm_set_epi32(-1, 0, -1, 0)));
+}
+
+template <ColorSpec::ChannelDepth kDepth>
+IMGIO_TARGET_SSE2 void normalizeRowSSE2(const uint32_t* aSums, uint8_t* aDest, size_t aCount, uint32_t aScale)
+{
+    typedef typename DepthTraits<kDepth>::Sample Sample;
+    const __m128i scale = _mm_set1_epi32(static_cast<int32_t>(aScale));
+    Sample* dest = reinterpret_cast<Sample*>(aDest);
+
+    size_t i = 0;
+    for (; i + 4 <= aCount; i += 4) {
+        __m128i samples = scaleSums(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSums + i)), scale);
+        if (kDepth == ColorSpec::ChannelDepth::k16Bit) {
+            const __m128i bias = _mm_set1_epi32(0x8000);
+            samples = _mm_packs_epi32(_mm_sub_epi32(samples, bias), _mm_sub_epi32(samples, bias));
+            samples = _mm_xor_si128(samples, _mm_set1_epi16(static_cast<int16_t>(0x8000)));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + i), samples);
+        } else {
+            samples = _mm_packs_epi32(samples, samples);
+            int32_t packed = _mm_cvtsi128_si32(_mm_packus_epi16(samples, samples));
+            std::memcpy(dest + i, &packed, sizeof(packed));
+        }
+    }
+
+    normalizeRow<kDepth>(aSums + i, reinterpret_cast<uint8_t*>(dest + i), aCount - i, aScale);
+}
+
+template <ColorSpec::ChannelDepth kDepth>
+IMGIO_TARGET_AVX2 void normalizeRowAVX2(const uint32_t* aSums, uint8_t* aDest, size_t aCount, uint32_t aScale)
+{
+    typedef typename DepthTraits<kDepth>::Sample Sample;
+    const __m256i scale = _mm256_set1_epi32(static_cast<int32_t>(aScale));
+    const __m256i round = _mm256_set1_epi64x(int64_t(1) << 31);
+    Sample* dest = reinterpret_cast<Sample*>(aDest);
+
+    size_t i = 0;
+    for (; i + 8 <= aCount; i += 8) {
+        __m256i sums = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSums + i));
+        __m256i even = _mm256_add_epi64(_mm256_mul_epu32(sums, scale), round);
+        __m256i odd = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(sums, 32), scale), round);
+        __m256i samples = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+        samples = _mm256_packus_epi32(samples, samples);
+        if (kDepth == ColorSpec::ChannelDepth::k16Bit) {
+            samples = _mm256_permute4x64_epi64(samples, 0x08);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm256_castsi256_si128(samples));
+        } else {
+            samples = _mm256_packus_epi16(samples, samples);
+            __m128i packed = _mm_unpacklo_epi32(_mm256_castsi256_si128(samples), _mm256_extracti128_si256(samples, 1));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + i), packed);
+        }
+    }
+
+    normalizeRowSSE2<kDepth>(aSums + i, reinterpret_cast<uint8_t*>(dest + i), aCount - i, aScale);
+}
+
+} // namespace
+
+FixedRowFunction simdFixedRowFunction(Simd::Level aLevel)
+{
+    if (aLevel >= Simd::Level::kAVX2)
+        return convolveFixedRowAVX2;
+    if (aLevel >= Simd::Level::kSSE2)
+        return convolveFixedRowSSE2;
+    return nullptr;
+}
+
+FixedColumnFunction simdFixedColumnFunction(Simd::Level aLevel)
+{
+    if (aLevel >= Simd::Level::kAVX2)
+        return convolveFixedColumnsAVX2;
+    if (aLevel >= Simd::Level::kSSE2)
+        return convolveFixedColumnsSSE2;
+    return nullptr;
+}
+
+FloatRowFunction simdFloatRowFunction(Simd::Level aLevel)
+{
+    if (aLevel >= Simd::Level::kAVX2)
+        return convolveFloatRowAVX2;
+    if (aLevel >= Simd::Level::kSSE2)
+        return convolveFloatRowSSE2;
+    return nullptr;
+}
+
+FloatColumnFunction simdFloatColumnFunction(Simd::Level aLevel, ColorSpec::ChannelDepth aChannelDepth)
+{
+    bool is16Bit = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+    if (aLevel >= Simd::Level::kAVX2)
+        return is16Bit ? convolveFloatColumnsAVX2<ColorSpec::ChannelDepth::k16Bit>
+                       : convolveFloatColumnsAVX2<ColorSpec::ChannelDepth::k8Bit>;
+    if (aLevel >= Simd::Level::kSSE2)
+        return is16Bit ? convolveFloatColumnsSSE2<ColorSpec::ChannelDepth::k16Bit>
+                       : convolveFloatColumnsSSE2<ColorSpec::ChannelDepth::k8Bit>;
+    return nullptr;
+}
+
+AccumulateFunction simdAccumulateFunction(Simd::Level aLevel)
+{
+    if (aLevel >= Simd::Level::kAVX2)
+        return accumulateRowAVX2;
+    if (aLevel >= Simd::Level::kSSE2)
+        return accumulateRowSSE2;
+    return nullptr;
+}
+
+NormalizeFunction simdNormalizeFunction(Simd::Level aLevel, ColorSpec::ChannelDepth aChannelDepth)
+{
+    bool is16Bit = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+    if (aLevel >= Simd::Level::kAVX2)
+        return is16Bit ? normalizeRowAVX2<ColorSpec::ChannelDepth::k16Bit>
+                       : normalizeRowAVX2<ColorSpec::ChannelDepth::k8Bit>;
+    if (aLevel >= Simd::Level::kSSE2)
+        return is16Bit ? normalizeRowSSE2<ColorSpec::ChannelDepth::k16Bit>
+                       : normalizeRowSSE2<ColorSpec::ChannelDepth::k8Bit>;
+    return nullptr;
+}
+
+#else // IMGIO_X86_SIMD
+
+FixedRowFunction simdFixedRowFunction(Simd::Level aLevel)
+{
+    return nullptr;
+}
+
+FixedColumnFunction simdFixedColumnFunction(Simd::Level aLevel)
+{
+    return nullptr;
+}
+
+FloatRowFunction simdFloatRowFunction(Simd::Level aLevel)
+{
+    return nullptr;
+}
+
+FloatColumnFunction simdFloatColumnFunction(Simd::Level aLevel, ColorSpec::ChannelDepth aChannelDepth)
+{
+    return nullptr;
+}
+
+AccumulateFunction simdAccumulateFunction(Simd::Level aLevel)
+{
+    return nullptr;
+}
+
+NormalizeFunction simdNormalizeFunction(Simd::Level aLevel, ColorSpec::ChannelDepth aChannelDepth)
+{
+    return nullptr;
+}
+
+#endif // IMGIO_X86_SIMD
+
+} // namespace ImgIO
+
+// EOF
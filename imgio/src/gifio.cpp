@@ -22,7 +22,15 @@
 //
 
 #include "gifio.h"
+
+#ifdef GIFIO_ENABLED
+
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 #include <gif_lib.h>
 
 #include "dataio.h"
@@ -30,18 +38,217 @@
 namespace ImgIO
 {
 
+    static int readDataHandler(GifFileType* aGif, GifByteType* aData, int aLength)
+    {
+        return static_cast<int>(reinterpret_cast<BufferedReader*>(aGif->UserData)->read(aData, aLength));
+    }
+
+    static int writeDataHandler(GifFileType* aGif, const GifByteType* aData, int aLength)
+    {
+        reinterpret_cast<BufferedWriter*>(aGif->UserData)->write(aData, aLength);
+        return aLength;
+    }
+
+    static std::string errorString(int aError)
+    {
+        const char* message = GifErrorString(aError);
+        return message ? message : "unknown error";
+    }
+
+    struct GifDecoderCloser
+    {
+        void operator()(GifFileType* aGif) const
+        {
+            int error = 0;
+            DGifCloseFile(aGif, &error);
+        }
+    };
+
+    struct GifEncoderCloser
+    {
+        void operator()(GifFileType* aGif) const
+        {
+            int error = 0;
+            EGifCloseFile(aGif, &error);
+        }
+    };
+
+    /**
+     * Decodes the first frame onto the logical screen, as indices into its
+     * color map. Pixels the frame doesn't cover are transparent, if the
+     * frame has a transparent color, or the background color. Records past
+     * the first frame aren't read.
+     */
     static Image readGif(DataReader& aDataReader,
                          ColorSpec::Format aOutputImageformat,
                          ColorSpec::ChannelDepth aOutputImageChannelDepth)
     {
-        // TODO: Implement
-        return {};
+        // giflib reads a few bytes at a time
+        BufferedReader reader(aDataReader);
+        int error = 0;
+        std::unique_ptr<GifFileType, GifDecoderCloser> gif(DGifOpen(&reader, readDataHandler, &error));
+        if (!gif)
+            throw std::logic_error("GIF decode error: " + errorString(error));
+
+        // The graphics control extension before the first frame applies to it
+        GraphicsControlBlock control;
+        control.DisposalMode = DISPOSAL_UNSPECIFIED;
+        control.UserInputFlag = false;
+        control.DelayTime = 0;
+        control.TransparentColor = NO_TRANSPARENT_COLOR;
+
+        GifRecordType recordType = UNDEFINED_RECORD_TYPE;
+        while (recordType != IMAGE_DESC_RECORD_TYPE) {
+            if (DGifGetRecordType(gif.get(), &recordType) != GIF_OK)
+                throw std::logic_error("GIF decode error: " + errorString(gif->Error));
+
+            if (recordType == TERMINATE_RECORD_TYPE)
+                throw std::logic_error("GIF decode error: no image");
+
+            if (recordType == EXTENSION_RECORD_TYPE) {
+                int code = 0;
+                GifByteType* extension = nullptr;
+                if (DGifGetExtension(gif.get(), &code, &extension) != GIF_OK)
+                    throw std::logic_error("GIF decode error: " + errorString(gif->Error));
+                if ((code == GRAPHICS_EXT_FUNC_CODE) && extension)
+                    DGifExtensionToGCB(extension[0], extension + 1, &control);
+                while (extension) {
+                    if (DGifGetExtensionNext(gif.get(), &extension) != GIF_OK)
+                        throw std::logic_error("GIF decode error: " + errorString(gif->Error));
+                }
+            }
+        }
+
+        if (DGifGetImageDesc(gif.get()) != GIF_OK)
+            throw std::logic_error("GIF decode error: " + errorString(gif->Error));
+
+        const GifImageDesc& frame = gif->Image;
+        const ColorMapObject* colorMap = frame.ColorMap ? frame.ColorMap : gif->SColorMap;
+        if (!colorMap)
+            throw UnsupportedImageFormatException("GIF without a color map");
+
+        Palette palette;
+        for (int i = 0; (i < colorMap->ColorCount) && (i < 256); ++i) {
+            const GifColorType& color = colorMap->Colors[i];
+            uint8_t alpha = (i == control.TransparentColor) ? 0 : 0xff;
+            palette.push_back(PaletteColor{color.Red, color.Green, color.Blue, alpha});
+        }
+
+        Image image(gif->SWidth, gif->SHeight, ColorSpec::Format::kIndexed, ColorSpec::ChannelDepth::k8Bit);
+        image.setPalette(palette);
+        if (!image.isValid())
+            return image;
+
+        uint8_t fill = (control.TransparentColor != NO_TRANSPARENT_COLOR) ? control.TransparentColor
+                                                                           : gif->SBackGroundColor;
+        long width = image.width();
+        long height = image.height();
+        long left = std::max<long>(frame.Left, 0);
+        long right = std::min<long>(frame.Left + frame.Width, width);
+        for (long y = 0; y < height; ++y)
+            std::memset(image.data() + y * image.stride(), fill, width);
+
+        // Rows of the frame are decoded one by one and clipped to the screen,
+        // interlaced ones come in four passes
+        static const int kPassOffsets[] = {0, 4, 2, 1};
+        static const int kPassSteps[] = {8, 8, 4, 2};
+        int passesCount = frame.Interlace ? 4 : 1;
+        std::vector<GifPixelType> line(std::max<long>(frame.Width, 1));
+        for (int pass = 0; pass < passesCount; ++pass) {
+            int offset = frame.Interlace ? kPassOffsets[pass] : 0;
+            int step = frame.Interlace ? kPassSteps[pass] : 1;
+            for (long frameY = offset; (frame.Width > 0) && (frameY < frame.Height); frameY += step) {
+                if (DGifGetLine(gif.get(), line.data(), frame.Width) != GIF_OK)
+                    throw std::logic_error("GIF decode error: " + errorString(gif->Error));
+
+                long y = frame.Top + frameY;
+                if ((y >= 0) && (y < height) && (left < right))
+                    std::memcpy(image.data() + y * image.stride() + left, line.data() + (left - frame.Left), right - left);
+            }
+        }
+
+        if ((aOutputImageformat != ColorSpec::Format::kIndexed) ||
+            (aOutputImageChannelDepth != ColorSpec::ChannelDepth::k8Bit))
+            image.convertInPlace(aOutputImageformat, aOutputImageChannelDepth);
+
+        return image;
     }
 
+    /**
+     * Encodes an indexed image as a single frame. The first entry of the
+     * palette with alpha below half becomes the transparent color, other
+     * alphas are dropped.
+     */
     static void writeGif(DataWriter& aDataWriter,
                          const Image& aImage)
     {
-        // TODO: Implement
+        if (aImage.colorFormat() != ColorSpec::Format::kIndexed)
+            throw NotImplementedException("GIF encoding needs an indexed image");
+
+        // Color maps have a power of two entries, indices past the palette are opaque black
+        Palette palette = aImage.palette();
+        if (palette.empty())
+            palette.assign(256, PaletteColor{0, 0, 0, 0xff});
+        int bits = GifBitSize(static_cast<int>(palette.size()));
+        std::vector<GifColorType> colors(1u << bits, GifColorType{0, 0, 0});
+        int transparentColor = NO_TRANSPARENT_COLOR;
+        for (size_t i = 0; i < palette.size(); ++i) {
+            colors[i].Red = palette[i].r;
+            colors[i].Green = palette[i].g;
+            colors[i].Blue = palette[i].b;
+            if ((transparentColor == NO_TRANSPARENT_COLOR) && (palette[i].a < 0x80))
+                transparentColor = static_cast<int>(i);
+        }
+
+        BufferedWriter writer(aDataWriter);
+        int error = 0;
+        std::unique_ptr<GifFileType, GifEncoderCloser> gif(EGifOpen(&writer, writeDataHandler, &error));
+        if (!gif)
+            throw std::logic_error("GIF encode error: " + errorString(error));
+
+        std::unique_ptr<ColorMapObject, void (*)(ColorMapObject*)> colorMap(
+            GifMakeMapObject(static_cast<int>(colors.size()), colors.data()), GifFreeMapObject);
+        if (!colorMap)
+            throw std::logic_error("GIF encode error: " + errorString(E_GIF_ERR_NOT_ENOUGH_MEM));
+
+        int width = static_cast<int>(aImage.width());
+        int height = static_cast<int>(aImage.height());
+        // giflib stamps GIF87a unless told otherwise, which has no
+        // graphics control extension for the transparent color
+        EGifSetGifVersion(gif.get(), true);
+        bool ok = (EGifPutScreenDesc(gif.get(), width, height, bits, 0, colorMap.get()) == GIF_OK);
+
+        if (ok && (transparentColor != NO_TRANSPARENT_COLOR)) {
+            GraphicsControlBlock control;
+            control.DisposalMode = DISPOSAL_UNSPECIFIED;
+            control.UserInputFlag = false;
+            control.DelayTime = 0;
+            control.TransparentColor = transparentColor;
+
+            GifByteType extension[4];
+            size_t extensionSize = EGifGCBToExtension(&control, extension);
+            ok = (EGifPutExtension(gif.get(), GRAPHICS_EXT_FUNC_CODE, static_cast<int>(extensionSize), extension) == GIF_OK);
+        }
+
+        ok = ok && (EGifPutImageDesc(gif.get(), 0, 0, width, height, false, nullptr) == GIF_OK);
+
+        // EGifPutLine() masks the indices to the code size in place, so rows
+        // of the image, which may be shared, go through a copy
+        std::vector<GifPixelType> line(std::max(width, 1));
+        for (int y = 0; ok && (y < height); ++y) {
+            const uint8_t* row = aImage.data() + y * aImage.stride();
+            std::copy(row, row + width, line.begin());
+            ok = (EGifPutLine(gif.get(), line.data(), width) == GIF_OK);
+        }
+
+        if (!ok)
+            throw std::logic_error("GIF encode error: " + errorString(gif->Error));
+
+        // Closing writes the trailer
+        GifFileType* file = gif.release();
+        if (EGifCloseFile(file, &error) != GIF_OK)
+            throw std::logic_error("GIF encode error: " + errorString(error));
+        writer.flush();
     }
 
     Image GifIO::read(std::istream& aPngDataStream,
@@ -71,11 +278,33 @@ namespace ImgIO
         writeGif(streamWriter, aImage);
     }
 
-    void GifIO::write(const Image& aImage, uint8_t* aData, size_t aLength)
+    void GifIO::write(const Image& aImage, DataWriter& aDataWriter)
     {
-        MemoryWriter streamWriter(aData, aLength);
-        writeGif(streamWriter, aImage);
+        writeGif(aDataWriter, aImage);
+    }
+
+    size_t GifIO::write(const Image& aImage, uint8_t* aData, size_t aLength)
+    {
+        MemoryWriter memoryWriter(aData, aLength);
+        writeGif(memoryWriter, aImage);
+        if (memoryWriter.isTruncated())
+            throw std::length_error("GIF data doesn't fit into the output buffer");
+        return memoryWriter.bytesWritten();
+    }
+
+    size_t GifIO::maxEncodedSize(const Image& aImage)
+    {
+        // Each LZW code takes 12 bits at most and covers a pixel at least,
+        // clear codes come at most every 256 codes. Sub-blocks add a byte
+        // per 255, the header, color map, extension, image descriptor and
+        // trailer fit into 1024 bytes.
+        size_t pixelsCount = static_cast<size_t>(aImage.width()) * aImage.height();
+        size_t codesCount = pixelsCount + pixelsCount / 256 + 3;
+        size_t dataSize = (codesCount * 12 + 7) / 8;
+        return dataSize + dataSize / 255 + 2 + 1024;
     }
 
 } // namespace ImgIO
+
+#endif // GIFIO_ENABLED
 // EOF
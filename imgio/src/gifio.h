@@ -29,6 +29,8 @@
 
 namespace ImgIO {
 
+    class DataWriter;
+
     class GifIO {
     public:
         static Image read(std::istream &aPngDataStream,
@@ -44,8 +46,20 @@ namespace ImgIO {
                           std::ostream &aPngDataStream);
 
         static void write(const Image &aImage,
-                          uint8_t *aData,
-                          size_t aLength);
+                          DataWriter &aDataWriter);
+
+        /**
+         * Encodes into aData and returns the number of bytes written. Throws
+         * std::length_error when they don't fit into aLength.
+         */
+        static size_t write(const Image &aImage,
+                            uint8_t *aData,
+                            size_t aLength);
+
+        /**
+         * Returns an upper bound of the size of aImage encoded by write().
+         */
+        static size_t maxEncodedSize(const Image &aImage);
     }; // class JpegIO
 
 } // namespace ImgIO
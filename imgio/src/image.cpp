@@ -21,69 +21,119 @@
 // SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <new>
 #include <imgio/image.h>
 #include "imageimpl.h"
 
 namespace ImgIO
 {
 
+const size_t Image::kRowAlignment;
+const size_t Image::kImplSize;
+
+Image::Impl& Image::impl()
+{
+    static_assert(sizeof(Impl) <= kImplSize, "Image::kImplSize is too small for Image::Impl");
+    static_assert(alignof(Impl) <= alignof(decltype(mImpl)), "Image::Impl is overaligned");
+    return *reinterpret_cast<Impl*>(&mImpl);
+}
+
+const Image::Impl& Image::impl() const
+{
+    return *reinterpret_cast<const Impl*>(&mImpl);
+}
+
 Image::Image()
-: mImpl(new Image::Impl)
-{}
+{
+    new (&mImpl) Impl();
+}
 
-Image::Image(Image&& aImage)
-: mImpl(std::move(aImage.mImpl))
-{}
+Image::Image(Image&& aImage) noexcept
+{
+    new (&mImpl) Impl(std::move(aImage.impl()));
+}
 
 Image::Image(const Image& aImage)
-: mImpl(new Impl(*aImage.mImpl))
-{}
+{
+    new (&mImpl) Impl(aImage.impl());
+}
 
-Image::Image(unsigned int aWidth, unsigned int aHeight, ColorSpec::Format aColorFormat, ColorSpec::ChannelDepth aColorChannelDepth, uint8_t* aData)
-: mImpl(new Impl(aWidth, aHeight, aColorFormat, aColorChannelDepth, aData))
-{}
+Image::Image(unsigned int aWidth, unsigned int aHeight, ColorSpec::Format aColorFormat, ColorSpec::ChannelDepth aColorChannelDepth, uint8_t* aData, size_t aStride)
+{
+    new (&mImpl) Impl(aWidth, aHeight, aColorFormat, aColorChannelDepth, aData, aStride);
+}
 
 Image::Image(Impl&& aImpl)
-        : mImpl(new Impl(std::move(aImpl)))
 {
+    new (&mImpl) Impl(std::move(aImpl));
 }
 
 Image::~Image()
-{}
+{
+    impl().~Impl();
+}
+
+Image& Image::operator=(const Image& aImage)
+{
+    impl() = aImage.impl();
+    return *this;
+}
+
+Image& Image::operator=(Image&& aImage) noexcept
+{
+    impl() = std::move(aImage.impl());
+    return *this;
+}
 
 bool Image::isValid() const
 {
-    return mImpl->isValid();
+    return impl().isValid();
 }
 
 ColorSpec::Format Image::colorFormat() const
 {
-    return mImpl->colorFormat();
+    return impl().colorFormat();
 }
 
 ColorSpec::ChannelDepth Image::colorChannelDepth() const
 {
-    return mImpl->colorChannelDepth();
+    return impl().colorChannelDepth();
 }
 
 unsigned int Image::width() const
 {
-    return mImpl->width();
+    return impl().width();
 }
 
 unsigned int Image::height() const
 {
-    return mImpl->height();
+    return impl().height();
+}
+
+size_t Image::stride() const
+{
+    return impl().stride();
 }
 
 uint8_t* Image::data()
 {
-    return mImpl->data();
+    return impl().data();
+}
+
+const uint8_t* Image::data() const
+{
+    return impl().data();
+}
+
+const Palette& Image::palette() const
+{
+    return impl().palette();
 }
 
-    const uint8_t* Image::data() const
+Image& Image::setPalette(const Palette& aPalette)
 {
-    return mImpl->data();
+    impl().setPalette(aPalette);
+    return *this;
 }
 
 Image& Image::composite(int aX,
@@ -91,7 +141,7 @@ Image& Image::composite(int aX,
                         const Image& aImage,
                         CompositeOperation aCompositeOperation)
 {
-    mImpl->composite(aX, aY, *aImage.mImpl, aCompositeOperation);
+    impl().composite(aX, aY, aImage.impl(), aCompositeOperation);
     return *this;
 }
 
@@ -100,13 +150,113 @@ Image Image::cropped(unsigned int aX,
                      unsigned int aWidth,
                      unsigned int aHeight) const
 {
-    return Image(mImpl->cropped(aX, aY, aWidth, aHeight));
+    return Image(impl().cropped(aX, aY, aWidth, aHeight));
+}
+
+Image Image::resized(unsigned int aWidth,
+                     unsigned int aHeight,
+                     ResizeFilter aFilter,
+                     unsigned int aThreadsCount) const
+{
+    return Image(impl().resized(aWidth, aHeight, aFilter, aThreadsCount));
+}
+
+Image Image::oriented(Orientation aOrientation, unsigned int aThreadsCount) const
+{
+    return Image(impl().oriented(aOrientation, aThreadsCount));
+}
+
+Image Image::rotated90(unsigned int aThreadsCount) const
+{
+    return oriented(Orientation::kRightTop, aThreadsCount);
+}
+
+Image Image::rotated180(unsigned int aThreadsCount) const
+{
+    return oriented(Orientation::kBottomRight, aThreadsCount);
+}
+
+Image Image::rotated270(unsigned int aThreadsCount) const
+{
+    return oriented(Orientation::kLeftBottom, aThreadsCount);
+}
+
+Image Image::flippedHorizontally(unsigned int aThreadsCount) const
+{
+    return oriented(Orientation::kTopRight, aThreadsCount);
+}
+
+Image Image::flippedVertically(unsigned int aThreadsCount) const
+{
+    return oriented(Orientation::kBottomLeft, aThreadsCount);
+}
+
+Image Image::transposed(unsigned int aThreadsCount) const
+{
+    return oriented(Orientation::kLeftTop, aThreadsCount);
+}
+
+Image Image::convolved(const std::vector<float>& aRowKernel,
+                       const std::vector<float>& aColumnKernel,
+                       EdgeMode aEdgeMode,
+                       unsigned int aThreadsCount) const
+{
+    return Image(impl().convolved(aRowKernel, aColumnKernel, aEdgeMode, aThreadsCount));
+}
+
+Image Image::boxBlurred(unsigned int aRadius, EdgeMode aEdgeMode, unsigned int aThreadsCount) const
+{
+    return Image(impl().boxBlurred(aRadius, aEdgeMode, aThreadsCount));
+}
+
+Image Image::stackBlurred(unsigned int aRadius, EdgeMode aEdgeMode, unsigned int aThreadsCount) const
+{
+    return Image(impl().stackBlurred(aRadius, aEdgeMode, aThreadsCount));
+}
+
+Image Image::gaussianBlurred(float aSigma, EdgeMode aEdgeMode, unsigned int aThreadsCount) const
+{
+    return Image(impl().gaussianBlurred(aSigma, aEdgeMode, aThreadsCount));
+}
+
+Image Image::unsharpMasked(float aSigma, float aAmount, float aThreshold, unsigned int aThreadsCount) const
+{
+    return Image(impl().unsharpMasked(aSigma, aAmount, aThreshold, aThreadsCount));
 }
 
 Image Image::convertedTo(ColorSpec::Format aFormat,
-                         ColorSpec::ChannelDepth aChannelDepth)
+                         ColorSpec::ChannelDepth aChannelDepth,
+                         unsigned int aThreadsCount) const
+{
+    return Image(impl().convertedTo(aFormat, aChannelDepth, aThreadsCount));
+}
+
+Image& Image::convertInPlace(ColorSpec::Format aFormat,
+                             ColorSpec::ChannelDepth aChannelDepth,
+                             unsigned int aThreadsCount)
+{
+    impl().convertInPlace(aFormat, aChannelDepth, aThreadsCount);
+    return *this;
+}
+
+void Image::convertInto(Image& aDest, unsigned int aThreadsCount) const
+{
+    impl().convertInto(aDest.impl(), aThreadsCount);
+}
+
+std::vector<Image::ChannelStatistics> Image::statistics(unsigned int aThreadsCount) const
+{
+    return impl().statistics(aThreadsCount);
+}
+
+std::vector<std::vector<uint64_t>> Image::histograms(unsigned int aThreadsCount) const
+{
+    return impl().histograms(aThreadsCount);
+}
+
+bool Image::isOpaque(unsigned int aThreadsCount) const
 {
-    return Image(mImpl->convertedTo(aFormat, aChannelDepth));
+    return impl().isOpaque(aThreadsCount);
 }
 
 } // namespace ImgIO
@@ -21,8 +21,20 @@
 // SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <memory>
+#include <stdexcept>
 #include "imageimpl.h"
+#include "blend.h"
+#include "convert.h"
+#include "filter.h"
+#include "palette.h"
+#include "resize.h"
+#include "rotate.h"
+#include "statistics.h"
+#include "threadpool.h"
 
 namespace ImgIO
 {
@@ -32,67 +44,111 @@ Image::Impl::Impl()
   mHeight(0),
   mColorFormat(ColorSpec::Format::kRGBA),
   mColorChannelDepth(ColorSpec::ChannelDepth::k8Bit),
+  mBuffer(),
   mData(nullptr),
-  mDataSize(0)
+  mStride(0),
+  mPalette()
 {
 }
 
-Image::Impl::Impl(Impl&& aImpl)
+// The moved-from image is left empty, but valid.
+Image::Impl::Impl(Impl&& aImpl) noexcept
 : mWidth(aImpl.mWidth),
   mHeight(aImpl.mHeight),
   mColorFormat(aImpl.mColorFormat),
   mColorChannelDepth(aImpl.mColorChannelDepth),
-  mData(nullptr),
-  mDataSize(aImpl.mDataSize)
+  mBuffer(std::move(aImpl.mBuffer)),
+  mData(aImpl.mData),
+  mStride(aImpl.mStride),
+  mPalette(std::move(aImpl.mPalette))
 {
-    std::lock_guard<std::mutex> lock(aImpl.mDataMutex);
-
-    mData.swap(aImpl.mData);
-
     aImpl.mWidth = 0;
     aImpl.mHeight = 0;
-    aImpl.mDataSize = 0;
+    aImpl.mData = nullptr;
+    aImpl.mStride = 0;
 }
 
+// Copies share the pixel buffer, it is detached on first mutable access.
 Image::Impl::Impl(const Impl& aImpl)
 : mWidth(aImpl.mWidth),
   mHeight(aImpl.mHeight),
   mColorFormat(aImpl.mColorFormat),
   mColorChannelDepth(aImpl.mColorChannelDepth),
-  mData(nullptr),
-  mDataSize(aImpl.mDataSize)
+  mBuffer(aImpl.mBuffer),
+  mData(aImpl.mData),
+  mStride(aImpl.mStride),
+  mPalette(aImpl.mPalette)
 {
-    std::lock_guard<std::mutex> lock(aImpl.mDataMutex);
-
-    mData = std::shared_ptr<uint8_t>(new uint8_t[aImpl.mDataSize]);
-    std::memcpy(mData.get(), aImpl.mData.get(), aImpl.mDataSize);
 }
 
 Image::Impl::Impl(unsigned int aWidth,
                   unsigned int aHeight,
                   ColorSpec::Format aColorFormat,
                   ColorSpec::ChannelDepth aColorChannelDepth,
-                  uint8_t* aData)
+                  uint8_t* aData,
+                  size_t aStride)
 : mWidth(aWidth),
   mHeight(aHeight),
   mColorFormat(aColorFormat),
   mColorChannelDepth(aColorChannelDepth),
+  mBuffer(),
   mData(nullptr),
-  mDataSize(0)
+  mStride(aStride),
+  mPalette()
 {
-    size_t pixelSize = static_cast<int>(aColorFormat) * static_cast<int>(aColorChannelDepth);
-    size_t lineSize = aWidth * pixelSize;
-    size_t dataSize = aHeight * lineSize;
+    if ((aColorFormat == ColorSpec::Format::kIndexed) && (aColorChannelDepth != ColorSpec::ChannelDepth::k8Bit))
+        throw std::invalid_argument("Indexed images have 8 bit indices");
 
-    if (dataSize > 0) {
-        mData.reset(aData ? aData : new uint8_t[dataSize]);
-        mDataSize = dataSize;
+    size_t rowSize = aWidth * pixelSize(aColorFormat, aColorChannelDepth);
+
+    // Allocated rows start on kRowAlignment boundaries, adopted data is packed unless told otherwise.
+    if (mStride == 0)
+        mStride = aData ? rowSize : alignedStride(rowSize);
+    else if (mStride < rowSize)
+        throw std::invalid_argument("Stride is smaller than the image row");
+
+    if ((rowSize == 0) || (aHeight == 0)) {
+        delete[] aData;
+        return;
     }
+
+    if (aData)
+        mBuffer = PixelBufferRef(PixelBuffer::adopt(aData, aHeight * mStride));
+    else
+        mBuffer = PixelBufferRef(PixelBuffer::create(aHeight * mStride));
+    mData = mBuffer->data();
+}
+
+// A view on a part of another image's buffer. It keeps the parent buffer alive.
+Image::Impl::Impl(const Impl& aParent,
+                  unsigned int aX,
+                  unsigned int aY,
+                  unsigned int aWidth,
+                  unsigned int aHeight)
+: mWidth(aWidth),
+  mHeight(aHeight),
+  mColorFormat(aParent.mColorFormat),
+  mColorChannelDepth(aParent.mColorChannelDepth),
+  mBuffer(aParent.mBuffer),
+  mData(aParent.mData + aY * aParent.mStride + aX * aParent.pixelSize()),
+  mStride(aParent.mStride),
+  mPalette(aParent.mPalette)
+{
+}
+
+size_t Image::Impl::pixelSize(ColorSpec::Format aColorFormat, ColorSpec::ChannelDepth aColorChannelDepth)
+{
+    return ColorSpec::pixelSize(aColorFormat, aColorChannelDepth);
+}
+
+size_t Image::Impl::alignedStride(size_t aRowSize)
+{
+    return (aRowSize + Image::kRowAlignment - 1) & ~(Image::kRowAlignment - 1);
 }
 
 bool Image::Impl::isValid() const
 {
-    return static_cast<bool>(mData);
+    return mData != nullptr;
 }
 
 ColorSpec::Format Image::Impl::colorFormat() const
@@ -115,320 +171,553 @@ unsigned int Image::Impl::height() const
     return mHeight;
 }
 
+size_t Image::Impl::stride() const
+{
+    return mStride;
+}
+
+size_t Image::Impl::pixelSize() const
+{
+    return pixelSize(mColorFormat, mColorChannelDepth);
+}
+
 const uint8_t* Image::Impl::data() const
 {
-    return mData.get();
+    return mData;
 }
 
 uint8_t* Image::Impl::data()
 {
-    return mData.get();
+    detach();
+    return mData;
 }
 
-void Image::Impl::composite(int aX,
-                            int aY,
-                            const Image::Impl& aImpl,
-                            CompositeOperation aCompositeOperation)
+bool Image::Impl::isShared() const
 {
-    throw NotImplementedException("Not implemented.s");
+    return mBuffer && mBuffer->isShared();
 }
 
-Image::Impl Image::Impl::cropped(unsigned int aX,
-                                 unsigned int aY,
-                                 unsigned int aWidth,
-                                 unsigned int aHeight) const
+void Image::Impl::detach()
 {
-    std::lock_guard<std::mutex> lock(mDataMutex);
+    // The buffer can't gain new owners concurrently, since that would require
+    // copying this very object, so a unique owner may write without locking.
+    if (!isShared())
+        return;
+
+    Image::Impl image(mWidth, mHeight, mColorFormat, mColorChannelDepth);
+    copyPixels(image.mData, image.mStride, 0);
+    image.mPalette = std::move(mPalette);
+    *this = std::move(image);
+}
 
-    if ((aX + aWidth) > mWidth)
-        aWidth = mWidth - aX;
-    if ((aY + aHeight) > mHeight)
-        aHeight = mHeight - aY;
+const Palette& Image::Impl::palette() const
+{
+    static const Palette kEmptyPalette;
+    return mPalette ? *mPalette : kEmptyPalette;
+}
 
-    Image::Impl croppedImage(aWidth, aHeight, mColorFormat, mColorChannelDepth);
+void Image::Impl::setPalette(const Palette& aPalette)
+{
+    if (mColorFormat != ColorSpec::Format::kIndexed)
+        throw std::logic_error("Only indexed images have a palette");
+    if (aPalette.size() > 256)
+        throw std::invalid_argument("Palette has over 256 colors");
 
-    size_t pixelSize = static_cast<int>(mColorFormat) * static_cast<int>(mColorChannelDepth);
-    size_t srcLineSize = mWidth * pixelSize;
-    size_t destLineSize = aWidth * pixelSize;
+    mPalette = std::make_shared<const Palette>(aPalette);
+}
 
-    if (croppedImage.isValid()) {
-        uint8_t* srcDataLine = mData.get() + aY * srcLineSize;
-        uint8_t* destDataLine = croppedImage.mData.get();
+// Indexed images are resized and blended as RGB, or RGBA when the palette
+// has any transparency.
+ColorSpec::Format Image::Impl::expandedFormat() const
+{
+    const Palette& colors = palette();
+    bool opaque = std::all_of(colors.begin(), colors.end(), [](const PaletteColor& aColor) {
+        return aColor.a == 0xff;
+    });
+    return opaque ? ColorSpec::Format::kRGB : ColorSpec::Format::kRGBA;
+}
 
-        for (size_t h = 0; h < aHeight; ++h) {
-            std::memcpy(destDataLine, srcDataLine + aX, destLineSize);
-            srcDataLine += srcLineSize;
-            destDataLine += destLineSize;
-        }
-    }
+// Straight alpha would bleed the colors of transparent pixels, filters
+// run on premultiplied RGBA. Indexed images are filtered as RGB(A).
+ColorSpec::Format Image::Impl::filteredFormat() const
+{
+    if (mColorFormat == ColorSpec::Format::kIndexed)
+        return expandedFormat();
+    if (mColorFormat == ColorSpec::Format::kRGBA)
+        return ColorSpec::Format::kRGBAPremultiplied;
+    return mColorFormat;
+}
 
-    return croppedImage;
+void Image::Impl::copyPixels(uint8_t* aDest, size_t aDestStride, unsigned int aThreadsCount) const
+{
+    size_t rowSize = mWidth * pixelSize();
+    parallelForRows(mHeight, 2 * rowSize, aThreadsCount, [=](size_t aBegin, size_t aEnd) {
+        copyRows(mData + aBegin * mStride,
+                 mStride,
+                 aDest + aBegin * aDestStride,
+                 aDestStride,
+                 rowSize,
+                 aEnd - aBegin);
+    });
 }
 
-Image::Impl Image::Impl::convertedTo(ColorSpec::Format aFormat,
-                                     ColorSpec::ChannelDepth aChannelDepth) const
+void Image::Impl::copyRows(const uint8_t* aSrc,
+                           size_t aSrcStride,
+                           uint8_t* aDest,
+                           size_t aDestStride,
+                           size_t aRowSize,
+                           size_t aRowsCount)
 {
-    if ((mColorFormat == aFormat) && (mColorChannelDepth == aChannelDepth))
-        return Image::Impl(*this);
+    if (aRowsCount == 0)
+        return;
 
-    void (*convertFunc)(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount) = nullptr;
-
-    switch(mColorFormat)
-    {
-    case ColorSpec::Format::kRGB:
-    {
-        if (mColorChannelDepth == ColorSpec::ChannelDepth::k8Bit) {
-            if ((aFormat == ColorSpec::Format::kRGB) && (aChannelDepth == ColorSpec::ChannelDepth::k16Bit))
-                convertFunc = convertRGB8BitToRGB16Bit;
-            else if ((aFormat == ColorSpec::Format::kRGBA) && (aChannelDepth == ColorSpec::ChannelDepth::k8Bit))
-                convertFunc = convertRGB8BitToRGBA8Bit;
-            else if ((aFormat == ColorSpec::Format::kRGBA) && (aChannelDepth == ColorSpec::ChannelDepth::k16Bit))
-                convertFunc = convertRGB8BitToRGBA16Bit;
-        } else if (mColorChannelDepth == ColorSpec::ChannelDepth::k16Bit) {
-            if ((aFormat == ColorSpec::Format::kRGB) && (aChannelDepth == ColorSpec::ChannelDepth::k8Bit))
-                convertFunc = convertRGB16BitToRGB8Bit;
-            else if ((aFormat == ColorSpec::Format::kRGBA) && (aChannelDepth == ColorSpec::ChannelDepth::k8Bit))
-                convertFunc = convertRGB16BitToRGBA8Bit;
-            else if ((aFormat == ColorSpec::Format::kRGBA) && (aChannelDepth == ColorSpec::ChannelDepth::k16Bit))
-                convertFunc = convertRGB16BitToRGBA16Bit;
-        }
-    }
-    case ColorSpec::Format::kRGBA:
-    {
-        if (mColorChannelDepth == ColorSpec::ChannelDepth::k8Bit) {
-            if ((aFormat == ColorSpec::Format::kRGBA) && (aChannelDepth == ColorSpec::ChannelDepth::k16Bit))
-                convertFunc = convertRGBA8BitToRGBA16Bit;
-            else if ((aFormat == ColorSpec::Format::kRGB) && (aChannelDepth == ColorSpec::ChannelDepth::k8Bit))
-                convertFunc = convertRGBA8BitToRGB8Bit;
-            else if ((aFormat == ColorSpec::Format::kRGB) && (aChannelDepth == ColorSpec::ChannelDepth::k16Bit))
-                convertFunc = convertRGBA8BitToRGB16Bit;
-        } else if (mColorChannelDepth == ColorSpec::ChannelDepth::k16Bit) {
-            if ((aFormat == ColorSpec::Format::kRGBA) && (aChannelDepth == ColorSpec::ChannelDepth::k8Bit))
-                convertFunc = convertRGBA16BitToRGBA8Bit;
-            else if ((aFormat == ColorSpec::Format::kRGB) && (aChannelDepth == ColorSpec::ChannelDepth::k8Bit))
-                convertFunc = convertRGBA16BitToRGB8Bit;
-            else if ((aFormat == ColorSpec::Format::kRGB) && (aChannelDepth == ColorSpec::ChannelDepth::k16Bit))
-                convertFunc = convertRGBA16BitToRGB16Bit;
-        }
-    }
-    default:
-        break;
+    // Equal strides let the row padding be copied along in a single block.
+    if (aSrcStride == aDestStride) {
+        std::memcpy(aDest, aSrc, (aRowsCount - 1) * aSrcStride + aRowSize);
+        return;
     }
 
-    if (!convertFunc) {
-        throw std::logic_error("Not implemented.s");
+    for (size_t y = 0; y < aRowsCount; ++y, aSrc += aSrcStride, aDest += aDestStride) {
+        std::memcpy(aDest, aSrc, aRowSize);
     }
-
-    Image::Impl image(mWidth, mHeight, aFormat, aChannelDepth);
-    size_t pixelsCount = mWidth * mHeight;
-    convertFunc(mData.get(), image.mData.get(), pixelsCount);
-
-    return image;
 }
 
-Image::Impl& Image::Impl::operator=(const Image::Impl& aImpl)
+void Image::Impl::composite(int aX,
+                            int aY,
+                            const Image::Impl& aImpl,
+                            CompositeOperation aCompositeOperation)
 {
-    std::lock_guard<std::mutex> lock(aImpl.mDataMutex);
+    // The copy keeps the source pixels if aImpl shares this image's buffer.
+    Image::Impl source(aImpl);
+
+    // Indices can only be copied, between images with the same colors
+    if ((mColorFormat == ColorSpec::Format::kIndexed) &&
+        ((aCompositeOperation != CompositeOperation::kCopy) ||
+         (source.mColorFormat != mColorFormat) ||
+         (source.palette() != palette())))
+        throw NotImplementedException("Not implemented.");
+
+    detach();
+
+    int64_t destX = std::max<int64_t>(aX, 0);
+    int64_t destY = std::max<int64_t>(aY, 0);
+    int64_t srcX = destX - aX;
+    int64_t srcY = destY - aY;
+    int64_t width = std::min<int64_t>(mWidth - destX, source.mWidth - srcX);
+    int64_t height = std::min<int64_t>(mHeight - destY, source.mHeight - srcY);
+    if ((width <= 0) || (height <= 0))
+        return;
+
+    const uint8_t* src = source.mData + srcY * source.mStride + srcX * source.pixelSize();
+    uint8_t* dest = mData + destY * mStride + destX * pixelSize();
+    size_t srcStride = source.mStride;
+    size_t destStride = mStride;
+    size_t rowSize = width * (source.pixelSize() + pixelSize());
+
+    if (aCompositeOperation == CompositeOperation::kCopy) {
+        if ((source.mColorFormat == mColorFormat) && (source.mColorChannelDepth == mColorChannelDepth)) {
+            size_t copySize = width * pixelSize();
+            parallelForRows(height, rowSize, 0, [=](size_t aBegin, size_t aEnd) {
+                copyRows(src + aBegin * srcStride, srcStride, dest + aBegin * destStride, destStride, copySize, aEnd - aBegin);
+            });
+        } else {
+            convertRows(source.cropped(srcX, srcY, width, height), dest, destStride, mColorFormat, mColorChannelDepth, 0);
+        }
+        return;
+    }
 
-    mWidth = aImpl.mWidth;
-    mHeight = aImpl.mHeight;
-    mColorFormat = aImpl.mColorFormat;
-    mColorChannelDepth = aImpl.mColorChannelDepth;
-    mDataSize = aImpl.mDataSize;
-    mData = std::shared_ptr<uint8_t>(new uint8_t[aImpl.mDataSize]);
-    std::memcpy(mData.get(), aImpl.mData.get(), aImpl.mDataSize);
+    // Blending works on RGBA rows at this image's depth, premultiplied when
+    // this image is, other formats go through per band scratch rows.
+    ColorSpec::Format rgba = (mColorFormat == ColorSpec::Format::kRGBAPremultiplied) ? mColorFormat
+                                                                                     : ColorSpec::Format::kRGBA;
+    BlendFunction blendFunc = blendFunction(aCompositeOperation, rgba, mColorChannelDepth);
+    ColorSpec::ChannelDepth depth = mColorChannelDepth;
+
+    // Indexed sources are expanded up front, only the part composited
+    if (source.mColorFormat == ColorSpec::Format::kIndexed) {
+        source = source.cropped(srcX, srcY, width, height).convertedTo(rgba, depth);
+        src = source.mData;
+        srcStride = source.mStride;
+    }
 
-    return *this;
+    bool convertSrc = (source.mColorFormat != rgba) || (source.mColorChannelDepth != depth);
+    bool convertDest = (mColorFormat != rgba);
+    ConvertFunction srcToRGBA = convertSrc ? convertFunction(source.mColorFormat, source.mColorChannelDepth, rgba, depth) : nullptr;
+    ConvertFunction destToRGBA = convertDest ? convertFunction(mColorFormat, depth, rgba, depth) : nullptr;
+    ConvertFunction destFromRGBA = convertDest ? convertFunction(rgba, depth, mColorFormat, depth) : nullptr;
+    if (!blendFunc || (convertSrc && !srcToRGBA) || (convertDest && (!destToRGBA || !destFromRGBA)))
+        throw NotImplementedException("Not implemented.");
+
+    size_t scratchSize = width * pixelSize(rgba, depth);
+    parallelForRows(height, rowSize, 0, [=](size_t aBegin, size_t aEnd) {
+        std::unique_ptr<uint8_t[]> srcScratch(srcToRGBA ? new uint8_t[scratchSize] : nullptr);
+        std::unique_ptr<uint8_t[]> destScratch(destToRGBA ? new uint8_t[scratchSize] : nullptr);
+
+        for (size_t y = aBegin; y < aEnd; ++y) {
+            const uint8_t* srcRow = src + y * srcStride;
+            uint8_t* destRow = dest + y * destStride;
+
+            if (srcToRGBA) {
+                srcToRGBA(srcRow, srcScratch.get(), width);
+                srcRow = srcScratch.get();
+            }
+            if (destToRGBA) {
+                destToRGBA(destRow, destScratch.get(), width);
+                blendFunc(srcRow, destScratch.get(), width);
+                destFromRGBA(destScratch.get(), destRow, width);
+            } else {
+                blendFunc(srcRow, destRow, width);
+            }
+        }
+    });
 }
 
-Image::Impl& Image::Impl::operator=(Image::Impl&& aImpl) noexcept
+Image::Impl Image::Impl::cropped(unsigned int aX,
+                                 unsigned int aY,
+                                 unsigned int aWidth,
+                                 unsigned int aHeight) const
 {
-    std::lock_guard<std::mutex> lock(aImpl.mDataMutex);
+    if ((aX >= mWidth) || (aY >= mHeight))
+        return Image::Impl();
 
-    mWidth = aImpl.mWidth;
-    aImpl.mWidth = 0;
+    // Clamped without aX + aWidth, which wraps for sizes near UINT_MAX
+    if (aWidth > mWidth - aX)
+        aWidth = mWidth - aX;
+    if (aHeight > mHeight - aY)
+        aHeight = mHeight - aY;
 
-    mHeight = aImpl.mHeight;
-    aImpl.mHeight = 0;
+    if ((aWidth == 0) || (aHeight == 0))
+        return Image::Impl();
 
-    mColorFormat = aImpl.mColorFormat;
-    mColorChannelDepth = aImpl.mColorChannelDepth;
+    return Image::Impl(*this, aX, aY, aWidth, aHeight);
+}
 
-    mData.swap(aImpl.mData);
+Image::Impl Image::Impl::resized(unsigned int aWidth,
+                                 unsigned int aHeight,
+                                 Image::ResizeFilter aFilter,
+                                 unsigned int aThreadsCount) const
+{
+    if ((aWidth == mWidth) && (aHeight == mHeight))
+        return Image::Impl(*this);
 
-    mDataSize = aImpl.mDataSize;
-    aImpl.mDataSize = 0;
+    if (!mData)
+        return Image::Impl();
+
+    // Filters other than kNearest would mix indices, they resize the colors
+    if ((mColorFormat == ColorSpec::Format::kIndexed) && (aFilter != Image::ResizeFilter::kNearest))
+        return convertedTo(expandedFormat(), mColorChannelDepth, aThreadsCount).resized(aWidth, aHeight, aFilter, aThreadsCount);
+
+    Image::Impl image(aWidth, aHeight, mColorFormat, mColorChannelDepth);
+    image.mPalette = mPalette;
+    if (!image.mData)
+        return image;
+
+    resizeRows(mData,
+               mStride,
+               mWidth,
+               mHeight,
+               image.mData,
+               image.mStride,
+               aWidth,
+               aHeight,
+               mColorFormat,
+               mColorChannelDepth,
+               aFilter,
+               aThreadsCount);
 
-    return *this;
+    return image;
 }
 
-
-void Image::Impl::convertRGB8BitToRGB16Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+Image::Impl Image::Impl::oriented(Image::Orientation aOrientation, unsigned int aThreadsCount) const
 {
-    const uint8_t* src = aSrc;
-    uint8_t* dest = aDest;
-    const size_t srcPixelSize = 3;
-    const size_t destPixelSize = 6;
+    if ((aOrientation == Image::Orientation::kTopLeft) || !mData)
+        return Image::Impl(*this);
 
-    for (size_t i = 0; i < aPixelsCount; ++i, dest += destPixelSize, src += srcPixelSize) {
-        reinterpret_cast<uint16_t*>(dest)[0] = static_cast<uint16_t>(src[0]) << 8;
-        reinterpret_cast<uint16_t*>(dest)[1] = static_cast<uint16_t>(src[1]) << 8;
-        reinterpret_cast<uint16_t*>(dest)[2] = static_cast<uint16_t>(src[2]) << 8;
-    }
+    bool swapped = swapsAxes(aOrientation);
+    Image::Impl image(swapped ? mHeight : mWidth, swapped ? mWidth : mHeight, mColorFormat, mColorChannelDepth);
+    image.mPalette = mPalette;
+
+    orientRows(mData,
+               mStride,
+               mWidth,
+               mHeight,
+               0,
+               mHeight,
+               pixelSize(),
+               image.mData,
+               image.mStride,
+               aOrientation,
+               aThreadsCount);
+
+    return image;
 }
 
-void Image::Impl::convertRGB8BitToRGBA8Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+Image::Impl Image::Impl::convolved(const std::vector<float>& aRowKernel,
+                                   const std::vector<float>& aColumnKernel,
+                                   Image::EdgeMode aEdgeMode,
+                                   unsigned int aThreadsCount) const
 {
-    const uint8_t* src = aSrc;
-    uint8_t* dest = aDest;
-    const size_t srcPixelSize = 3;
-    const size_t destPixelSize = 4;
+    ColorSpec::Format format = filteredFormat();
+    Image::Impl source = convertedTo(format, mColorChannelDepth, aThreadsCount);
+    Image::Impl image(mWidth, mHeight, format, mColorChannelDepth);
+
+    convolveRows(source.mData,
+                 source.mStride,
+                 mWidth,
+                 mHeight,
+                 image.mData,
+                 image.mStride,
+                 format,
+                 mColorChannelDepth,
+                 aRowKernel,
+                 aColumnKernel,
+                 aEdgeMode,
+                 aThreadsCount);
+
+    if (mColorFormat == ColorSpec::Format::kRGBA)
+        image.convertInPlace(mColorFormat, mColorChannelDepth, aThreadsCount);
+    return image;
+}
 
-    for (size_t i = 0; i < aPixelsCount; ++i, dest += destPixelSize, src += srcPixelSize) {
-        std::memcpy(dest, src, srcPixelSize);
-        dest[3] = static_cast<uint8_t>(1 << 8);
-    };
+Image::Impl Image::Impl::blurred(unsigned int aRadius,
+                                 BlurShape aShape,
+                                 Image::EdgeMode aEdgeMode,
+                                 unsigned int aThreadsCount) const
+{
+    ColorSpec::Format format = filteredFormat();
+    Image::Impl source = convertedTo(format, mColorChannelDepth, aThreadsCount);
+    Image::Impl image(mWidth, mHeight, format, mColorChannelDepth);
+
+    blurRows(source.mData,
+             source.mStride,
+             mWidth,
+             mHeight,
+             image.mData,
+             image.mStride,
+             format,
+             mColorChannelDepth,
+             aRadius,
+             aShape,
+             aEdgeMode,
+             aThreadsCount);
+
+    if (mColorFormat == ColorSpec::Format::kRGBA)
+        image.convertInPlace(mColorFormat, mColorChannelDepth, aThreadsCount);
+    return image;
 }
 
-void Image::Impl::convertRGB8BitToRGBA16Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+Image::Impl Image::Impl::boxBlurred(unsigned int aRadius, Image::EdgeMode aEdgeMode, unsigned int aThreadsCount) const
 {
-    const uint8_t* src = aSrc;
-    uint8_t* dest = aDest;
-    const size_t srcPixelSize = 3;
-    const size_t destPixelSize = 8;
+    return blurred(aRadius, BlurShape::kBox, aEdgeMode, aThreadsCount);
+}
 
-    for (size_t i = 0; i < aPixelsCount; ++i, dest += destPixelSize, src += srcPixelSize) {
-        reinterpret_cast<uint16_t*>(dest)[0] = static_cast<uint16_t>(src[0]) << 8;
-        reinterpret_cast<uint16_t*>(dest)[1] = static_cast<uint16_t>(src[1]) << 8;
-        reinterpret_cast<uint16_t*>(dest)[2] = static_cast<uint16_t>(src[2]) << 8;
-        reinterpret_cast<uint16_t*>(dest)[3] = static_cast<uint16_t>(1 << 16);
-    }
+Image::Impl Image::Impl::stackBlurred(unsigned int aRadius, Image::EdgeMode aEdgeMode, unsigned int aThreadsCount) const
+{
+    return blurred(aRadius, BlurShape::kStack, aEdgeMode, aThreadsCount);
 }
 
-void Image::Impl::convertRGB16BitToRGB8Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+Image::Impl Image::Impl::gaussianBlurred(float aSigma, Image::EdgeMode aEdgeMode, unsigned int aThreadsCount) const
 {
-    const uint8_t* src = aSrc;
-    uint8_t* dest = aDest;
-    const size_t srcPixelSize = 6;
-    const size_t destPixelSize = 3;
+    if (!(aSigma > 0.0f)) {
+        ColorSpec::Format format = (mColorFormat == ColorSpec::Format::kIndexed) ? expandedFormat() : mColorFormat;
+        return convertedTo(format, mColorChannelDepth, aThreadsCount);
+    }
 
-    for (size_t i = 0; i < aPixelsCount; ++i, dest += destPixelSize, src += srcPixelSize) {
-        dest[0] = static_cast<uint8_t>(reinterpret_cast<const uint16_t*>(src)[0] >> 8);
-        dest[1] = static_cast<uint8_t>(reinterpret_cast<const uint16_t*>(src)[1] >> 8);
-        dest[2] = static_cast<uint8_t>(reinterpret_cast<const uint16_t*>(src)[2] >> 8);
+    size_t radius = std::max<size_t>(static_cast<size_t>(std::ceil(3.0f * aSigma)), 1);
+    std::vector<float> kernel(2 * radius + 1);
+    double sum = 0.0;
+    for (size_t k = 0; k < kernel.size(); ++k) {
+        double x = static_cast<double>(k) - radius;
+        kernel[k] = static_cast<float>(std::exp(-x * x / (2.0 * aSigma * aSigma)));
+        sum += kernel[k];
     }
+    for (float& weight : kernel)
+        weight = static_cast<float>(weight / sum);
+
+    return convolved(kernel, kernel, aEdgeMode, aThreadsCount);
 }
 
-void Image::Impl::convertRGB16BitToRGBA8Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+Image::Impl Image::Impl::unsharpMasked(float aSigma, float aAmount, float aThreshold, unsigned int aThreadsCount) const
 {
-    const uint8_t* src = aSrc;
-    uint8_t* dest = aDest;
-    const size_t srcPixelSize = 6;
-    const size_t destPixelSize = 4;
+    Image::Impl image = gaussianBlurred(aSigma, Image::EdgeMode::kClamp, aThreadsCount);
+    Image::Impl source = convertedTo(image.mColorFormat, mColorChannelDepth, aThreadsCount);
+    image.detach();
+
+    unsharpRows(source.mData,
+                source.mStride,
+                mWidth,
+                mHeight,
+                image.mData,
+                image.mStride,
+                image.mColorFormat,
+                mColorChannelDepth,
+                aAmount,
+                aThreshold,
+                aThreadsCount);
 
-    for (size_t i = 0; i < aPixelsCount; ++i, dest += destPixelSize, src += srcPixelSize) {
-        dest[0] = static_cast<uint8_t>(reinterpret_cast<const uint16_t*>(src)[0] >> 8);
-        dest[1] = static_cast<uint8_t>(reinterpret_cast<const uint16_t*>(src)[1] >> 8);
-        dest[2] = static_cast<uint8_t>(reinterpret_cast<const uint16_t*>(src)[2] >> 8);
-        dest[3] = static_cast<uint8_t>(1 << 8);
-    }
+    return image;
 }
 
-void Image::Impl::convertRGB16BitToRGBA16Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+Image::Impl Image::Impl::convertedTo(ColorSpec::Format aFormat,
+                                     ColorSpec::ChannelDepth aChannelDepth,
+                                     unsigned int aThreadsCount) const
 {
-    const uint8_t* src = aSrc;
-    uint8_t* dest = aDest;
-    const size_t srcPixelSize = 6;
-    const size_t destPixelSize = 8;
+    if ((mColorFormat == aFormat) && (mColorChannelDepth == aChannelDepth))
+        return Image::Impl(*this);
+
+    Image::Impl image(mWidth, mHeight, aFormat, aChannelDepth);
+    convertRows(*this, image.mData, image.mStride, aFormat, aChannelDepth, aThreadsCount);
 
-    for (size_t i = 0; i < aPixelsCount; ++i, dest += destPixelSize, src += srcPixelSize) {
-        std::memcpy(dest, src, srcPixelSize);
-        reinterpret_cast<uint16_t*>(dest)[3] = static_cast<uint16_t>(1 << 16);
-    };
+    return image;
 }
 
-void Image::Impl::convertRGBA8BitToRGBA16Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+void Image::Impl::convertInPlace(ColorSpec::Format aFormat,
+                                 ColorSpec::ChannelDepth aChannelDepth,
+                                 unsigned int aThreadsCount)
 {
-    const uint8_t* src = aSrc;
-    uint8_t* dest = aDest;
-    const size_t srcPixelSize = 4;
-    const size_t destPixelSize = 8;
+    if ((mColorFormat == aFormat) && (mColorChannelDepth == aChannelDepth))
+        return;
 
-    for (size_t i = 0; i < aPixelsCount; ++i, dest += destPixelSize, src += srcPixelSize) {
-        reinterpret_cast<uint16_t*>(dest)[0] = static_cast<uint16_t>(src[0]) << 8;
-        reinterpret_cast<uint16_t*>(dest)[1] = static_cast<uint16_t>(src[1]) << 8;
-        reinterpret_cast<uint16_t*>(dest)[2] = static_cast<uint16_t>(src[2]) << 8;
-        reinterpret_cast<uint16_t*>(dest)[3] = static_cast<uint16_t>(src[3]) << 8;
+    // The kernels read each pixel before writing it, left to right, so
+    // pixels that don't grow can overwrite their source row.
+    if (isShared() || !mData || (pixelSize(aFormat, aChannelDepth) > pixelSize())) {
+        *this = convertedTo(aFormat, aChannelDepth, aThreadsCount);
+        return;
     }
+
+    convertRows(*this, mData, mStride, aFormat, aChannelDepth, aThreadsCount);
+    mColorFormat = aFormat;
+    mColorChannelDepth = aChannelDepth;
+    mPalette.reset();
 }
 
-void Image::Impl::convertRGBA8BitToRGB8Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+void Image::Impl::convertInto(Image::Impl& aDest, unsigned int aThreadsCount) const
 {
-    const uint8_t* src = aSrc;
-    uint8_t* dest = aDest;
-    const size_t srcPixelSize = 4;
-    const size_t destPixelSize = 3;
-
-    for (size_t i = 0; i < (aPixelsCount - 1); ++i, dest += destPixelSize, src += srcPixelSize) {
-        std::memcpy(dest, src, srcPixelSize);
+    if (&aDest == this)
+        return;
+
+    ColorSpec::Format format = aDest.mColorFormat;
+    ColorSpec::ChannelDepth channelDepth = aDest.mColorChannelDepth;
+    size_t stride = alignedStride(mWidth * pixelSize(format, channelDepth));
+
+    // The whole buffer can be reused, no matter which part aDest viewed.
+    bool reusable = aDest.mBuffer && !aDest.mBuffer->isShared() && (aDest.mBuffer->size() >= mHeight * stride);
+    if (!reusable || !mData) {
+        aDest = convertedTo(format, channelDepth, aThreadsCount);
+        return;
     }
-    std::memcpy(dest, src, destPixelSize);
+
+    // convertRows() rejects unsupported formats before it writes, aDest is
+    // updated only after the pixels are in place.
+    uint8_t* data = aDest.mBuffer->data();
+    if ((format == mColorFormat) && (channelDepth == mColorChannelDepth))
+        copyPixels(data, stride, aThreadsCount);
+    else
+        convertRows(*this, data, stride, format, channelDepth, aThreadsCount);
+
+    aDest.mWidth = mWidth;
+    aDest.mHeight = mHeight;
+    aDest.mData = data;
+    aDest.mStride = stride;
+    if (format == ColorSpec::Format::kIndexed)
+        aDest.mPalette = mPalette;
 }
 
-void Image::Impl::convertRGBA8BitToRGB16Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+std::vector<Image::ChannelStatistics> Image::Impl::statistics(unsigned int aThreadsCount) const
 {
-    const uint8_t* src = aSrc;
-    uint8_t* dest = aDest;
-    const size_t srcPixelSize = 4;
-    const size_t destPixelSize = 6;
+    return channelStatistics(mData, mStride, mWidth, mHeight,
+                             ColorSpec::channelCount(mColorFormat), mColorChannelDepth, aThreadsCount);
+}
 
-    for (size_t i = 0; i < aPixelsCount; ++i, dest += destPixelSize, src += srcPixelSize) {
-        reinterpret_cast<uint16_t*>(dest)[0] = static_cast<uint16_t>(src[0]) << 8;
-        reinterpret_cast<uint16_t*>(dest)[1] = static_cast<uint16_t>(src[1]) << 8;
-        reinterpret_cast<uint16_t*>(dest)[2] = static_cast<uint16_t>(src[2]) << 8;
-    }
+std::vector<std::vector<uint64_t>> Image::Impl::histograms(unsigned int aThreadsCount) const
+{
+    return channelHistograms(mData, mStride, mWidth, mHeight,
+                             ColorSpec::channelCount(mColorFormat), mColorChannelDepth, aThreadsCount);
 }
 
-void Image::Impl::convertRGBA16BitToRGBA8Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+bool Image::Impl::isOpaque(unsigned int aThreadsCount) const
 {
-    const uint8_t* src = aSrc;
-    uint8_t* dest = aDest;
-    const size_t srcPixelSize = 8;
-    const size_t destPixelSize = 4;
+    return opaqueRows(mData, mStride, mWidth, mHeight, mColorFormat, mColorChannelDepth, palette(), aThreadsCount);
+}
 
-    for (size_t i = 0; i < aPixelsCount; ++i, dest += destPixelSize, src += srcPixelSize) {
-        dest[0] = static_cast<uint8_t>(reinterpret_cast<const uint16_t*>(src)[0] >> 8);
-        dest[1] = static_cast<uint8_t>(reinterpret_cast<const uint16_t*>(src)[1] >> 8);
-        dest[2] = static_cast<uint8_t>(reinterpret_cast<const uint16_t*>(src)[2] >> 8);
-        dest[3] = static_cast<uint8_t>(reinterpret_cast<const uint16_t*>(src)[3] >> 8);
+void Image::Impl::convertRows(const Image::Impl& aSrc,
+                              uint8_t* aDest,
+                              size_t aDestStride,
+                              ColorSpec::Format aFormat,
+                              ColorSpec::ChannelDepth aChannelDepth,
+                              unsigned int aThreadsCount)
+{
+    if (aFormat == ColorSpec::Format::kIndexed)
+        throw NotImplementedException("Conversion to indexed is not supported");
+
+    // Indices are looked up in the palette converted to the destination format
+    std::unique_ptr<PaletteTable> table;
+    ConvertFunction convertFunc = nullptr;
+    if (aSrc.mColorFormat == ColorSpec::Format::kIndexed) {
+        table.reset(new PaletteTable(aSrc.palette(), aFormat, aChannelDepth));
+    } else {
+        convertFunc = convertFunction(aSrc.mColorFormat, aSrc.mColorChannelDepth, aFormat, aChannelDepth);
+        if (!convertFunc) {
+            throw std::logic_error("Not implemented.");
+        }
     }
+
+    const PaletteTable* palette = table.get();
+    const uint8_t* src = aSrc.mData;
+    size_t srcStride = aSrc.mStride;
+    size_t width = aSrc.mWidth;
+    size_t rowSize = width * (aSrc.pixelSize() + pixelSize(aFormat, aChannelDepth));
+    parallelForRows(aSrc.mHeight, rowSize, aThreadsCount, [=](size_t aBegin, size_t aEnd) {
+        const uint8_t* srcRow = src + aBegin * srcStride;
+        uint8_t* destRow = aDest + aBegin * aDestStride;
+        for (size_t y = aBegin; y < aEnd; ++y, srcRow += srcStride, destRow += aDestStride) {
+            if (palette)
+                palette->expand(srcRow, destRow, width);
+            else
+                convertFunc(srcRow, destRow, width);
+        }
+    });
 }
 
-void Image::Impl::convertRGBA16BitToRGB8Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+Image::Impl& Image::Impl::operator=(const Image::Impl& aImpl)
 {
-    const uint8_t* src = aSrc;
-    uint8_t* dest = aDest;
-    const size_t srcPixelSize = 8;
-    const size_t destPixelSize = 3;
+    mWidth = aImpl.mWidth;
+    mHeight = aImpl.mHeight;
+    mColorFormat = aImpl.mColorFormat;
+    mColorChannelDepth = aImpl.mColorChannelDepth;
+    mBuffer = aImpl.mBuffer;
+    mData = aImpl.mData;
+    mStride = aImpl.mStride;
+    mPalette = aImpl.mPalette;
 
-    for (size_t i = 0; i < aPixelsCount; ++i, dest += destPixelSize, src += srcPixelSize) {
-        dest[0] = static_cast<uint8_t>(reinterpret_cast<const uint16_t*>(src)[0] >> 8);
-        dest[1] = static_cast<uint8_t>(reinterpret_cast<const uint16_t*>(src)[1] >> 8);
-        dest[2] = static_cast<uint8_t>(reinterpret_cast<const uint16_t*>(src)[2] >> 8);
-    }
+    return *this;
 }
 
-void Image::Impl::convertRGBA16BitToRGB16Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+Image::Impl& Image::Impl::operator=(Image::Impl&& aImpl) noexcept
 {
-    const uint8_t* src = aSrc;
-    uint8_t* dest = aDest;
-    const size_t srcPixelSize = 8;
-    const size_t destPixelSize = 6;
+    if (this == &aImpl)
+        return *this;
 
-    for (size_t i = 0; i < (aPixelsCount - 1); ++i, dest += destPixelSize, src += srcPixelSize) {
-        std::memcpy(dest, src, srcPixelSize);
-    }
-    std::memcpy(dest, src, destPixelSize);
+    mWidth = aImpl.mWidth;
+    aImpl.mWidth = 0;
+
+    mHeight = aImpl.mHeight;
+    aImpl.mHeight = 0;
+
+    mColorFormat = aImpl.mColorFormat;
+    mColorChannelDepth = aImpl.mColorChannelDepth;
+
+    mBuffer = std::move(aImpl.mBuffer);
+
+    mData = aImpl.mData;
+    aImpl.mData = nullptr;
+
+    mStride = aImpl.mStride;
+    aImpl.mStride = 0;
+
+    mPalette = std::move(aImpl.mPalette);
+
+    return *this;
 }
 
 } // namespace ImgIO
@@ -24,31 +24,46 @@
 #ifndef _IMAGEIMPL_H__
 #define _IMAGEIMPL_H__
 
+#include <memory>
 #include <imgio/image.h>
-#include <mutex>
+#include "pixelbuffer.h"
 
 namespace ImgIO
 {
 
+enum class BlurShape;
+
 class Image::Impl
 {
 public:
     Impl();
-    Impl(Impl&& aImpl);
+    Impl(Impl&& aImpl) noexcept;
     Impl(const Impl& aImpl);
     Impl(unsigned int aWidth,
          unsigned int aHeight,
          ColorSpec::Format aColorFormat = ColorSpec::Format::kRGB,
          ColorSpec::ChannelDepth aColorChannelDepth = ColorSpec::ChannelDepth::k8Bit,
-         uint8_t* aData = nullptr);
+         uint8_t* aData = nullptr,
+         size_t aStride = 0);
+    Impl(const Impl& aParent,
+         unsigned int aX,
+         unsigned int aY,
+         unsigned int aWidth,
+         unsigned int aHeight);
 
     bool isValid() const;
     ColorSpec::Format colorFormat() const;
     ColorSpec::ChannelDepth colorChannelDepth() const;
     unsigned int width() const;
     unsigned int height() const;
+    size_t stride() const;
+    size_t pixelSize() const;
     const uint8_t* data() const;
     uint8_t* data();
+    bool isShared() const;
+    void detach();
+    const Palette& palette() const;
+    void setPalette(const Palette& aPalette);
 
     void composite(int aX,
                    int aY,
@@ -60,37 +75,67 @@ public:
                         unsigned int aWidth,
                         unsigned int aHeight) const;
 
-    Image::Impl convertedTo(ColorSpec::Format aFormat,
-                            ColorSpec::ChannelDepth aChannelDepth = ColorSpec::ChannelDepth::k8Bit) const;
+    Image::Impl resized(unsigned int aWidth,
+                        unsigned int aHeight,
+                        Image::ResizeFilter aFilter,
+                        unsigned int aThreadsCount = 0) const;
 
-    Image::Impl& operator=(const Image::Impl& aImpl);
-    Image::Impl& operator=(Image::Impl&& aImpl) noexcept ;
+    Image::Impl oriented(Image::Orientation aOrientation, unsigned int aThreadsCount = 0) const;
 
+    Image::Impl convolved(const std::vector<float>& aRowKernel,
+                          const std::vector<float>& aColumnKernel,
+                          Image::EdgeMode aEdgeMode,
+                          unsigned int aThreadsCount = 0) const;
+    Image::Impl boxBlurred(unsigned int aRadius, Image::EdgeMode aEdgeMode, unsigned int aThreadsCount = 0) const;
+    Image::Impl stackBlurred(unsigned int aRadius, Image::EdgeMode aEdgeMode, unsigned int aThreadsCount = 0) const;
+    Image::Impl gaussianBlurred(float aSigma, Image::EdgeMode aEdgeMode, unsigned int aThreadsCount = 0) const;
+    Image::Impl unsharpMasked(float aSigma, float aAmount, float aThreshold, unsigned int aThreadsCount = 0) const;
 
-    static void convertRGB8BitToRGB16Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount);
-    static void convertRGB8BitToRGBA8Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount);
-    static void convertRGB8BitToRGBA16Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount);
+    Image::Impl convertedTo(ColorSpec::Format aFormat,
+                            ColorSpec::ChannelDepth aChannelDepth = ColorSpec::ChannelDepth::k8Bit,
+                            unsigned int aThreadsCount = 0) const;
+    void convertInPlace(ColorSpec::Format aFormat,
+                        ColorSpec::ChannelDepth aChannelDepth = ColorSpec::ChannelDepth::k8Bit,
+                        unsigned int aThreadsCount = 0);
+    void convertInto(Image::Impl& aDest, unsigned int aThreadsCount = 0) const;
 
-    static void convertRGB16BitToRGB8Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount);
-    static void convertRGB16BitToRGBA8Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount);
-    static void convertRGB16BitToRGBA16Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount);
+    std::vector<Image::ChannelStatistics> statistics(unsigned int aThreadsCount = 0) const;
+    std::vector<std::vector<uint64_t>> histograms(unsigned int aThreadsCount = 0) const;
+    bool isOpaque(unsigned int aThreadsCount = 0) const;
 
-    static void convertRGBA8BitToRGBA16Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount);
-    static void convertRGBA8BitToRGB8Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount);
-    static void convertRGBA8BitToRGB16Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount);
+    Image::Impl& operator=(const Image::Impl& aImpl);
+    Image::Impl& operator=(Image::Impl&& aImpl) noexcept ;
 
-    static void convertRGBA16BitToRGBA8Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount);
-    static void convertRGBA16BitToRGB8Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount);
-    static void convertRGBA16BitToRGB16Bit(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount);
+    static size_t pixelSize(ColorSpec::Format aColorFormat, ColorSpec::ChannelDepth aColorChannelDepth);
+    static size_t alignedStride(size_t aRowSize);
+    static void copyRows(const uint8_t* aSrc,
+                         size_t aSrcStride,
+                         uint8_t* aDest,
+                         size_t aDestStride,
+                         size_t aRowSize,
+                         size_t aRowsCount);
+
+private:
+    ColorSpec::Format expandedFormat() const;
+    ColorSpec::Format filteredFormat() const;
+    Image::Impl blurred(unsigned int aRadius, BlurShape aShape, Image::EdgeMode aEdgeMode, unsigned int aThreadsCount) const;
+    void copyPixels(uint8_t* aDest, size_t aDestStride, unsigned int aThreadsCount) const;
+    static void convertRows(const Image::Impl& aSrc,
+                            uint8_t* aDest,
+                            size_t aDestStride,
+                            ColorSpec::Format aFormat,
+                            ColorSpec::ChannelDepth aChannelDepth,
+                            unsigned int aThreadsCount);
 
 private:
     unsigned int mWidth;
     unsigned int mHeight;
     ColorSpec::Format mColorFormat;
     ColorSpec::ChannelDepth mColorChannelDepth;
-    std::shared_ptr<uint8_t> mData;
-    size_t mDataSize;
-    mutable std::mutex mDataMutex;
+    PixelBufferRef mBuffer;
+    uint8_t* mData;
+    size_t mStride;
+    std::shared_ptr<const Palette> mPalette;
 }; // class Image::Impl
 
 } // namespace ImgIO
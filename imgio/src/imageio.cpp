@@ -23,6 +23,10 @@
 
 
 #include <imgio/imageio.h>
+#include <algorithm>
+#include <cstring>
+#include "dataio.h"
+#include "fileio.h"
 
 #ifdef PNGIO_ENABLED
 #include "pngio.h"
@@ -32,17 +36,83 @@
 #include "jpegio.h"
 #endif // JPEGIO_ENABLED
 
+#ifdef GIFIO_ENABLED
+#include "gifio.h"
+#endif // GIFIO_ENABLED
+
 namespace ImgIO
 {
 
+ImageIO::ImageFormat ImageIO::detectFormat(const uint8_t* aData, size_t aLength)
+{
+    static const uint8_t pngSignature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    static const uint8_t jpegSignature[] = {0xff, 0xd8, 0xff};
+    static const uint8_t gifSignature[] = {'G', 'I', 'F', '8'};
+
+    if (aLength == 0)
+        return ImageFormat::kUnspecified;
+
+    if (std::memcmp(aData, pngSignature, std::min(aLength, sizeof(pngSignature))) == 0)
+        return ImageFormat::kPng;
+    if (std::memcmp(aData, jpegSignature, std::min(aLength, sizeof(jpegSignature))) == 0)
+        return ImageFormat::kJpeg;
+    if (std::memcmp(aData, gifSignature, std::min(aLength, sizeof(gifSignature))) == 0)
+        return ImageFormat::kGif;
+
+    return ImageFormat::kUnspecified;
+}
+
+ImageIO::ImageFormat ImageIO::detectFormat(std::istream& aInputDataStream)
+{
+    int firstByte = aInputDataStream.peek();
+    if (firstByte == std::char_traits<char>::eof())
+        return ImageFormat::kUnspecified;
+
+    uint8_t data = static_cast<uint8_t>(firstByte);
+    return detectFormat(&data, 1);
+}
+
 Image ImageIO::read(std::istream &aInputDataStream,
                     ImageFormat aInputImageFormat,
                     ColorSpec::Format aOutputImageColorformat,
-                    ColorSpec::ChannelDepth aOutputImageChannelDepth)
+                    ColorSpec::ChannelDepth aOutputImageChannelDepth,
+                    bool aApplyOrientation,
+                    bool aDropOpaqueAlpha)
 {
+    if (aInputImageFormat == ImageFormat::kUnspecified)
+        aInputImageFormat = detectFormat(aInputDataStream);
+
     Image image;
 
-    // TODO: implement
+    switch (aInputImageFormat) {
+#ifdef PNGIO_ENABLED
+    case ImageFormat::kPng:
+        image = PngIO::read(aInputDataStream, aOutputImageColorformat, aOutputImageChannelDepth, aApplyOrientation, aDropOpaqueAlpha);
+        if (aDropOpaqueAlpha)
+            aOutputImageColorformat = image.colorFormat();
+        break;
+#endif // PNGIO_ENABLED
+#ifdef JPEGIO_ENABLED
+    case ImageFormat::kJpeg:
+        // There is never any alpha to decode
+        if (aDropOpaqueAlpha)
+            aOutputImageColorformat = ColorSpec::opaqueFormat(aOutputImageColorformat);
+        image = JpegIO::read(aInputDataStream, aOutputImageColorformat, aOutputImageChannelDepth, aApplyOrientation);
+        break;
+#endif // JPEGIO_ENABLED
+#ifdef GIFIO_ENABLED
+    case ImageFormat::kGif:
+        image = GifIO::read(aInputDataStream, aOutputImageColorformat, aOutputImageChannelDepth);
+        if (aDropOpaqueAlpha && image.isOpaque())
+            aOutputImageColorformat = ColorSpec::opaqueFormat(aOutputImageColorformat);
+        break;
+#endif // GIFIO_ENABLED
+    default:
+        throw UnsupportedImageFormatException("Unsupported image format");
+    }
+
+    if ((image.colorFormat() != aOutputImageColorformat) || (image.colorChannelDepth() != aOutputImageChannelDepth))
+        image.convertInPlace(aOutputImageColorformat, aOutputImageChannelDepth);
 
     return image;
 }
@@ -51,28 +121,190 @@ Image ImageIO::read(const uint8_t *aInputData,
                     size_t aLength,
                     ImageFormat aInputImageFormat,
                     ColorSpec::Format aOutputImageColorformat,
-                    ColorSpec::ChannelDepth aOutputImageChannelDepth)
+                    ColorSpec::ChannelDepth aOutputImageChannelDepth,
+                    bool aApplyOrientation,
+                    bool aDropOpaqueAlpha)
 {
+    if (aInputImageFormat == ImageFormat::kUnspecified)
+        aInputImageFormat = detectFormat(aInputData, aLength);
+
     Image image;
 
-    // TODO: implement
+    switch (aInputImageFormat) {
+#ifdef PNGIO_ENABLED
+    case ImageFormat::kPng:
+        image = PngIO::read(aInputData, aLength, aOutputImageColorformat, aOutputImageChannelDepth, aApplyOrientation, aDropOpaqueAlpha);
+        if (aDropOpaqueAlpha)
+            aOutputImageColorformat = image.colorFormat();
+        break;
+#endif // PNGIO_ENABLED
+#ifdef JPEGIO_ENABLED
+    case ImageFormat::kJpeg:
+        // There is never any alpha to decode
+        if (aDropOpaqueAlpha)
+            aOutputImageColorformat = ColorSpec::opaqueFormat(aOutputImageColorformat);
+        image = JpegIO::read(aInputData, aLength, aOutputImageColorformat, aOutputImageChannelDepth, aApplyOrientation);
+        break;
+#endif // JPEGIO_ENABLED
+#ifdef GIFIO_ENABLED
+    case ImageFormat::kGif:
+        image = GifIO::read(aInputData, aLength, aOutputImageColorformat, aOutputImageChannelDepth);
+        if (aDropOpaqueAlpha && image.isOpaque())
+            aOutputImageColorformat = ColorSpec::opaqueFormat(aOutputImageColorformat);
+        break;
+#endif // GIFIO_ENABLED
+    default:
+        throw UnsupportedImageFormatException("Unsupported image format");
+    }
+
+    if ((image.colorFormat() != aOutputImageColorformat) || (image.colorChannelDepth() != aOutputImageChannelDepth))
+        image.convertInPlace(aOutputImageColorformat, aOutputImageChannelDepth);
 
     return image;
 }
 
+Image ImageIO::read(const std::string& aPath,
+                    ImageFormat aInputImageFormat,
+                    ColorSpec::Format aOutputImageColorformat,
+                    ColorSpec::ChannelDepth aOutputImageChannelDepth,
+                    bool aApplyOrientation,
+                    bool aDropOpaqueAlpha)
+{
+    MappedFileReader fileReader(aPath);
+    return read(fileReader.data(),
+                fileReader.length(),
+                aInputImageFormat,
+                aOutputImageColorformat,
+                aOutputImageChannelDepth,
+                aApplyOrientation,
+                aDropOpaqueAlpha);
+}
+
 void ImageIO::write(const Image &aImage,
                     std::ostream &aOutputDataStream,
                     ImageFormat aImageFormat)
 {
-    // TODO: implement
+    switch (aImageFormat) {
+#ifdef PNGIO_ENABLED
+    case ImageFormat::kPng:
+        PngIO::write(aImage, aOutputDataStream);
+        break;
+#endif // PNGIO_ENABLED
+#ifdef JPEGIO_ENABLED
+    case ImageFormat::kJpeg:
+        JpegIO::write(aImage, aOutputDataStream);
+        break;
+#endif // JPEGIO_ENABLED
+#ifdef GIFIO_ENABLED
+    case ImageFormat::kGif:
+        GifIO::write(aImage, aOutputDataStream);
+        break;
+#endif // GIFIO_ENABLED
+    default:
+        throw UnsupportedImageFormatException("Unsupported image format");
+    }
+}
+
+size_t ImageIO::write(const Image &aImage,
+                      uint8_t *aOutputDataBuf,
+                      size_t aOutputDataBufLength,
+                      ImageFormat aImageFormat)
+{
+    switch (aImageFormat) {
+#ifdef PNGIO_ENABLED
+    case ImageFormat::kPng:
+        return PngIO::write(aImage, aOutputDataBuf, aOutputDataBufLength);
+#endif // PNGIO_ENABLED
+#ifdef JPEGIO_ENABLED
+    case ImageFormat::kJpeg:
+        return JpegIO::write(aImage, aOutputDataBuf, aOutputDataBufLength);
+#endif // JPEGIO_ENABLED
+#ifdef GIFIO_ENABLED
+    case ImageFormat::kGif:
+        return GifIO::write(aImage, aOutputDataBuf, aOutputDataBufLength);
+#endif // GIFIO_ENABLED
+    default:
+        throw UnsupportedImageFormatException("Unsupported image format");
+    }
 }
 
 void ImageIO::write(const Image &aImage,
-                    uint8_t *aOutputDataBuf,
-                    size_t aOutputDataBufLength,
+                    EncodedBuffer &aOutputBuffer,
                     ImageFormat aImageFormat)
 {
-    // TODO: implement
+    aOutputBuffer.clear();
+    BufferWriter bufferWriter(aOutputBuffer);
+
+    switch (aImageFormat) {
+#ifdef PNGIO_ENABLED
+    case ImageFormat::kPng:
+        PngIO::write(aImage, bufferWriter);
+        break;
+#endif // PNGIO_ENABLED
+#ifdef JPEGIO_ENABLED
+    case ImageFormat::kJpeg:
+        JpegIO::write(aImage, bufferWriter);
+        break;
+#endif // JPEGIO_ENABLED
+#ifdef GIFIO_ENABLED
+    case ImageFormat::kGif:
+        GifIO::write(aImage, bufferWriter);
+        break;
+#endif // GIFIO_ENABLED
+    default:
+        throw UnsupportedImageFormatException("Unsupported image format");
+    }
+}
+
+void ImageIO::write(const Image &aImage,
+                    const std::string &aPath,
+                    ImageFormat aImageFormat,
+                    Durability aDurability,
+                    bool aMapOutput)
+{
+    FileWriter fileWriter(aPath, aDurability, maxEncodedSize(aImage, aImageFormat), aMapOutput);
+
+    switch (aImageFormat) {
+#ifdef PNGIO_ENABLED
+    case ImageFormat::kPng:
+        PngIO::write(aImage, fileWriter);
+        break;
+#endif // PNGIO_ENABLED
+#ifdef JPEGIO_ENABLED
+    case ImageFormat::kJpeg:
+        JpegIO::write(aImage, fileWriter);
+        break;
+#endif // JPEGIO_ENABLED
+#ifdef GIFIO_ENABLED
+    case ImageFormat::kGif:
+        GifIO::write(aImage, fileWriter);
+        break;
+#endif // GIFIO_ENABLED
+    default:
+        throw UnsupportedImageFormatException("Unsupported image format");
+    }
+    fileWriter.close();
+}
+
+size_t ImageIO::maxEncodedSize(const Image &aImage,
+                               ImageFormat aImageFormat)
+{
+    switch (aImageFormat) {
+#ifdef PNGIO_ENABLED
+    case ImageFormat::kPng:
+        return PngIO::maxEncodedSize(aImage);
+#endif // PNGIO_ENABLED
+#ifdef JPEGIO_ENABLED
+    case ImageFormat::kJpeg:
+        return JpegIO::maxEncodedSize(aImage);
+#endif // JPEGIO_ENABLED
+#ifdef GIFIO_ENABLED
+    case ImageFormat::kGif:
+        return GifIO::maxEncodedSize(aImage);
+#endif // GIFIO_ENABLED
+    default:
+        throw UnsupportedImageFormatException("Unsupported image format");
+    }
 }
 
 } // namespace ImgIO
@@ -22,11 +22,17 @@
 //
 
 #include "jpegio.h"
+#include <algorithm>
+#include <cstring>
 #include <jpeglib.h>
 
 #include "dataio.h"
+#include "exif.h"
+#include "rotate.h"
+#include "rowstream.h"
 
 #include <functional>
+#include <stdexcept>
 
 namespace ImgIO
 {
@@ -40,7 +46,7 @@ struct my_source_mgr {
 class JpegSourceManager : private jpeg_source_mgr {
 public:
     JpegSourceManager(j_decompress_ptr aDecompressInfo, DataReader &aDataReader)
-            : mDataReader(aDataReader), mBuffer(new JOCTET[1025]), mBufferSize(1024) {
+            : mReader(aDataReader), mHandedOut(0) {
         init_source = initSource;
         fill_input_buffer = fillInputBuffer;
         skip_input_data = skipInputData;
@@ -48,30 +54,31 @@ public:
         term_source = terminateSource;
         bytes_in_buffer = 0;
         next_input_byte = 0;
+        mEoi[0] = (JOCTET) 0xFF;
+        mEoi[1] = (JOCTET) JPEG_EOI;
 
         aDecompressInfo->src = static_cast<struct jpeg_source_mgr *>(this);
     }
 
-    void resizeBuffer(size_t aSize)
-    {
-        mBuffer.reset(new JOCTET[aSize > 2 ? aSize : 2]);
-        mBufferSize = (aSize > 2 ? aSize : 2);
-    }
 private:
     static void initSource(j_decompress_ptr aDecompressInfo) {
     }
 
+    // The decoder reads straight from the block of the reader, so data in
+    // memory is decoded in place.
     static boolean fillInputBuffer(j_decompress_ptr aDecompressInfo) {
         JpegSourceManager* src = reinterpret_cast<JpegSourceManager*>(aDecompressInfo->src);
 
-        size_t bytes = src->mDataReader.read(src->mBuffer.get(), src->mBufferSize);
+        src->mReader.skip(src->mHandedOut);
+        size_t bytes = 0;
+        const uint8_t* data = src->mReader.peek(bytes);
+        src->mHandedOut = bytes;
         if (bytes == 0) {
             /* Insert a fake EOI marker */
-            src->mBuffer.get()[0] = (JOCTET) 0xFF;
-            src->mBuffer.get()[1] = (JOCTET) JPEG_EOI;
+            data = src->mEoi;
             bytes = 2;
         }
-        src->next_input_byte = src->mBuffer.get();
+        src->next_input_byte = data;
         src->bytes_in_buffer = bytes;
 
         return TRUE;
@@ -88,21 +95,25 @@ private:
         src->bytes_in_buffer -= aNumBytes;
     }
 
+    // The bytes past the image are given back to the data reader by the
+    // buffered reader.
     static void terminateSource(j_decompress_ptr aDecompressInfo) {
         JpegSourceManager* src = reinterpret_cast<JpegSourceManager*>(aDecompressInfo->src);
-        src->mDataReader.clearErrors();
-        src->mDataReader.seekPos(src->mDataReader.tellPos() - (std::streampos)src->bytes_in_buffer);
+        if (src->mHandedOut)
+            src->mReader.skip(src->mHandedOut - src->bytes_in_buffer);
+        src->mHandedOut = 0;
+        src->bytes_in_buffer = 0;
     }
 private:
-    DataReader& mDataReader;
-    std::unique_ptr<JOCTET> mBuffer;
-    size_t mBufferSize;
+    BufferedReader mReader;
+    size_t mHandedOut;
+    JOCTET mEoi[2];
 }; // class JpegSourceManager
 
 class JpegDestinationManager : private jpeg_destination_mgr {
 public:
-    JpegDestinationManager(j_compress_ptr aCompressInfo, DataWriter& aDataWriter, size_t aBufferSize)
-    : mDataWriter(aDataWriter), mBuffer(new JOCTET[aBufferSize]), mBufferSize(aBufferSize)
+    JpegDestinationManager(j_compress_ptr aCompressInfo, DataWriter& aDataWriter)
+    : mWriter(aDataWriter), mHandedOut(0)
     {
         init_destination = init;
         empty_output_buffer = write;
@@ -112,48 +123,115 @@ public:
     }
 
 private:
+    // The encoder writes straight into the block of the writer.
     static void init(j_compress_ptr compressInfo) {
         JpegDestinationManager* destMgr = reinterpret_cast<JpegDestinationManager*>(compressInfo->dest);
-//        dest->buffer = (JOCTET*)(*compressInfo->mem->alloc_small) ((j_common_ptr)compressInfo, JPOOL_IMAGE, JPEG_BUF_SIZE * sizeof(JOCTET));
-        destMgr->next_output_byte = destMgr->mBuffer.get();
-        destMgr->free_in_buffer = destMgr->mBufferSize;
+        destMgr->next_output_byte = destMgr->mWriter.space(destMgr->mHandedOut);
+        destMgr->free_in_buffer = destMgr->mHandedOut;
     }
 
     static boolean write(j_compress_ptr copressInfo) {
         JpegDestinationManager* destMgr = reinterpret_cast<JpegDestinationManager*>(copressInfo->dest);
 
-        destMgr->mDataWriter.write(static_cast<uint8_t*>(destMgr->mBuffer.get()), destMgr->mBufferSize);
-//        if (destMgr->os->fail()) {
-//            LOG_FATAL("Couldn't write entire jpeg buffer to stream.");
-//        }
-        destMgr->next_output_byte = destMgr->mBuffer.get();
-        destMgr->free_in_buffer = destMgr->mBufferSize;
+        destMgr->mWriter.commit(destMgr->mHandedOut);
+        destMgr->next_output_byte = destMgr->mWriter.space(destMgr->mHandedOut);
+        destMgr->free_in_buffer = destMgr->mHandedOut;
 
         return true;
     }
 
     static void terminate(j_compress_ptr cinfo) {
         JpegDestinationManager* destMgr = (JpegDestinationManager*) cinfo->dest;
-        size_t remainingDataSize = destMgr->mBufferSize - destMgr->free_in_buffer;
 
-        if (remainingDataSize > 0) {
-            destMgr->mDataWriter.write(static_cast<uint8_t*>(destMgr->mBuffer.get()), remainingDataSize);
-//            if (destMgr->os->fail()) {
-//                LOG_FATAL("Couldn't write remaining jpeg data to stream.");
-//            }
-        }
-        destMgr->mDataWriter.flush();
+        destMgr->mWriter.commit(destMgr->mHandedOut - destMgr->free_in_buffer);
+        destMgr->mHandedOut = 0;
+        destMgr->free_in_buffer = 0;
+        destMgr->mWriter.flush();
     }
 
 private:
-    DataWriter& mDataWriter;
-    std::unique_ptr<JOCTET> mBuffer;
-    size_t mBufferSize;
+    BufferedWriter mWriter;
+    size_t mHandedOut;
 };
 
+// Picks the output color space, the luma plane alone when aGrayscale is set
+// or the file has nothing else.
+static ColorSpec::Format setOutputColorSpace(struct jpeg_decompress_struct& aDecompressInfo, bool aGrayscale)
+{
+    switch (aDecompressInfo.num_components) {
+    case 1:
+        aDecompressInfo.out_color_space = JCS_GRAYSCALE;
+        return ColorSpec::Format::kMonochromatic;
+    case 3:
+        if (aGrayscale && (aDecompressInfo.jpeg_color_space == JCS_YCbCr)) {
+            aDecompressInfo.out_color_space = JCS_GRAYSCALE;
+            return ColorSpec::Format::kMonochromatic;
+        }
+        aDecompressInfo.out_color_space = JCS_RGB;
+        return ColorSpec::Format::kRGB;
+    default:
+        throw std::logic_error("Unsupported number of color components: " + std::to_string(aDecompressInfo.num_components));
+    }
+}
+
+// Returns the orientation from the first APP1 marker holding EXIF data.
+static Image::Orientation exifOrientation(struct jpeg_decompress_struct& aDecompressInfo)
+{
+    static const uint8_t exifSignature[] = {'E', 'x', 'i', 'f', 0, 0};
+
+    for (jpeg_saved_marker_ptr marker = aDecompressInfo.marker_list; marker != nullptr; marker = marker->next) {
+        if ((marker->marker != JPEG_APP0 + 1) || (marker->data_length < sizeof(exifSignature)))
+            continue;
+        if (std::memcmp(marker->data, exifSignature, sizeof(exifSignature)) != 0)
+            continue;
+        return exifOrientation(marker->data + sizeof(exifSignature), marker->data_length - sizeof(exifSignature));
+    }
+
+    return Image::Orientation::kTopLeft;
+}
+
+// Decodes bands of scanlines into a scratch image, each band is moved to
+// its place in the oriented image while it is still cached.
+static Image readJpegOriented(struct jpeg_decompress_struct& aDecompressInfo,
+                              ColorSpec::Format aColorFormat,
+                              Image::Orientation aOrientation)
+{
+    static const unsigned int kBandHeight = 64;
+
+    unsigned int width = aDecompressInfo.output_width;
+    unsigned int height = aDecompressInfo.output_height;
+    bool swapped = swapsAxes(aOrientation);
+    Image image(swapped ? height : width,
+                swapped ? width : height,
+                aColorFormat,
+                ColorSpec::ChannelDepth::k8Bit);
+    Image band(width, std::min(height, kBandHeight), aColorFormat, ColorSpec::ChannelDepth::k8Bit);
+
+    std::unique_ptr<uint8_t*[]> dataRows(new uint8_t*[band.height()]);
+    for (size_t y = 0; y < band.height(); y++) {
+        dataRows[y] = band.data() + y * band.stride();
+    }
+
+    while (aDecompressInfo.output_scanline != height) {
+        unsigned int y = aDecompressInfo.output_scanline;
+        unsigned int rowsCount = std::min(height - y, band.height());
+        unsigned int rowsRead = 0;
+        while (rowsRead < rowsCount) {
+            rowsRead += jpeg_read_scanlines(&aDecompressInfo, dataRows.get() + rowsRead, rowsCount - rowsRead);
+        }
+        orientRows(band.data(), band.stride(), width, height, y, rowsCount,
+                   ColorSpec::pixelSize(aColorFormat, ColorSpec::ChannelDepth::k8Bit),
+                   image.data(), image.stride(), aOrientation, 0);
+    }
+    jpeg_finish_decompress(&aDecompressInfo);
+
+    return image;
+}
+
 static Image readJpeg(DataReader& aDataReader,
                       ColorSpec::Format aOutputImageformat,
-                      ColorSpec::ChannelDepth aOutputImageChannelDepth)
+                      ColorSpec::ChannelDepth aOutputImageChannelDepth,
+                      bool aApplyOrientation)
 {
     std::function<void(struct jpeg_decompress_struct*)> decompressInfoAutoCleanupFunction =
             [](struct jpeg_decompress_struct* aDecompressInfo) {
@@ -170,27 +248,37 @@ static Image readJpeg(DataReader& aDataReader,
 
     JpegSourceManager sourceManager(&decompressInfo, aDataReader);
 
+    if (aApplyOrientation)
+        jpeg_save_markers(&decompressInfo, JPEG_APP0 + 1, 0xffff);
+
     if (jpeg_read_header(&decompressInfo, TRUE) != JPEG_HEADER_OK) {
         throw std::logic_error("Failed to read JPEG header.");
     }
 
-    if (decompressInfo.num_components != 3) {
-        throw std::logic_error("Unsupported number of color components: " + std::to_string(decompressInfo.num_components));
-    }
+    Image::Orientation orientation = aApplyOrientation ? exifOrientation(decompressInfo) : Image::Orientation::kTopLeft;
+
+    bool grayscale = (aOutputImageformat == ColorSpec::Format::kMonochromatic) ||
+                     (aOutputImageformat == ColorSpec::Format::kMonochromaticAlpha);
+    ColorSpec::Format colorFormat = setOutputColorSpace(decompressInfo, grayscale);
 
     jpeg_start_decompress(&decompressInfo);
 
-    size_t rowSize = decompressInfo.output_width * static_cast<int>(ColorSpec::Format::kRGB) * static_cast<int>(ColorSpec::ChannelDepth::k8Bit);
-    size_t dataSize = decompressInfo.output_height * rowSize;
+    if (orientation != Image::Orientation::kTopLeft)
+        return readJpegOriented(decompressInfo, colorFormat, orientation);
+
+    // Decode scanlines straight into the (padded) rows of the image
+    Image image(decompressInfo.output_width,
+                decompressInfo.output_height,
+                colorFormat,
+                ColorSpec::ChannelDepth::k8Bit);
 
-    std::unique_ptr<uint8_t> data(new uint8_t[dataSize]);
-    std::unique_ptr<uint8_t*> dataRows(new uint8_t*[decompressInfo.output_height]);
+    std::unique_ptr<uint8_t*[]> dataRows(new uint8_t*[decompressInfo.output_height]);
 
-    for (size_t y = 0; y < decompressInfo.output_height; y++) {
-        dataRows.get()[y] = data.get() + y * rowSize;
+    uint8_t* row = image.data();
+    for (size_t y = 0; y < decompressInfo.output_height; y++, row += image.stride()) {
+        dataRows[y] = row;
     }
 
-    sourceManager.resizeBuffer(rowSize);
     while (decompressInfo.output_scanline != decompressInfo.output_height) {
         jpeg_read_scanlines(&decompressInfo,
                             dataRows.get() + decompressInfo.output_scanline,
@@ -198,77 +286,113 @@ static Image readJpeg(DataReader& aDataReader,
     }
     jpeg_finish_decompress(&decompressInfo);
 
-    return Image(decompressInfo.output_width,
-                 decompressInfo.output_height,
-                 ColorSpec::Format::kRGB,
-                 ColorSpec::ChannelDepth::k8Bit,
-                 data.release());
+    return image;
 }
 
-static void writeJpeg(DataWriter& aDataWriter,
-                     const Image& aImage)
+/**
+ * Row sink writing a JPEG file, takes RGB 8 bit rows.
+ */
+class JpegEncoder : public RowSink
 {
-    int quality = 75;
-    if ((aImage.colorFormat() != ColorSpec::Format::kRGB) || (aImage.colorChannelDepth() != ColorSpec::ChannelDepth::k8Bit)) {
-        throw std::logic_error("Expected RGB (8bit per channel) image");
+public:
+    JpegEncoder(DataWriter& aDataWriter)
+    : mDataWriter(aDataWriter)
+    {
+        mCompressInfo.err = jpeg_std_error(&mErrorManager);
+        jpeg_create_compress(&mCompressInfo);
     }
 
-    struct jpeg_compress_struct compressInfo;
-    struct jpeg_error_mgr errorManager;
+    ~JpegEncoder()
+    {
+        jpeg_destroy_compress(&mCompressInfo);
+    }
 
-    compressInfo.err = jpeg_std_error(&errorManager);
-    jpeg_create_compress(&compressInfo);
+    void start(unsigned int aWidth,
+               unsigned int aHeight,
+               ColorSpec::Format aColorFormat,
+               ColorSpec::ChannelDepth aColorChannelDepth)
+    {
+        int quality = 75;
+        bool isGray = (aColorFormat == ColorSpec::Format::kMonochromatic);
+        if ((!isGray && (aColorFormat != ColorSpec::Format::kRGB)) || (aColorChannelDepth != ColorSpec::ChannelDepth::k8Bit)) {
+            throw std::logic_error("Expected RGB or monochromatic (8bit per channel) image");
+        }
 
-    compressInfo.image_width = aImage.width(); 	/* image width and height, in pixels */
-    compressInfo.image_height = aImage.height();
+        mCompressInfo.image_width = aWidth; 	/* image width and height, in pixels */
+        mCompressInfo.image_height = aHeight;
 
-    compressInfo.input_components = 3;
-    compressInfo.in_color_space = JCS_RGB;
+        mCompressInfo.input_components = isGray ? 1 : 3;
+        mCompressInfo.in_color_space = isGray ? JCS_GRAYSCALE : JCS_RGB;
 
-    jpeg_set_defaults(&compressInfo);
-    jpeg_set_quality(&compressInfo, quality, true);
+        jpeg_set_defaults(&mCompressInfo);
+        jpeg_set_quality(&mCompressInfo, quality, true);
 
+        mDestinationManager.reset(new JpegDestinationManager(&mCompressInfo, mDataWriter));
 
-    size_t rowLength = aImage.width() * static_cast<int>(aImage.colorFormat()) * static_cast<int>(aImage.colorChannelDepth());
+        jpeg_start_compress(&mCompressInfo, true);
+    }
 
-    JpegDestinationManager destinationManager(&compressInfo, aDataWriter, rowLength);
+    void push(const uint8_t* aRow)
+    {
+        JSAMPROW row = const_cast<JSAMPROW>(aRow);
+        jpeg_write_scanlines(&mCompressInfo, &row, 1);
+    }
 
-    jpeg_start_compress(&compressInfo, true);
+    void finish()
+    {
+        jpeg_finish_compress(&mCompressInfo);
+    }
 
-    std::unique_ptr<const uint8_t*> rows(new const uint8_t*[aImage.height()]);
+private:
+    JpegEncoder(const JpegEncoder&) = delete;
+    JpegEncoder& operator=(const JpegEncoder&) = delete;
+
+private:
+    DataWriter& mDataWriter;
+    struct jpeg_compress_struct mCompressInfo;
+    struct jpeg_error_mgr mErrorManager;
+    std::unique_ptr<JpegDestinationManager> mDestinationManager;
+}; // class JpegEncoder
+
+static void writeJpeg(DataWriter& aDataWriter,
+                     const Image& aImage)
+{
+    JpegEncoder encoder(aDataWriter);
+    encoder.start(aImage.width(), aImage.height(), aImage.colorFormat(), aImage.colorChannelDepth());
 
     const uint8_t* row = aImage.data();
     for (size_t y = 0; y < aImage.height(); ++y)
     {
-        rows.get()[y] = row;
-        row += rowLength;
+        encoder.push(row);
+        row += aImage.stride();
     }
 
-    jpeg_write_scanlines(&compressInfo, const_cast<JSAMPARRAY>(rows.get()), aImage.height());
-
-    jpeg_finish_compress(&compressInfo);
-    jpeg_destroy_compress(&compressInfo);
+    encoder.finish();
 }
 
 Image JpegIO::read(std::istream& aPngDataStream,
                   ColorSpec::Format aOutputImageformat,
-                  ColorSpec::ChannelDepth aOutputImageChannelDepth)
+                  ColorSpec::ChannelDepth aOutputImageChannelDepth,
+                  bool aApplyOrientation)
 {
     StreamReader streamReader(aPngDataStream);
     return readJpeg(streamReader,
                    aOutputImageformat,
-                   aOutputImageChannelDepth);
+                   aOutputImageChannelDepth,
+                   aApplyOrientation);
 }
 
 Image JpegIO::read(const uint8_t* aData,
                   size_t aLength,
                   ColorSpec::Format aOutputImageformat,
-                  ColorSpec::ChannelDepth aOutputImageChannelDepth)
+                  ColorSpec::ChannelDepth aOutputImageChannelDepth,
+                  bool aApplyOrientation)
 {
     MemoryReader memoryReader(aData, aLength);
     return readJpeg(memoryReader,
                    aOutputImageformat,
-                   aOutputImageChannelDepth);
+                   aOutputImageChannelDepth,
+                   aApplyOrientation);
 }
 
 void JpegIO::write(const Image& aImage, std::ostream& aPngDataStream)
@@ -277,10 +401,126 @@ void JpegIO::write(const Image& aImage, std::ostream& aPngDataStream)
     writeJpeg(streamWriter, aImage);
 }
 
-void JpegIO::write(const Image& aImage, uint8_t* aData, size_t aLength)
+void JpegIO::write(const Image& aImage, DataWriter& aDataWriter)
 {
-    MemoryWriter streamWriter(aData, aLength);
-    writeJpeg(streamWriter, aImage);
+    writeJpeg(aDataWriter, aImage);
+}
+
+size_t JpegIO::write(const Image& aImage, uint8_t* aData, size_t aLength)
+{
+    MemoryWriter memoryWriter(aData, aLength);
+    writeJpeg(memoryWriter, aImage);
+    if (memoryWriter.isTruncated())
+        throw std::length_error("JPEG data doesn't fit into the output buffer");
+    return memoryWriter.bytesWritten();
+}
+
+size_t JpegIO::maxEncodedSize(const Image& aImage)
+{
+    // The bound of libjpeg-turbo's tjBufSize(), two bytes for each sample of
+    // the padded MCUs, with 2x2 subsampled chroma of jpeg_set_defaults().
+    // Markers and tables fit into 2048 bytes.
+    bool isGray = (aImage.colorFormat() == ColorSpec::Format::kMonochromatic);
+    size_t mcuSize = isGray ? 8 : 16;
+    size_t width = (aImage.width() + mcuSize - 1) / mcuSize * mcuSize;
+    size_t height = (aImage.height() + mcuSize - 1) / mcuSize * mcuSize;
+    return width * height * (isGray ? 2 : 3) + 2048;
+}
+
+void JpegIO::readRows(DataReader& aDataReader,
+                      const DecodeHints& aHints,
+                      RowSink& aSink)
+{
+    std::function<void(struct jpeg_decompress_struct*)> decompressInfoAutoCleanupFunction =
+            [](struct jpeg_decompress_struct* aDecompressInfo) {
+                jpeg_destroy_decompress(aDecompressInfo);
+            };
+    std::unique_ptr<struct jpeg_decompress_struct, std::function<void(struct jpeg_decompress_struct*)>> decompressInfoAutoCleanup(nullptr,
+                                                                                                                                  decompressInfoAutoCleanupFunction);
+    struct jpeg_decompress_struct decompressInfo;
+    struct jpeg_error_mgr errorManager;
+
+    decompressInfo.err = jpeg_std_error(&errorManager);
+    jpeg_create_decompress(&decompressInfo);
+    decompressInfoAutoCleanup.reset(&decompressInfo);
+
+    JpegSourceManager sourceManager(&decompressInfo, aDataReader);
+
+    if (jpeg_read_header(&decompressInfo, TRUE) != JPEG_HEADER_OK) {
+        throw std::logic_error("Failed to read JPEG header.");
+    }
+
+    ColorSpec::Format colorFormat = setOutputColorSpace(decompressInfo, aHints.grayscale);
+
+    unsigned int x, y, width, height;
+    clipWindow(aHints, decompressInfo.image_width, decompressInfo.image_height, x, y, width, height);
+
+    // The IDCT scales by 1/2, 1/4 or 1/8 almost for free. It is used only
+    // when the window maps exactly to the scaled image.
+    unsigned int scale = 8;
+    for (; scale > 1; scale /= 2) {
+        if ((aHints.minWidth == 0) || (aHints.minHeight == 0))
+            continue;
+        if (((x % scale) != 0) || ((y % scale) != 0))
+            continue;
+        if (((width % scale) != 0) && ((x + width) != decompressInfo.image_width))
+            continue;
+        if (((height % scale) != 0) && ((y + height) != decompressInfo.image_height))
+            continue;
+        if (((width + scale - 1) / scale >= aHints.minWidth) && ((height + scale - 1) / scale >= aHints.minHeight))
+            break;
+    }
+    decompressInfo.scale_num = 1;
+    decompressInfo.scale_denom = scale;
+
+    x /= scale;
+    y /= scale;
+    width = (width + scale - 1) / scale;
+    height = (height + scale - 1) / scale;
+
+    aSink.start(width, height, colorFormat, ColorSpec::ChannelDepth::k8Bit);
+    if ((width == 0) || (height == 0)) {
+        aSink.finish();
+        return;
+    }
+
+    jpeg_start_decompress(&decompressInfo);
+
+    // Columns are cropped to whole iMCUs, the rest is skipped in the row.
+    // Upsampled chroma at the edges of the cropped rows lacks its neighbors,
+    // so the crop keeps a column of context on both sides.
+    if (width < decompressInfo.output_width) {
+        JDIMENSION cropX = (x > 0) ? x - 1 : 0;
+        JDIMENSION cropWidth = std::min(x + width + 1, decompressInfo.output_width) - cropX;
+        jpeg_crop_scanline(&decompressInfo, &cropX, &cropWidth);
+        x -= cropX;
+    } else {
+        x = 0;
+    }
+    size_t offset = x * decompressInfo.output_components;
+
+    if (y > 0)
+        jpeg_skip_scanlines(&decompressInfo, y);
+
+    std::unique_ptr<uint8_t[]> row(new uint8_t[decompressInfo.output_width * decompressInfo.output_components]);
+    JSAMPROW rowPtr = row.get();
+    for (unsigned int i = 0; i < height; ++i) {
+        jpeg_read_scanlines(&decompressInfo, &rowPtr, 1);
+        aSink.push(row.get() + offset);
+    }
+
+    // Rows below the window are never decoded
+    if (decompressInfo.output_scanline < decompressInfo.output_height)
+        jpeg_abort_decompress(&decompressInfo);
+    else
+        jpeg_finish_decompress(&decompressInfo);
+
+    aSink.finish();
+}
+
+std::unique_ptr<RowSink> JpegIO::rowWriter(DataWriter& aDataWriter)
+{
+    return std::unique_ptr<RowSink>(new JpegEncoder(aDataWriter));
 }
 
 } // namespace ImgIO
@@ -25,27 +25,62 @@
 #define _JPEGIO_H__
 
 #include <iostream>
+#include <memory>
 #include <imgio/image.h>
 
 namespace ImgIO {
 
+class DataReader;
+class DataWriter;
+class RowSink;
+struct DecodeHints;
+
 class JpegIO {
 public:
     static Image read(std::istream &aPngDataStream,
                       ColorSpec::Format aOutputImageformat = ColorSpec::Format::kRGBA,
-                      ColorSpec::ChannelDepth aOutputImageChannelDepth = ColorSpec::ChannelDepth::k8Bit);
+                      ColorSpec::ChannelDepth aOutputImageChannelDepth = ColorSpec::ChannelDepth::k8Bit,
+                      bool aApplyOrientation = false);
 
     static Image read(const uint8_t *aData,
                       size_t aLength,
                       ColorSpec::Format aOutputImageformat = ColorSpec::Format::kRGBA,
-                      ColorSpec::ChannelDepth aOutputImageChannelDepth = ColorSpec::ChannelDepth::k8Bit);
+                      ColorSpec::ChannelDepth aOutputImageChannelDepth = ColorSpec::ChannelDepth::k8Bit,
+                      bool aApplyOrientation = false);
 
     static void write(const Image &aImage,
                       std::ostream &aPngDataStream);
 
     static void write(const Image &aImage,
-                      uint8_t *aData,
-                      size_t aLength);
+                      DataWriter &aDataWriter);
+
+    /**
+     * Encodes into aData and returns the number of bytes written. Throws
+     * std::length_error when they don't fit into aLength.
+     */
+    static size_t write(const Image &aImage,
+                        uint8_t *aData,
+                        size_t aLength);
+
+    /**
+     * Returns an upper bound of the size of aImage encoded by write().
+     */
+    static size_t maxEncodedSize(const Image &aImage);
+
+    /**
+     * Decodes the window of aHints row by row into aSink as RGB 8 bit rows.
+     * Rows above the window are skipped, columns outside of it are cropped
+     * to whole iMCUs and decoding stops after the window. The window is
+     * downscaled by the IDCT when the hints allow it.
+     */
+    static void readRows(DataReader& aDataReader,
+                         const DecodeHints& aHints,
+                         RowSink& aSink);
+
+    /**
+     * Returns a row sink encoding the RGB 8 bit rows it gets into aDataWriter.
+     */
+    static std::unique_ptr<RowSink> rowWriter(DataWriter& aDataWriter);
 }; // class JpegIO
 
 } // namespace ImgIO
@@ -0,0 +1,80 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "palette.h"
+#include <algorithm>
+#include <imgio/exception.h>
+#include "convert.h"
+
+namespace ImgIO
+{
+
+const size_t PaletteTable::kPadding;
+
+PaletteTable::PaletteTable(const Palette& aPalette, ColorSpec::Format aFormat, ColorSpec::ChannelDepth aChannelDepth)
+: mTable(),
+  mExpand(nullptr)
+{
+    ConvertFunction convertFunc = convertFunction(ColorSpec::Format::kRGBA, ColorSpec::ChannelDepth::k8Bit,
+                                                  aFormat, aChannelDepth);
+    size_t pixelSize = ColorSpec::pixelSize(aFormat, aChannelDepth);
+    mExpand = expandFunction(pixelSize);
+    if (!convertFunc || !mExpand)
+        throw NotImplementedException("Not implemented.");
+
+    // The palette goes through the regular conversions, as one RGBA row
+    PaletteColor colors[256];
+    std::fill(colors, colors + 256, PaletteColor{0, 0, 0, 0xff});
+    std::copy(aPalette.begin(), aPalette.begin() + std::min<size_t>(aPalette.size(), 256), colors);
+
+    mTable.reset(new uint8_t[256 * pixelSize + kPadding]());
+    convertFunc(reinterpret_cast<const uint8_t*>(colors), mTable.get(), 256);
+}
+
+ExpandFunction expandFunction(size_t aPixelSize)
+{
+    ExpandFunction expandFunc = simdExpandFunction(Simd::level(), aPixelSize);
+    if (expandFunc)
+        return expandFunc;
+
+    switch (aPixelSize) {
+    case 1:
+        return expandRow<1>;
+    case 2:
+        return expandRow<2>;
+    case 3:
+        return expandRow<3>;
+    case 4:
+        return expandRow<4>;
+    case 6:
+        return expandRow<6>;
+    case 8:
+        return expandRow<8>;
+    default:
+        return nullptr;
+    }
+}
+
+} // namespace ImgIO
+
+// EOF
@@ -0,0 +1,97 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _PALETTE_H__
+#define _PALETTE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <imgio/color.h>
+#include <imgio/simd.h>
+
+namespace ImgIO
+{
+
+/**
+ * Expands a row of 8 bit indices into pixels looked up in aTable, which
+ * holds 256 pixels followed by PaletteTable::kPadding bytes.
+ */
+typedef void (*ExpandFunction)(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount, const uint8_t* aTable);
+
+template <size_t kPixelSize>
+void expandRow(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount, const uint8_t* aTable)
+{
+    for (size_t i = 0; i < aPixelsCount; ++i, aDest += kPixelSize)
+        std::memcpy(aDest, aTable + aSrc[i] * kPixelSize, kPixelSize);
+}
+
+/**
+ * A palette converted to one pixel format. It has an entry for each of
+ * the 256 indices, those past the end of the palette are opaque black.
+ */
+class PaletteTable
+{
+public:
+    /**
+     * Bytes after the last entry, vector kernels load whole words from it.
+     */
+    static const size_t kPadding = 8;
+
+public:
+    /**
+     * Converts aPalette to aFormat, throws NotImplementedException for
+     * kIndexed and formats there's no conversion to.
+     */
+    PaletteTable(const Palette& aPalette, ColorSpec::Format aFormat, ColorSpec::ChannelDepth aChannelDepth);
+
+    /**
+     * Expands a row of indices into pixels of the table's format.
+     */
+    void expand(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount) const
+    {
+        mExpand(aSrc, aDest, aPixelsCount, mTable.get());
+    }
+
+private:
+    std::unique_ptr<uint8_t[]> mTable;
+    ExpandFunction mExpand;
+}; // class PaletteTable
+
+/**
+ * Returns the expansion kernel for the current Simd::level().
+ * @return Expansion function or nullptr for unsupported pixel sizes.
+ */
+ExpandFunction expandFunction(size_t aPixelSize);
+
+/**
+ * Returns the vectorized expansion kernel for the given instruction set level.
+ * @return Expansion function or nullptr, when the level has none.
+ */
+ExpandFunction simdExpandFunction(Simd::Level aLevel, size_t aPixelSize);
+
+} // namespace ImgIO
+
+#endif // _PALETTE_H__
+// EOF
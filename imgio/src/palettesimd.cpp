@@ -0,0 +1,207 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "palette.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMGIO_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace ImgIO
+{
+
+#ifdef IMGIO_X86_SIMD
+
+#define IMGIO_TARGET_AVX2 __attribute__((target("avx2")))
+
+namespace
+{
+
+//
+// Table lookups with gathers, each lane loads a 32 or 64 bit word from the
+// entry of its index. Entries narrower than the word are packed with a
+// shuffle, the word may run into the next entry or the table padding.
+//
+
+IMGIO_TARGET_AVX2 inline __m256i loadIndices(const uint8_t* aSrc)
+{
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(aSrc)));
+}
+
+IMGIO_TARGET_AVX2 inline __m256i gather32(const uint8_t* aTable, __m256i aOffsets)
+{
+    return _mm256_i32gather_epi32(reinterpret_cast<const int*>(aTable), aOffsets, 1);
+}
+
+IMGIO_TARGET_AVX2 inline __m256i gather64(const uint8_t* aTable, __m128i aOffsets)
+{
+    return _mm256_i32gather_epi64(reinterpret_cast<const long long*>(aTable), aOffsets, 1);
+}
+
+// Stores the low 12 bytes of both lanes as 24 consecutive bytes.
+IMGIO_TARGET_AVX2 inline void store24(uint8_t* aDest, __m256i aValue)
+{
+    __m256i packed = _mm256_permutevar8x32_epi32(aValue, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest), _mm256_castsi256_si128(packed));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(aDest + 16), _mm256_extracti128_si256(packed, 1));
+}
+
+// Mono8: the low byte of each word.
+struct Expand1
+{
+    static const size_t kPixelSize = 1;
+
+    IMGIO_TARGET_AVX2 static void expand8(const uint8_t* aSrc, uint8_t* aDest, const uint8_t* aTable)
+    {
+        const __m256i kShuffle = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                  0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        __m256i pixels = _mm256_shuffle_epi8(gather32(aTable, loadIndices(aSrc)), kShuffle);
+        pixels = _mm256_permutevar8x32_epi32(pixels, _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(aDest), _mm256_castsi256_si128(pixels));
+    }
+};
+
+// Mono16, MonoAlpha8: the low half of each word.
+struct Expand2
+{
+    static const size_t kPixelSize = 2;
+
+    IMGIO_TARGET_AVX2 static void expand8(const uint8_t* aSrc, uint8_t* aDest, const uint8_t* aTable)
+    {
+        const __m256i kShuffle = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                  0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+        __m256i offsets = _mm256_slli_epi32(loadIndices(aSrc), 1);
+        __m256i pixels = _mm256_shuffle_epi8(gather32(aTable, offsets), kShuffle);
+        pixels = _mm256_permute4x64_epi64(pixels, 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest), _mm256_castsi256_si128(pixels));
+    }
+};
+
+// RGB8: three bytes of each word.
+struct Expand3
+{
+    static const size_t kPixelSize = 3;
+
+    IMGIO_TARGET_AVX2 static void expand8(const uint8_t* aSrc, uint8_t* aDest, const uint8_t* aTable)
+    {
+        const __m256i kShuffle = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                                  0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        __m256i indices = loadIndices(aSrc);
+        __m256i offsets = _mm256_add_epi32(indices, _mm256_slli_epi32(indices, 1));
+        store24(aDest, _mm256_shuffle_epi8(gather32(aTable, offsets), kShuffle));
+    }
+};
+
+// RGBA8, MonoAlpha16: whole words.
+struct Expand4
+{
+    static const size_t kPixelSize = 4;
+
+    IMGIO_TARGET_AVX2 static void expand8(const uint8_t* aSrc, uint8_t* aDest, const uint8_t* aTable)
+    {
+        __m256i offsets = _mm256_slli_epi32(loadIndices(aSrc), 2);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest), gather32(aTable, offsets));
+    }
+};
+
+// RGB16: six bytes of each 64 bit word.
+struct Expand6
+{
+    static const size_t kPixelSize = 6;
+
+    IMGIO_TARGET_AVX2 static void expand8(const uint8_t* aSrc, uint8_t* aDest, const uint8_t* aTable)
+    {
+        const __m256i kShuffle = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, -1, -1, -1, -1,
+                                                  0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, -1, -1, -1, -1);
+        __m256i indices = loadIndices(aSrc);
+        __m256i offsets = _mm256_mullo_epi32(indices, _mm256_set1_epi32(6));
+        __m256i lo = gather64(aTable, _mm256_castsi256_si128(offsets));
+        __m256i hi = gather64(aTable, _mm256_extracti128_si256(offsets, 1));
+        store24(aDest, _mm256_shuffle_epi8(lo, kShuffle));
+        store24(aDest + 24, _mm256_shuffle_epi8(hi, kShuffle));
+    }
+};
+
+// RGBA16: whole 64 bit words.
+struct Expand8
+{
+    static const size_t kPixelSize = 8;
+
+    IMGIO_TARGET_AVX2 static void expand8(const uint8_t* aSrc, uint8_t* aDest, const uint8_t* aTable)
+    {
+        __m256i offsets = _mm256_slli_epi32(loadIndices(aSrc), 3);
+        __m256i lo = gather64(aTable, _mm256_castsi256_si128(offsets));
+        __m256i hi = gather64(aTable, _mm256_extracti128_si256(offsets, 1));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest), lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + 32), hi);
+    }
+};
+
+template <class Expand>
+IMGIO_TARGET_AVX2 void expandRowAVX2(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount, const uint8_t* aTable)
+{
+    size_t i = 0;
+    for (; i + 8 <= aPixelsCount; i += 8)
+        Expand::expand8(aSrc + i, aDest + i * Expand::kPixelSize, aTable);
+
+    expandRow<Expand::kPixelSize>(aSrc + i, aDest + i * Expand::kPixelSize, aPixelsCount - i, aTable);
+}
+
+} // namespace
+
+ExpandFunction simdExpandFunction(Simd::Level aLevel, size_t aPixelSize)
+{
+    if (aLevel < Simd::Level::kAVX2)
+        return nullptr;
+
+    switch (aPixelSize) {
+    case 1:
+        return expandRowAVX2<Expand1>;
+    case 2:
+        return expandRowAVX2<Expand2>;
+    case 3:
+        return expandRowAVX2<Expand3>;
+    case 4:
+        return expandRowAVX2<Expand4>;
+    case 6:
+        return expandRowAVX2<Expand6>;
+    case 8:
+        return expandRowAVX2<Expand8>;
+    default:
+        return nullptr;
+    }
+}
+
+#else // IMGIO_X86_SIMD
+
+ExpandFunction simdExpandFunction(Simd::Level aLevel, size_t aPixelSize)
+{
+    return nullptr;
+}
+
+#endif // IMGIO_X86_SIMD
+
+} // namespace ImgIO
+
+// EOF
@@ -0,0 +1,603 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <imgio/pipeline.h>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "convert.h"
+#include "dataio.h"
+#include "resize.h"
+#include "rowstream.h"
+
+#ifdef PNGIO_ENABLED
+#include "pngio.h"
+#endif // PNGIO_ENABLED
+
+#ifdef JPEGIO_ENABLED
+#include "jpegio.h"
+#endif // JPEGIO_ENABLED
+
+namespace ImgIO
+{
+
+namespace
+{
+
+struct Operation
+{
+    enum class Type
+    {
+        kCrop,
+        kResize,
+        kConvert,
+    };
+
+    Type type;
+    unsigned int x;
+    unsigned int y;
+    unsigned int width;
+    unsigned int height;
+    Image::ResizeFilter filter;
+    ColorSpec::Format format;
+    ColorSpec::ChannelDepth channelDepth;
+};
+
+class CropStage : public RowSink
+{
+public:
+    CropStage(const Operation& aOperation, RowSink& aNext)
+    : mNext(aNext), mY(0), mHeight(0), mOffset(0), mRow(0)
+    {
+        mWindow.x = aOperation.x;
+        mWindow.y = aOperation.y;
+        mWindow.width = aOperation.width;
+        mWindow.height = aOperation.height;
+    }
+
+    void start(unsigned int aWidth,
+               unsigned int aHeight,
+               ColorSpec::Format aColorFormat,
+               ColorSpec::ChannelDepth aColorChannelDepth)
+    {
+        unsigned int x, width;
+        clipWindow(mWindow, aWidth, aHeight, x, mY, width, mHeight);
+        if (width == 0)
+            mHeight = 0;
+
+        mOffset = x * ColorSpec::pixelSize(aColorFormat, aColorChannelDepth);
+        mRow = 0;
+        mNext.start(width, mHeight, aColorFormat, aColorChannelDepth);
+    }
+
+    void push(const uint8_t* aRow)
+    {
+        if ((mRow >= mY) && (mRow < (mY + mHeight)))
+            mNext.push(aRow + mOffset);
+        ++mRow;
+    }
+
+    void finish()
+    {
+        mNext.finish();
+    }
+
+private:
+    RowSink& mNext;
+    DecodeHints mWindow;
+    unsigned int mY;
+    unsigned int mHeight;
+    size_t mOffset;
+    unsigned int mRow;
+};
+
+// Streaming form of resizeRows(): every source row goes through the
+// horizontal pass once, into a ring of the taps rows the vertical pass needs.
+class ResizeStage : public RowSink
+{
+public:
+    ResizeStage(const Operation& aOperation, RowSink& aNext)
+    : mNext(aNext),
+      mWidth(aOperation.width),
+      mHeight(aOperation.height),
+      mFilter(aOperation.filter),
+      mPassThrough(false),
+      mPixelSize(0),
+      mChannels(0),
+      mIs16Bit(false),
+      mPremultiplied(false),
+      mHorizontal(nullptr),
+      mVertical(nullptr),
+      mSrcSamples(0),
+      mRingRowLength(0),
+      mSrcRow(0),
+      mDestRow(0)
+    {}
+
+    void start(unsigned int aWidth,
+               unsigned int aHeight,
+               ColorSpec::Format aColorFormat,
+               ColorSpec::ChannelDepth aColorChannelDepth)
+    {
+        mSrcRow = 0;
+        mDestRow = 0;
+        mPassThrough = (aWidth == mWidth) && (aHeight == mHeight);
+        if (mPassThrough) {
+            mNext.start(aWidth, aHeight, aColorFormat, aColorChannelDepth);
+            return;
+        }
+
+        // Nothing to resample, no rows go out
+        if ((aWidth == 0) || (aHeight == 0) || (mWidth == 0) || (mHeight == 0)) {
+            mRows.reset();
+            mNext.start(0, 0, aColorFormat, aColorChannelDepth);
+            return;
+        }
+
+        mColumns = FilterTable::get(aWidth, mWidth, mFilter);
+        mRows = FilterTable::get(aHeight, mHeight, mFilter);
+        mPixelSize = ColorSpec::pixelSize(aColorFormat, aColorChannelDepth);
+        mChannels = ColorSpec::channelCount(aColorFormat);
+        mIs16Bit = (aColorChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+        mPremultiplied = (aColorFormat == ColorSpec::Format::kRGBAPremultiplied);
+        mDestRowData.assign(mWidth * mPixelSize, 0);
+
+        if (mFilter != Image::ResizeFilter::kNearest) {
+            mHorizontal = horizontalFunction(mChannels);
+            mVertical = verticalFunction(aColorChannelDepth);
+            if (!mHorizontal)
+                throw NotImplementedException("Not implemented.");
+
+            // Kernels may read a padded row of taps and write one sample past a pixel.
+            mSrcSamples = aWidth * mChannels;
+            mRingRowLength = mWidth * mChannels + 1;
+            mSrcRowData.assign(mSrcSamples + mColumns->stride * mChannels + 1, 0.0f);
+            mRing.assign(mRows->taps * mRingRowLength, 0.0f);
+            mWindow.resize(mRows->taps);
+        }
+
+        mNext.start(mWidth, mHeight, aColorFormat, aColorChannelDepth);
+    }
+
+    void push(const uint8_t* aRow)
+    {
+        if (mPassThrough) {
+            mNext.push(aRow);
+            return;
+        }
+        if (!mRows)
+            return;
+
+        size_t row = mSrcRow++;
+
+        if (mFilter == Image::ResizeFilter::kNearest) {
+            for (; (mDestRow < mHeight) && (mRows->offsets[mDestRow] == row); ++mDestRow) {
+                uint8_t* dest = mDestRowData.data();
+                for (size_t x = 0; x < mWidth; ++x, dest += mPixelSize)
+                    std::memcpy(dest, aRow + mColumns->offsets[x] * mPixelSize, mPixelSize);
+                mNext.push(mDestRowData.data());
+            }
+            return;
+        }
+
+        // Rows no destination row reads are dropped unfiltered
+        if ((mDestRow >= mHeight) || (row < mRows->offsets[mDestRow]))
+            return;
+
+        size_t taps = mRows->taps;
+        if (mIs16Bit)
+            samplesToFloat<uint16_t>(aRow, mSrcRowData.data(), mSrcSamples);
+        else
+            samplesToFloat<uint8_t>(aRow, mSrcRowData.data(), mSrcSamples);
+        mHorizontal(mSrcRowData.data(), mRing.data() + (row % taps) * mRingRowLength, *mColumns);
+
+        for (; (mDestRow < mHeight) && ((mRows->offsets[mDestRow] + taps) <= (row + 1)); ++mDestRow) {
+            size_t first = mRows->offsets[mDestRow];
+            for (size_t k = 0; k < taps; ++k)
+                mWindow[k] = mRing.data() + ((first + k) % taps) * mRingRowLength;
+            mVertical(mWindow.data(),
+                      mRows->weights.data() + mDestRow * mRows->stride,
+                      taps,
+                      0,
+                      mWidth * mChannels,
+                      mDestRowData.data());
+            if (mPremultiplied && mIs16Bit)
+                clampPremultipliedRow<ColorSpec::ChannelDepth::k16Bit>(mDestRowData.data(), mWidth);
+            else if (mPremultiplied)
+                clampPremultipliedRow<ColorSpec::ChannelDepth::k8Bit>(mDestRowData.data(), mWidth);
+            mNext.push(mDestRowData.data());
+        }
+    }
+
+    void finish()
+    {
+        mNext.finish();
+    }
+
+private:
+    RowSink& mNext;
+    unsigned int mWidth;
+    unsigned int mHeight;
+    Image::ResizeFilter mFilter;
+    bool mPassThrough;
+    std::shared_ptr<const FilterTable> mColumns;
+    std::shared_ptr<const FilterTable> mRows;
+    size_t mPixelSize;
+    size_t mChannels;
+    bool mIs16Bit;
+    bool mPremultiplied;
+    HorizontalFunction mHorizontal;
+    VerticalFunction mVertical;
+    size_t mSrcSamples;
+    std::vector<float> mSrcRowData;
+    std::vector<float> mRing;
+    size_t mRingRowLength;
+    std::vector<const float*> mWindow;
+    std::vector<uint8_t> mDestRowData;
+    size_t mSrcRow;
+    size_t mDestRow;
+};
+
+class ConvertStage : public RowSink
+{
+public:
+    ConvertStage(const Operation& aOperation, RowSink& aNext)
+    : mNext(aNext),
+      mFormat(aOperation.format),
+      mChannelDepth(aOperation.channelDepth),
+      mConvert(nullptr),
+      mWidth(0)
+    {}
+
+    void start(unsigned int aWidth,
+               unsigned int aHeight,
+               ColorSpec::Format aColorFormat,
+               ColorSpec::ChannelDepth aColorChannelDepth)
+    {
+        mConvert = nullptr;
+        if ((aColorFormat != mFormat) || (aColorChannelDepth != mChannelDepth)) {
+            mConvert = convertFunction(aColorFormat, aColorChannelDepth, mFormat, mChannelDepth);
+            if (!mConvert)
+                throw NotImplementedException("Not implemented.");
+        }
+
+        mWidth = aWidth;
+        mRow.assign(aWidth * ColorSpec::pixelSize(mFormat, mChannelDepth), 0);
+        mNext.start(aWidth, aHeight, mFormat, mChannelDepth);
+    }
+
+    void push(const uint8_t* aRow)
+    {
+        if (!mConvert) {
+            mNext.push(aRow);
+            return;
+        }
+
+        mConvert(aRow, mRow.data(), mWidth);
+        mNext.push(mRow.data());
+    }
+
+    void finish()
+    {
+        mNext.finish();
+    }
+
+private:
+    RowSink& mNext;
+    ColorSpec::Format mFormat;
+    ColorSpec::ChannelDepth mChannelDepth;
+    ConvertFunction mConvert;
+    unsigned int mWidth;
+    std::vector<uint8_t> mRow;
+};
+
+class ImageSink : public RowSink
+{
+public:
+    ImageSink()
+    : mRow(0)
+    {}
+
+    void start(unsigned int aWidth,
+               unsigned int aHeight,
+               ColorSpec::Format aColorFormat,
+               ColorSpec::ChannelDepth aColorChannelDepth)
+    {
+        mImage = Image(aWidth, aHeight, aColorFormat, aColorChannelDepth);
+        mRowSize = aWidth * ColorSpec::pixelSize(aColorFormat, aColorChannelDepth);
+        mRow = 0;
+    }
+
+    void push(const uint8_t* aRow)
+    {
+        std::memcpy(mImage.data() + mRow * mImage.stride(), aRow, mRowSize);
+        ++mRow;
+    }
+
+    void finish()
+    {
+    }
+
+    Image& image()
+    {
+        return mImage;
+    }
+
+private:
+    Image mImage;
+    size_t mRowSize;
+    size_t mRow;
+};
+
+std::unique_ptr<RowSink> createEncoder(DataWriter& aDataWriter, ImageIO::ImageFormat aImageFormat)
+{
+    switch (aImageFormat) {
+#ifdef PNGIO_ENABLED
+    case ImageIO::ImageFormat::kPng:
+        return PngIO::rowWriter(aDataWriter);
+#endif // PNGIO_ENABLED
+#ifdef JPEGIO_ENABLED
+    case ImageIO::ImageFormat::kJpeg:
+        return JpegIO::rowWriter(aDataWriter);
+#endif // JPEGIO_ENABLED
+    default:
+        throw UnsupportedImageFormatException("Unsupported image format");
+    }
+}
+
+} // namespace
+
+class Pipeline::Impl
+{
+public:
+    Impl()
+    : mDecoderScaling(true)
+    {}
+
+    void append(const Operation& aOperation)
+    {
+        mOperations.push_back(aOperation);
+    }
+
+    void setDecoderScaling(bool aEnabled)
+    {
+        mDecoderScaling = aEnabled;
+    }
+
+    void run(DataReader& aDataReader, ImageIO::ImageFormat aInputImageFormat, RowSink& aSink) const;
+
+private:
+    std::vector<Operation> mOperations;
+    bool mDecoderScaling;
+};
+
+void Pipeline::Impl::run(DataReader& aDataReader, ImageIO::ImageFormat aInputImageFormat, RowSink& aSink) const
+{
+    DecodeHints hints;
+    size_t first = 0;
+
+    // A leading crop becomes the decoded window, a downscale right after it
+    // the smallest size the decoder may scale to.
+    if (!mOperations.empty() && (mOperations[0].type == Operation::Type::kCrop)
+        && (mOperations[0].width > 0) && (mOperations[0].height > 0)) {
+        hints.x = mOperations[0].x;
+        hints.y = mOperations[0].y;
+        hints.width = mOperations[0].width;
+        hints.height = mOperations[0].height;
+        first = 1;
+    }
+
+    if (mDecoderScaling && (first < mOperations.size())
+        && (mOperations[first].type == Operation::Type::kResize)
+        && (mOperations[first].filter != Image::ResizeFilter::kNearest)) {
+        hints.minWidth = mOperations[first].width;
+        hints.minHeight = mOperations[first].height;
+    }
+
+    // Crops and resizes don't care about colors, so a conversion to gray
+    // after them lets the decoder skip the colors altogether.
+    for (size_t i = first; i < mOperations.size(); ++i) {
+        if (mOperations[i].type != Operation::Type::kConvert)
+            continue;
+        hints.grayscale = (mOperations[i].format == ColorSpec::Format::kMonochromatic) ||
+                          (mOperations[i].format == ColorSpec::Format::kMonochromaticAlpha);
+        break;
+    }
+
+    std::vector<std::unique_ptr<RowSink>> stages;
+    RowSink* next = &aSink;
+    for (size_t i = mOperations.size(); i > first; --i) {
+        const Operation& operation = mOperations[i - 1];
+        switch (operation.type) {
+        case Operation::Type::kCrop:
+            stages.emplace_back(new CropStage(operation, *next));
+            break;
+        case Operation::Type::kResize:
+            stages.emplace_back(new ResizeStage(operation, *next));
+            break;
+        case Operation::Type::kConvert:
+            stages.emplace_back(new ConvertStage(operation, *next));
+            break;
+        }
+        next = stages.back().get();
+    }
+
+    switch (aInputImageFormat) {
+#ifdef PNGIO_ENABLED
+    case ImageIO::ImageFormat::kPng:
+        PngIO::readRows(aDataReader, hints, *next);
+        break;
+#endif // PNGIO_ENABLED
+#ifdef JPEGIO_ENABLED
+    case ImageIO::ImageFormat::kJpeg:
+        JpegIO::readRows(aDataReader, hints, *next);
+        break;
+#endif // JPEGIO_ENABLED
+    default:
+        throw UnsupportedImageFormatException("Unsupported image format");
+    }
+}
+
+Pipeline::Pipeline()
+: mImpl(new Impl())
+{
+}
+
+Pipeline::Pipeline(const Pipeline& aPipeline)
+: mImpl(new Impl(*aPipeline.mImpl))
+{
+}
+
+Pipeline& Pipeline::operator=(const Pipeline& aPipeline)
+{
+    *mImpl = *aPipeline.mImpl;
+    return *this;
+}
+
+Pipeline::~Pipeline()
+{
+}
+
+Pipeline& Pipeline::crop(unsigned int aX,
+                         unsigned int aY,
+                         unsigned int aWidth,
+                         unsigned int aHeight)
+{
+    Operation operation = Operation();
+    operation.type = Operation::Type::kCrop;
+    operation.x = aX;
+    operation.y = aY;
+    operation.width = aWidth;
+    operation.height = aHeight;
+    mImpl->append(operation);
+    return *this;
+}
+
+Pipeline& Pipeline::resize(unsigned int aWidth,
+                           unsigned int aHeight,
+                           Image::ResizeFilter aFilter)
+{
+    Operation operation = Operation();
+    operation.type = Operation::Type::kResize;
+    operation.width = aWidth;
+    operation.height = aHeight;
+    operation.filter = aFilter;
+    mImpl->append(operation);
+    return *this;
+}
+
+Pipeline& Pipeline::convert(ColorSpec::Format aFormat,
+                            ColorSpec::ChannelDepth aChannelDepth)
+{
+    Operation operation = Operation();
+    operation.type = Operation::Type::kConvert;
+    operation.format = aFormat;
+    operation.channelDepth = aChannelDepth;
+    mImpl->append(operation);
+    return *this;
+}
+
+Pipeline& Pipeline::setDecoderScaling(bool aEnabled)
+{
+    mImpl->setDecoderScaling(aEnabled);
+    return *this;
+}
+
+Image Pipeline::run(std::istream& aInputDataStream,
+                    ImageIO::ImageFormat aInputImageFormat) const
+{
+    if (aInputImageFormat == ImageIO::ImageFormat::kUnspecified)
+        aInputImageFormat = ImageIO::detectFormat(aInputDataStream);
+
+    StreamReader streamReader(aInputDataStream);
+    ImageSink imageSink;
+    mImpl->run(streamReader, aInputImageFormat, imageSink);
+    return imageSink.image();
+}
+
+Image Pipeline::run(const uint8_t* aInputData,
+                    size_t aLength,
+                    ImageIO::ImageFormat aInputImageFormat) const
+{
+    if (aInputImageFormat == ImageIO::ImageFormat::kUnspecified)
+        aInputImageFormat = ImageIO::detectFormat(aInputData, aLength);
+
+    MemoryReader memoryReader(aInputData, aLength);
+    ImageSink imageSink;
+    mImpl->run(memoryReader, aInputImageFormat, imageSink);
+    return imageSink.image();
+}
+
+void Pipeline::run(std::istream& aInputDataStream,
+                   ImageIO::ImageFormat aInputImageFormat,
+                   std::ostream& aOutputDataStream,
+                   ImageIO::ImageFormat aOutputImageFormat) const
+{
+    if (aInputImageFormat == ImageIO::ImageFormat::kUnspecified)
+        aInputImageFormat = ImageIO::detectFormat(aInputDataStream);
+
+    StreamReader streamReader(aInputDataStream);
+    StreamWriter streamWriter(aOutputDataStream);
+    std::unique_ptr<RowSink> encoder = createEncoder(streamWriter, aOutputImageFormat);
+    mImpl->run(streamReader, aInputImageFormat, *encoder);
+}
+
+size_t Pipeline::run(const uint8_t* aInputData,
+                     size_t aLength,
+                     ImageIO::ImageFormat aInputImageFormat,
+                     uint8_t* aOutputDataBuf,
+                     size_t aOutputDataBufLength,
+                     ImageIO::ImageFormat aOutputImageFormat) const
+{
+    if (aInputImageFormat == ImageIO::ImageFormat::kUnspecified)
+        aInputImageFormat = ImageIO::detectFormat(aInputData, aLength);
+
+    MemoryReader memoryReader(aInputData, aLength);
+    MemoryWriter memoryWriter(aOutputDataBuf, aOutputDataBufLength);
+    std::unique_ptr<RowSink> encoder = createEncoder(memoryWriter, aOutputImageFormat);
+    mImpl->run(memoryReader, aInputImageFormat, *encoder);
+    if (memoryWriter.isTruncated())
+        throw std::length_error("Encoded data doesn't fit into the output buffer");
+    return memoryWriter.bytesWritten();
+}
+
+void Pipeline::run(const uint8_t* aInputData,
+                   size_t aLength,
+                   ImageIO::ImageFormat aInputImageFormat,
+                   EncodedBuffer& aOutputBuffer,
+                   ImageIO::ImageFormat aOutputImageFormat) const
+{
+    if (aInputImageFormat == ImageIO::ImageFormat::kUnspecified)
+        aInputImageFormat = ImageIO::detectFormat(aInputData, aLength);
+
+    aOutputBuffer.clear();
+    MemoryReader memoryReader(aInputData, aLength);
+    BufferWriter bufferWriter(aOutputBuffer);
+    std::unique_ptr<RowSink> encoder = createEncoder(bufferWriter, aOutputImageFormat);
+    mImpl->run(memoryReader, aInputImageFormat, *encoder);
+}
+
+} // namespace ImgIO
+
+// EOF
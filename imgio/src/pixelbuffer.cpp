@@ -0,0 +1,83 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <new>
+#include <imgio/allocator.h>
+#include <imgio/image.h>
+#include "pixelbuffer.h"
+
+namespace ImgIO
+{
+
+static const size_t kHeaderSize = (sizeof(PixelBuffer) + Image::kRowAlignment - 1) & ~(Image::kRowAlignment - 1);
+
+PixelBuffer::PixelBuffer(const std::shared_ptr<Allocator>& aAllocator,
+                         size_t aBlockSize,
+                         uint8_t* aData,
+                         size_t aSize,
+                         bool aAdopted)
+: mReferencesCount(1),
+  mAllocator(aAllocator),
+  mBlockSize(aBlockSize),
+  mData(aData),
+  mSize(aSize),
+  mAdopted(aAdopted)
+{}
+
+PixelBuffer* PixelBuffer::create(size_t aSize)
+{
+    std::shared_ptr<Allocator> allocator = Allocator::defaultAllocator();
+    size_t blockSize = kHeaderSize + aSize;
+    uint8_t* block = static_cast<uint8_t*>(allocator->allocate(blockSize, Image::kRowAlignment));
+
+    return new (block) PixelBuffer(allocator, blockSize, block + kHeaderSize, aSize, false);
+}
+
+PixelBuffer* PixelBuffer::adopt(uint8_t* aData, size_t aSize)
+{
+    std::shared_ptr<Allocator> allocator = Allocator::defaultAllocator();
+    void* block = nullptr;
+    try {
+        block = allocator->allocate(kHeaderSize, Image::kRowAlignment);
+    } catch (...) {
+        delete[] aData;
+        throw;
+    }
+
+    return new (block) PixelBuffer(allocator, kHeaderSize, aData, aSize, true);
+}
+
+void PixelBuffer::destroy()
+{
+    std::shared_ptr<Allocator> allocator(std::move(mAllocator));
+    size_t blockSize = mBlockSize;
+
+    if (mAdopted)
+        delete[] mData;
+
+    this->~PixelBuffer();
+    allocator->deallocate(this, blockSize, Image::kRowAlignment);
+}
+
+} // namespace ImgIO
+// EOF
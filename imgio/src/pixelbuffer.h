@@ -0,0 +1,173 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _PIXELBUFFER_H__
+#define _PIXELBUFFER_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace ImgIO
+{
+
+class Allocator;
+
+/**
+ * Reference counted pixel buffer. The counter and the bookkeeping share a
+ * single allocation with the pixels, which start at the first
+ * Image::kRowAlignment boundary after the header.
+ */
+class PixelBuffer
+{
+public:
+    /**
+     * Allocates a buffer from the default allocator, with a reference count of one.
+     * @param aSize Pixel data size in bytes.
+     */
+    static PixelBuffer* create(size_t aSize);
+
+    /**
+     * Wraps data allocated with new[], which is deleted with the buffer.
+     * @param aData Pixel data.
+     * @param aSize Pixel data size in bytes.
+     */
+    static PixelBuffer* adopt(uint8_t* aData, size_t aSize);
+
+    uint8_t* data()
+    {
+        return mData;
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+    bool isShared() const
+    {
+        return mReferencesCount.load(std::memory_order_acquire) > 1;
+    }
+
+    void retain()
+    {
+        mReferencesCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release()
+    {
+        if (mReferencesCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            destroy();
+    }
+
+private:
+    PixelBuffer(const std::shared_ptr<Allocator>& aAllocator, size_t aBlockSize, uint8_t* aData, size_t aSize, bool aAdopted);
+    ~PixelBuffer() = default;
+
+    void destroy();
+
+private:
+    std::atomic<size_t> mReferencesCount;
+    std::shared_ptr<Allocator> mAllocator;
+    size_t mBlockSize;
+    uint8_t* mData;
+    size_t mSize;
+    bool mAdopted;
+}; // class PixelBuffer
+
+/**
+ * Owning reference to a PixelBuffer.
+ */
+class PixelBufferRef
+{
+public:
+    PixelBufferRef() noexcept
+    : mBuffer(nullptr)
+    {}
+
+    explicit PixelBufferRef(PixelBuffer* aBuffer) noexcept
+    : mBuffer(aBuffer)
+    {}
+
+    PixelBufferRef(const PixelBufferRef& aRef) noexcept
+    : mBuffer(aRef.mBuffer)
+    {
+        if (mBuffer)
+            mBuffer->retain();
+    }
+
+    PixelBufferRef(PixelBufferRef&& aRef) noexcept
+    : mBuffer(aRef.mBuffer)
+    {
+        aRef.mBuffer = nullptr;
+    }
+
+    ~PixelBufferRef()
+    {
+        if (mBuffer)
+            mBuffer->release();
+    }
+
+    PixelBufferRef& operator=(const PixelBufferRef& aRef) noexcept
+    {
+        PixelBufferRef(aRef).swap(*this);
+        return *this;
+    }
+
+    PixelBufferRef& operator=(PixelBufferRef&& aRef) noexcept
+    {
+        PixelBufferRef(std::move(aRef)).swap(*this);
+        return *this;
+    }
+
+    void swap(PixelBufferRef& aRef) noexcept
+    {
+        PixelBuffer* buffer = mBuffer;
+        mBuffer = aRef.mBuffer;
+        aRef.mBuffer = buffer;
+    }
+
+    PixelBuffer* get() const
+    {
+        return mBuffer;
+    }
+
+    PixelBuffer* operator->() const
+    {
+        return mBuffer;
+    }
+
+    explicit operator bool() const
+    {
+        return mBuffer != nullptr;
+    }
+
+private:
+    PixelBuffer* mBuffer;
+}; // class PixelBufferRef
+
+} // namespace ImgIO
+
+#endif // _PIXELBUFFER_H__
+// EOF
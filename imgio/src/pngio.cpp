@@ -25,9 +25,15 @@
 #include <iostream>
 #include <png.h>
 
+#include "convert.h"
 #include "dataio.h"
+#include "exif.h"
+#include "rowstream.h"
 
+#include <algorithm>
 #include <functional>
+#include <stdexcept>
+#include <vector>
 
 #define PNGSIGSIZE 8
 
@@ -44,237 +50,669 @@ static void pngWarningHandler(png_structp pngPtr, png_const_charp warningMsg)
 {
 }
 
+static bool isLittleEndian()
+{
+    const uint16_t value = 1;
+    return *reinterpret_cast<const uint8_t*>(&value) == 1;
+}
+
+// libpng reads chunk headers and checksums a few bytes at a time, they come
+// from the block of the reader without any virtual calls. Truncated data is
+// an error, libpng would go on with whatever is in its buffers.
 static void readDataHandler(png_structp pngPtr, png_bytep data, png_size_t length)
 {
-    reinterpret_cast<DataReader*>(png_get_io_ptr(pngPtr))->read(reinterpret_cast<uint8_t*>(data), length);
+    if (reinterpret_cast<BufferedReader*>(png_get_io_ptr(pngPtr))->read(reinterpret_cast<uint8_t*>(data), length) != length)
+        png_error(pngPtr, "unexpected end of data");
 }
 
 static void writeDataHandler(png_structp pngPtr, png_bytep data, png_size_t length)
 {
-    reinterpret_cast<DataWriter*>(png_get_io_ptr(pngPtr))->write(reinterpret_cast<uint8_t*>(data), length);
+    reinterpret_cast<BufferedWriter*>(png_get_io_ptr(pngPtr))->write(reinterpret_cast<uint8_t*>(data), length);
 }
 
 static void flushDataHandler(png_structp pngPtr)
 {
-    reinterpret_cast<DataWriter*>(png_get_io_ptr(pngPtr))->flush();
+    reinterpret_cast<BufferedWriter*>(png_get_io_ptr(pngPtr))->flush();
 }
 
-static Image readPng(DataReader& aDataReader,
-                     ColorSpec::Format aOutputImageformat,
-                     ColorSpec::ChannelDepth aOutputImageChannelDepth)
+/**
+ * libpng read structures, from the signature to the decoded row layout.
+ */
+class PngDecoder
 {
-    png_byte pngSig[PNGSIGSIZE];
+public:
+    PngDecoder(DataReader& aDataReader)
+    : mReader(aDataReader), mPng(nullptr), mInfo(nullptr)
+    {
+        png_byte pngSig[PNGSIGSIZE];
 
-    if ((aDataReader.read((uint8_t*)pngSig, PNGSIGSIZE) != PNGSIGSIZE) || (png_sig_cmp(pngSig, 0, PNGSIGSIZE) != 0)) {
-        throw std::logic_error("Not a PNG");
-    }
+        if ((mReader.read((uint8_t*)pngSig, PNGSIGSIZE) != PNGSIGSIZE) || (png_sig_cmp(pngSig, 0, PNGSIGSIZE) != 0)) {
+            throw std::logic_error("Not a PNG");
+        }
 
-    std::unique_ptr<png_struct, std::function<void(png_structp)>> pngImage(nullptr,
-       [](png_structp pngImagePtr) { png_destroy_read_struct(&pngImagePtr, nullptr, nullptr); });
-    {
-        png_structp pngImagePtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, errorHandler, pngWarningHandler);
-        if (!pngImagePtr) {
+        mPng = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, errorHandler, pngWarningHandler);
+        if (!mPng) {
             throw std::logic_error("PNG decoder internal error");
         }
-        pngImage.reset(pngImagePtr);
-    }
 
-    std::unique_ptr<png_info, std::function<void(png_infop)>> pngImageInfo(nullptr,
-                                                                           [](png_infop pngImageInfoPtr) { png_destroy_read_struct(nullptr, &pngImageInfoPtr, nullptr); });
-    {
-        png_infop pngImageInfoPtr = png_create_info_struct(pngImage.get());
-        if (!pngImageInfoPtr) {
+        mInfo = png_create_info_struct(mPng);
+        if (!mInfo) {
+            png_destroy_read_struct(&mPng, nullptr, nullptr);
             throw std::logic_error("Couldn't initialize png info struct");
         }
-        pngImageInfo.reset(pngImageInfoPtr);
+
+        png_set_read_fn(mPng,
+                        reinterpret_cast<png_voidp>(&mReader),
+                        readDataHandler);
+
+        try {
+            png_set_sig_bytes(mPng, PNGSIGSIZE);
+            png_read_info(mPng, mInfo);
+        } catch (...) {
+            png_destroy_read_struct(&mPng, &mInfo, nullptr);
+            throw;
+        }
     }
 
-    png_set_read_fn(pngImage.get(),
-                    reinterpret_cast<png_voidp>(&aDataReader),
-                    readDataHandler);
-
-    png_set_sig_bytes(pngImage.get(), PNGSIGSIZE);
-    png_read_info(pngImage.get(), pngImageInfo.get());
-
-    png_uint_32 pngImageWidth =  png_get_image_width(pngImage.get(), pngImageInfo.get());
-    png_uint_32 pngImageHeight = png_get_image_height(pngImage.get(), pngImageInfo.get());
-    png_uint_32 pngImageChannelDepth = png_get_bit_depth(pngImage.get(), pngImageInfo.get());
-    png_uint_32 pngImageChannels = png_get_channels(pngImage.get(), pngImageInfo.get());
-    png_uint_32 pngImageFormat = png_get_color_type(pngImage.get(), pngImageInfo.get());
-
-    switch (pngImageFormat) {
-        case PNG_COLOR_TYPE_PALETTE:
-            png_set_palette_to_rgb(pngImage.get());
-            pngImageChannels = 3;
-            break;
-        case PNG_COLOR_TYPE_GRAY:
-            if (pngImageChannelDepth < 8)
-                png_set_expand_gray_1_2_4_to_8(pngImage.get());
-            pngImageChannelDepth = 8;
-            break;
+    ~PngDecoder()
+    {
+        png_destroy_read_struct(&mPng, &mInfo, nullptr);
     }
 
-    // Convert transparent color to alpha channel
-    if (png_get_valid(pngImage.get(), pngImageInfo.get(), PNG_INFO_tRNS)) {
-        png_set_tRNS_to_alpha(pngImage.get());
-        pngImageChannels += 1;
+    /**
+     * Sets up the transformations giving rows closest to the given layout.
+     */
+    void setOutput(ColorSpec::Format aOutputImageformat,
+                   ColorSpec::ChannelDepth aOutputImageChannelDepth)
+    {
+        update(true, aOutputImageformat, aOutputImageChannelDepth);
     }
 
-    if ((pngImageChannelDepth == 16) && (aOutputImageChannelDepth == ColorSpec::ChannelDepth::k8Bit)) {
-        png_set_strip_16(pngImage.get());
+    /**
+     * Sets up the transformations keeping the channels and depth of the file.
+     */
+    void setOutput()
+    {
+        update(false, ColorSpec::Format::kRGBA, ColorSpec::ChannelDepth::k16Bit);
     }
 
-    if ((aOutputImageformat == ColorSpec::Format::kRGBA) && (pngImageFormat == PNG_COLOR_TYPE_RGB))
+    png_structp png() const
     {
-        png_set_add_alpha(pngImage.get(), 255, PNG_FILLER_AFTER);
-        pngImageFormat = PNG_COLOR_TYPE_RGBA;
-        pngImageChannels += 1;
+        return mPng;
     }
 
-    if ((aOutputImageformat == ColorSpec::Format::kRGB) && (pngImageFormat == PNG_COLOR_TYPE_RGBA))
+    unsigned int width() const
     {
-        png_set_strip_alpha(pngImage.get());
-        pngImageFormat = PNG_COLOR_TYPE_RGB;
-        pngImageChannels -= 1;
+        return png_get_image_width(mPng, mInfo);
     }
 
-    png_read_update_info(pngImage.get(), pngImageInfo.get());
+    unsigned int height() const
+    {
+        return png_get_image_height(mPng, mInfo);
+    }
 
-    std::unique_ptr<png_bytep> rowPtrs(new png_bytep[pngImageHeight]);
-    std::unique_ptr<uint8_t> data(new uint8_t[pngImageWidth * pngImageHeight * pngImageChannelDepth * pngImageChannels / 8]);
-    const unsigned int dataLineSize = pngImageWidth * pngImageChannelDepth * pngImageChannels / 8;
+    bool isInterlaced() const
+    {
+        return png_get_interlace_type(mPng, mInfo) != PNG_INTERLACE_NONE;
+    }
 
-    for (size_t i = 0; i < pngImageHeight; ++i) {
-        rowPtrs.get()[i] = static_cast<png_bytep>(data.get()) + i * dataLineSize;
+    bool isIndexed() const
+    {
+        return png_get_color_type(mPng, mInfo) == PNG_COLOR_TYPE_PALETTE;
     }
 
-    png_read_image(pngImage.get(), rowPtrs.get());
+    bool hasAlpha() const
+    {
+        return ((png_get_color_type(mPng, mInfo) & PNG_COLOR_MASK_ALPHA) != 0) ||
+               (png_get_valid(mPng, mInfo, PNG_INFO_tRNS) != 0);
+    }
 
-    return Image(pngImageWidth,
-                 pngImageHeight,
-                 aOutputImageformat,
-                 aOutputImageChannelDepth,
-                 data.release());
-}
+    /**
+     * Returns the PLTE colors with the tRNS alphas, empty for other color types.
+     */
+    Palette palette() const
+    {
+        Palette palette;
+        png_colorp colors = nullptr;
+        int colorsCount = 0;
+        if (!png_get_PLTE(mPng, mInfo, &colors, &colorsCount))
+            return palette;
+
+        png_bytep alphas = nullptr;
+        int alphasCount = 0;
+        png_get_tRNS(mPng, mInfo, &alphas, &alphasCount, nullptr);
+
+        for (int i = 0; i < colorsCount; ++i) {
+            png_byte alpha = (alphas && (i < alphasCount)) ? alphas[i] : 0xff;
+            palette.push_back(PaletteColor{colors[i].red, colors[i].green, colors[i].blue, alpha});
+        }
+        return palette;
+    }
 
-static void writePng(DataWriter& aDataWriter,
-                     Image& aImage)
-{
-    std::unique_ptr<png_struct, std::function<void(png_structp)>> pngImage(nullptr,
-                                                                           [](png_structp pngImagePtr) { png_destroy_write_struct(&pngImagePtr, nullptr); });
+    /**
+     * Reads the chunks after the image data, eXIf may be among them.
+     */
+    void readEnd()
     {
-        png_structp pngImagePtr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, errorHandler, pngWarningHandler);
-        if (!pngImagePtr) {
-            throw std::logic_error("PNG decoder internal error");
+        png_read_end(mPng, mInfo);
+    }
+
+    /**
+     * Returns the orientation from the eXIf chunk, kTopLeft without one.
+     */
+    Image::Orientation orientation() const
+    {
+#ifdef PNG_eXIf_SUPPORTED
+        png_uint_32 length = 0;
+        png_bytep exif = nullptr;
+        if (png_get_eXIf_1(mPng, mInfo, &length, &exif) && exif)
+            return exifOrientation(exif, length);
+#endif // PNG_eXIf_SUPPORTED
+        return Image::Orientation::kTopLeft;
+    }
+
+    size_t rowBytes() const
+    {
+        return png_get_rowbytes(mPng, mInfo);
+    }
+
+    ColorSpec::Format colorFormat() const
+    {
+        return mColorFormat;
+    }
+
+    ColorSpec::ChannelDepth colorChannelDepth() const
+    {
+        return mColorChannelDepth;
+    }
+
+private:
+    PngDecoder(const PngDecoder&) = delete;
+    PngDecoder& operator=(const PngDecoder&) = delete;
+
+    void update(bool aAdjustFormat,
+                ColorSpec::Format aOutputImageformat,
+                ColorSpec::ChannelDepth aOutputImageChannelDepth)
+    {
+        png_uint_32 pngImageChannelDepth = png_get_bit_depth(mPng, mInfo);
+        png_uint_32 pngImageFormat = png_get_color_type(mPng, mInfo);
+
+        // Indices are kept as they are, one per byte
+        if (aAdjustFormat && (aOutputImageformat == ColorSpec::Format::kIndexed) && (pngImageFormat == PNG_COLOR_TYPE_PALETTE)) {
+            if (pngImageChannelDepth < 8)
+                png_set_packing(mPng);
+            png_set_interlace_handling(mPng);
+            png_read_update_info(mPng, mInfo);
+            mColorFormat = ColorSpec::Format::kIndexed;
+            mColorChannelDepth = ColorSpec::ChannelDepth::k8Bit;
+            return;
+        }
+
+        switch (pngImageFormat) {
+            case PNG_COLOR_TYPE_PALETTE:
+                png_set_palette_to_rgb(mPng);
+                pngImageChannelDepth = 8;
+                break;
+            case PNG_COLOR_TYPE_GRAY:
+                if (pngImageChannelDepth < 8) {
+                    png_set_expand_gray_1_2_4_to_8(mPng);
+                    pngImageChannelDepth = 8;
+                }
+                break;
+        }
+
+        // Convert transparent color to alpha channel
+        bool pngHasAlpha = (pngImageFormat & PNG_COLOR_MASK_ALPHA) != 0;
+        if (png_get_valid(mPng, mInfo, PNG_INFO_tRNS)) {
+            png_set_tRNS_to_alpha(mPng);
+            pngHasAlpha = true;
+        }
+
+        bool pngIsGray = (pngImageFormat & PNG_COLOR_MASK_COLOR) == 0;
+        bool outputIsGray = (aOutputImageformat == ColorSpec::Format::kMonochromatic) ||
+                            (aOutputImageformat == ColorSpec::Format::kMonochromaticAlpha);
+        bool outputHasAlpha = (aOutputImageformat == ColorSpec::Format::kMonochromaticAlpha) ||
+                              (aOutputImageformat == ColorSpec::Format::kRGBA) ||
+                              (aOutputImageformat == ColorSpec::Format::kRGBAPremultiplied);
+
+        // Luma is computed from the full samples, as by convertRow()
+        bool keep16 = aAdjustFormat && outputIsGray && !pngIsGray;
+        if ((pngImageChannelDepth == 16) && (aOutputImageChannelDepth == ColorSpec::ChannelDepth::k8Bit) && !keep16) {
+            png_set_strip_16(mPng);
+            pngImageChannelDepth = 8;
+        }
+
+        if (aAdjustFormat) {
+            // Gray is replicated the same way as by convertRow(), luma is left to it
+            if (pngIsGray && !outputIsGray)
+                png_set_gray_to_rgb(mPng);
+
+            if (outputHasAlpha && !pngHasAlpha)
+                png_set_add_alpha(mPng, (pngImageChannelDepth == 16) ? 0xffff : 0xff, PNG_FILLER_AFTER);
+
+            if (!outputHasAlpha && pngHasAlpha)
+                png_set_strip_alpha(mPng);
+        }
+
+        // Images keep 16 bit samples in native byte order
+        if (isLittleEndian())
+            png_set_swap(mPng);
+
+        png_set_interlace_handling(mPng);
+        png_read_update_info(mPng, mInfo);
+
+        switch (png_get_channels(mPng, mInfo)) {
+            case 1:
+                mColorFormat = ColorSpec::Format::kMonochromatic;
+                break;
+            case 2:
+                mColorFormat = ColorSpec::Format::kMonochromaticAlpha;
+                break;
+            case 3:
+                mColorFormat = ColorSpec::Format::kRGB;
+                break;
+            case 4:
+                mColorFormat = ColorSpec::Format::kRGBA;
+                break;
+            default:
+                throw UnsupportedImageFormatException("Unsupported PNG color type");
         }
-        pngImage.reset(pngImagePtr);
+        mColorChannelDepth = (png_get_bit_depth(mPng, mInfo) == 16)
+                             ? ColorSpec::ChannelDepth::k16Bit
+                             : ColorSpec::ChannelDepth::k8Bit;
     }
 
-    std::unique_ptr<png_info, std::function<void(png_infop)>> pngImageInfo(nullptr,
-                                                                           [](png_infop pngImageInfoPtr) { png_destroy_write_struct(nullptr, &pngImageInfoPtr); });
+private:
+    BufferedReader mReader;
+    png_structp mPng;
+    png_infop mInfo;
+    ColorSpec::Format mColorFormat;
+    ColorSpec::ChannelDepth mColorChannelDepth;
+}; // class PngDecoder
+
+/**
+ * Row sink writing a PNG file.
+ */
+class PngEncoder : public RowSink
+{
+public:
+    PngEncoder(DataWriter& aDataWriter)
+    : mWriter(aDataWriter), mPng(nullptr), mInfo(nullptr), mUnpremultiply(nullptr), mPixelsCount(0), mPalette()
     {
-        png_infop pngImageInfoPtr = png_create_info_struct(pngImage.get());
-        if (!pngImageInfoPtr) {
+        mPng = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, errorHandler, pngWarningHandler);
+        if (!mPng) {
+            throw std::logic_error("PNG decoder internal error");
+        }
+
+        mInfo = png_create_info_struct(mPng);
+        if (!mInfo) {
+            png_destroy_write_struct(&mPng, nullptr);
             throw std::logic_error("Couldn't initialize png info struct");
         }
-        pngImageInfo.reset(pngImageInfoPtr);
+
+        png_set_write_fn(mPng,
+                        reinterpret_cast<png_voidp>(&mWriter),
+                        writeDataHandler,
+                        flushDataHandler);
+    }
+
+    ~PngEncoder()
+    {
+        png_destroy_write_struct(&mPng, &mInfo);
+    }
+
+    /**
+     * Sets the PLTE and tRNS colors of kIndexed rows, it has to cover their
+     * indices. Without one, indices are opaque black.
+     */
+    void setPalette(const Palette& aPalette)
+    {
+        mPalette = aPalette;
     }
 
-    png_set_write_fn(pngImage.get(),
-                    reinterpret_cast<png_voidp>(&aDataWriter),
-                    writeDataHandler,
-                    flushDataHandler);
+    void start(unsigned int aWidth,
+               unsigned int aHeight,
+               ColorSpec::Format aColorFormat,
+               ColorSpec::ChannelDepth aColorChannelDepth)
+    {
+        int pngBitDepth = 0;
+        int pngColorType = 0;
+
+        switch(aColorChannelDepth)
+        {
+            case ColorSpec::ChannelDepth::k8Bit:
+                pngBitDepth = 8;
+                break;
+            case ColorSpec::ChannelDepth::k16Bit:
+                pngBitDepth = 16;
+                break;
+            default:
+                throw std::logic_error("Unsupported bit depth");
+                break;
+        }
+
+        switch(aColorFormat)
+        {
+            case ColorSpec::Format::kMonochromatic:
+                pngColorType = PNG_COLOR_TYPE_GRAY;
+                break;
+            case ColorSpec::Format::kMonochromaticAlpha:
+                pngColorType = PNG_COLOR_TYPE_GRAY_ALPHA;
+                break;
+            case ColorSpec::Format::kRGB:
+                pngColorType = PNG_COLOR_TYPE_RGB;
+                break;
+            case ColorSpec::Format::kRGBA:
+                pngColorType = PNG_COLOR_TYPE_RGBA;
+                break;
+            case ColorSpec::Format::kIndexed:
+                // Small palettes are written with packed indices
+                pngColorType = PNG_COLOR_TYPE_PALETTE;
+                if (mPalette.empty())
+                    mPalette.assign(256, PaletteColor{0, 0, 0, 0xff});
+                else if (mPalette.size() > 256)
+                    throw std::logic_error("Palette has over 256 colors");
+                pngBitDepth = (mPalette.size() <= 2) ? 1 : (mPalette.size() <= 4) ? 2 : (mPalette.size() <= 16) ? 4 : 8;
+                break;
+            case ColorSpec::Format::kRGBAPremultiplied:
+                // PNG alpha is straight, rows are divided into a scratch row
+                pngColorType = PNG_COLOR_TYPE_RGBA;
+                mUnpremultiply = convertFunction(aColorFormat, aColorChannelDepth,
+                                                 ColorSpec::Format::kRGBA, aColorChannelDepth);
+                mPixelsCount = aWidth;
+                mRow.reset(new uint8_t[ColorSpec::pixelSize(aColorFormat, aColorChannelDepth) * aWidth]);
+                break;
+            default:
+                throw std::logic_error("Unsupported image colorFormat");
+                break;
+        }
+
+        png_set_IHDR(mPng,
+                     mInfo,
+                     aWidth,
+                     aHeight,
+                     pngBitDepth,
+                     pngColorType,
+                     PNG_INTERLACE_NONE,
+                     PNG_COMPRESSION_TYPE_BASE,
+                     PNG_FILTER_TYPE_BASE);
+
+        if (pngColorType == PNG_COLOR_TYPE_PALETTE)
+            setPaletteChunks();
+
+        png_text softwareText;
+        softwareText.compression = PNG_TEXT_COMPRESSION_NONE;
+        softwareText.key = const_cast<png_charp>("Software");
+        softwareText.text = const_cast<png_charp>("imgio");
+        png_set_text(mPng,
+                     mInfo,
+                     &softwareText, 1);
+
+        png_write_info(mPng, mInfo);
+
+        if ((pngBitDepth == 16) && isLittleEndian())
+            png_set_swap(mPng);
+        if (pngBitDepth < 8)
+            png_set_packing(mPng);
+    }
 
-    int pngBitDepth = 0;
-    int pngColorType = 0;
+    void push(const uint8_t* aRow)
+    {
+        if (mUnpremultiply) {
+            mUnpremultiply(aRow, mRow.get(), mPixelsCount);
+            aRow = mRow.get();
+        }
+        png_write_row(mPng, aRow);
+    }
 
-    switch(aImage.colorChannelDepth())
+    void finish()
     {
-        case ColorSpec::ChannelDepth::k8Bit:
-            pngBitDepth = 8;
-            break;
-        case ColorSpec::ChannelDepth::k16Bit:
-            pngBitDepth = 16;
-            break;
-        default:
-            throw std::logic_error("Unsupported bit depth");
-            break;
+        png_write_end(mPng, NULL);
+        mWriter.flush();
     }
 
-    switch(aImage.colorFormat())
+private:
+    PngEncoder(const PngEncoder&) = delete;
+    PngEncoder& operator=(const PngEncoder&) = delete;
+
+    void setPaletteChunks()
     {
-        case ColorSpec::Format::kRGB:
-            pngColorType = PNG_COLOR_TYPE_RGB;
-            break;
-        case ColorSpec::Format::kRGBA:
-            pngColorType = PNG_COLOR_TYPE_RGBA;
-            break;
-        default:
-            throw std::logic_error("Unsupported image colorFormat");
-            break;
+        std::vector<png_color> colors(mPalette.size());
+        std::vector<png_byte> alphas(mPalette.size());
+        size_t alphasCount = 0;
+        for (size_t i = 0; i < mPalette.size(); ++i) {
+            colors[i].red = mPalette[i].r;
+            colors[i].green = mPalette[i].g;
+            colors[i].blue = mPalette[i].b;
+            alphas[i] = mPalette[i].a;
+            if (alphas[i] != 0xff)
+                alphasCount = i + 1;
+        }
+
+        png_set_PLTE(mPng, mInfo, colors.data(), static_cast<int>(colors.size()));
+
+        // Opaque entries after the last transparent one are left out of tRNS
+        if (alphasCount > 0)
+            png_set_tRNS(mPng, mInfo, alphas.data(), static_cast<int>(alphasCount), nullptr);
+    }
+
+private:
+    BufferedWriter mWriter;
+    png_structp mPng;
+    png_infop mInfo;
+    ConvertFunction mUnpremultiply;
+    size_t mPixelsCount;
+    std::unique_ptr<uint8_t[]> mRow;
+    Palette mPalette;
+}; // class PngEncoder
+
+static Image readPng(DataReader& aDataReader,
+                     ColorSpec::Format aOutputImageformat,
+                     ColorSpec::ChannelDepth aOutputImageChannelDepth,
+                     bool aApplyOrientation,
+                     bool aDropOpaqueAlpha)
+{
+    PngDecoder decoder(aDataReader);
+
+    // Files without any alpha are decoded without it straight away
+    if (aDropOpaqueAlpha && !decoder.hasAlpha())
+        aOutputImageformat = ColorSpec::opaqueFormat(aOutputImageformat);
+
+    // Palette images are decoded as indices, colors are looked up afterwards
+    // only for other output formats
+    if (decoder.isIndexed())
+        decoder.setOutput(ColorSpec::Format::kIndexed, ColorSpec::ChannelDepth::k8Bit);
+    else if (aOutputImageformat == ColorSpec::Format::kIndexed)
+        throw NotImplementedException("Conversion to indexed is not supported");
+    else
+        decoder.setOutput(aOutputImageformat, aOutputImageChannelDepth);
+
+    // Decode straight into the (padded) rows of the image
+    Image image(decoder.width(), decoder.height(), decoder.colorFormat(), decoder.colorChannelDepth());
+    if (decoder.isIndexed())
+        image.setPalette(decoder.palette());
+
+    std::unique_ptr<png_bytep[]> rowPtrs(new png_bytep[decoder.height()]);
+    uint8_t* row = image.data();
+    for (size_t i = 0; i < decoder.height(); ++i, row += image.stride()) {
+        rowPtrs[i] = static_cast<png_bytep>(row);
+    }
+
+    png_read_image(decoder.png(), rowPtrs.get());
+
+    // Alpha that turns out to be at its maximum everywhere is dropped, with
+    // the conversion below, which shrinks the pixels in place
+    if (aDropOpaqueAlpha && (ColorSpec::opaqueFormat(aOutputImageformat) != aOutputImageformat) && image.isOpaque())
+        aOutputImageformat = ColorSpec::opaqueFormat(aOutputImageformat);
+
+    // Premultiplied output keeps the buffer, other layouts libpng couldn't produce may grow it
+    if ((decoder.colorFormat() != aOutputImageformat) || (decoder.colorChannelDepth() != aOutputImageChannelDepth))
+        image.convertInPlace(aOutputImageformat, aOutputImageChannelDepth);
+
+    // Reading up to IEND leaves a stream right after the image. eXIf may
+    // follow the image data, so rows can't be placed while decoding.
+    decoder.readEnd();
+    if (aApplyOrientation) {
+        Image::Orientation orientation = decoder.orientation();
+        if (orientation != Image::Orientation::kTopLeft)
+            image = image.oriented(orientation);
+    }
+
+    return image;
+}
+
+static void writePng(DataWriter& aDataWriter,
+                     const Image& aImage)
+{
+    PngEncoder encoder(aDataWriter);
+
+    // PLTE has to cover all the indices, missing entries are opaque black
+    if (aImage.colorFormat() == ColorSpec::Format::kIndexed) {
+        Palette palette = aImage.palette();
+        if ((palette.size() < 256) && (aImage.width() > 0)) {
+            uint8_t maxIndex = 0;
+            for (size_t y = 0; y < aImage.height(); ++y) {
+                const uint8_t* row = aImage.data() + y * aImage.stride();
+                maxIndex = std::max(maxIndex, *std::max_element(row, row + aImage.width()));
+            }
+            if (maxIndex >= palette.size())
+                palette.resize(maxIndex + 1, PaletteColor{0, 0, 0, 0xff});
+        }
+        encoder.setPalette(palette);
     }
 
-    png_set_IHDR(pngImage.get(),
-                 pngImageInfo.get(),
-                 aImage.width(),
-                 aImage.height(),
-                 pngBitDepth,
-                 pngColorType,
-                 PNG_INTERLACE_NONE,
-                 PNG_COMPRESSION_TYPE_BASE,
-                 PNG_FILTER_TYPE_BASE);
-
-    png_text softwareText;
-    softwareText.compression = PNG_TEXT_COMPRESSION_NONE;
-    softwareText.key = const_cast<png_charp>("Software");
-    softwareText.text = const_cast<png_charp>("imgio");
-    png_set_text(pngImage.get(),
-                 pngImageInfo.get(),
-                 &softwareText, 1);
-
-    png_write_info(pngImage.get(), pngImageInfo.get());
-
-    uint8_t* row = aImage.data();
-    size_t rowLength = aImage.width() * static_cast<int>(aImage.colorFormat()) * static_cast<int>(aImage.colorChannelDepth());
+    encoder.start(aImage.width(), aImage.height(), aImage.colorFormat(), aImage.colorChannelDepth());
+
+    const uint8_t* row = aImage.data();
     for (size_t y = 0 ; y < aImage.height() ; ++y) {
-        png_write_row(pngImage.get(), row);
-        row += rowLength;
+        encoder.push(row);
+        row += aImage.stride();
     }
 
-    png_write_end(pngImage.get(), NULL);
+    encoder.finish();
 }
 
 Image PngIO::read(std::istream& aPngDataStream,
                   ColorSpec::Format aOutputImageformat,
-                  ColorSpec::ChannelDepth aOutputImageChannelDepth)
+                  ColorSpec::ChannelDepth aOutputImageChannelDepth,
+                  bool aApplyOrientation,
+                  bool aDropOpaqueAlpha)
 {
     StreamReader streamReader(aPngDataStream);
     return readPng(streamReader,
                    aOutputImageformat,
-                   aOutputImageChannelDepth);
+                   aOutputImageChannelDepth,
+                   aApplyOrientation,
+                   aDropOpaqueAlpha);
 }
 
 Image PngIO::read(const uint8_t* aData,
                   size_t aLength,
                   ColorSpec::Format aOutputImageformat,
-                  ColorSpec::ChannelDepth aOutputImageChannelDepth)
+                  ColorSpec::ChannelDepth aOutputImageChannelDepth,
+                  bool aApplyOrientation,
+                  bool aDropOpaqueAlpha)
 {
     MemoryReader memoryReader(aData, aLength);
     return readPng(memoryReader,
                    aOutputImageformat,
-                   aOutputImageChannelDepth);
+                   aOutputImageChannelDepth,
+                   aApplyOrientation,
+                   aDropOpaqueAlpha);
 }
 
-void PngIO::write(Image& aImage, std::ostream& aPngDataStream)
+void PngIO::write(const Image& aImage, std::ostream& aPngDataStream)
 {
     StreamWriter streamWriter(aPngDataStream);
     writePng(streamWriter, aImage);
 }
 
-void PngIO::write(Image& aImage, uint8_t* aData, size_t aLength)
+void PngIO::write(const Image& aImage, DataWriter& aDataWriter)
 {
-    MemoryWriter streamWriter(aData, aLength);
-    writePng(streamWriter, aImage);
+    writePng(aDataWriter, aImage);
+}
+
+size_t PngIO::write(const Image& aImage, uint8_t* aData, size_t aLength)
+{
+    MemoryWriter memoryWriter(aData, aLength);
+    writePng(memoryWriter, aImage);
+    if (memoryWriter.isTruncated())
+        throw std::length_error("PNG data doesn't fit into the output buffer");
+    return memoryWriter.bytesWritten();
+}
+
+size_t PngIO::maxEncodedSize(const Image& aImage)
+{
+    // Filter byte and samples of each row, premultiplied rows are written
+    // straight and indices take a byte at most
+    size_t rowSize = 1 + ColorSpec::pixelSize(aImage.colorFormat(), aImage.colorChannelDepth()) * aImage.width();
+    size_t dataSize = rowSize * aImage.height();
+
+    // deflateBound() for windows below the default one, which libpng picks
+    // for small images, with the zlib header and checksum
+    size_t zlibSize = dataSize + ((dataSize + 7) >> 3) + ((dataSize + 63) >> 6) + 5 + 6;
+
+    // IDAT chunks are flushed from the compression buffer, the signature,
+    // IHDR, tEXt and IEND come with every image
+    size_t size = zlibSize + 12 * (zlibSize / PNG_ZBUF_SIZE + 1) + 8 + 25 + 26 + 12;
+    if (aImage.colorFormat() == ColorSpec::Format::kIndexed)
+        size += (12 + 3 * 256) + (12 + 256);
+    return size;
+}
+
+void PngIO::readRows(DataReader& aDataReader,
+                     const DecodeHints& aHints,
+                     RowSink& aSink)
+{
+    PngDecoder decoder(aDataReader);
+    decoder.setOutput();
+
+    unsigned int x, y, width, height;
+    clipWindow(aHints, decoder.width(), decoder.height(), x, y, width, height);
+
+    aSink.start(width, height, decoder.colorFormat(), decoder.colorChannelDepth());
+    if ((width == 0) || (height == 0)) {
+        decoder.readEnd();
+        aSink.finish();
+        return;
+    }
+
+    size_t offset = x * ColorSpec::pixelSize(decoder.colorFormat(), decoder.colorChannelDepth());
+
+    if (decoder.isInterlaced()) {
+        // Rows of interlaced images are complete only after the last pass
+        Image image(decoder.width(), height, decoder.colorFormat(), decoder.colorChannelDepth());
+        std::unique_ptr<png_bytep[]> rowPtrs(new png_bytep[decoder.height()]);
+        std::unique_ptr<uint8_t[]> skippedRow(new uint8_t[decoder.rowBytes()]);
+        for (size_t i = 0; i < decoder.height(); ++i) {
+            rowPtrs[i] = ((i >= y) && (i < (y + height)))
+                         ? static_cast<png_bytep>(image.data() + (i - y) * image.stride())
+                         : skippedRow.get();
+        }
+
+        png_read_image(decoder.png(), rowPtrs.get());
+
+        for (size_t i = y; i < (y + height); ++i)
+            aSink.push(rowPtrs[i] + offset);
+    } else {
+        // Rows above the window still have to be inflated, rows below are
+        // only inflated by readEnd(), without unfiltering
+        std::unique_ptr<uint8_t[]> row(new uint8_t[decoder.rowBytes()]);
+        for (size_t i = 0; i < (y + height); ++i) {
+            png_read_row(decoder.png(), row.get(), nullptr);
+            if (i >= y)
+                aSink.push(row.get() + offset);
+        }
+    }
+
+    // Reading up to IEND leaves a stream right after the image
+    decoder.readEnd();
+    aSink.finish();
+}
+
+std::unique_ptr<RowSink> PngIO::rowWriter(DataWriter& aDataWriter)
+{
+    return std::unique_ptr<RowSink>(new PngEncoder(aDataWriter));
 }
 
 } // namespace ImgIO
@@ -24,26 +24,66 @@
 #ifndef _PNGIO_H__
 #define _PNGIO_H__
 
+#include <memory>
 #include <imgio/image.h>
 
 namespace ImgIO
 {
 
+class DataReader;
+class DataWriter;
+class RowSink;
+struct DecodeHints;
+
 class PngIO
 {
 public:
+    /**
+     * Decodes a PNG file. With aDropOpaqueAlpha set, images whose alpha is
+     * at its maximum everywhere, or missing, come without alpha.
+     */
     static Image read(std::istream& aPngDataStream,
                       ColorSpec::Format aOutputImageformat = ColorSpec::Format::kRGBA,
-                      ColorSpec::ChannelDepth aOutputImageChannelDepth = ColorSpec::ChannelDepth::k8Bit);
+                      ColorSpec::ChannelDepth aOutputImageChannelDepth = ColorSpec::ChannelDepth::k8Bit,
+                      bool aApplyOrientation = false,
+                      bool aDropOpaqueAlpha = false);
     static Image read(const uint8_t* aData,
                       size_t aLength,
                       ColorSpec::Format aOutputImageformat = ColorSpec::Format::kRGBA,
-                      ColorSpec::ChannelDepth aOutputImageChannelDepth = ColorSpec::ChannelDepth::k8Bit);
-    static void write(Image& aImage,
+                      ColorSpec::ChannelDepth aOutputImageChannelDepth = ColorSpec::ChannelDepth::k8Bit,
+                      bool aApplyOrientation = false,
+                      bool aDropOpaqueAlpha = false);
+    static void write(const Image& aImage,
                       std::ostream& aPngDataStream);
-    static void write(Image& aImage,
-                      uint8_t* aData,
-                      size_t aLength);
+    static void write(const Image& aImage,
+                      DataWriter& aDataWriter);
+
+    /**
+     * Encodes into aData and returns the number of bytes written. Throws
+     * std::length_error when they don't fit into aLength.
+     */
+    static size_t write(const Image& aImage,
+                        uint8_t* aData,
+                        size_t aLength);
+
+    /**
+     * Returns an upper bound of the size of aImage encoded by write().
+     */
+    static size_t maxEncodedSize(const Image& aImage);
+
+    /**
+     * Decodes the window of aHints row by row into aSink, keeping the
+     * channels and depth of the file, palette images come as RGB(A).
+     * Decoding stops after the window.
+     */
+    static void readRows(DataReader& aDataReader,
+                         const DecodeHints& aHints,
+                         RowSink& aSink);
+
+    /**
+     * Returns a row sink encoding the rows it gets into aDataWriter.
+     */
+    static std::unique_ptr<RowSink> rowWriter(DataWriter& aDataWriter);
 }; // class PngIO
 
 } // namespace ImgIO
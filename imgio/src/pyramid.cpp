@@ -0,0 +1,476 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <imgio/pyramid.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "dataio.h"
+#include "downsample.h"
+#include "palette.h"
+#include "rowstream.h"
+#include "threadpool.h"
+
+#ifdef PNGIO_ENABLED
+#include "pngio.h"
+#endif // PNGIO_ENABLED
+
+#ifdef JPEGIO_ENABLED
+#include "jpegio.h"
+#endif // JPEGIO_ENABLED
+
+namespace ImgIO
+{
+
+DownsampleFunction downsampleFunction(ColorSpec::Format aFormat, ColorSpec::ChannelDepth aChannelDepth)
+{
+    bool is16Bit = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+    if (aFormat == ColorSpec::Format::kRGBA)
+        return is16Bit ? downsampleStraightRow<uint16_t> : downsampleStraightRow<uint8_t>;
+    if (aFormat == ColorSpec::Format::kIndexed)
+        return nullptr;
+
+    size_t channels = ColorSpec::channelCount(aFormat);
+    DownsampleFunction function = simdDownsampleFunction(Simd::level(), channels, aChannelDepth);
+    if (function)
+        return function;
+
+    switch (channels) {
+    case 1:
+        return is16Bit ? downsampleRow<uint16_t, 1> : downsampleRow<uint8_t, 1>;
+    case 2:
+        return is16Bit ? downsampleRow<uint16_t, 2> : downsampleRow<uint8_t, 2>;
+    case 3:
+        return is16Bit ? downsampleRow<uint16_t, 3> : downsampleRow<uint8_t, 3>;
+    case 4:
+        return is16Bit ? downsampleRow<uint16_t, 4> : downsampleRow<uint8_t, 4>;
+    default:
+        return nullptr;
+    }
+}
+
+namespace
+{
+
+// Encoding costs far more than copying, rows of tiles this large in bytes
+// are worth spreading over threads.
+const size_t kEncodingCostFactor = 64;
+
+class VectorWriter : public DataWriter
+{
+public:
+    VectorWriter(std::vector<uint8_t>& aData)
+    : mData(aData)
+    {}
+
+    size_t write(const uint8_t* aData, size_t aLength)
+    {
+        mData.insert(mData.end(), aData, aData + aLength);
+        return aLength;
+    }
+
+    void flush()
+    {
+    }
+
+private:
+    std::vector<uint8_t>& mData;
+}; // class VectorWriter
+
+void encodeTile(const Image& aTile, ImageIO::ImageFormat aFormat, std::vector<uint8_t>& aData)
+{
+    VectorWriter writer(aData);
+    std::unique_ptr<RowSink> encoder;
+    switch (aFormat) {
+#ifdef PNGIO_ENABLED
+    case ImageIO::ImageFormat::kPng:
+        // Indexed tiles go through PngIO::write(), which writes their palette
+        if (aTile.colorFormat() == ColorSpec::Format::kIndexed) {
+            std::ostringstream stream;
+            PngIO::write(aTile, stream);
+            std::string data = stream.str();
+            aData.assign(data.begin(), data.end());
+            return;
+        }
+        encoder = PngIO::rowWriter(writer);
+        break;
+#endif // PNGIO_ENABLED
+#ifdef JPEGIO_ENABLED
+    case ImageIO::ImageFormat::kJpeg:
+        encoder = JpegIO::rowWriter(writer);
+        break;
+#endif // JPEGIO_ENABLED
+    default:
+        throw UnsupportedImageFormatException("Unsupported image format");
+    }
+
+    encoder->start(aTile.width(), aTile.height(), aTile.colorFormat(), aTile.colorChannelDepth());
+    for (unsigned int y = 0; y < aTile.height(); ++y)
+        encoder->push(aTile.data() + y * aTile.stride());
+    encoder->finish();
+}
+
+/**
+ * Row sink turning the rows of an image into the tiles of its pyramid.
+ *
+ * Each level keeps a strip of its rows, one tile row and the overlaps
+ * high. Every second row of a level is averaged with the one before it
+ * straight into the strip of the next level. Once a level has the last row
+ * of a row of tiles, they are cut from the strip and passed on, the rows
+ * the next row of tiles shares are moved to the top of the strip before
+ * it's written again.
+ */
+class PyramidBuilder : public RowSink
+{
+public:
+    /**
+     * Takes the tiles of row aRow of level aLevel, left to right.
+     */
+    typedef std::function<void(unsigned int aLevel, unsigned int aRow, std::vector<Image>& aTiles)> TileRowFunction;
+
+public:
+    PyramidBuilder(unsigned int aTileSize, unsigned int aOverlap, const TileRowFunction& aTileRowFunction)
+    : mTileSize(aTileSize),
+      mOverlap(aOverlap),
+      mTileRowFunction(aTileRowFunction),
+      mSource(nullptr)
+    {}
+
+    /**
+     * Rows of level 0 are then taken from aImage, its tiles are views of it.
+     */
+    void setSource(const Image* aImage)
+    {
+        mSource = aImage;
+    }
+
+    void start(unsigned int aWidth,
+               unsigned int aHeight,
+               ColorSpec::Format aColorFormat,
+               ColorSpec::ChannelDepth aColorChannelDepth)
+    {
+        mLevels.clear();
+        mLevels.resize(TilePyramid::levelsCount(aWidth, aHeight));
+        unsigned int stripHeight = mTileSize + 2 * mOverlap;
+
+        for (size_t i = 0; i < mLevels.size(); ++i) {
+            Level& level = mLevels[i];
+            level.width = aWidth;
+            level.height = aHeight;
+            level.format = aColorFormat;
+            level.depth = aColorChannelDepth;
+            level.rowSize = aWidth * ColorSpec::pixelSize(aColorFormat, aColorChannelDepth);
+            if ((i > 0) || !mSource)
+                level.strip = Image(aWidth, std::min(stripHeight, aHeight), aColorFormat, aColorChannelDepth);
+
+            if (i + 1 == mLevels.size())
+                break;
+
+            // Indexed rows are expanded before they are averaged
+            if (aColorFormat == ColorSpec::Format::kIndexed) {
+                if (!mSource)
+                    throw NotImplementedException("Not implemented.");
+                const Palette& palette = mSource->palette();
+                bool opaque = std::all_of(palette.begin(), palette.end(), [](const PaletteColor& aColor) {
+                    return aColor.a == 0xff;
+                });
+                aColorFormat = opaque ? ColorSpec::Format::kRGB : ColorSpec::Format::kRGBA;
+                level.palette.reset(new PaletteTable(palette, aColorFormat, aColorChannelDepth));
+                for (std::vector<uint8_t>& row : level.expandedRows)
+                    row.resize(aWidth * ColorSpec::pixelSize(aColorFormat, aColorChannelDepth));
+            }
+
+            level.downsample = downsampleFunction(aColorFormat, aColorChannelDepth);
+            if (!level.downsample)
+                throw NotImplementedException("Not implemented.");
+
+            aWidth = (aWidth + 1) / 2;
+            aHeight = (aHeight + 1) / 2;
+        }
+    }
+
+    void push(const uint8_t* aRow)
+    {
+        if (mLevels.empty())
+            return;
+
+        Level& level = mLevels[0];
+        if (!mSource) {
+            uint8_t* row = rowSlot(level);
+            std::memcpy(row, aRow, level.rowSize);
+            aRow = row;
+        }
+        commitRow(0, aRow);
+    }
+
+    void finish()
+    {
+    }
+
+private:
+    struct Level
+    {
+        Level()
+        : width(0), height(0), format(ColorSpec::Format::kRGBA), depth(ColorSpec::ChannelDepth::k8Bit),
+          rowSize(0), stripY(0), rowsCount(0), tileRow(0), unpaired(nullptr), downsample(nullptr)
+        {}
+
+        unsigned int width;
+        unsigned int height;
+        ColorSpec::Format format;
+        ColorSpec::ChannelDepth depth;
+        size_t rowSize;
+
+        // Strip holding rows [stripY, rowsCount), none for a source level
+        Image strip;
+        unsigned int stripY;
+        unsigned int rowsCount;
+        unsigned int tileRow;
+
+        // Even row waiting for the next one
+        const uint8_t* unpaired;
+        std::vector<uint8_t> pending;
+
+        DownsampleFunction downsample;
+        std::unique_ptr<PaletteTable> palette;
+        std::vector<uint8_t> expandedRows[2];
+    };
+
+private:
+    // Returns where the next row of a strip level goes.
+    uint8_t* rowSlot(Level& aLevel)
+    {
+        if (aLevel.rowsCount - aLevel.stripY == aLevel.strip.height()) {
+            // The strip is full only once its row of tiles is passed on,
+            // the next one starts mOverlap rows above its first row
+            unsigned int keepY = aLevel.tileRow * mTileSize - mOverlap;
+            uint8_t* strip = aLevel.strip.data();
+            size_t stride = aLevel.strip.stride();
+
+            for (unsigned int y = keepY; y < aLevel.rowsCount; ++y)
+                std::memcpy(strip + (y - keepY) * stride, strip + (y - aLevel.stripY) * stride, aLevel.rowSize);
+            aLevel.stripY = keepY;
+        }
+        return aLevel.strip.data() + (aLevel.rowsCount - aLevel.stripY) * aLevel.strip.stride();
+    }
+
+    void commitRow(size_t aLevel, const uint8_t* aRow)
+    {
+        Level& level = mLevels[aLevel];
+        unsigned int y = level.rowsCount++;
+
+        // The last rows of tiles may end together, within the overlap
+        unsigned int tileRows = (level.height + mTileSize - 1) / mTileSize;
+        while ((level.tileRow < tileRows) &&
+               (level.rowsCount == std::min((level.tileRow + 1) * mTileSize + mOverlap, level.height))) {
+            passTileRow(aLevel);
+            ++level.tileRow;
+        }
+
+        if (aLevel + 1 == mLevels.size())
+            return;
+
+        if (level.palette) {
+            std::vector<uint8_t>& expanded = level.expandedRows[y % 2];
+            level.palette->expand(aRow, expanded.data(), level.width);
+            aRow = expanded.data();
+        }
+
+        // The last row of an odd height is averaged with itself. Strip rows
+        // move when the strip is shifted, or when kept tiles make writing
+        // copy it, so a row waiting for the next one is copied.
+        if (((y % 2) == 0) && (y + 1 < level.height)) {
+            if (level.strip.width() && !level.palette) {
+                level.pending.assign(aRow, aRow + level.rowSize);
+                aRow = level.pending.data();
+            }
+            level.unpaired = aRow;
+            return;
+        }
+
+        const uint8_t* upper = (y % 2) ? level.unpaired : aRow;
+        level.unpaired = nullptr;
+        Level& next = mLevels[aLevel + 1];
+        uint8_t* row = rowSlot(next);
+        level.downsample(upper, aRow, row, level.width);
+        commitRow(aLevel + 1, row);
+    }
+
+    void passTileRow(size_t aLevel)
+    {
+        Level& level = mLevels[aLevel];
+        const Image& rows = mSource && (aLevel == 0) ? *mSource : level.strip;
+        unsigned int rowsY = mSource && (aLevel == 0) ? 0 : level.stripY;
+
+        unsigned int y0 = std::max<int64_t>(int64_t(level.tileRow) * mTileSize - mOverlap, 0);
+        unsigned int y1 = std::min((level.tileRow + 1) * mTileSize + mOverlap, level.height);
+        unsigned int columns = (level.width + mTileSize - 1) / mTileSize;
+
+        std::vector<Image> tiles;
+        tiles.reserve(columns);
+        for (unsigned int column = 0; column < columns; ++column) {
+            unsigned int x0 = std::max<int64_t>(int64_t(column) * mTileSize - mOverlap, 0);
+            unsigned int x1 = std::min((column + 1) * mTileSize + mOverlap, level.width);
+            tiles.push_back(rows.cropped(x0, y0 - rowsY, x1 - x0, y1 - y0));
+        }
+        mTileRowFunction(aLevel, level.tileRow, tiles);
+    }
+
+private:
+    unsigned int mTileSize;
+    unsigned int mOverlap;
+    TileRowFunction mTileRowFunction;
+    const Image* mSource;
+    std::vector<Level> mLevels;
+}; // class PyramidBuilder
+
+PyramidBuilder::TileRowFunction passTiles(const TilePyramid::TileFunction& aTileFunction)
+{
+    return [&aTileFunction](unsigned int aLevel, unsigned int aRow, std::vector<Image>& aTiles) {
+        for (size_t column = 0; column < aTiles.size(); ++column)
+            aTileFunction(aLevel, column, aRow, aTiles[column]);
+    };
+}
+
+PyramidBuilder::TileRowFunction encodeTiles(ImageIO::ImageFormat aTileFormat,
+                                            const TilePyramid::EncodedTileFunction& aTileFunction,
+                                            unsigned int aThreadsCount)
+{
+    return [=, &aTileFunction](unsigned int aLevel, unsigned int aRow, std::vector<Image>& aTiles) {
+        std::vector<std::vector<uint8_t>> data(aTiles.size());
+        const Image& tile = aTiles.front();
+        size_t tileBytes = tile.width() * tile.height() * ColorSpec::pixelSize(tile.colorFormat(), tile.colorChannelDepth());
+
+        parallelForRows(aTiles.size(), kEncodingCostFactor * tileBytes, aThreadsCount, [&](size_t aBegin, size_t aEnd) {
+            for (size_t column = aBegin; column < aEnd; ++column)
+                encodeTile(aTiles[column], aTileFormat, data[column]);
+        });
+
+        for (size_t column = 0; column < aTiles.size(); ++column)
+            aTileFunction(aLevel, column, aRow, data[column].data(), data[column].size());
+    };
+}
+
+void buildFromImage(const Image& aImage, PyramidBuilder& aBuilder)
+{
+    aBuilder.setSource(&aImage);
+    aBuilder.start(aImage.width(), aImage.height(), aImage.colorFormat(), aImage.colorChannelDepth());
+    for (unsigned int y = 0; y < aImage.height(); ++y)
+        aBuilder.push(aImage.data() + y * aImage.stride());
+    aBuilder.finish();
+}
+
+void buildFromStream(std::istream& aInputDataStream, ImageIO::ImageFormat aInputImageFormat, PyramidBuilder& aBuilder)
+{
+    if (aInputImageFormat == ImageIO::ImageFormat::kUnspecified)
+        aInputImageFormat = ImageIO::detectFormat(aInputDataStream);
+
+    StreamReader streamReader(aInputDataStream);
+    DecodeHints hints;
+    switch (aInputImageFormat) {
+#ifdef PNGIO_ENABLED
+    case ImageIO::ImageFormat::kPng:
+        PngIO::readRows(streamReader, hints, aBuilder);
+        break;
+#endif // PNGIO_ENABLED
+#ifdef JPEGIO_ENABLED
+    case ImageIO::ImageFormat::kJpeg:
+        JpegIO::readRows(streamReader, hints, aBuilder);
+        break;
+#endif // JPEGIO_ENABLED
+    default:
+        throw UnsupportedImageFormatException("Unsupported image format");
+    }
+}
+
+} // namespace
+
+TilePyramid::TilePyramid(unsigned int aTileSize, unsigned int aOverlap)
+: mTileSize(aTileSize),
+  mOverlap(aOverlap)
+{
+    if ((aTileSize == 0) || (aOverlap >= aTileSize))
+        throw std::invalid_argument("Tile size must be positive and larger than the overlap");
+}
+
+unsigned int TilePyramid::tileSize() const
+{
+    return mTileSize;
+}
+
+unsigned int TilePyramid::overlap() const
+{
+    return mOverlap;
+}
+
+unsigned int TilePyramid::levelsCount(unsigned int aWidth, unsigned int aHeight)
+{
+    if ((aWidth == 0) || (aHeight == 0))
+        return 0;
+
+    unsigned int count = 1;
+    for (unsigned int size = std::max(aWidth, aHeight); size > 1; size = (size + 1) / 2)
+        ++count;
+    return count;
+}
+
+void TilePyramid::build(const Image& aImage, const TileFunction& aTileFunction) const
+{
+    PyramidBuilder builder(mTileSize, mOverlap, passTiles(aTileFunction));
+    buildFromImage(aImage, builder);
+}
+
+void TilePyramid::build(const Image& aImage,
+                        ImageIO::ImageFormat aTileFormat,
+                        const EncodedTileFunction& aTileFunction,
+                        unsigned int aThreadsCount) const
+{
+    PyramidBuilder builder(mTileSize, mOverlap, encodeTiles(aTileFormat, aTileFunction, aThreadsCount));
+    buildFromImage(aImage, builder);
+}
+
+void TilePyramid::build(std::istream& aInputDataStream,
+                        ImageIO::ImageFormat aInputImageFormat,
+                        const TileFunction& aTileFunction) const
+{
+    PyramidBuilder builder(mTileSize, mOverlap, passTiles(aTileFunction));
+    buildFromStream(aInputDataStream, aInputImageFormat, builder);
+}
+
+void TilePyramid::build(std::istream& aInputDataStream,
+                        ImageIO::ImageFormat aInputImageFormat,
+                        ImageIO::ImageFormat aTileFormat,
+                        const EncodedTileFunction& aTileFunction,
+                        unsigned int aThreadsCount) const
+{
+    PyramidBuilder builder(mTileSize, mOverlap, encodeTiles(aTileFormat, aTileFunction, aThreadsCount));
+    buildFromStream(aInputDataStream, aInputImageFormat, builder);
+}
+
+} // namespace ImgIO
+
+// EOF
@@ -0,0 +1,286 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <cmath>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <tuple>
+#include "resize.h"
+#include "threadpool.h"
+
+namespace ImgIO
+{
+
+namespace
+{
+
+// Number of filter tables kept for reuse.
+const size_t kMaxCachedTables = 32;
+
+double filterSupport(Image::ResizeFilter aFilter)
+{
+    switch (aFilter) {
+    case Image::ResizeFilter::kBicubic:
+        return 2.0;
+    case Image::ResizeFilter::kLanczos3:
+        return 3.0;
+    default:
+        return 1.0;
+    }
+}
+
+double sinc(double aX)
+{
+    if (aX == 0.0)
+        return 1.0;
+    aX *= M_PI;
+    return std::sin(aX) / aX;
+}
+
+double filterValue(Image::ResizeFilter aFilter, double aX)
+{
+    aX = std::fabs(aX);
+
+    switch (aFilter) {
+    case Image::ResizeFilter::kBicubic: {
+        // Keys cubic convolution with a = -0.5 (Catmull-Rom).
+        const double a = -0.5;
+        if (aX < 1.0)
+            return ((a + 2.0) * aX - (a + 3.0)) * aX * aX + 1.0;
+        if (aX < 2.0)
+            return ((a * aX - 5.0 * a) * aX + 8.0 * a) * aX - 4.0 * a;
+        return 0.0;
+    }
+    case Image::ResizeFilter::kLanczos3:
+        return (aX < 3.0) ? sinc(aX) * sinc(aX / 3.0) : 0.0;
+    default:
+        return (aX < 1.0) ? 1.0 - aX : 0.0;
+    }
+}
+
+std::shared_ptr<FilterTable> computeTable(unsigned int aSrcSize, unsigned int aDestSize, Image::ResizeFilter aFilter)
+{
+    std::shared_ptr<FilterTable> table = std::make_shared<FilterTable>();
+    table->offsets.resize(aDestSize);
+
+    double scale = static_cast<double>(aSrcSize) / aDestSize;
+
+    if (aFilter == Image::ResizeFilter::kNearest) {
+        table->taps = 1;
+        table->stride = 1;
+        table->weights.assign(aDestSize, 1.0f);
+        for (size_t i = 0; i < aDestSize; ++i)
+            table->offsets[i] = std::min<size_t>(static_cast<size_t>((i + 0.5) * scale), aSrcSize - 1);
+        return table;
+    }
+
+    // Downscaling widens the filter to cover all source samples.
+    double filterScale = std::max(scale, 1.0);
+    double support = filterSupport(aFilter) * filterScale;
+
+    std::vector<std::pair<int64_t, int64_t>> ranges(aDestSize);
+    table->taps = 0;
+    for (size_t i = 0; i < aDestSize; ++i) {
+        double center = (i + 0.5) * scale;
+        int64_t first = std::max<int64_t>(static_cast<int64_t>(center - support + 0.5), 0);
+        int64_t last = std::min<int64_t>(static_cast<int64_t>(center + support + 0.5), aSrcSize);
+        ranges[i] = std::make_pair(first, last);
+        table->taps = std::max<size_t>(table->taps, last - first);
+    }
+
+    // Rows of weights are padded for four wide loads. The ranges near the
+    // end are shifted left, so that all taps stay inside the source.
+    table->stride = (table->taps + 3) & ~static_cast<size_t>(3);
+    table->weights.assign(aDestSize * table->stride, 0.0f);
+
+    std::vector<double> weights(table->taps);
+    for (size_t i = 0; i < aDestSize; ++i) {
+        double center = (i + 0.5) * scale;
+        int64_t first = ranges[i].first;
+        int64_t last = ranges[i].second;
+
+        double sum = 0.0;
+        for (int64_t j = first; j < last; ++j) {
+            weights[j - first] = filterValue(aFilter, (j - center + 0.5) / filterScale);
+            sum += weights[j - first];
+        }
+
+        size_t offset = std::min<size_t>(first, aSrcSize - table->taps);
+        float* row = table->weights.data() + i * table->stride + (first - offset);
+        for (int64_t j = first; j < last; ++j)
+            row[j - first] = static_cast<float>((sum != 0.0) ? weights[j - first] / sum : 0.0);
+        table->offsets[i] = offset;
+    }
+
+    return table;
+}
+
+} // namespace
+
+std::shared_ptr<const FilterTable> FilterTable::get(unsigned int aSrcSize,
+                                                    unsigned int aDestSize,
+                                                    Image::ResizeFilter aFilter)
+{
+    typedef std::tuple<unsigned int, unsigned int, Image::ResizeFilter> Key;
+    typedef std::list<std::pair<Key, std::shared_ptr<const FilterTable>>> Cache;
+
+    static std::mutex mutex;
+    static Cache cache;
+
+    Key key(aSrcSize, aDestSize, aFilter);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Cache::iterator it = cache.begin(); it != cache.end(); ++it) {
+            if (it->first == key) {
+                cache.splice(cache.begin(), cache, it);
+                return it->second;
+            }
+        }
+    }
+
+    std::shared_ptr<const FilterTable> table = computeTable(aSrcSize, aDestSize, aFilter);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.emplace_front(key, table);
+    if (cache.size() > kMaxCachedTables)
+        cache.pop_back();
+
+    return table;
+}
+
+HorizontalFunction horizontalFunction(size_t aChannels)
+{
+    HorizontalFunction horizontalFunc = simdHorizontalFunction(Simd::level(), aChannels);
+    if (horizontalFunc)
+        return horizontalFunc;
+
+    switch (aChannels) {
+    case 1:
+        return resampleRow<1>;
+    case 2:
+        return resampleRow<2>;
+    case 3:
+        return resampleRow<3>;
+    case 4:
+        return resampleRow<4>;
+    default:
+        return nullptr;
+    }
+}
+
+VerticalFunction verticalFunction(ColorSpec::ChannelDepth aChannelDepth)
+{
+    VerticalFunction verticalFunc = simdVerticalFunction(Simd::level(), aChannelDepth);
+    if (verticalFunc)
+        return verticalFunc;
+
+    if (aChannelDepth == ColorSpec::ChannelDepth::k16Bit)
+        return resampleColumns<ColorSpec::ChannelDepth::k16Bit>;
+    return resampleColumns<ColorSpec::ChannelDepth::k8Bit>;
+}
+
+void resizeRows(const uint8_t* aSrc,
+                size_t aSrcStride,
+                unsigned int aSrcWidth,
+                unsigned int aSrcHeight,
+                uint8_t* aDest,
+                size_t aDestStride,
+                unsigned int aDestWidth,
+                unsigned int aDestHeight,
+                ColorSpec::Format aColorFormat,
+                ColorSpec::ChannelDepth aChannelDepth,
+                Image::ResizeFilter aFilter,
+                unsigned int aThreadsCount)
+{
+    std::shared_ptr<const FilterTable> columns = FilterTable::get(aSrcWidth, aDestWidth, aFilter);
+    std::shared_ptr<const FilterTable> rows = FilterTable::get(aSrcHeight, aDestHeight, aFilter);
+
+    size_t channels = ColorSpec::channelCount(aColorFormat);
+    size_t pixelSize = ColorSpec::pixelSize(aColorFormat, aChannelDepth);
+    size_t destRowSize = aDestWidth * pixelSize;
+    size_t workPerRow = destRowSize + aSrcWidth * pixelSize * std::max<size_t>(aSrcHeight / aDestHeight, 1);
+
+    if (aFilter == Image::ResizeFilter::kNearest) {
+        parallelForRows(aDestHeight, workPerRow, aThreadsCount, [&](size_t aBegin, size_t aEnd) {
+            for (size_t y = aBegin; y < aEnd; ++y) {
+                const uint8_t* src = aSrc + rows->offsets[y] * aSrcStride;
+                uint8_t* dest = aDest + y * aDestStride;
+                for (size_t x = 0; x < aDestWidth; ++x, dest += pixelSize)
+                    std::memcpy(dest, src + columns->offsets[x] * pixelSize, pixelSize);
+            }
+        });
+        return;
+    }
+
+    HorizontalFunction horizontal = horizontalFunction(channels);
+    VerticalFunction vertical = verticalFunction(aChannelDepth);
+    if (!horizontal)
+        throw NotImplementedException("Not implemented.");
+
+    size_t srcSamples = aSrcWidth * channels;
+    size_t destSamples = aDestWidth * channels;
+
+    // Kernels may read a padded row of taps and write one sample past a pixel.
+    size_t srcRowLength = srcSamples + columns->stride * channels + 1;
+    size_t ringRowLength = destSamples + 1;
+    size_t ringSize = rows->taps;
+    bool is16Bit = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+    bool premultiplied = (aColorFormat == ColorSpec::Format::kRGBAPremultiplied);
+
+    // Each band streams its source rows through the horizontal pass into a
+    // ring of taps rows, which is all the vertical pass needs at a time.
+    parallelForRows(aDestHeight, workPerRow, aThreadsCount, [&](size_t aBegin, size_t aEnd) {
+        std::vector<float> srcRow(srcRowLength, 0.0f);
+        std::vector<float> ring(ringSize * ringRowLength, 0.0f);
+        std::vector<const float*> window(ringSize);
+
+        size_t nextRow = rows->offsets[aBegin];
+        for (size_t y = aBegin; y < aEnd; ++y) {
+            size_t first = rows->offsets[y];
+            nextRow = std::max(nextRow, first);
+            for (; nextRow < first + ringSize; ++nextRow) {
+                const uint8_t* src = aSrc + nextRow * aSrcStride;
+                if (is16Bit)
+                    samplesToFloat<uint16_t>(src, srcRow.data(), srcSamples);
+                else
+                    samplesToFloat<uint8_t>(src, srcRow.data(), srcSamples);
+                horizontal(srcRow.data(), ring.data() + (nextRow % ringSize) * ringRowLength, *columns);
+            }
+
+            for (size_t k = 0; k < ringSize; ++k)
+                window[k] = ring.data() + ((first + k) % ringSize) * ringRowLength;
+            uint8_t* dest = aDest + y * aDestStride;
+            vertical(window.data(), rows->weights.data() + y * rows->stride, ringSize, 0, destSamples, dest);
+            if (premultiplied && is16Bit)
+                clampPremultipliedRow<ColorSpec::ChannelDepth::k16Bit>(dest, aDestWidth);
+            else if (premultiplied)
+                clampPremultipliedRow<ColorSpec::ChannelDepth::k8Bit>(dest, aDestWidth);
+        }
+    });
+}
+
+} // namespace ImgIO
+
+// EOF
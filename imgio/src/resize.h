@@ -0,0 +1,167 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _RESIZE_H__
+#define _RESIZE_H__
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <imgio/image.h>
+#include <imgio/simd.h>
+#include "convert.h"
+
+namespace ImgIO
+{
+
+/**
+ * Resampling coefficients for one dimension. Destination index i reads
+ * taps source samples from offsets[i], weighted by weights[i * stride].
+ */
+struct FilterTable
+{
+    std::vector<size_t> offsets;
+    std::vector<float> weights;
+    size_t taps;
+    size_t stride;
+
+    /**
+     * Returns the table for the given sizes, computed once and cached.
+     */
+    static std::shared_ptr<const FilterTable> get(unsigned int aSrcSize,
+                                                  unsigned int aDestSize,
+                                                  Image::ResizeFilter aFilter);
+};
+
+/**
+ * Resamples a row of float samples horizontally.
+ */
+typedef void (*HorizontalFunction)(const float* aSrc, float* aDest, const FilterTable& aTable);
+
+/**
+ * Combines samples [aBegin, aEnd) of aTaps float rows into a row of 8 or 16
+ * bit samples.
+ */
+typedef void (*VerticalFunction)(const float* const* aRows,
+                                 const float* aWeights,
+                                 size_t aTaps,
+                                 size_t aBegin,
+                                 size_t aEnd,
+                                 uint8_t* aDest);
+
+template <typename Sample>
+void samplesToFloat(const uint8_t* aSrc, float* aDest, size_t aSamplesCount)
+{
+    const Sample* src = reinterpret_cast<const Sample*>(aSrc);
+    for (size_t i = 0; i < aSamplesCount; ++i)
+        aDest[i] = src[i];
+}
+
+template <size_t kChannels>
+void resampleRow(const float* aSrc, float* aDest, const FilterTable& aTable)
+{
+    const float* weights = aTable.weights.data();
+    size_t count = aTable.offsets.size();
+
+    for (size_t x = 0; x < count; ++x, weights += aTable.stride, aDest += kChannels) {
+        const float* src = aSrc + aTable.offsets[x] * kChannels;
+        float sums[kChannels] = {};
+        for (size_t k = 0; k < aTable.taps; ++k)
+            for (size_t c = 0; c < kChannels; ++c)
+                sums[c] += weights[k] * src[k * kChannels + c];
+        for (size_t c = 0; c < kChannels; ++c)
+            aDest[c] = sums[c];
+    }
+}
+
+template <ColorSpec::ChannelDepth kDepth>
+void resampleColumns(const float* const* aRows,
+                     const float* aWeights,
+                     size_t aTaps,
+                     size_t aBegin,
+                     size_t aEnd,
+                     uint8_t* aDest)
+{
+    typedef typename DepthTraits<kDepth>::Sample Sample;
+    const float max = static_cast<float>(DepthTraits<kDepth>::kMax);
+    Sample* dest = reinterpret_cast<Sample*>(aDest);
+
+    for (size_t i = aBegin; i < aEnd; ++i) {
+        float sum = 0.0f;
+        for (size_t k = 0; k < aTaps; ++k)
+            sum += aWeights[k] * aRows[k][i];
+        dest[i] = static_cast<Sample>(std::min(std::max(sum + 0.5f, 0.0f), max));
+    }
+}
+
+/**
+ * Limits the colors of premultiplied RGBA pixels to their alpha. Filters
+ * with negative lobes can ring them above it.
+ */
+template <ColorSpec::ChannelDepth kDepth>
+void clampPremultipliedRow(uint8_t* aRow, size_t aPixelsCount)
+{
+    typedef typename DepthTraits<kDepth>::Sample Sample;
+    Sample* row = reinterpret_cast<Sample*>(aRow);
+
+    for (size_t i = 0; i < aPixelsCount; ++i, row += 4) {
+        Sample alpha = row[3];
+        row[0] = std::min(row[0], alpha);
+        row[1] = std::min(row[1], alpha);
+        row[2] = std::min(row[2], alpha);
+    }
+}
+
+/**
+ * Returns the horizontal kernel for the current Simd::level().
+ */
+HorizontalFunction horizontalFunction(size_t aChannels);
+
+/**
+ * Returns the vertical kernel for the current Simd::level().
+ */
+VerticalFunction verticalFunction(ColorSpec::ChannelDepth aChannelDepth);
+
+HorizontalFunction simdHorizontalFunction(Simd::Level aLevel, size_t aChannels);
+VerticalFunction simdVerticalFunction(Simd::Level aLevel, ColorSpec::ChannelDepth aChannelDepth);
+
+/**
+ * Resamples aSrc into aDest, both in the given format and depth.
+ */
+void resizeRows(const uint8_t* aSrc,
+                size_t aSrcStride,
+                unsigned int aSrcWidth,
+                unsigned int aSrcHeight,
+                uint8_t* aDest,
+                size_t aDestStride,
+                unsigned int aDestWidth,
+                unsigned int aDestHeight,
+                ColorSpec::Format aColorFormat,
+                ColorSpec::ChannelDepth aChannelDepth,
+                Image::ResizeFilter aFilter,
+                unsigned int aThreadsCount);
+
+} // namespace ImgIO
+
+#endif // _RESIZE_H__
+// EOF
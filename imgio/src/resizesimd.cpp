@@ -0,0 +1,265 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "resize.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMGIO_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace ImgIO
+{
+
+#ifdef IMGIO_X86_SIMD
+
+#define IMGIO_TARGET_SSE2 __attribute__((target("sse2")))
+#define IMGIO_TARGET_AVX2 __attribute__((target("avx2")))
+
+namespace
+{
+
+//
+// Horizontal pass: RGB and RGBA pixels are accumulated in one register,
+// RGB ones with an extra lane reading into the padding or the next pixel.
+// Monochromatic rows are dot products over the zero padded taps.
+//
+
+template <size_t kChannels>
+IMGIO_TARGET_SSE2 void resampleRowSSE2(const float* aSrc, float* aDest, const FilterTable& aTable)
+{
+    const float* weights = aTable.weights.data();
+    size_t count = aTable.offsets.size();
+
+    for (size_t x = 0; x < count; ++x, weights += aTable.stride, aDest += kChannels) {
+        const float* src = aSrc + aTable.offsets[x] * kChannels;
+        __m128 sum = _mm_setzero_ps();
+        for (size_t k = 0; k < aTable.taps; ++k)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(src + k * kChannels)));
+        _mm_storeu_ps(aDest, sum);
+    }
+}
+
+IMGIO_TARGET_SSE2 void resampleRow1SSE2(const float* aSrc, float* aDest, const FilterTable& aTable)
+{
+    const float* weights = aTable.weights.data();
+    size_t count = aTable.offsets.size();
+
+    for (size_t x = 0; x < count; ++x, weights += aTable.stride) {
+        const float* src = aSrc + aTable.offsets[x];
+        __m128 sum = _mm_setzero_ps();
+        for (size_t k = 0; k < aTable.stride; k += 4)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(weights + k), _mm_loadu_ps(src + k)));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        _mm_store_ss(aDest + x, sum);
+    }
+}
+
+//
+// Vertical pass: straight over the samples of a row, several registers at a
+// time to hide the latency of the additions.
+//
+
+IMGIO_TARGET_SSE2 inline __m128i roundSSE2(__m128 aSum, __m128 aMax)
+{
+    return _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_add_ps(aSum, _mm_set1_ps(0.5f)), _mm_setzero_ps()), aMax));
+}
+
+template <int kRegisters>
+IMGIO_TARGET_SSE2 inline void sumColumnsSSE2(const float* const* aRows,
+                                             const float* aWeights,
+                                             size_t aTaps,
+                                             size_t aIndex,
+                                             __m128* aSums)
+{
+    for (int j = 0; j < kRegisters; ++j)
+        aSums[j] = _mm_setzero_ps();
+    for (size_t k = 0; k < aTaps; ++k) {
+        __m128 weight = _mm_set1_ps(aWeights[k]);
+        for (int j = 0; j < kRegisters; ++j)
+            aSums[j] = _mm_add_ps(aSums[j], _mm_mul_ps(weight, _mm_loadu_ps(aRows[k] + aIndex + 4 * j)));
+    }
+}
+
+IMGIO_TARGET_SSE2 void resampleColumns8BitSSE2(const float* const* aRows,
+                                               const float* aWeights,
+                                               size_t aTaps,
+                                               size_t aBegin,
+                                               size_t aEnd,
+                                               uint8_t* aDest)
+{
+    const __m128 max = _mm_set1_ps(255.0f);
+
+    size_t i = aBegin;
+    for (; i + 16 <= aEnd; i += 16) {
+        __m128 sums[4];
+        sumColumnsSSE2<4>(aRows, aWeights, aTaps, i, sums);
+        __m128i lo = _mm_packs_epi32(roundSSE2(sums[0], max), roundSSE2(sums[1], max));
+        __m128i hi = _mm_packs_epi32(roundSSE2(sums[2], max), roundSSE2(sums[3], max));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + i), _mm_packus_epi16(lo, hi));
+    }
+
+    resampleColumns<ColorSpec::ChannelDepth::k8Bit>(aRows, aWeights, aTaps, i, aEnd, aDest);
+}
+
+IMGIO_TARGET_SSE2 void resampleColumns16BitSSE2(const float* const* aRows,
+                                                const float* aWeights,
+                                                size_t aTaps,
+                                                size_t aBegin,
+                                                size_t aEnd,
+                                                uint8_t* aDest)
+{
+    const __m128 max = _mm_set1_ps(65535.0f);
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16(static_cast<int16_t>(0x8000));
+
+    size_t i = aBegin;
+    for (; i + 8 <= aEnd; i += 8) {
+        __m128 sums[2];
+        sumColumnsSSE2<2>(aRows, aWeights, aTaps, i, sums);
+        // SSE2 only packs signed words, so the samples are shifted by 0x8000 around the pack.
+        __m128i lo = _mm_sub_epi32(roundSSE2(sums[0], max), bias32);
+        __m128i hi = _mm_sub_epi32(roundSSE2(sums[1], max), bias32);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + 2 * i), _mm_xor_si128(_mm_packs_epi32(lo, hi), bias16));
+    }
+
+    resampleColumns<ColorSpec::ChannelDepth::k16Bit>(aRows, aWeights, aTaps, i, aEnd, aDest);
+}
+
+IMGIO_TARGET_AVX2 inline __m256i roundAVX2(__m256 aSum, __m256 aMax)
+{
+    __m256 rounded = _mm256_add_ps(aSum, _mm256_set1_ps(0.5f));
+    return _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(rounded, _mm256_setzero_ps()), aMax));
+}
+
+template <int kRegisters>
+IMGIO_TARGET_AVX2 inline void sumColumnsAVX2(const float* const* aRows,
+                                             const float* aWeights,
+                                             size_t aTaps,
+                                             size_t aIndex,
+                                             __m256* aSums)
+{
+    for (int j = 0; j < kRegisters; ++j)
+        aSums[j] = _mm256_setzero_ps();
+    for (size_t k = 0; k < aTaps; ++k) {
+        __m256 weight = _mm256_set1_ps(aWeights[k]);
+        for (int j = 0; j < kRegisters; ++j)
+            aSums[j] = _mm256_add_ps(aSums[j], _mm256_mul_ps(weight, _mm256_loadu_ps(aRows[k] + aIndex + 8 * j)));
+    }
+}
+
+IMGIO_TARGET_AVX2 void resampleColumns8BitAVX2(const float* const* aRows,
+                                               const float* aWeights,
+                                               size_t aTaps,
+                                               size_t aBegin,
+                                               size_t aEnd,
+                                               uint8_t* aDest)
+{
+    const __m256 max = _mm256_set1_ps(255.0f);
+
+    size_t i = aBegin;
+    for (; i + 32 <= aEnd; i += 32) {
+        __m256 sums[4];
+        sumColumnsAVX2<4>(aRows, aWeights, aTaps, i, sums);
+        // Packing works within lanes, the permutes restore the sample order.
+        __m256i lo = _mm256_permute4x64_epi64(_mm256_packs_epi32(roundAVX2(sums[0], max), roundAVX2(sums[1], max)), 0xd8);
+        __m256i hi = _mm256_permute4x64_epi64(_mm256_packs_epi32(roundAVX2(sums[2], max), roundAVX2(sums[3], max)), 0xd8);
+        __m256i result = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xd8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + i), result);
+    }
+
+    resampleColumns8BitSSE2(aRows, aWeights, aTaps, i, aEnd, aDest);
+}
+
+IMGIO_TARGET_AVX2 void resampleColumns16BitAVX2(const float* const* aRows,
+                                                const float* aWeights,
+                                                size_t aTaps,
+                                                size_t aBegin,
+                                                size_t aEnd,
+                                                uint8_t* aDest)
+{
+    const __m256 max = _mm256_set1_ps(65535.0f);
+
+    size_t i = aBegin;
+    for (; i + 16 <= aEnd; i += 16) {
+        __m256 sums[2];
+        sumColumnsAVX2<2>(aRows, aWeights, aTaps, i, sums);
+        __m256i packed = _mm256_packus_epi32(roundAVX2(sums[0], max), roundAVX2(sums[1], max));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + 2 * i), _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+
+    resampleColumns16BitSSE2(aRows, aWeights, aTaps, i, aEnd, aDest);
+}
+
+} // namespace
+
+HorizontalFunction simdHorizontalFunction(Simd::Level aLevel, size_t aChannels)
+{
+    if (aLevel < Simd::Level::kSSE2)
+        return nullptr;
+
+    switch (aChannels) {
+    case 1:
+        return resampleRow1SSE2;
+    case 3:
+        return resampleRowSSE2<3>;
+    case 4:
+        return resampleRowSSE2<4>;
+    default:
+        return nullptr;
+    }
+}
+
+VerticalFunction simdVerticalFunction(Simd::Level aLevel, ColorSpec::ChannelDepth aChannelDepth)
+{
+    bool is16Bit = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+
+    switch (aLevel) {
+    case Simd::Level::kAVX2:
+        return is16Bit ? resampleColumns16BitAVX2 : resampleColumns8BitAVX2;
+    case Simd::Level::kSSSE3:
+    case Simd::Level::kSSE2:
+        return is16Bit ? resampleColumns16BitSSE2 : resampleColumns8BitSSE2;
+    default:
+        return nullptr;
+    }
+}
+
+#else // IMGIO_X86_SIMD
+
+HorizontalFunction simdHorizontalFunction(Simd::Level aLevel, size_t aChannels)
+{
+    return nullptr;
+}
+
+VerticalFunction simdVerticalFunction(Simd::Level aLevel, ColorSpec::ChannelDepth aChannelDepth)
+{
+    return nullptr;
+}
+
+#endif // IMGIO_X86_SIMD
+
+} // namespace ImgIO
+
+// EOF
@@ -0,0 +1,240 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "rotate.h"
+#include <algorithm>
+#include <stdexcept>
+#include <imgio/exception.h>
+#include "threadpool.h"
+
+namespace ImgIO
+{
+
+namespace
+{
+
+typedef void (*ReverseFunction)(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount);
+
+ReverseFunction reverseFunction(size_t aPixelSize)
+{
+    switch (aPixelSize) {
+    case 1:
+        return reverseRow<1>;
+    case 2:
+        return reverseRow<2>;
+    case 3:
+        return reverseRow<3>;
+    case 4:
+        return reverseRow<4>;
+    case 6:
+        return reverseRow<6>;
+    case 8:
+        return reverseRow<8>;
+    default:
+        return nullptr;
+    }
+}
+
+// Tiles of about 16 KiB per side, a multiple of all block sizes.
+size_t tileSize(size_t aPixelSize)
+{
+    return std::max<size_t>((256 / aPixelSize) & ~size_t(15), 16);
+}
+
+} // namespace
+
+TransposeKernel transposeKernel(size_t aPixelSize)
+{
+    TransposeKernel kernel = simdTransposeKernel(Simd::level(), aPixelSize);
+    if (kernel.function)
+        return kernel;
+
+    switch (aPixelSize) {
+    case 1:
+        return TransposeKernel{transposeBlock<1, 8>, 8};
+    case 2:
+        return TransposeKernel{transposeBlock<2, 8>, 8};
+    case 3:
+        return TransposeKernel{transposeBlock<3, 8>, 8};
+    case 4:
+        return TransposeKernel{transposeBlock<4, 8>, 8};
+    case 6:
+        return TransposeKernel{transposeBlock<6, 8>, 8};
+    case 8:
+        return TransposeKernel{transposeBlock<8, 8>, 8};
+    default:
+        return TransposeKernel{nullptr, 0};
+    }
+}
+
+void orientRows(const uint8_t* aSrc,
+                size_t aSrcStride,
+                unsigned int aWidth,
+                unsigned int aHeight,
+                unsigned int aY,
+                unsigned int aRowsCount,
+                size_t aPixelSize,
+                uint8_t* aDest,
+                size_t aDestStride,
+                Image::Orientation aOrientation,
+                unsigned int aThreadsCount)
+{
+    if ((aWidth == 0) || (aRowsCount == 0))
+        return;
+
+    // Destination pixel (x, y) of the band is the source one at
+    // origin + x * dx + y * dy. The band lands at destX, destY.
+    ptrdiff_t pixel = aPixelSize;
+    ptrdiff_t stride = aSrcStride;
+    ptrdiff_t lastRow = (aRowsCount - 1) * stride;
+    ptrdiff_t lastColumn = (aWidth - 1) * pixel;
+    size_t below = aHeight - aY - aRowsCount;
+    ptrdiff_t origin = 0;
+    ptrdiff_t dx = 0;
+    ptrdiff_t dy = 0;
+    size_t destX = 0;
+    size_t destY = 0;
+
+    switch (aOrientation) {
+    case Image::Orientation::kTopLeft:
+        origin = 0;
+        dx = pixel;
+        dy = stride;
+        destY = aY;
+        break;
+    case Image::Orientation::kTopRight:
+        origin = lastColumn;
+        dx = -pixel;
+        dy = stride;
+        destY = aY;
+        break;
+    case Image::Orientation::kBottomRight:
+        origin = lastRow + lastColumn;
+        dx = -pixel;
+        dy = -stride;
+        destY = below;
+        break;
+    case Image::Orientation::kBottomLeft:
+        origin = lastRow;
+        dx = pixel;
+        dy = -stride;
+        destY = below;
+        break;
+    case Image::Orientation::kLeftTop:
+        origin = 0;
+        dx = stride;
+        dy = pixel;
+        destX = aY;
+        break;
+    case Image::Orientation::kRightTop:
+        origin = lastRow;
+        dx = -stride;
+        dy = pixel;
+        destX = below;
+        break;
+    case Image::Orientation::kRightBottom:
+        origin = lastRow + lastColumn;
+        dx = -stride;
+        dy = -pixel;
+        destX = below;
+        break;
+    case Image::Orientation::kLeftBottom:
+        origin = lastColumn;
+        dx = stride;
+        dy = -pixel;
+        destX = aY;
+        break;
+    default:
+        throw std::invalid_argument("Unknown orientation");
+    }
+
+    const uint8_t* src = aSrc + origin;
+    uint8_t* dest = aDest + destY * aDestStride + destX * aPixelSize;
+    ptrdiff_t destStride = aDestStride;
+
+    // Rows stay rows, reversed when mirrored left to right
+    if (!swapsAxes(aOrientation)) {
+        ReverseFunction reverseFunc = reverseFunction(aPixelSize);
+        if (!reverseFunc)
+            throw NotImplementedException("Not implemented.");
+
+        size_t rowSize = aWidth * aPixelSize;
+        parallelForRows(aRowsCount, 2 * rowSize, aThreadsCount, [=](size_t aBegin, size_t aEnd) {
+            for (size_t y = aBegin; y < aEnd; ++y) {
+                const uint8_t* srcRow = src + static_cast<ptrdiff_t>(y) * dy;
+                uint8_t* destRow = dest + y * destStride;
+                if (dx > 0)
+                    std::memcpy(destRow, srcRow, rowSize);
+                else
+                    reverseFunc(srcRow - lastColumn, destRow, aWidth);
+            }
+        });
+        return;
+    }
+
+    TransposeKernel kernel = transposeKernel(aPixelSize);
+    if (!kernel.function)
+        throw NotImplementedException("Not implemented.");
+
+    // Source columns become rows. Each band of tile rows is walked tile by
+    // tile, so the source rows a tile reads stay cached, and each tile block
+    // by block. Blocks read their source rows upwards when dy is negative.
+    ptrdiff_t destWidth = aRowsCount;
+    ptrdiff_t destHeight = aWidth;
+    ptrdiff_t block = kernel.blockSize;
+    ptrdiff_t tile = tileSize(aPixelSize);
+    size_t tilesCount = (destHeight + tile - 1) / tile;
+
+    auto copyPixels = [=](ptrdiff_t aX0, ptrdiff_t aX1, ptrdiff_t aY0, ptrdiff_t aY1) {
+        for (ptrdiff_t y = aY0; y < aY1; ++y)
+            for (ptrdiff_t x = aX0; x < aX1; ++x)
+                std::memcpy(dest + y * destStride + x * pixel, src + x * dx + y * dy, pixel);
+    };
+
+    parallelForRows(tilesCount, 2 * tile * destWidth * pixel, aThreadsCount, [=](size_t aBegin, size_t aEnd) {
+        for (size_t t = aBegin; t < aEnd; ++t) {
+            ptrdiff_t y0 = t * tile;
+            ptrdiff_t y1 = std::min(y0 + tile, destHeight);
+            for (ptrdiff_t x0 = 0; x0 < destWidth; x0 += tile) {
+                ptrdiff_t x1 = std::min(x0 + tile, destWidth);
+                ptrdiff_t y = y0;
+                for (; y + block <= y1; y += block) {
+                    ptrdiff_t firstRow = (dy > 0) ? y : y + block - 1;
+                    ptrdiff_t x = x0;
+                    for (; x + block <= x1; x += block) {
+                        kernel.function(src + x * dx + firstRow * dy,
+                                        dx,
+                                        dest + firstRow * destStride + x * pixel,
+                                        (dy > 0) ? destStride : -destStride);
+                    }
+                    copyPixels(x, x1, y, y + block);
+                }
+                copyPixels(x0, x1, y, y1);
+            }
+        }
+    });
+}
+
+} // namespace ImgIO
+
+// EOF
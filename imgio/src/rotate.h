@@ -0,0 +1,151 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _ROTATE_H__
+#define _ROTATE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <imgio/image.h>
+#include <imgio/simd.h>
+
+namespace ImgIO
+{
+
+/**
+ * Transposes a square block of pixels, pixel j of source row i becomes
+ * pixel i of destination row j. Rows of either side may go upwards in
+ * memory, with negative steps.
+ */
+typedef void (*TransposeFunction)(const uint8_t* aSrc, ptrdiff_t aSrcStep, uint8_t* aDest, ptrdiff_t aDestStep);
+
+/**
+ * Block transposition kernel with the side of its blocks in pixels.
+ */
+struct TransposeKernel
+{
+    TransposeFunction function;
+    size_t blockSize;
+};
+
+// Pixels of 1, 2, 4 and 8 bytes are moved as a whole, so the loops vectorize.
+template <size_t kPixelSize>
+struct PixelWord
+{
+    uint8_t bytes[kPixelSize];
+};
+
+template <>
+struct PixelWord<1>
+{
+    uint8_t value;
+};
+
+template <>
+struct PixelWord<2>
+{
+    uint16_t value;
+};
+
+template <>
+struct PixelWord<4>
+{
+    uint32_t value;
+};
+
+template <>
+struct PixelWord<8>
+{
+    uint64_t value;
+};
+
+template <size_t kPixelSize, size_t kBlockSize>
+void transposeBlock(const uint8_t* aSrc, ptrdiff_t aSrcStep, uint8_t* aDest, ptrdiff_t aDestStep)
+{
+    typedef PixelWord<kPixelSize> Pixel;
+
+    for (size_t j = 0; j < kBlockSize; ++j, aDest += aDestStep) {
+        Pixel* dest = reinterpret_cast<Pixel*>(aDest);
+        const uint8_t* src = aSrc + j * kPixelSize;
+        for (size_t i = 0; i < kBlockSize; ++i, src += aSrcStep)
+            std::memcpy(dest + i, src, kPixelSize);
+    }
+}
+
+/**
+ * Copies a row of pixels in reverse order.
+ */
+template <size_t kPixelSize>
+void reverseRow(const uint8_t* aSrc, uint8_t* aDest, size_t aPixelsCount)
+{
+    typedef PixelWord<kPixelSize> Pixel;
+    const Pixel* src = reinterpret_cast<const Pixel*>(aSrc) + aPixelsCount;
+    Pixel* dest = reinterpret_cast<Pixel*>(aDest);
+
+    for (size_t i = 0; i < aPixelsCount; ++i)
+        dest[i] = *--src;
+}
+
+/**
+ * Returns whether aOrientation swaps the width and the height.
+ */
+inline bool swapsAxes(Image::Orientation aOrientation)
+{
+    return aOrientation >= Image::Orientation::kLeftTop;
+}
+
+/**
+ * Returns the block transposition kernel for the current Simd::level().
+ * @return Kernel or one with a nullptr function for unsupported pixel sizes.
+ */
+TransposeKernel transposeKernel(size_t aPixelSize);
+
+/**
+ * Returns the vectorized block transposition for the given instruction set level.
+ * @return Kernel or one with a nullptr function, when the level has none.
+ */
+TransposeKernel simdTransposeKernel(Simd::Level aLevel, size_t aPixelSize);
+
+/**
+ * Moves rows [aY, aY + aRowsCount) of a aWidth x aHeight image, starting
+ * at aSrc, to their place in the image oriented as aOrientation tells,
+ * starting at aDest. Transposing orientations go through tiles small
+ * enough for the cache, rows and columns at once.
+ */
+void orientRows(const uint8_t* aSrc,
+                size_t aSrcStride,
+                unsigned int aWidth,
+                unsigned int aHeight,
+                unsigned int aY,
+                unsigned int aRowsCount,
+                size_t aPixelSize,
+                uint8_t* aDest,
+                size_t aDestStride,
+                Image::Orientation aOrientation,
+                unsigned int aThreadsCount);
+
+} // namespace ImgIO
+
+#endif // _ROTATE_H__
+// EOF
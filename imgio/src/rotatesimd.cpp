@@ -0,0 +1,272 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "rotate.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMGIO_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace ImgIO
+{
+
+#ifdef IMGIO_X86_SIMD
+
+#define IMGIO_TARGET_SSE2 __attribute__((target("sse2")))
+#define IMGIO_TARGET_AVX2 __attribute__((target("avx2")))
+
+namespace
+{
+
+//
+// Block transpositions in registers. Each round of unpacks interleaves
+// pairs of rows, doubling the width of the interleaved units, until every
+// register holds a column.
+//
+
+IMGIO_TARGET_SSE2 inline __m128i load64(const uint8_t* aSrc)
+{
+    return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(aSrc));
+}
+
+IMGIO_TARGET_SSE2 inline __m128i load128(const uint8_t* aSrc)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc));
+}
+
+IMGIO_TARGET_SSE2 inline void store64(uint8_t* aDest, __m128i aValue)
+{
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(aDest), aValue);
+}
+
+IMGIO_TARGET_SSE2 inline void store128(uint8_t* aDest, __m128i aValue)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest), aValue);
+}
+
+// 8 x 8 pixels of 1 byte.
+IMGIO_TARGET_SSE2 void transpose8x8x1SSE2(const uint8_t* aSrc, ptrdiff_t aSrcStep, uint8_t* aDest, ptrdiff_t aDestStep)
+{
+    __m128i a0 = _mm_unpacklo_epi8(load64(aSrc), load64(aSrc + aSrcStep));
+    __m128i a1 = _mm_unpacklo_epi8(load64(aSrc + 2 * aSrcStep), load64(aSrc + 3 * aSrcStep));
+    __m128i a2 = _mm_unpacklo_epi8(load64(aSrc + 4 * aSrcStep), load64(aSrc + 5 * aSrcStep));
+    __m128i a3 = _mm_unpacklo_epi8(load64(aSrc + 6 * aSrcStep), load64(aSrc + 7 * aSrcStep));
+
+    __m128i b0 = _mm_unpacklo_epi16(a0, a1);
+    __m128i b1 = _mm_unpackhi_epi16(a0, a1);
+    __m128i b2 = _mm_unpacklo_epi16(a2, a3);
+    __m128i b3 = _mm_unpackhi_epi16(a2, a3);
+
+    __m128i c0 = _mm_unpacklo_epi32(b0, b2);
+    __m128i c1 = _mm_unpackhi_epi32(b0, b2);
+    __m128i c2 = _mm_unpacklo_epi32(b1, b3);
+    __m128i c3 = _mm_unpackhi_epi32(b1, b3);
+
+    store64(aDest, c0);
+    store64(aDest + aDestStep, _mm_unpackhi_epi64(c0, c0));
+    store64(aDest + 2 * aDestStep, c1);
+    store64(aDest + 3 * aDestStep, _mm_unpackhi_epi64(c1, c1));
+    store64(aDest + 4 * aDestStep, c2);
+    store64(aDest + 5 * aDestStep, _mm_unpackhi_epi64(c2, c2));
+    store64(aDest + 6 * aDestStep, c3);
+    store64(aDest + 7 * aDestStep, _mm_unpackhi_epi64(c3, c3));
+}
+
+// 8 x 8 pixels of 2 bytes.
+IMGIO_TARGET_SSE2 void transpose8x8x2SSE2(const uint8_t* aSrc, ptrdiff_t aSrcStep, uint8_t* aDest, ptrdiff_t aDestStep)
+{
+    __m128i r0 = load128(aSrc);
+    __m128i r1 = load128(aSrc + aSrcStep);
+    __m128i r2 = load128(aSrc + 2 * aSrcStep);
+    __m128i r3 = load128(aSrc + 3 * aSrcStep);
+    __m128i r4 = load128(aSrc + 4 * aSrcStep);
+    __m128i r5 = load128(aSrc + 5 * aSrcStep);
+    __m128i r6 = load128(aSrc + 6 * aSrcStep);
+    __m128i r7 = load128(aSrc + 7 * aSrcStep);
+
+    __m128i a0 = _mm_unpacklo_epi16(r0, r1);
+    __m128i a1 = _mm_unpackhi_epi16(r0, r1);
+    __m128i a2 = _mm_unpacklo_epi16(r2, r3);
+    __m128i a3 = _mm_unpackhi_epi16(r2, r3);
+    __m128i a4 = _mm_unpacklo_epi16(r4, r5);
+    __m128i a5 = _mm_unpackhi_epi16(r4, r5);
+    __m128i a6 = _mm_unpacklo_epi16(r6, r7);
+    __m128i a7 = _mm_unpackhi_epi16(r6, r7);
+
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    store128(aDest, _mm_unpacklo_epi64(b0, b4));
+    store128(aDest + aDestStep, _mm_unpackhi_epi64(b0, b4));
+    store128(aDest + 2 * aDestStep, _mm_unpacklo_epi64(b1, b5));
+    store128(aDest + 3 * aDestStep, _mm_unpackhi_epi64(b1, b5));
+    store128(aDest + 4 * aDestStep, _mm_unpacklo_epi64(b2, b6));
+    store128(aDest + 5 * aDestStep, _mm_unpackhi_epi64(b2, b6));
+    store128(aDest + 6 * aDestStep, _mm_unpacklo_epi64(b3, b7));
+    store128(aDest + 7 * aDestStep, _mm_unpackhi_epi64(b3, b7));
+}
+
+// 4 x 4 pixels of 4 bytes.
+IMGIO_TARGET_SSE2 void transpose4x4x4SSE2(const uint8_t* aSrc, ptrdiff_t aSrcStep, uint8_t* aDest, ptrdiff_t aDestStep)
+{
+    __m128i r0 = load128(aSrc);
+    __m128i r1 = load128(aSrc + aSrcStep);
+    __m128i r2 = load128(aSrc + 2 * aSrcStep);
+    __m128i r3 = load128(aSrc + 3 * aSrcStep);
+
+    __m128i a0 = _mm_unpacklo_epi32(r0, r1);
+    __m128i a1 = _mm_unpackhi_epi32(r0, r1);
+    __m128i a2 = _mm_unpacklo_epi32(r2, r3);
+    __m128i a3 = _mm_unpackhi_epi32(r2, r3);
+
+    store128(aDest, _mm_unpacklo_epi64(a0, a2));
+    store128(aDest + aDestStep, _mm_unpackhi_epi64(a0, a2));
+    store128(aDest + 2 * aDestStep, _mm_unpacklo_epi64(a1, a3));
+    store128(aDest + 3 * aDestStep, _mm_unpackhi_epi64(a1, a3));
+}
+
+// 2 x 2 pixels of 8 bytes.
+IMGIO_TARGET_SSE2 void transpose2x2x8SSE2(const uint8_t* aSrc, ptrdiff_t aSrcStep, uint8_t* aDest, ptrdiff_t aDestStep)
+{
+    __m128i r0 = load128(aSrc);
+    __m128i r1 = load128(aSrc + aSrcStep);
+
+    store128(aDest, _mm_unpacklo_epi64(r0, r1));
+    store128(aDest + aDestStep, _mm_unpackhi_epi64(r0, r1));
+}
+
+IMGIO_TARGET_AVX2 inline __m256i load256(const uint8_t* aSrc)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc));
+}
+
+IMGIO_TARGET_AVX2 inline void store256(uint8_t* aDest, __m256i aValue)
+{
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest), aValue);
+}
+
+// 8 x 8 pixels of 4 bytes, unpacks work within lanes, lanes are swapped last.
+IMGIO_TARGET_AVX2 void transpose8x8x4AVX2(const uint8_t* aSrc, ptrdiff_t aSrcStep, uint8_t* aDest, ptrdiff_t aDestStep)
+{
+    __m256i r0 = load256(aSrc);
+    __m256i r1 = load256(aSrc + aSrcStep);
+    __m256i r2 = load256(aSrc + 2 * aSrcStep);
+    __m256i r3 = load256(aSrc + 3 * aSrcStep);
+    __m256i r4 = load256(aSrc + 4 * aSrcStep);
+    __m256i r5 = load256(aSrc + 5 * aSrcStep);
+    __m256i r6 = load256(aSrc + 6 * aSrcStep);
+    __m256i r7 = load256(aSrc + 7 * aSrcStep);
+
+    __m256i a0 = _mm256_unpacklo_epi32(r0, r1);
+    __m256i a1 = _mm256_unpackhi_epi32(r0, r1);
+    __m256i a2 = _mm256_unpacklo_epi32(r2, r3);
+    __m256i a3 = _mm256_unpackhi_epi32(r2, r3);
+    __m256i a4 = _mm256_unpacklo_epi32(r4, r5);
+    __m256i a5 = _mm256_unpackhi_epi32(r4, r5);
+    __m256i a6 = _mm256_unpacklo_epi32(r6, r7);
+    __m256i a7 = _mm256_unpackhi_epi32(r6, r7);
+
+    __m256i b0 = _mm256_unpacklo_epi64(a0, a2);
+    __m256i b1 = _mm256_unpackhi_epi64(a0, a2);
+    __m256i b2 = _mm256_unpacklo_epi64(a1, a3);
+    __m256i b3 = _mm256_unpackhi_epi64(a1, a3);
+    __m256i b4 = _mm256_unpacklo_epi64(a4, a6);
+    __m256i b5 = _mm256_unpackhi_epi64(a4, a6);
+    __m256i b6 = _mm256_unpacklo_epi64(a5, a7);
+    __m256i b7 = _mm256_unpackhi_epi64(a5, a7);
+
+    store256(aDest, _mm256_permute2x128_si256(b0, b4, 0x20));
+    store256(aDest + aDestStep, _mm256_permute2x128_si256(b1, b5, 0x20));
+    store256(aDest + 2 * aDestStep, _mm256_permute2x128_si256(b2, b6, 0x20));
+    store256(aDest + 3 * aDestStep, _mm256_permute2x128_si256(b3, b7, 0x20));
+    store256(aDest + 4 * aDestStep, _mm256_permute2x128_si256(b0, b4, 0x31));
+    store256(aDest + 5 * aDestStep, _mm256_permute2x128_si256(b1, b5, 0x31));
+    store256(aDest + 6 * aDestStep, _mm256_permute2x128_si256(b2, b6, 0x31));
+    store256(aDest + 7 * aDestStep, _mm256_permute2x128_si256(b3, b7, 0x31));
+}
+
+// 4 x 4 pixels of 8 bytes.
+IMGIO_TARGET_AVX2 void transpose4x4x8AVX2(const uint8_t* aSrc, ptrdiff_t aSrcStep, uint8_t* aDest, ptrdiff_t aDestStep)
+{
+    __m256i r0 = load256(aSrc);
+    __m256i r1 = load256(aSrc + aSrcStep);
+    __m256i r2 = load256(aSrc + 2 * aSrcStep);
+    __m256i r3 = load256(aSrc + 3 * aSrcStep);
+
+    __m256i a0 = _mm256_unpacklo_epi64(r0, r1);
+    __m256i a1 = _mm256_unpackhi_epi64(r0, r1);
+    __m256i a2 = _mm256_unpacklo_epi64(r2, r3);
+    __m256i a3 = _mm256_unpackhi_epi64(r2, r3);
+
+    store256(aDest, _mm256_permute2x128_si256(a0, a2, 0x20));
+    store256(aDest + aDestStep, _mm256_permute2x128_si256(a1, a3, 0x20));
+    store256(aDest + 2 * aDestStep, _mm256_permute2x128_si256(a0, a2, 0x31));
+    store256(aDest + 3 * aDestStep, _mm256_permute2x128_si256(a1, a3, 0x31));
+}
+
+} // namespace
+
+TransposeKernel simdTransposeKernel(Simd::Level aLevel, size_t aPixelSize)
+{
+    if (aLevel >= Simd::Level::kAVX2) {
+        if (aPixelSize == 4)
+            return TransposeKernel{transpose8x8x4AVX2, 8};
+        if (aPixelSize == 8)
+            return TransposeKernel{transpose4x4x8AVX2, 4};
+    }
+
+    if (aLevel >= Simd::Level::kSSE2) {
+        switch (aPixelSize) {
+        case 1:
+            return TransposeKernel{transpose8x8x1SSE2, 8};
+        case 2:
+            return TransposeKernel{transpose8x8x2SSE2, 8};
+        case 4:
+            return TransposeKernel{transpose4x4x4SSE2, 4};
+        case 8:
+            return TransposeKernel{transpose2x2x8SSE2, 2};
+        }
+    }
+
+    return TransposeKernel{nullptr, 0};
+}
+
+#else // IMGIO_X86_SIMD
+
+TransposeKernel simdTransposeKernel(Simd::Level aLevel, size_t aPixelSize)
+{
+    return TransposeKernel{nullptr, 0};
+}
+
+#endif // IMGIO_X86_SIMD
+
+} // namespace ImgIO
+
+// EOF
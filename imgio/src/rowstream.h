@@ -0,0 +1,128 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef _ROWSTREAM_H__
+#define _ROWSTREAM_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <imgio/color.h>
+
+namespace ImgIO
+{
+
+/**
+ * Consumer of image rows, fed top to bottom. Lets decoders, the pipeline
+ * stages and encoders pass rows on without materializing whole images.
+ */
+class RowSink
+{
+public:
+    virtual ~RowSink() {}
+
+    /**
+     * Announces the size and layout of the rows to come.
+     */
+    virtual void start(unsigned int aWidth,
+                       unsigned int aHeight,
+                       ColorSpec::Format aColorFormat,
+                       ColorSpec::ChannelDepth aColorChannelDepth) = 0;
+
+    /**
+     * Takes the next row, valid only during the call.
+     */
+    virtual void push(const uint8_t* aRow) = 0;
+
+    /**
+     * Called after the last row.
+     */
+    virtual void finish() = 0;
+}; // class RowSink
+
+/**
+ * Work a row decoder may take over from the stages that follow it.
+ */
+struct DecodeHints
+{
+    DecodeHints()
+    : x(0), y(0), width(0), height(0), minWidth(0), minHeight(0), grayscale(false)
+    {}
+
+    /**
+     * Window to decode, clipped to the image. Zero width decodes all of it.
+     */
+    unsigned int x;
+    unsigned int y;
+    unsigned int width;
+    unsigned int height;
+
+    /**
+     * Smallest acceptable size of the decoded window. Decoders able to
+     * downscale while decoding may do so down to it, zero disables that.
+     */
+    unsigned int minWidth;
+    unsigned int minHeight;
+
+    /**
+     * Only the luma is needed. Decoders storing it separately may output
+     * monochromatic rows instead of converting colors.
+     */
+    bool grayscale;
+};
+
+/**
+ * Clips the window of aHints to an image, an empty result has zero size.
+ */
+inline void clipWindow(const DecodeHints& aHints,
+                       unsigned int aImageWidth,
+                       unsigned int aImageHeight,
+                       unsigned int& aX,
+                       unsigned int& aY,
+                       unsigned int& aWidth,
+                       unsigned int& aHeight)
+{
+    aX = 0;
+    aY = 0;
+    aWidth = aImageWidth;
+    aHeight = aImageHeight;
+    if (aHints.width == 0)
+        return;
+
+    if ((aHints.x >= aImageWidth) || (aHints.y >= aImageHeight)) {
+        aWidth = 0;
+        aHeight = 0;
+        return;
+    }
+
+    aX = aHints.x;
+    aY = aHints.y;
+    aWidth = std::min(aHints.width, aImageWidth - aX);
+    aHeight = std::min(aHints.height, aImageHeight - aY);
+}
+
+} // namespace ImgIO
+
+#endif // _ROWSTREAM_H__
+// EOF
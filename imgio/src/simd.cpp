@@ -0,0 +1,68 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <imgio/simd.h>
+#include <atomic>
+
+namespace ImgIO
+{
+
+static Simd::Level detectLevel()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return Simd::Level::kAVX2;
+    if (__builtin_cpu_supports("ssse3"))
+        return Simd::Level::kSSSE3;
+    if (__builtin_cpu_supports("sse2"))
+        return Simd::Level::kSSE2;
+#endif
+    return Simd::Level::kScalar;
+}
+
+static std::atomic<Simd::Level>& levelStorage()
+{
+    static std::atomic<Simd::Level> level(Simd::supportedLevel());
+    return level;
+}
+
+Simd::Level Simd::supportedLevel()
+{
+    static const Simd::Level level = detectLevel();
+    return level;
+}
+
+Simd::Level Simd::level()
+{
+    return levelStorage().load(std::memory_order_relaxed);
+}
+
+void Simd::setLevel(Simd::Level aLevel)
+{
+    if (aLevel > supportedLevel())
+        aLevel = supportedLevel();
+    levelStorage().store(aLevel, std::memory_order_relaxed);
+}
+
+} // namespace ImgIO
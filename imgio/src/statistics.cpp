@@ -0,0 +1,253 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "statistics.h"
+#include <atomic>
+#include <mutex>
+#include "threadpool.h"
+
+namespace ImgIO
+{
+
+StatisticsFunction statisticsFunction(size_t aChannels, ColorSpec::ChannelDepth aChannelDepth)
+{
+    StatisticsFunction function = simdStatisticsFunction(Simd::level(), aChannels, aChannelDepth);
+    if (function)
+        return function;
+
+    bool is16Bit = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+    switch (aChannels) {
+    case 1:
+        return is16Bit ? accumulateStatistics<uint16_t, 1> : accumulateStatistics<uint8_t, 1>;
+    case 2:
+        return is16Bit ? accumulateStatistics<uint16_t, 2> : accumulateStatistics<uint8_t, 2>;
+    case 3:
+        return is16Bit ? accumulateStatistics<uint16_t, 3> : accumulateStatistics<uint8_t, 3>;
+    case 4:
+        return is16Bit ? accumulateStatistics<uint16_t, 4> : accumulateStatistics<uint8_t, 4>;
+    default:
+        return nullptr;
+    }
+}
+
+OpaqueFunction opaqueFunction(ColorSpec::Format aFormat, ColorSpec::ChannelDepth aChannelDepth)
+{
+    if ((aFormat != ColorSpec::Format::kMonochromaticAlpha) &&
+        (aFormat != ColorSpec::Format::kRGBA) &&
+        (aFormat != ColorSpec::Format::kRGBAPremultiplied))
+        return nullptr;
+
+    size_t channels = ColorSpec::channelCount(aFormat);
+    OpaqueFunction function = simdOpaqueFunction(Simd::level(), channels, aChannelDepth);
+    if (function)
+        return function;
+
+    bool is16Bit = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+    if (channels == 2)
+        return is16Bit ? isOpaqueRow<uint16_t, 2> : isOpaqueRow<uint8_t, 2>;
+    return is16Bit ? isOpaqueRow<uint16_t, 4> : isOpaqueRow<uint8_t, 4>;
+}
+
+namespace
+{
+
+// Counts of 8 bit samples go to one of four histograms in turn, so that
+// runs of equal samples don't wait for each other's increments.
+const size_t kSubHistograms = 4;
+
+// Bins count up to this many pixels before they are added to the result
+const size_t kMaxCountedPixels = size_t(1) << 30;
+
+template <typename Sample>
+void countSamples(const uint8_t* aRow, size_t aPixelsCount, size_t aChannels, uint32_t* aBins)
+{
+    const Sample* row = reinterpret_cast<const Sample*>(aRow);
+    const size_t values = size_t(1) << (8 * sizeof(Sample));
+
+    if (sizeof(Sample) == 1) {
+        size_t i = 0;
+        for (; i + kSubHistograms <= aPixelsCount; i += kSubHistograms, row += kSubHistograms * aChannels) {
+            for (size_t c = 0; c < aChannels; ++c) {
+                uint32_t* bins = aBins + c * kSubHistograms * values;
+                for (size_t j = 0; j < kSubHistograms; ++j)
+                    ++bins[j * values + row[j * aChannels + c]];
+            }
+        }
+        for (; i < aPixelsCount; ++i, row += aChannels) {
+            for (size_t c = 0; c < aChannels; ++c)
+                ++aBins[c * kSubHistograms * values + row[c]];
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < aPixelsCount; ++i, row += aChannels) {
+        for (size_t c = 0; c < aChannels; ++c)
+            ++aBins[c * values + row[c]];
+    }
+}
+
+} // namespace
+
+std::vector<Image::ChannelStatistics> channelStatistics(const uint8_t* aData,
+                                                       size_t aStride,
+                                                       size_t aPixelsCount,
+                                                       size_t aRowsCount,
+                                                       size_t aChannels,
+                                                       ColorSpec::ChannelDepth aChannelDepth,
+                                                       unsigned int aThreadsCount)
+{
+    std::vector<Image::ChannelStatistics> statistics(aChannels, Image::ChannelStatistics{0, 0, 0.0});
+    if ((aPixelsCount == 0) || (aRowsCount == 0))
+        return statistics;
+
+    StatisticsFunction accumulate = statisticsFunction(aChannels, aChannelDepth);
+    if (!accumulate)
+        throw NotImplementedException("Not implemented.");
+
+    size_t rowSize = aPixelsCount * aChannels * ((aChannelDepth == ColorSpec::ChannelDepth::k16Bit) ? 2 : 1);
+    StatisticsAccumulator total;
+    std::mutex mutex;
+    parallelForRows(aRowsCount, rowSize, aThreadsCount, [&](size_t aBegin, size_t aEnd) {
+        StatisticsAccumulator band;
+        for (size_t y = aBegin; y < aEnd; ++y)
+            accumulate(aData + y * aStride, aPixelsCount, band);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        total.merge(band);
+    });
+
+    double samples = static_cast<double>(aPixelsCount) * aRowsCount;
+    for (size_t c = 0; c < aChannels; ++c) {
+        statistics[c].minimum = total.minimum[c];
+        statistics[c].maximum = total.maximum[c];
+        statistics[c].mean = total.sums[c] / samples;
+    }
+    return statistics;
+}
+
+std::vector<std::vector<uint64_t>> channelHistograms(const uint8_t* aData,
+                                                     size_t aStride,
+                                                     size_t aPixelsCount,
+                                                     size_t aRowsCount,
+                                                     size_t aChannels,
+                                                     ColorSpec::ChannelDepth aChannelDepth,
+                                                     unsigned int aThreadsCount)
+{
+    bool is16Bit = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+    size_t values = is16Bit ? 65536 : 256;
+    size_t subHistograms = is16Bit ? 1 : kSubHistograms;
+    std::vector<std::vector<uint64_t>> histograms(aChannels, std::vector<uint64_t>(values, 0));
+    std::mutex mutex;
+
+    size_t rowSize = aPixelsCount * aChannels * (is16Bit ? 2 : 1);
+    parallelForRows(aRowsCount, rowSize, aThreadsCount, [&](size_t aBegin, size_t aEnd) {
+        std::vector<uint32_t> bins(aChannels * subHistograms * values, 0);
+        std::vector<uint64_t> counts(aChannels * values, 0);
+        auto flush = [&]() {
+            for (size_t c = 0; c < aChannels; ++c) {
+                for (size_t j = 0; j < subHistograms; ++j) {
+                    uint32_t* sub = bins.data() + (c * subHistograms + j) * values;
+                    for (size_t v = 0; v < values; ++v)
+                        counts[c * values + v] += sub[v];
+                }
+            }
+            std::fill(bins.begin(), bins.end(), 0);
+        };
+
+        size_t counted = 0;
+        for (size_t y = aBegin; y < aEnd; ++y) {
+            if (counted + aPixelsCount > kMaxCountedPixels) {
+                flush();
+                counted = 0;
+            }
+            if (is16Bit)
+                countSamples<uint16_t>(aData + y * aStride, aPixelsCount, aChannels, bins.data());
+            else
+                countSamples<uint8_t>(aData + y * aStride, aPixelsCount, aChannels, bins.data());
+            counted += aPixelsCount;
+        }
+        flush();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t c = 0; c < aChannels; ++c) {
+            for (size_t v = 0; v < values; ++v)
+                histograms[c][v] += counts[c * values + v];
+        }
+    });
+
+    return histograms;
+}
+
+bool opaqueRows(const uint8_t* aData,
+                size_t aStride,
+                size_t aPixelsCount,
+                size_t aRowsCount,
+                ColorSpec::Format aFormat,
+                ColorSpec::ChannelDepth aChannelDepth,
+                const Palette& aPalette,
+                unsigned int aThreadsCount)
+{
+    std::atomic<bool> opaque(true);
+
+    // Indices past the end of the palette are opaque black
+    if (aFormat == ColorSpec::Format::kIndexed) {
+        bool transparent[256] = {};
+        bool anyTransparent = false;
+        for (size_t i = 0; i < aPalette.size(); ++i) {
+            transparent[i] = (aPalette[i].a != 0xff);
+            anyTransparent = anyTransparent || transparent[i];
+        }
+        if (!anyTransparent)
+            return true;
+
+        parallelForRows(aRowsCount, aPixelsCount, aThreadsCount, [&](size_t aBegin, size_t aEnd) {
+            for (size_t y = aBegin; (y < aEnd) && opaque.load(std::memory_order_relaxed); ++y) {
+                const uint8_t* row = aData + y * aStride;
+                bool any = false;
+                for (size_t x = 0; x < aPixelsCount; ++x)
+                    any |= transparent[row[x]];
+                if (any)
+                    opaque.store(false, std::memory_order_relaxed);
+            }
+        });
+        return opaque.load();
+    }
+
+    OpaqueFunction isOpaque = opaqueFunction(aFormat, aChannelDepth);
+    if (!isOpaque)
+        return true;
+
+    size_t rowSize = aPixelsCount * ColorSpec::pixelSize(aFormat, aChannelDepth);
+    parallelForRows(aRowsCount, rowSize, aThreadsCount, [&](size_t aBegin, size_t aEnd) {
+        for (size_t y = aBegin; (y < aEnd) && opaque.load(std::memory_order_relaxed); ++y) {
+            if (!isOpaque(aData + y * aStride, aPixelsCount))
+                opaque.store(false, std::memory_order_relaxed);
+        }
+    });
+    return opaque.load();
+}
+
+} // namespace ImgIO
+
+// EOF
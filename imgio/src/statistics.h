@@ -0,0 +1,170 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef _STATISTICS_H__
+#define _STATISTICS_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <imgio/image.h>
+#include <imgio/simd.h>
+
+namespace ImgIO
+{
+
+/**
+ * Per channel sums and extremes of the samples seen so far.
+ */
+struct StatisticsAccumulator
+{
+    StatisticsAccumulator()
+    {
+        for (size_t c = 0; c < 4; ++c) {
+            sums[c] = 0;
+            minimum[c] = 0xffff;
+            maximum[c] = 0;
+        }
+    }
+
+    void merge(const StatisticsAccumulator& aOther)
+    {
+        for (size_t c = 0; c < 4; ++c) {
+            sums[c] += aOther.sums[c];
+            minimum[c] = std::min(minimum[c], aOther.minimum[c]);
+            maximum[c] = std::max(maximum[c], aOther.maximum[c]);
+        }
+    }
+
+    uint64_t sums[4];
+    uint16_t minimum[4];
+    uint16_t maximum[4];
+};
+
+/**
+ * Adds the samples of a row of aPixelsCount pixels to aStatistics.
+ */
+typedef void (*StatisticsFunction)(const uint8_t* aRow, size_t aPixelsCount, StatisticsAccumulator& aStatistics);
+
+/**
+ * Returns whether the alpha of all aPixelsCount pixels of a row is at its maximum.
+ */
+typedef bool (*OpaqueFunction)(const uint8_t* aRow, size_t aPixelsCount);
+
+template <typename Sample, size_t kChannels>
+void accumulateStatistics(const uint8_t* aRow, size_t aPixelsCount, StatisticsAccumulator& aStatistics)
+{
+    const Sample* row = reinterpret_cast<const Sample*>(aRow);
+    for (size_t c = 0; c < kChannels; ++c) {
+        uint64_t sum = 0;
+        Sample minimum = aStatistics.minimum[c];
+        Sample maximum = aStatistics.maximum[c];
+        for (size_t i = c; i < aPixelsCount * kChannels; i += kChannels) {
+            sum += row[i];
+            minimum = std::min(minimum, row[i]);
+            maximum = std::max(maximum, row[i]);
+        }
+        aStatistics.sums[c] += sum;
+        aStatistics.minimum[c] = minimum;
+        aStatistics.maximum[c] = maximum;
+    }
+}
+
+template <typename Sample, size_t kChannels>
+bool isOpaqueRow(const uint8_t* aRow, size_t aPixelsCount)
+{
+    const Sample* alpha = reinterpret_cast<const Sample*>(aRow) + kChannels - 1;
+    Sample all = static_cast<Sample>(~Sample(0));
+    for (size_t i = 0; i < aPixelsCount; ++i, alpha += kChannels)
+        all &= *alpha;
+    return all == static_cast<Sample>(~Sample(0));
+}
+
+/**
+ * Returns the statistics kernel for the current Simd::level().
+ * @return Statistics function or nullptr for unsupported layouts.
+ */
+StatisticsFunction statisticsFunction(size_t aChannels, ColorSpec::ChannelDepth aChannelDepth);
+
+/**
+ * Returns the vectorized statistics kernel for the given instruction set level.
+ * @return Statistics function or nullptr, when the level has none.
+ */
+StatisticsFunction simdStatisticsFunction(Simd::Level aLevel, size_t aChannels, ColorSpec::ChannelDepth aChannelDepth);
+
+/**
+ * Returns the alpha scan kernel for the current Simd::level(), for
+ * formats with alpha as their last channel.
+ * @return Scan function or nullptr for formats without alpha.
+ */
+OpaqueFunction opaqueFunction(ColorSpec::Format aFormat, ColorSpec::ChannelDepth aChannelDepth);
+
+/**
+ * Returns the vectorized alpha scan kernel for the given instruction set level.
+ * @return Scan function or nullptr, when the level has none.
+ */
+OpaqueFunction simdOpaqueFunction(Simd::Level aLevel, size_t aChannels, ColorSpec::ChannelDepth aChannelDepth);
+
+/**
+ * Computes the statistics of each channel of aRowsCount rows of aPixelsCount pixels.
+ */
+std::vector<Image::ChannelStatistics> channelStatistics(const uint8_t* aData,
+                                                       size_t aStride,
+                                                       size_t aPixelsCount,
+                                                       size_t aRowsCount,
+                                                       size_t aChannels,
+                                                       ColorSpec::ChannelDepth aChannelDepth,
+                                                       unsigned int aThreadsCount);
+
+/**
+ * Counts the samples of each value in each channel of aRowsCount rows of
+ * aPixelsCount pixels.
+ */
+std::vector<std::vector<uint64_t>> channelHistograms(const uint8_t* aData,
+                                                     size_t aStride,
+                                                     size_t aPixelsCount,
+                                                     size_t aRowsCount,
+                                                     size_t aChannels,
+                                                     ColorSpec::ChannelDepth aChannelDepth,
+                                                     unsigned int aThreadsCount);
+
+/**
+ * Returns whether all pixels of aRowsCount rows have their alpha at its
+ * maximum, stopping at the first row with one that doesn't. Formats
+ * without alpha are opaque, indices of kIndexed rows are looked up in aPalette.
+ */
+bool opaqueRows(const uint8_t* aData,
+                size_t aStride,
+                size_t aPixelsCount,
+                size_t aRowsCount,
+                ColorSpec::Format aFormat,
+                ColorSpec::ChannelDepth aChannelDepth,
+                const Palette& aPalette,
+                unsigned int aThreadsCount);
+
+} // namespace ImgIO
+
+#endif // _STATISTICS_H__
+// EOF
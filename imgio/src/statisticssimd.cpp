@@ -0,0 +1,273 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "statistics.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMGIO_X86_SIMD
+#include <immintrin.h>
+#endif
+
+
+namespace ImgIO
+{
+
+#ifdef IMGIO_X86_SIMD
+
+#define IMGIO_TARGET_SSE2 __attribute__((target("sse2")))
+#define IMGIO_TARGET_AVX2 __attribute__((target("avx2")))
+
+namespace
+{
+
+// Alpha scans AND whole vectors together and check them every kScanBytes.
+const size_t kScanBytes = 256;
+
+// Partial sums in 16 bit lanes take up to 256 samples of 8 bits each.
+const size_t kChunkBlocks = 256;
+
+IMGIO_TARGET_SSE2 inline __m128i load128(const void* aSrc)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc));
+}
+
+//
+// Statistics. Blocks of whole pixels and whole vectors, one vector or
+// three for pixels of 3 and 6 bytes, keep each lane on one channel. Lanes
+// collect extremes for the whole row and sums for chunks of blocks, in
+// lanes twice as wide. 16 bit samples are biased for signed comparisons.
+//
+
+template <typename Sample, size_t kChannels>
+IMGIO_TARGET_SSE2 void accumulateStatisticsSSE2(const uint8_t* aRow, size_t aPixelsCount, StatisticsAccumulator& aStatistics)
+{
+    const size_t kPixelSize = kChannels * sizeof(Sample);
+    const size_t kPhases = (kPixelSize % 3) ? 1 : 3;
+    const size_t kLanes = 16 / sizeof(Sample);
+    const size_t kBlockPixels = 16 * kPhases / kPixelSize;
+    const bool is16Bit = (sizeof(Sample) == 2);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16(-0x8000);
+
+    __m128i minimum[kPhases];
+    __m128i maximum[kPhases];
+    for (size_t k = 0; k < kPhases; ++k) {
+        minimum[k] = is16Bit ? _mm_set1_epi16(0x7fff) : _mm_set1_epi8(-1);
+        maximum[k] = is16Bit ? bias : zero;
+    }
+
+    uint64_t laneSums[kPhases * kLanes] = {};
+    size_t blocks = aPixelsCount / kBlockPixels;
+    const uint8_t* src = aRow;
+    for (size_t chunk = 0; chunk < blocks; chunk += kChunkBlocks) {
+        size_t end = std::min(blocks, chunk + kChunkBlocks);
+        __m128i sumLow[kPhases];
+        __m128i sumHigh[kPhases];
+        for (size_t k = 0; k < kPhases; ++k) {
+            sumLow[k] = zero;
+            sumHigh[k] = zero;
+        }
+
+        for (size_t b = chunk; b < end; ++b) {
+            for (size_t k = 0; k < kPhases; ++k, src += 16) {
+                __m128i value = load128(src);
+                if (is16Bit) {
+                    __m128i biased = _mm_xor_si128(value, bias);
+                    minimum[k] = _mm_min_epi16(minimum[k], biased);
+                    maximum[k] = _mm_max_epi16(maximum[k], biased);
+                    sumLow[k] = _mm_add_epi32(sumLow[k], _mm_unpacklo_epi16(value, zero));
+                    sumHigh[k] = _mm_add_epi32(sumHigh[k], _mm_unpackhi_epi16(value, zero));
+                } else {
+                    minimum[k] = _mm_min_epu8(minimum[k], value);
+                    maximum[k] = _mm_max_epu8(maximum[k], value);
+                    sumLow[k] = _mm_add_epi16(sumLow[k], _mm_unpacklo_epi8(value, zero));
+                    sumHigh[k] = _mm_add_epi16(sumHigh[k], _mm_unpackhi_epi8(value, zero));
+                }
+            }
+        }
+
+        for (size_t k = 0; k < kPhases; ++k) {
+            uint64_t* sums = laneSums + k * kLanes;
+            if (is16Bit) {
+                alignas(16) uint32_t low[4];
+                alignas(16) uint32_t high[4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(low), sumLow[k]);
+                _mm_store_si128(reinterpret_cast<__m128i*>(high), sumHigh[k]);
+                for (size_t i = 0; i < 4; ++i) {
+                    sums[i] += low[i];
+                    sums[4 + i] += high[i];
+                }
+            } else {
+                alignas(16) uint16_t low[8];
+                alignas(16) uint16_t high[8];
+                _mm_store_si128(reinterpret_cast<__m128i*>(low), sumLow[k]);
+                _mm_store_si128(reinterpret_cast<__m128i*>(high), sumHigh[k]);
+                for (size_t i = 0; i < 8; ++i) {
+                    sums[i] += low[i];
+                    sums[8 + i] += high[i];
+                }
+            }
+        }
+    }
+
+    // Sample i of a block belongs to channel i % kChannels
+    for (size_t k = 0; k < kPhases; ++k) {
+        alignas(16) Sample minimumLanes[kLanes];
+        alignas(16) Sample maximumLanes[kLanes];
+        _mm_store_si128(reinterpret_cast<__m128i*>(minimumLanes), is16Bit ? _mm_xor_si128(minimum[k], bias) : minimum[k]);
+        _mm_store_si128(reinterpret_cast<__m128i*>(maximumLanes), is16Bit ? _mm_xor_si128(maximum[k], bias) : maximum[k]);
+        for (size_t i = 0; i < kLanes; ++i) {
+            size_t channel = (k * kLanes + i) % kChannels;
+            aStatistics.sums[channel] += laneSums[k * kLanes + i];
+            aStatistics.minimum[channel] = std::min<uint16_t>(aStatistics.minimum[channel], minimumLanes[i]);
+            aStatistics.maximum[channel] = std::max<uint16_t>(aStatistics.maximum[channel], maximumLanes[i]);
+        }
+    }
+
+    accumulateStatistics<Sample, kChannels>(src, aPixelsCount - blocks * kBlockPixels, aStatistics);
+}
+
+//
+// Alpha scans. Color bytes are set to ones, so a vector of opaque pixels
+// ANDs to all ones. Pixels of 2, 4 and 8 bytes keep their place in vectors.
+//
+
+template <typename Sample, size_t kChannels, size_t kVectorSize>
+struct ColorBytes
+{
+    ColorBytes()
+    {
+        const size_t kPixelSize = kChannels * sizeof(Sample);
+        for (size_t j = 0; j < kVectorSize; ++j)
+            bytes[j] = ((j % kPixelSize) < kPixelSize - sizeof(Sample)) ? 0xff : 0;
+    }
+
+    alignas(32) uint8_t bytes[kVectorSize];
+};
+
+template <typename Sample, size_t kChannels>
+IMGIO_TARGET_SSE2 bool isOpaqueSSE2(const uint8_t* aRow, size_t aPixelsCount)
+{
+    static const ColorBytes<Sample, kChannels, 16> colorBytes;
+    const __m128i colors = load128(colorBytes.bytes);
+    const __m128i ones = _mm_set1_epi8(-1);
+
+    size_t bytes = aPixelsCount * kChannels * sizeof(Sample);
+    size_t vectorBytes = bytes & ~size_t(15);
+    size_t i = 0;
+    while (i < vectorBytes) {
+        size_t end = std::min(vectorBytes, i + kScanBytes);
+        __m128i all = ones;
+        for (; i < end; i += 16)
+            all = _mm_and_si128(all, load128(aRow + i));
+        all = _mm_or_si128(all, colors);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(all, ones)) != 0xffff)
+            return false;
+    }
+    return isOpaqueRow<Sample, kChannels>(aRow + i, (bytes - i) / (kChannels * sizeof(Sample)));
+}
+
+template <typename Sample, size_t kChannels>
+IMGIO_TARGET_AVX2 bool isOpaqueAVX2(const uint8_t* aRow, size_t aPixelsCount)
+{
+    static const ColorBytes<Sample, kChannels, 32> colorBytes;
+    const __m256i colors = _mm256_load_si256(reinterpret_cast<const __m256i*>(colorBytes.bytes));
+    const __m256i ones = _mm256_set1_epi8(-1);
+
+    size_t bytes = aPixelsCount * kChannels * sizeof(Sample);
+    size_t vectorBytes = bytes & ~size_t(31);
+    size_t i = 0;
+    while (i < vectorBytes) {
+        size_t end = std::min(vectorBytes, i + kScanBytes);
+        __m256i all = ones;
+        for (; i < end; i += 32)
+            all = _mm256_and_si256(all, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aRow + i)));
+        all = _mm256_or_si256(all, colors);
+        if (static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(all, ones))) != 0xffffffffu)
+            return false;
+    }
+    return isOpaqueRow<Sample, kChannels>(aRow + i, (bytes - i) / (kChannels * sizeof(Sample)));
+}
+
+} // namespace
+
+StatisticsFunction simdStatisticsFunction(Simd::Level aLevel, size_t aChannels, ColorSpec::ChannelDepth aChannelDepth)
+{
+    // There are no AVX2 specific kernels, the scan is bound by memory.
+    if (aLevel < Simd::Level::kSSE2)
+        return nullptr;
+
+    bool is16Bit = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+    switch (aChannels) {
+    case 1:
+        return is16Bit ? accumulateStatisticsSSE2<uint16_t, 1> : accumulateStatisticsSSE2<uint8_t, 1>;
+    case 2:
+        return is16Bit ? accumulateStatisticsSSE2<uint16_t, 2> : accumulateStatisticsSSE2<uint8_t, 2>;
+    case 3:
+        return is16Bit ? accumulateStatisticsSSE2<uint16_t, 3> : accumulateStatisticsSSE2<uint8_t, 3>;
+    case 4:
+        return is16Bit ? accumulateStatisticsSSE2<uint16_t, 4> : accumulateStatisticsSSE2<uint8_t, 4>;
+    default:
+        return nullptr;
+    }
+}
+
+OpaqueFunction simdOpaqueFunction(Simd::Level aLevel, size_t aChannels, ColorSpec::ChannelDepth aChannelDepth)
+{
+    bool is16Bit = (aChannelDepth == ColorSpec::ChannelDepth::k16Bit);
+    if ((aChannels != 2) && (aChannels != 4))
+        return nullptr;
+
+    if (aLevel >= Simd::Level::kAVX2) {
+        if (aChannels == 2)
+            return is16Bit ? isOpaqueAVX2<uint16_t, 2> : isOpaqueAVX2<uint8_t, 2>;
+        return is16Bit ? isOpaqueAVX2<uint16_t, 4> : isOpaqueAVX2<uint8_t, 4>;
+    }
+
+    if (aLevel >= Simd::Level::kSSE2) {
+        if (aChannels == 2)
+            return is16Bit ? isOpaqueSSE2<uint16_t, 2> : isOpaqueSSE2<uint8_t, 2>;
+        return is16Bit ? isOpaqueSSE2<uint16_t, 4> : isOpaqueSSE2<uint8_t, 4>;
+    }
+
+    return nullptr;
+}
+
+#else // IMGIO_X86_SIMD
+
+StatisticsFunction simdStatisticsFunction(Simd::Level aLevel, size_t aChannels, ColorSpec::ChannelDepth aChannelDepth)
+{
+    return nullptr;
+}
+
+OpaqueFunction simdOpaqueFunction(Simd::Level aLevel, size_t aChannels, ColorSpec::ChannelDepth aChannelDepth)
+{
+    return nullptr;
+}
+
+#endif // IMGIO_X86_SIMD
+
+} // namespace ImgIO
+
+// EOF
@@ -0,0 +1,204 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <imgio/parallelism.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include "threadpool.h"
+
+namespace ImgIO
+{
+
+// Bands smaller than this cost more in dispatch than they gain.
+static const size_t kMinBandBytes = 256 * 1024;
+
+static thread_local bool tIsWorker = false;
+
+struct ThreadPool::Batch
+{
+    const RangeFunction* function;
+    size_t count;
+    size_t rangeSize;
+    size_t rangesCount;
+    std::atomic<size_t> nextRange;
+    size_t activeHelpers;
+    std::exception_ptr error;
+};
+
+ThreadPool& ThreadPool::instance()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::ThreadPool()
+: mStopping(false)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWorkAvailable.notify_all();
+
+    for (auto& worker : mWorkers)
+        worker.join();
+}
+
+void ThreadPool::parallelFor(size_t aCount, size_t aGrain, unsigned int aThreadsCount, const RangeFunction& aFunction)
+{
+    if (aCount == 0)
+        return;
+
+    size_t rangesCount = std::min<size_t>(aCount / std::max<size_t>(aGrain, 1), aThreadsCount * 4);
+    if ((rangesCount <= 1) || (aThreadsCount <= 1) || tIsWorker) {
+        aFunction(0, aCount);
+        return;
+    }
+
+    size_t helpersCount = std::min<size_t>(aThreadsCount, rangesCount) - 1;
+
+    Batch batch;
+    batch.function = &aFunction;
+    batch.count = aCount;
+    batch.rangeSize = (aCount + rangesCount - 1) / rangesCount;
+    batch.rangesCount = (aCount + batch.rangeSize - 1) / batch.rangeSize;
+    batch.nextRange = 0;
+    batch.activeHelpers = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        startWorkers(helpersCount);
+        mBatches.insert(mBatches.end(), helpersCount, &batch);
+    }
+    mWorkAvailable.notify_all();
+
+    runBatch(batch);
+
+    // Entries nobody picked up must not outlive the batch, and helpers still
+    // running their last range must finish before it goes out of scope.
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mBatches.erase(std::remove(mBatches.begin(), mBatches.end(), &batch), mBatches.end());
+        mHelperFinished.wait(lock, [&batch] { return batch.activeHelpers == 0; });
+    }
+
+    if (batch.error)
+        std::rethrow_exception(batch.error);
+}
+
+void ThreadPool::startWorkers(size_t aCount)
+{
+    while (mWorkers.size() < aCount)
+        mWorkers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+void ThreadPool::workerLoop()
+{
+    tIsWorker = true;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mWorkAvailable.wait(lock, [this] { return mStopping || !mBatches.empty(); });
+        if (mStopping)
+            return;
+
+        Batch* batch = mBatches.front();
+        mBatches.pop_front();
+        ++batch->activeHelpers;
+
+        lock.unlock();
+        runBatch(*batch);
+        lock.lock();
+
+        if (--batch->activeHelpers == 0)
+            mHelperFinished.notify_all();
+    }
+}
+
+void ThreadPool::runBatch(Batch& aBatch)
+{
+    while (true) {
+        size_t range = aBatch.nextRange.fetch_add(1, std::memory_order_relaxed);
+        if (range >= aBatch.rangesCount)
+            return;
+
+        size_t begin = range * aBatch.rangeSize;
+        size_t end = std::min(begin + aBatch.rangeSize, aBatch.count);
+        try {
+            (*aBatch.function)(begin, end);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!aBatch.error)
+                aBatch.error = std::current_exception();
+        }
+    }
+}
+
+void parallelForRows(size_t aRowsCount,
+                     size_t aRowSize,
+                     unsigned int aThreadsCount,
+                     const ThreadPool::RangeFunction& aFunction)
+{
+    if (aThreadsCount == 0)
+        aThreadsCount = Parallelism::threadsCount();
+
+    if ((aThreadsCount <= 1) || (aRowsCount * aRowSize < Parallelism::kMinParallelBytes)) {
+        aFunction(0, aRowsCount);
+        return;
+    }
+
+    size_t grain = std::max<size_t>(kMinBandBytes / std::max<size_t>(aRowSize, 1), 1);
+    ThreadPool::instance().parallelFor(aRowsCount, grain, aThreadsCount, aFunction);
+}
+
+static std::atomic<unsigned int>& threadsCountStorage()
+{
+    static std::atomic<unsigned int> threadsCount(Parallelism::hardwareThreadsCount());
+    return threadsCount;
+}
+
+unsigned int Parallelism::threadsCount()
+{
+    return threadsCountStorage().load(std::memory_order_relaxed);
+}
+
+void Parallelism::setThreadsCount(unsigned int aThreadsCount)
+{
+    if (aThreadsCount == 0)
+        aThreadsCount = hardwareThreadsCount();
+    threadsCountStorage().store(aThreadsCount, std::memory_order_relaxed);
+}
+
+unsigned int Parallelism::hardwareThreadsCount()
+{
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+} // namespace ImgIO
+
+// EOF
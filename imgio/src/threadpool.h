@@ -0,0 +1,96 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining 
+// a copy of this software and associated documentation files (the 
+// "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, 
+// distribute, sublicense, and/or sell copies of the Software, and to 
+// permit persons to whom the Software is furnished to do so, subject to 
+// the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included 
+// in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _THREADPOOL_H__
+#define _THREADPOOL_H__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ImgIO
+{
+
+/**
+ * Pool of worker threads running parallel loops. Workers are started on
+ * demand and live until the library is unloaded.
+ */
+class ThreadPool
+{
+public:
+    typedef std::function<void(size_t aBegin, size_t aEnd)> RangeFunction;
+
+public:
+    static ThreadPool& instance();
+
+    ~ThreadPool();
+
+    /**
+     * Splits [0, aCount) into ranges of at least aGrain items and runs them
+     * on up to aThreadsCount threads, the calling one included. Returns when
+     * all ranges are done and rethrows the first exception thrown by aFunction.
+     * Loops started from inside a worker run on that worker only.
+     */
+    void parallelFor(size_t aCount, size_t aGrain, unsigned int aThreadsCount, const RangeFunction& aFunction);
+
+private:
+    struct Batch;
+
+private:
+    ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void startWorkers(size_t aCount);
+    void workerLoop();
+    void runBatch(Batch& aBatch);
+
+private:
+    std::mutex mMutex;
+    std::condition_variable mWorkAvailable;
+    std::condition_variable mHelperFinished;
+    std::deque<Batch*> mBatches;
+    std::vector<std::thread> mWorkers;
+    bool mStopping;
+}; // class ThreadPool
+
+/**
+ * Runs aFunction over bands of rows, in parallel when the image is large
+ * enough (see Parallelism::kMinParallelBytes).
+ * @param aRowsCount Number of rows.
+ * @param aRowSize Bytes read and written per row.
+ * @param aThreadsCount Threads count, 0 uses Parallelism::threadsCount().
+ * @param aFunction Function called with [begin, end) row ranges.
+ */
+void parallelForRows(size_t aRowsCount,
+                     size_t aRowSize,
+                     unsigned int aThreadsCount,
+                     const ThreadPool::RangeFunction& aFunction);
+
+} // namespace ImgIO
+
+#endif // _THREADPOOL_H__
+// EOF
@@ -0,0 +1,63 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef _CHECK_H__
+#define _CHECK_H__
+
+#include <cstdio>
+
+// Minimal assertions for the tests. A failed check is reported and the
+// test goes on, main() returns checkResult().
+
+static int sFailedChecks = 0;
+
+#define CHECK(aCondition)                                                            \
+    do {                                                                             \
+        if (!(aCondition)) {                                                         \
+            std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #aCondition); \
+            ++sFailedChecks;                                                         \
+        }                                                                            \
+    } while (false)
+
+#define CHECK_THROWS(aStatement)                  \
+    do {                                          \
+        bool thrown = false;                      \
+        try {                                     \
+            aStatement;                           \
+        } catch (...) {                           \
+            thrown = true;                        \
+        }                                         \
+        CHECK(thrown && #aStatement " throws");   \
+    } while (false)
+
+inline int checkResult()
+{
+    if (sFailedChecks > 0)
+        std::printf("%d checks failed\n", sFailedChecks);
+    return (sFailedChecks > 0) ? 1 : 0;
+}
+
+#endif // _CHECK_H__
+
+// EOF
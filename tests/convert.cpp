@@ -0,0 +1,78 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+// Conversions into existing images reuse their buffer and leave them
+// untouched when the conversion is not supported.
+
+#include <cstring>
+#include <vector>
+#include <imgio/image.h>
+
+#include "check.h"
+
+using namespace ImgIO;
+
+static void fill(Image& aImage, uint8_t aSeed)
+{
+    size_t rowSize = aImage.width() * ColorSpec::pixelSize(aImage.colorFormat(), aImage.colorChannelDepth());
+    for (unsigned int y = 0; y < aImage.height(); ++y)
+        for (size_t x = 0; x < rowSize; ++x)
+            aImage.data()[y * aImage.stride() + x] = static_cast<uint8_t>(aSeed + x + 3 * y);
+}
+
+int main()
+{
+    Image source(40, 30, ColorSpec::Format::kRGB);
+    fill(source, 0);
+
+    // A large enough buffer is reused
+    Image dest(50, 40, ColorSpec::Format::kRGBA);
+    const uint8_t* buffer = dest.data();
+    source.convertInto(dest);
+    CHECK((dest.width() == 40) && (dest.height() == 30));
+    CHECK(dest.colorFormat() == ColorSpec::Format::kRGBA);
+    CHECK(dest.data() == buffer);
+    CHECK((dest.data()[0] == source.data()[0]) && (dest.data()[3] == 255));
+    CHECK(dest.data()[dest.stride() + 4] == source.data()[source.stride() + 3]);
+
+    // An unsupported conversion throws before aDest changes
+    Image indexed(60, 50, ColorSpec::Format::kIndexed);
+    fill(indexed, 5);
+    std::vector<uint8_t> pixels(indexed.data(), indexed.data() + indexed.height() * indexed.stride());
+    buffer = indexed.data();
+    size_t stride = indexed.stride();
+    CHECK_THROWS(source.convertInto(indexed));
+    CHECK((indexed.width() == 60) && (indexed.height() == 50));
+    CHECK(indexed.colorFormat() == ColorSpec::Format::kIndexed);
+    CHECK((indexed.data() == buffer) && (indexed.stride() == stride));
+    CHECK(std::memcmp(indexed.data(), pixels.data(), pixels.size()) == 0);
+
+    // The same for a view that doesn't start at the buffer
+    Image view = Image(60, 50, ColorSpec::Format::kIndexed).cropped(10, 10, 20, 20);
+    buffer = view.data();
+    CHECK_THROWS(source.convertInto(view));
+    CHECK((view.width() == 20) && (view.height() == 20) && (view.data() == buffer));
+
+    return checkResult();
+}
@@ -0,0 +1,87 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+// Crops clip to the image, also for sizes that overflow when added to
+// the origin.
+
+#include <climits>
+#include <sstream>
+#include <imgio/image.h>
+#include <imgio/imageio.h>
+#include <imgio/pipeline.h>
+
+#include "check.h"
+
+using namespace ImgIO;
+
+static Image pattern(unsigned int aWidth, unsigned int aHeight)
+{
+    Image image(aWidth, aHeight, ColorSpec::Format::kMonochromatic);
+    for (unsigned int y = 0; y < aHeight; ++y)
+        for (unsigned int x = 0; x < aWidth; ++x)
+            image.data()[y * image.stride() + x] = static_cast<uint8_t>(x + 7 * y);
+    return image;
+}
+
+int main()
+{
+    const Image image = pattern(100, 50);
+
+    Image crop = image.cropped(10, 5, 20, 10);
+    CHECK((crop.width() == 20) && (crop.height() == 10));
+    CHECK(crop.data()[0] == static_cast<uint8_t>(10 + 7 * 5));
+
+    crop = image.cropped(10, 0, UINT_MAX, 10);
+    CHECK((crop.width() == 90) && (crop.height() == 10));
+    CHECK(crop.data()[0] == 10);
+
+    crop = image.cropped(0, 20, 10, UINT_MAX);
+    CHECK((crop.width() == 10) && (crop.height() == 30));
+    CHECK(crop.data()[0] == static_cast<uint8_t>(7 * 20));
+
+    crop = image.cropped(99, 49, UINT_MAX, UINT_MAX);
+    CHECK((crop.width() == 1) && (crop.height() == 1));
+    CHECK(crop.data()[0] == static_cast<uint8_t>(99 + 7 * 49));
+
+    CHECK(!image.cropped(100, 0, 10, 10).isValid());
+    CHECK(!image.cropped(0, 50, 10, 10).isValid());
+    CHECK(!image.cropped(UINT_MAX, UINT_MAX, UINT_MAX, UINT_MAX).isValid());
+    CHECK(!image.cropped(10, 10, 0, 10).isValid());
+
+    // Pipelines clip their crops the same way
+    std::ostringstream encoded;
+    ImageIO::write(image, encoded, ImageIO::ImageFormat::kPng);
+    for (bool leading : {true, false}) {
+        Pipeline pipeline;
+        if (!leading)
+            pipeline.convert(ColorSpec::Format::kMonochromatic);
+        pipeline.crop(10, 20, UINT_MAX, UINT_MAX);
+        std::istringstream input(encoded.str());
+        crop = pipeline.run(input, ImageIO::ImageFormat::kPng);
+        CHECK((crop.width() == 90) && (crop.height() == 30));
+        CHECK(crop.data()[0] == static_cast<uint8_t>(10 + 7 * 20));
+    }
+
+    return checkResult();
+}
@@ -0,0 +1,194 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+// GIF round trips through the encoder, and decoding of files from another
+// encoder (libgd) with an interlaced frame, a frame offset on the logical
+// screen, one clipped by it and several frames.
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <imgio/imageio.h>
+
+#include "check.h"
+
+using namespace ImgIO;
+
+// 7x11, interlaced, pixel (x, y) is index (x + 2 * y) % 5 of black, red,
+// green, blue and white
+static const uint8_t kInterlaced[] = {
+    0x47, 0x49, 0x46, 0x38, 0x37, 0x61, 0x07, 0x00, 0x0b, 0x00, 0xa2, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00,
+    0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x2c, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x0b, 0x00, 0x40, 0x03,
+    0x14, 0x08, 0x21, 0x43, 0xba, 0x4d, 0x31, 0x07, 0x09, 0x9d, 0x00, 0x43,
+    0x19, 0x2b, 0xf7, 0x0b, 0x47, 0x5d, 0x51, 0x37, 0x25, 0x00, 0x3b,
+};
+
+// 8x6 screen with a NETSCAPE2.0 loop. The first frame is 4x3 at (2, 1),
+// pixel (x, y) is index (x + y) % 4, transparent index 4. The second frame
+// covers the screen with index 3.
+static const uint8_t kAnimation[] = {
+    0x47, 0x49, 0x46, 0x38, 0x39, 0x61, 0x08, 0x00, 0x06, 0x00, 0xa2, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00,
+    0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x21, 0xff, 0x0b, 0x4e, 0x45, 0x54, 0x53, 0x43, 0x41, 0x50, 0x45,
+    0x32, 0x2e, 0x30, 0x03, 0x01, 0x00, 0x00, 0x00, 0x21, 0xf9, 0x04, 0x05,
+    0x0a, 0x00, 0x04, 0x00, 0x2c, 0x02, 0x00, 0x01, 0x00, 0x04, 0x00, 0x03,
+    0x00, 0x00, 0x03, 0x06, 0x08, 0x21, 0xb3, 0x03, 0x4c, 0x25, 0x00, 0x21,
+    0xf9, 0x04, 0x04, 0x0a, 0x00, 0xff, 0x00, 0x2c, 0x00, 0x00, 0x00, 0x00,
+    0x08, 0x00, 0x06, 0x00, 0x00, 0x03, 0x07, 0x38, 0xba, 0xdc, 0xfe, 0x30,
+    0xae, 0x04, 0x00, 0x3b,
+};
+
+// 8x6 screen, background index 0, with a 5x4 frame at (6, 3) that the
+// screen clips to 2x3. Pixel (x, y) of the frame is index (x * y) % 4.
+static const uint8_t kClipped[] = {
+    0x47, 0x49, 0x46, 0x38, 0x39, 0x61, 0x08, 0x00, 0x06, 0x00, 0xa2, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00,
+    0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x21, 0xf9, 0x04, 0x00, 0x00, 0x00, 0xff, 0x00, 0x2c, 0x06, 0x00,
+    0x03, 0x00, 0x05, 0x00, 0x04, 0x00, 0x00, 0x03, 0x0a, 0x08, 0xba, 0x21,
+    0xa3, 0x02, 0x44, 0x30, 0x44, 0x00, 0x09, 0x00, 0x3b,
+};
+
+static uint8_t pixel(const Image& aImage, unsigned int aX, unsigned int aY)
+{
+    return aImage.data()[aY * aImage.stride() + aX];
+}
+
+static bool sameIndices(const Image& aImage, const Image& aOther)
+{
+    if ((aImage.width() != aOther.width()) || (aImage.height() != aOther.height()))
+        return false;
+    for (unsigned int y = 0; y < aImage.height(); ++y) {
+        if (std::memcmp(aImage.data() + y * aImage.stride(), aOther.data() + y * aOther.stride(), aImage.width()) != 0)
+            return false;
+    }
+    return true;
+}
+
+static void checkRoundTrip(unsigned int aWidth, unsigned int aHeight, size_t aColorsCount, int aTransparentColor)
+{
+    Palette palette;
+    for (size_t i = 0; i < aColorsCount; ++i)
+        palette.push_back(PaletteColor{static_cast<uint8_t>(i * 7), static_cast<uint8_t>(255 - i), static_cast<uint8_t>(i * 13), 0xff});
+    if (aTransparentColor >= 0)
+        palette[aTransparentColor].a = 0;
+
+    Image image(aWidth, aHeight, ColorSpec::Format::kIndexed);
+    image.setPalette(palette);
+    for (unsigned int y = 0; y < aHeight; ++y)
+        for (unsigned int x = 0; x < aWidth; ++x)
+            image.data()[y * image.stride() + x] = static_cast<uint8_t>(std::rand() % aColorsCount);
+
+    std::ostringstream output;
+    ImageIO::write(image, output, ImageIO::ImageFormat::kGif);
+    const std::string encoded = output.str();
+    CHECK(encoded.compare(0, 6, "GIF89a") == 0);
+
+    std::istringstream input(encoded);
+    Image decoded = ImageIO::read(input, ImageIO::ImageFormat::kGif, ColorSpec::Format::kIndexed);
+    CHECK(sameIndices(decoded, image));
+    CHECK(decoded.palette().size() >= aColorsCount);
+    for (size_t i = 0; (i < aColorsCount) && (i < decoded.palette().size()); ++i) {
+        const PaletteColor& color = decoded.palette()[i];
+        CHECK((color.r == palette[i].r) && (color.g == palette[i].g) && (color.b == palette[i].b));
+        CHECK(color.a == palette[i].a);
+    }
+}
+
+int main()
+{
+    std::srand(1);
+
+    // Color maps of 2 to 256 entries, LZW codes up to 12 bits and table resets
+    const unsigned int sizes[][2] = {{1, 1}, {17, 5}, {300, 200}, {1000, 700}};
+    const size_t colorsCounts[] = {1, 2, 3, 16, 17, 256};
+    for (const auto& size : sizes) {
+        for (size_t colorsCount : colorsCounts) {
+            checkRoundTrip(size[0], size[1], colorsCount, -1);
+            checkRoundTrip(size[0], size[1], colorsCount, static_cast<int>(colorsCount / 2));
+        }
+    }
+
+    // The transparent index becomes alpha, indices past the color map leave
+    // the source as it was
+    Image image(4, 2, ColorSpec::Format::kIndexed);
+    image.setPalette(Palette{{255, 0, 0, 0xff}, {0, 255, 0, 0}, {0, 0, 255, 0xff}});
+    const uint8_t indices[] = {0, 1, 2, 1, 2, 0, 1, 9};
+    for (int i = 0; i < 8; ++i)
+        image.data()[(i / 4) * image.stride() + i % 4] = indices[i];
+    std::ostringstream output;
+    ImageIO::write(image, output, ImageIO::ImageFormat::kGif);
+    CHECK(pixel(image, 3, 1) == 9);
+    Image rgba = ImageIO::read(reinterpret_cast<const uint8_t*>(output.str().data()), output.str().size(),
+                               ImageIO::ImageFormat::kGif, ColorSpec::Format::kRGBA);
+    CHECK((rgba.width() == 4) && (rgba.height() == 2) && (rgba.colorFormat() == ColorSpec::Format::kRGBA));
+    CHECK((rgba.data()[0] == 255) && (rgba.data()[3] == 0xff));
+    CHECK((rgba.data()[4 + 1] == 255) && (rgba.data()[4 + 3] == 0));
+    CHECK(rgba.data()[rgba.stride() + 8 + 3] == 0);
+
+    // Interlaced rows come in four passes
+    Image decoded = ImageIO::read(kInterlaced, sizeof(kInterlaced), ImageIO::ImageFormat::kGif, ColorSpec::Format::kIndexed);
+    CHECK((decoded.width() == 7) && (decoded.height() == 11));
+    bool interlacedMatches = true;
+    for (unsigned int y = 0; y < 11; ++y)
+        for (unsigned int x = 0; x < 7; ++x)
+            interlacedMatches = interlacedMatches && (pixel(decoded, x, y) == (x + 2 * y) % 5);
+    CHECK(interlacedMatches);
+    CHECK((decoded.palette().size() == 8) && (decoded.palette()[1].r == 255) && (decoded.palette()[1].a == 0xff));
+
+    // Only the first frame is decoded, at its offset, with the transparent
+    // color of its control extension around it
+    decoded = ImageIO::read(kAnimation, sizeof(kAnimation), ImageIO::ImageFormat::kGif, ColorSpec::Format::kIndexed);
+    CHECK((decoded.width() == 8) && (decoded.height() == 6));
+    bool animationMatches = true;
+    for (unsigned int y = 0; y < 6; ++y) {
+        for (unsigned int x = 0; x < 8; ++x) {
+            bool inside = (x >= 2) && (x < 6) && (y >= 1) && (y < 4);
+            animationMatches = animationMatches && (pixel(decoded, x, y) == (inside ? (x - 2 + y - 1) % 4 : 4));
+        }
+    }
+    CHECK(animationMatches);
+    CHECK((decoded.palette()[4].a == 0) && (decoded.palette()[3].a == 0xff));
+
+    // Frames are clipped to the screen, the rest is the background color
+    decoded = ImageIO::read(kClipped, sizeof(kClipped), ImageIO::ImageFormat::kGif, ColorSpec::Format::kIndexed);
+    CHECK((decoded.width() == 8) && (decoded.height() == 6));
+    bool clippedMatches = true;
+    for (unsigned int y = 0; y < 6; ++y) {
+        for (unsigned int x = 0; x < 8; ++x) {
+            bool inside = (x >= 6) && (y >= 3);
+            clippedMatches = clippedMatches && (pixel(decoded, x, y) == (inside ? ((x - 6) * (y - 3)) % 4 : 0));
+        }
+    }
+    CHECK(clippedMatches);
+
+    // Truncated data throws
+    CHECK_THROWS(ImageIO::read(kAnimation, 60, ImageIO::ImageFormat::kGif, ColorSpec::Format::kIndexed));
+
+    return checkResult();
+}
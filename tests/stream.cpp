@@ -0,0 +1,104 @@
+//
+// Copyright 2017 Ireneusz Kapica.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+// Decoding leaves a stream right after the image, so images stored back
+// to back are read in sequence.
+
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <imgio/imageio.h>
+#include <imgio/pipeline.h>
+
+#include "check.h"
+
+using namespace ImgIO;
+
+static Image pattern(unsigned int aWidth, unsigned int aHeight, uint8_t aSeed)
+{
+    Image image(aWidth, aHeight, ColorSpec::Format::kRGB);
+    for (unsigned int y = 0; y < aHeight; ++y)
+        for (unsigned int x = 0; x < 3 * aWidth; ++x)
+            image.data()[y * image.stride() + x] = static_cast<uint8_t>(aSeed + x * y);
+    return image;
+}
+
+static std::string encode(const Image& aImage, ImageIO::ImageFormat aImageFormat)
+{
+    std::ostringstream output;
+    ImageIO::write(aImage, output, aImageFormat);
+    return output.str();
+}
+
+static bool samePixels(const Image& aImage, const Image& aOther)
+{
+    if ((aImage.width() != aOther.width()) || (aImage.height() != aOther.height()) ||
+        (aImage.colorFormat() != aOther.colorFormat()))
+        return false;
+    size_t rowSize = aImage.width() * ColorSpec::pixelSize(aImage.colorFormat(), aImage.colorChannelDepth());
+    for (unsigned int y = 0; y < aImage.height(); ++y) {
+        if (std::memcmp(aImage.data() + y * aImage.stride(), aOther.data() + y * aOther.stride(), rowSize) != 0)
+            return false;
+    }
+    return true;
+}
+
+int main()
+{
+    const Image first = pattern(300, 200, 0);
+    const Image second = pattern(120, 90, 77);
+    const std::string png = encode(first, ImageIO::ImageFormat::kPng);
+    const std::string nextPng = encode(second, ImageIO::ImageFormat::kPng);
+
+    // Whole images, with and without the orientation applied
+    for (bool applyOrientation : {false, true}) {
+        std::istringstream input(png + nextPng + png);
+        Image image = ImageIO::read(input, ImageIO::ImageFormat::kPng, ColorSpec::Format::kRGB,
+                                    ColorSpec::ChannelDepth::k8Bit, applyOrientation);
+        CHECK(samePixels(image, first));
+        CHECK(static_cast<size_t>(input.tellg()) == png.size());
+        image = ImageIO::read(input, ImageIO::ImageFormat::kPng, ColorSpec::Format::kRGB,
+                              ColorSpec::ChannelDepth::k8Bit, applyOrientation);
+        CHECK(samePixels(image, second));
+        CHECK(static_cast<size_t>(input.tellg()) == png.size() + nextPng.size());
+        image = ImageIO::read(input, ImageIO::ImageFormat::kPng, ColorSpec::Format::kRGB);
+        CHECK(samePixels(image, first));
+    }
+
+    // Pipelines stop decoding rows below a crop, still they read up to the end
+    const unsigned int crops[][4] = {{0, 0, 300, 200}, {10, 0, 100, 50}, {0, 150, 300, 50}, {300, 0, 10, 10}};
+    for (const auto& crop : crops) {
+        std::istringstream input(png + nextPng);
+        Pipeline pipeline;
+        pipeline.crop(crop[0], crop[1], crop[2], crop[3]);
+        Image image = pipeline.run(input, ImageIO::ImageFormat::kPng);
+        CHECK(static_cast<size_t>(input.tellg()) == png.size());
+        if (image.isValid())
+            CHECK(samePixels(image.convertedTo(ColorSpec::Format::kRGB), first.cropped(crop[0], crop[1], crop[2], crop[3])));
+        image = ImageIO::read(input, ImageIO::ImageFormat::kPng, ColorSpec::Format::kRGB);
+        CHECK(samePixels(image, second));
+    }
+
+    return checkResult();
+}